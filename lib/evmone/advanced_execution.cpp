@@ -5,6 +5,7 @@
 #include "advanced_execution.hpp"
 #include "advanced_analysis.hpp"
 #include "eof.hpp"
+#include "vm.hpp"
 #include <memory>
 
 namespace evmone::advanced
@@ -35,11 +36,18 @@ evmc_result execute(AdvancedExecutionState& state, const AdvancedCodeAnalysis& a
     }
 
     assert(state.output_size != 0 || state.output_offset == 0);
+#if EVMONE_MEMORY_COUNTERS
+    if (state.output_size != 0)
+    {
+        count_memory(&MemoryCounters::output_allocs);
+        count_memory(&MemoryCounters::bytes_copied, state.output_size);
+    }
+#endif
     return evmc::make_result(state.status, gas_left, gas_refund, storage_gas_consumed, storage_gas_refund, speculative_cpu_gas_consumed,
         state.memory.data() + state.output_offset, state.output_size);
 }
 
-evmc_result execute(evmc_vm* /*unused*/, const evmc_host_interface* host, evmc_host_context* ctx,
+evmc_result execute(evmc_vm* c_vm, const evmc_host_interface* host, evmc_host_context* ctx,
     evmc_revision rev, const evmc_message* msg, const uint8_t* code, size_t code_size) noexcept
 {
     AdvancedCodeAnalysis analysis;
@@ -59,6 +67,21 @@ evmc_result execute(evmc_vm* /*unused*/, const evmc_host_interface* host, evmc_h
     else
         analysis = analyze(rev, container);
     auto state = std::make_unique<AdvancedExecutionState>(*msg, rev, *host, ctx, container);
+
+#if not defined(ANTELOPE)
+    auto* const contract_stats =
+        c_vm != nullptr ? static_cast<VM*>(c_vm)->get_contract_stats() : nullptr;
+    if (INTX_LIKELY(contract_stats == nullptr))
+        return execute(*state, analysis);
+
+    const auto stats_execution = ContractStatsRegistry::begin();
+    const auto result = execute(*state, analysis);
+    contract_stats->end(stats_execution, state->host, *msg, container, msg->gas - result.gas_left,
+        state->memory.size());
+    return result;
+#else
+    (void)c_vm;
     return execute(*state, analysis);
+#endif
 }
 }  // namespace evmone::advanced
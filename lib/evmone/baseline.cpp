@@ -275,8 +275,10 @@ int64_t dispatch(const CostTable& cost_table, ExecutionState& state, int64_t gas
 }
 
 #if EVMONE_CGOTO_SUPPORTED
-int64_t dispatch_cgoto(
-    const CostTable& cost_table, ExecutionState& state, int64_t gas, const uint8_t* code) noexcept
+/// The computed goto dispatch loop.
+/// If the handlers is not null, only the addresses of the opcode handlers are output there.
+int64_t dispatch_cgoto(const CostTable& cost_table, ExecutionState& state, int64_t gas,
+    const uint8_t* code, const void* const** handlers = nullptr) noexcept
 {
 #pragma GCC diagnostic ignored "-Wpedantic"
 
@@ -291,6 +293,12 @@ int64_t dispatch_cgoto(
     };
     static_assert(std::size(cgoto_table) == 256);
 
+    if (INTX_UNLIKELY(handlers != nullptr))
+    {
+        *handlers = cgoto_table;
+        return gas;
+    }
+
     const auto stack_bottom = state.stack_space.bottom();
 
     // Code iterator and stack top pointer for interpreter loop.
@@ -321,9 +329,8 @@ TARGET_OP_UNDEFINED:
     return gas;
 }
 #endif
-}  // namespace
 
-evmc_result execute(
+evmc_result execute_frame(
     const VM& vm, int64_t gas, ExecutionState& state, const CodeAnalysis& analysis) noexcept
 {
     state.analysis.baseline = &analysis;  // Assign code analysis for instruction implementations.
@@ -333,6 +340,16 @@ evmc_result execute(
     const auto& cost_table = get_baseline_cost_table(state.rev, analysis.eof_header.version);
 
     auto* tracer = vm.get_tracer();
+#if not defined(ANTELOPE)
+    // The tracers and their filter are only configurable outside the ANTELOPE build.
+    if (INTX_UNLIKELY(tracer != nullptr) &&
+        !vm.tracer_filter.matches(*state.msg, state.original_code))
+    {
+        // Execute the frame not selected by the filter without tracing.
+        tracer = nullptr;
+    }
+#endif
+    state.tracer = tracer;
     if (INTX_UNLIKELY(tracer != nullptr))
     {
         tracer->notify_execution_start(state.rev, *state.msg, analysis.executable_code);
@@ -366,6 +383,13 @@ evmc_result execute(
     }
 
     assert(state.output_size != 0 || state.output_offset == 0);
+#if EVMONE_MEMORY_COUNTERS
+    if (state.output_size != 0)
+    {
+        count_memory(&MemoryCounters::output_allocs);
+        count_memory(&MemoryCounters::bytes_copied, state.output_size);
+    }
+#endif
     const auto result = evmc::make_result(state.status, gas_left, gas_refund, storage_gas_consumed, storage_gas_refund, speculative_cpu_gas_consumed,
         state.output_size != 0 ? &state.memory[state.output_offset] : nullptr, state.output_size);
 
@@ -375,6 +399,44 @@ evmc_result execute(
     return result;
 }
 
+#if not defined(ANTELOPE)
+/// Executes the frame and records it in the per-contract statistics.
+/// Kept out of line so the execution without the statistics enabled stays unaffected.
+[[gnu::noinline]] evmc_result execute_with_stats(ContractStatsRegistry& contract_stats,
+    const VM& vm, int64_t gas, ExecutionState& state, const CodeAnalysis& analysis) noexcept
+{
+    const auto stats_execution = ContractStatsRegistry::begin();
+    const auto result = execute_frame(vm, gas, state, analysis);
+    contract_stats.end(stats_execution, state.host, *state.msg, state.original_code,
+        gas - result.gas_left, state.memory.size());
+    return result;
+}
+#endif
+}  // namespace
+
+evmc_result execute(
+    const VM& vm, int64_t gas, ExecutionState& state, const CodeAnalysis& analysis) noexcept
+{
+#if not defined(ANTELOPE)
+    if (auto* const contract_stats = vm.get_contract_stats();
+        INTX_UNLIKELY(contract_stats != nullptr))
+        return execute_with_stats(*contract_stats, vm, gas, state, analysis);
+#endif
+    return execute_frame(vm, gas, state, analysis);
+}
+
+const void* const* get_opcode_handlers() noexcept
+{
+#if EVMONE_CGOTO_SUPPORTED
+    const void* const* handlers = nullptr;
+    const auto state = std::make_unique<ExecutionState>();
+    dispatch_cgoto(get_baseline_cost_table(EVMC_FRONTIER, 0), *state, 0, nullptr, &handlers);
+    return handlers;
+#else
+    return nullptr;
+#endif
+}
+
 evmc_result execute(evmc_vm* c_vm, const evmc_host_interface* host, evmc_host_context* ctx,
     evmc_revision rev, const evmc_message* msg, const uint8_t* code, size_t code_size) noexcept
 {
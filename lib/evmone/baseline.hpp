@@ -60,5 +60,9 @@ evmc_result execute(evmc_vm* vm, const evmc_host_interface* host, evmc_host_cont
 EVMC_EXPORT evmc_result execute(
     const VM&, int64_t gas_limit, ExecutionState& state, const CodeAnalysis& analysis) noexcept;
 
+/// Returns the addresses of the opcode handlers (indexed by opcode) of the Baseline interpreter
+/// with the computed goto dispatch, or null if this dispatch is not supported.
+EVMC_EXPORT const void* const* get_opcode_handlers() noexcept;
+
 }  // namespace baseline
 }  // namespace evmone
@@ -0,0 +1,254 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "binary_trace.hpp"
+#include "execution_state.hpp"
+#include "instructions_traits.hpp"
+#include "tracing.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stack>
+#include <thread>
+
+namespace evmone
+{
+namespace
+{
+using namespace binary_trace;
+
+/// The lock-free ring buffer of bytes for a single producer and a single consumer.
+class RingBuffer
+{
+    static constexpr size_t capacity = size_t{1} << 22;
+
+    std::unique_ptr<uint8_t[]> m_data{new uint8_t[capacity]};
+
+    /// The total number of bytes written. Modified only by the producer.
+    alignas(64) std::atomic<uint64_t> m_write_pos{0};
+
+    /// The total number of bytes read. Modified only by the consumer.
+    alignas(64) std::atomic<uint64_t> m_read_pos{0};
+
+public:
+    /// Writes the bytes, waiting for the consumer if the buffer is full.
+    void write(const uint8_t* data, size_t size) noexcept
+    {
+        auto pos = m_write_pos.load(std::memory_order_relaxed);
+        while (size != 0)
+        {
+            const auto free = capacity - (pos - m_read_pos.load(std::memory_order_acquire));
+            if (free == 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            const auto offset = pos % capacity;
+            const auto n = std::min({size, static_cast<size_t>(free), capacity - offset});
+            std::memcpy(&m_data[offset], data, n);
+            data += n;
+            size -= n;
+            pos += n;
+            m_write_pos.store(pos, std::memory_order_release);
+        }
+    }
+
+    /// Reads up to the given number of bytes, returns the number of bytes read.
+    size_t read(uint8_t* out, size_t max_size) noexcept
+    {
+        const auto pos = m_read_pos.load(std::memory_order_relaxed);
+        const auto available = m_write_pos.load(std::memory_order_acquire) - pos;
+        const auto offset = pos % capacity;
+        const auto n = std::min({max_size, static_cast<size_t>(available), capacity - offset});
+        std::memcpy(out, &m_data[offset], n);
+        m_read_pos.store(pos + n, std::memory_order_release);
+        return n;
+    }
+};
+
+/// @see create_binary_tracer()
+class BinaryTracer : public Tracer
+{
+    struct Context
+    {
+        const uint8_t* const code;  ///< Reference to the code being executed.
+        uint32_t pc = 0;
+        uint8_t opcode = 0;
+        int64_t gas;
+        size_t memory_size = 0;
+        std::vector<intx::uint256> stack;  ///< The stack at the previous instruction.
+        std::vector<uint8_t> memory;       ///< The memory at the previous instruction if traced.
+
+        Context(const uint8_t* c, int64_t g) noexcept : code{c}, gas{g} {}
+    };
+
+    const bool m_trace_memory;
+    std::FILE* const m_file;
+    std::stack<Context> m_contexts;
+
+    /// The record being encoded and the changed memory ranges, reused to avoid allocations.
+    std::vector<uint8_t> m_record;
+    std::vector<std::pair<size_t, size_t>> m_ranges;
+
+    RingBuffer m_buffer;
+    std::atomic<bool> m_stop{false};
+    std::thread m_writer;
+
+    void write_record() noexcept
+    {
+        m_buffer.write(m_record.data(), m_record.size());
+        m_record.clear();
+    }
+
+    /// Drains the ring buffer into the file until stopped.
+    void run_writer() noexcept
+    {
+        std::vector<uint8_t> chunk(size_t{1} << 16);
+        while (true)
+        {
+            // Check the stop flag before reading to not miss the bytes written before stopping.
+            const auto stop = m_stop.load(std::memory_order_acquire);
+            if (const auto n = m_buffer.read(chunk.data(), chunk.size()); n != 0)
+                std::fwrite(chunk.data(), 1, n, m_file);
+            else if (stop)
+                break;
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds{100});
+        }
+    }
+
+    void encode_stack(Context& ctx, const intx::uint256* stack_top, int stack_height)
+    {
+        const auto height = static_cast<size_t>(stack_height);
+        const auto stack_begin = stack_top + 1 - stack_height;
+        auto& prev = ctx.stack;
+
+        // The stack items below the ones required by the previous instruction are unchanged.
+        // The depth accessed by SWAPN is given by its immediate argument, not by the traits.
+        auto required = static_cast<size_t>(instr::traits[ctx.opcode].stack_height_required);
+        if (ctx.opcode == OP_SWAPN)
+            required = size_t{ctx.code[ctx.pc + 1]} + 2;
+        auto keep = std::min(prev.size() - std::min(prev.size(), required), height);
+        while (keep < std::min(prev.size(), height) && prev[keep] == stack_begin[keep])
+            ++keep;
+
+        put_varint(m_record, prev.size() - keep);
+        put_varint(m_record, height - keep);
+        prev.resize(keep);
+        for (auto it = stack_begin + keep; it != stack_begin + height; ++it)
+        {
+            put_word(m_record, *it);
+            prev.push_back(*it);
+        }
+    }
+
+    void encode_memory(Context& ctx, const Memory& memory)
+    {
+        auto& prev = ctx.memory;
+        prev.resize(memory.size());
+
+        // Encode the ranges of the bytes that differ, the offsets relative to the previous range.
+        auto& ranges = m_ranges;
+        ranges.clear();
+        for (size_t i = 0; i < prev.size();)
+        {
+            if (memory.data()[i] == prev[i])
+            {
+                ++i;
+                continue;
+            }
+            const auto begin = i;
+            while (i < prev.size() && memory.data()[i] != prev[i])
+                ++i;
+            ranges.emplace_back(begin, i);
+        }
+
+        put_varint(m_record, ranges.size());
+        size_t last_end = 0;
+        for (const auto& [begin, end] : ranges)
+        {
+            put_varint(m_record, begin - last_end);
+            put_varint(m_record, end - begin);
+            put_bytes(m_record, memory.data() + begin, end - begin);
+            std::memcpy(&prev[begin], memory.data() + begin, end - begin);
+            last_end = end;
+        }
+    }
+
+    void on_execution_start(
+        evmc_revision rev, const evmc_message& msg, bytes_view code) noexcept override
+    {
+        m_contexts.emplace(code.data(), msg.gas);
+
+        m_record.push_back(tag_execution_start);
+        put_varint(m_record, static_cast<uint32_t>(msg.depth));
+        m_record.push_back(static_cast<uint8_t>(rev));
+        m_record.push_back((msg.flags & EVMC_STATIC) != 0);
+        put_signed_varint(m_record, msg.gas);
+        write_record();
+    }
+
+    void on_instruction_start(uint32_t pc, const intx::uint256* stack_top, int stack_height,
+        int64_t gas, const ExecutionState& state) noexcept override
+    {
+        auto& ctx = m_contexts.top();
+
+        m_record.push_back(tag_instruction);
+        put_signed_varint(m_record, int64_t{pc} - int64_t{ctx.pc});
+        m_record.push_back(ctx.code[pc]);
+        put_signed_varint(m_record, ctx.gas - gas);
+        encode_stack(ctx, stack_top, stack_height);
+        put_signed_varint(m_record,
+            static_cast<int64_t>(state.memory.size()) - static_cast<int64_t>(ctx.memory_size));
+        if (m_trace_memory)
+            encode_memory(ctx, state.memory);
+        write_record();
+
+        ctx.pc = pc;
+        ctx.opcode = ctx.code[pc];
+        ctx.gas = gas;
+        ctx.memory_size = state.memory.size();
+    }
+
+    void on_execution_end(const evmc_result& result) noexcept override
+    {
+        m_contexts.pop();
+
+        m_record.push_back(tag_execution_end);
+        put_signed_varint(m_record, result.status_code);
+        put_signed_varint(m_record, result.gas_left);
+        put_varint(m_record, result.output_size);
+        put_bytes(m_record, result.output_data, result.output_size);
+        write_record();
+    }
+
+public:
+    BinaryTracer(std::FILE* file, bool trace_memory) noexcept
+      : m_trace_memory{trace_memory}, m_file{file}
+    {
+        m_record.assign(std::begin(magic), std::end(magic));
+        m_record.push_back(version);
+        m_record.push_back(trace_memory ? flag_memory : 0);
+        write_record();
+        m_writer = std::thread{&BinaryTracer::run_writer, this};
+    }
+
+    ~BinaryTracer() override
+    {
+        m_stop.store(true, std::memory_order_release);
+        m_writer.join();
+        std::fclose(m_file);
+    }
+};
+}  // namespace
+
+std::unique_ptr<Tracer> create_binary_tracer(const std::string& path, bool trace_memory)
+{
+    const auto file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return nullptr;
+    return std::make_unique<BinaryTracer>(file, trace_memory);
+}
+}  // namespace evmone
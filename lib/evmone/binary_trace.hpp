@@ -0,0 +1,138 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+/// @file
+/// The binary trace format produced by the tracer from create_binary_tracer().
+///
+/// The trace starts with the header: the 8-byte magic "evmtrace", the format version byte
+/// and the flags byte. The records follow, each starting with the tag byte:
+///
+/// - execution start: depth, revision, flags (static), gas,
+/// - instruction: pc delta, opcode, gas consumed by the previous instruction of the frame,
+///   the number of the stack items popped, the number of the stack items pushed followed by
+///   their values, memory size delta, optionally the changed memory ranges,
+/// - execution end: status code, gas left, output.
+///
+/// The deltas are relative to the previous instruction of the same frame.
+/// The numbers are LEB128 varints, the signed numbers are zigzag-encoded.
+/// The stack values are encoded as the length byte followed by the big-endian bytes
+/// without leading zeros.
+
+#include <intx/intx.hpp>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace evmone::binary_trace
+{
+inline constexpr uint8_t magic[8] = {'e', 'v', 'm', 't', 'r', 'a', 'c', 'e'};
+inline constexpr uint8_t version = 1;
+
+/// The header flag enabling the memory changes in the instruction records.
+inline constexpr uint8_t flag_memory = 1;
+
+enum Tag : uint8_t
+{
+    tag_execution_start = 1,
+    tag_instruction = 2,
+    tag_execution_end = 3,
+};
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+inline void put_signed_varint(std::vector<uint8_t>& out, int64_t v)
+{
+    put_varint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+inline void put_bytes(std::vector<uint8_t>& out, const uint8_t* data, size_t size)
+{
+    out.insert(out.end(), data, data + size);
+}
+
+inline void put_word(std::vector<uint8_t>& out, const intx::uint256& v)
+{
+    uint8_t bytes[32];
+    intx::be::store(bytes, v);
+    const auto skip = static_cast<size_t>(intx::clz(v) / 8);
+    out.push_back(static_cast<uint8_t>(32 - skip));
+    put_bytes(out, bytes + skip, 32 - skip);
+}
+
+/// The reader of the trace bytes. The reads past the end set the error flag and return zeros.
+class Reader
+{
+    const uint8_t* m_it;
+    const uint8_t* const m_end;
+    bool m_error = false;
+
+public:
+    Reader(const uint8_t* begin, const uint8_t* end) noexcept : m_it{begin}, m_end{end} {}
+
+    [[nodiscard]] bool error() const noexcept { return m_error; }
+    [[nodiscard]] bool empty() const noexcept { return m_it == m_end; }
+
+    const uint8_t* bytes(size_t size) noexcept
+    {
+        if (size > static_cast<size_t>(m_end - m_it))
+        {
+            m_error = true;
+            m_it = m_end;
+            return nullptr;
+        }
+        const auto p = m_it;
+        m_it += size;
+        return p;
+    }
+
+    uint8_t byte() noexcept
+    {
+        const auto p = bytes(1);
+        return p != nullptr ? *p : 0;
+    }
+
+    uint64_t varint() noexcept
+    {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            const auto b = byte();
+            v |= uint64_t{b & 0x7fu} << shift;
+            if ((b & 0x80) == 0)
+                return v;
+        }
+        m_error = true;
+        return 0;
+    }
+
+    int64_t signed_varint() noexcept
+    {
+        const auto v = varint();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    intx::uint256 word() noexcept
+    {
+        const auto size = byte();
+        if (size > 32)
+        {
+            m_error = true;
+            return 0;
+        }
+        uint8_t word_bytes[32]{};
+        if (const auto p = bytes(size); p != nullptr)
+            std::memcpy(word_bytes + 32 - size, p, size);
+        return intx::be::load<intx::uint256>(word_bytes);
+    }
+};
+}  // namespace evmone::binary_trace
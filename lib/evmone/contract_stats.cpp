@@ -0,0 +1,96 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "contract_stats.hpp"
+#include <ethash/keccak.hpp>
+#include <algorithm>
+#include <atomic>
+
+namespace evmone
+{
+namespace
+{
+/// The wall time of the calls made by the execution in progress in this thread.
+thread_local std::chrono::nanoseconds t_child_time{};
+
+/// The counter assigning the registry shards to the threads.
+std::atomic<size_t> g_next_shard{0};
+
+/// The index of the registry shard of this thread.
+thread_local const size_t t_shard = g_next_shard++;
+
+evmc::bytes32 get_code_hash(
+    const evmc::HostInterface& host, const evmc_message& msg, bytes_view code) noexcept
+{
+    if (msg.kind != EVMC_CREATE && msg.kind != EVMC_CREATE2)
+    {
+        if (const auto code_hash = host.get_code_hash(msg.code_address); code_hash != evmc::bytes32{})
+            return code_hash;
+    }
+
+    const auto hash = ethash::keccak256(code.data(), code.size());
+    evmc::bytes32 code_hash;
+    std::copy(std::begin(hash.bytes), std::end(hash.bytes), code_hash.bytes);
+    return code_hash;
+}
+}  // namespace
+
+ContractStatsRegistry::Execution ContractStatsRegistry::begin() noexcept
+{
+    const auto parent_child_time = t_child_time;
+    t_child_time = {};
+#if EVMONE_MEMORY_COUNTERS
+    return {clock::now(), parent_child_time, memory_counters()};
+#else
+    return {clock::now(), parent_child_time, {}};
+#endif
+}
+
+void ContractStatsRegistry::end(const Execution& execution, const evmc::HostInterface& host,
+    const evmc_message& msg, bytes_view code, int64_t gas_used, size_t memory_size) noexcept
+{
+    const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock::now() - execution.start_time);
+    const auto self_time = time - t_child_time;
+    t_child_time = execution.parent_child_time + time;
+
+    const auto code_hash = get_code_hash(host, msg, code);
+
+    auto& shard = m_shards[t_shard % NumShards];
+    const std::lock_guard lock{shard.mutex};
+    auto& s = shard.stats[code_hash];
+    ++s.calls;
+    s.gas_used += gas_used;
+    s.time += time;
+    s.self_time += self_time;
+    s.max_depth = std::max(s.max_depth, msg.depth);
+    s.max_memory_size = std::max(s.max_memory_size, memory_size);
+#if EVMONE_MEMORY_COUNTERS
+    s.memory += memory_counters() - execution.start_memory_counters;
+#endif
+}
+
+ContractStatsRegistry::Snapshot ContractStatsRegistry::snapshot(bool reset)
+{
+    Snapshot result;
+    for (auto& shard : m_shards)
+    {
+        const std::lock_guard lock{shard.mutex};
+        for (const auto& [code_hash, stats] : shard.stats)
+            result[code_hash] += stats;
+        if (reset)
+            shard.stats.clear();
+    }
+    return result;
+}
+
+void ContractStatsRegistry::reset() noexcept
+{
+    for (auto& shard : m_shards)
+    {
+        const std::lock_guard lock{shard.mutex};
+        shard.stats.clear();
+    }
+}
+}  // namespace evmone
@@ -0,0 +1,98 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "memory_counters.hpp"
+#include <evmc/evmc.hpp>
+#include <evmc/utils.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace evmone
+{
+using bytes_view = std::basic_string_view<uint8_t>;
+
+/// The execution statistics of a contract code.
+struct ContractStats
+{
+    uint64_t calls = 0;
+    int64_t gas_used = 0;                  ///< Including the gas used by the calls made.
+    std::chrono::nanoseconds time{};       ///< The wall time including the calls made.
+    std::chrono::nanoseconds self_time{};  ///< The wall time excluding the calls made.
+    int32_t max_depth = 0;
+    size_t max_memory_size = 0;  ///< The memory high-water mark.
+
+    /// The memory expansions and allocations including the calls made.
+    /// Counted only if evmone is built with EVMONE_MEMORY_COUNTERS.
+    MemoryCounters memory;
+
+    /// Adds the statistics of other executions of the same code.
+    ContractStats& operator+=(const ContractStats& other) noexcept
+    {
+        calls += other.calls;
+        gas_used += other.gas_used;
+        time += other.time;
+        self_time += other.self_time;
+        max_depth = std::max(max_depth, other.max_depth);
+        max_memory_size = std::max(max_memory_size, other.max_memory_size);
+        memory += other.memory;
+        return *this;
+    }
+};
+
+/// The registry of the execution statistics keyed by the Keccak hash of the code.
+///
+/// The statistics are recorded once per execution (not per instruction) by both the baseline
+/// and the advanced interpreters. The code hash of a call is taken from the host
+/// (get_code_hash() of the code address), only the code of the create executions
+/// (or of the accounts unknown to the host) is hashed.
+/// The statistics are accumulated in the shard of the executing thread and merged
+/// by snapshot(), so the concurrent executions do not contend for a single lock.
+class ContractStatsRegistry
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using Snapshot = std::unordered_map<evmc::bytes32, ContractStats>;
+
+    /// The measurement of the execution in progress.
+    struct Execution
+    {
+        clock::time_point start_time;
+
+        /// The time of the calls made by the parent execution before this one started.
+        std::chrono::nanoseconds parent_child_time;
+
+        MemoryCounters start_memory_counters;
+    };
+
+private:
+    static constexpr size_t NumShards = 16;
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        Snapshot stats;
+    };
+
+    std::array<Shard, NumShards> m_shards;
+
+public:
+    /// Starts measuring the execution. Must be paired with end() in the same thread.
+    [[nodiscard]] static Execution begin() noexcept;
+
+    /// Finishes measuring the execution of the message and records its statistics.
+    void end(const Execution& execution, const evmc::HostInterface& host, const evmc_message& msg,
+        bytes_view code, int64_t gas_used, size_t memory_size) noexcept;
+
+    /// Returns the copy of the statistics, optionally resetting them at the same time.
+    [[nodiscard]] Snapshot snapshot(bool reset = false);
+
+    /// Removes all the statistics.
+    void reset() noexcept;
+};
+}  // namespace evmone
@@ -11,6 +11,10 @@
 
 #include "instructions_traits.hpp"
 
+#if EVMONE_MEMORY_COUNTERS
+#include "memory_counters.hpp"
+#endif
+
 namespace evmone
 {
 struct StorageStoreCost
@@ -19,6 +23,8 @@ struct StorageStoreCost
     int64_t gas_refund;
 };
 
+class Tracer;
+
 namespace advanced
 {
 struct AdvancedCodeAnalysis;
@@ -75,6 +81,9 @@ class Memory
 
     void allocate_capacity() noexcept
     {
+#if EVMONE_MEMORY_COUNTERS
+        count_memory(&MemoryCounters::memory_reallocs);
+#endif
         m_data = static_cast<uint8_t*>(std::realloc(m_data, m_capacity));
         if (m_data == nullptr)
             handle_out_of_memory();
@@ -118,6 +127,10 @@ public:
 
             allocate_capacity();
         }
+#if EVMONE_MEMORY_COUNTERS
+        count_memory(&MemoryCounters::memory_grows);
+        count_memory(&MemoryCounters::bytes_zeroed, new_size - m_size);
+#endif
         std::memset(m_data + m_size, 0, new_size - m_size);
         m_size = new_size;
     }
@@ -344,6 +357,10 @@ public:
 
     std::vector<const uint8_t*> call_stack;
 
+    /// The tracer notified of the storage accesses or null if not tracing.
+    /// This is set by the Baseline execute() function.
+    Tracer* tracer = nullptr;
+
     /// Stack space allocation.
     ///
     /// This is the last field to make other fields' offsets of reasonable values.
@@ -375,6 +392,7 @@ public:
         gas_params = _gas_params;
         eos_evm_version = _eos_evm_version;
         gas_state.reset(_eos_evm_version, 0, 0, 0, 0);
+        tracer = nullptr;
     }
 
     [[nodiscard]] bool in_static_mode() const { return (msg->flags & EVMC_STATIC) != 0; }
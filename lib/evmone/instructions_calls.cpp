@@ -6,6 +6,20 @@
 
 namespace evmone::instr::core
 {
+namespace
+{
+/// Replaces the return data with the output of the call.
+void set_return_data(ExecutionState& state, const evmc::Result& result) noexcept
+{
+#if EVMONE_MEMORY_COUNTERS
+    if (result.output_size > state.return_data.capacity())
+        count_memory(&MemoryCounters::return_data_allocs);
+    count_memory(&MemoryCounters::bytes_copied, result.output_size);
+#endif
+    state.return_data.assign(result.output_data, result.output_size);
+}
+}  // namespace
+
 template <Opcode Op>
 Result call_impl(StackTop stack, int64_t gas_left, ExecutionState& state) noexcept
 {
@@ -110,7 +124,7 @@ Result call_impl(StackTop stack, int64_t gas_left, ExecutionState& state) noexce
 
     const auto result = state.host.call(msg);
 
-    state.return_data.assign(result.output_data, result.output_size);
+    set_return_data(state, result);
     stack.top() = result.status_code == EVMC_SUCCESS;
 
     if (const auto copy_size = std::min(output_size, result.output_size); copy_size > 0)
@@ -211,7 +225,7 @@ Result create_impl(StackTop stack, int64_t gas_left, ExecutionState& state) noex
         gas_left -= msg.gas - result.gas_left;
         state.gas_state.add_cpu_gas_refund(result.gas_refund);
     }
-    state.return_data.assign(result.output_data, result.output_size);
+    set_return_data(state, result);
     if (result.status_code == EVMC_SUCCESS)
         stack.top() = intx::be::load<uint256>(result.create_address);
 
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "instructions.hpp"
+#include "tracing.hpp"
 
 namespace evmone::instr::core
 {
@@ -86,8 +87,10 @@ Result sload(StackTop stack, int64_t gas_left, ExecutionState& state) noexcept
     auto& x = stack.top();
     const auto key = intx::be::store<evmc::bytes32>(x);
 
-    if (state.rev >= EVMC_BERLIN &&
-        state.host.access_storage(state.msg->recipient, key) == EVMC_ACCESS_COLD)
+    const auto access_status = state.rev >= EVMC_BERLIN ?
+                                   state.host.access_storage(state.msg->recipient, key) :
+                                   EVMC_ACCESS_WARM;
+    if (access_status == EVMC_ACCESS_COLD)
     {
         // The warm storage access cost is already applied (from the cost table).
         // Here we need to apply additional cold storage access cost.
@@ -98,6 +101,9 @@ Result sload(StackTop stack, int64_t gas_left, ExecutionState& state) noexcept
 
     x = intx::be::load<uint256>(state.host.get_storage(state.msg->recipient, key));
 
+    if (INTX_UNLIKELY(state.tracer != nullptr))
+        state.tracer->notify_storage_load(state.msg->recipient, key, access_status);
+
     return {EVMC_SUCCESS, gas_left};
 }
 
@@ -112,12 +118,14 @@ Result sstore(StackTop stack, int64_t gas_left, ExecutionState& state) noexcept
     const auto key = intx::be::store<evmc::bytes32>(stack.pop());
     const auto value = intx::be::store<evmc::bytes32>(stack.pop());
 
-    const auto gas_cost_cold =
-        (state.rev >= EVMC_BERLIN &&
-            state.host.access_storage(state.msg->recipient, key) == EVMC_ACCESS_COLD) ?
-            instr::cold_sload_cost :
-            0;
+    const auto access_status = state.rev >= EVMC_BERLIN ?
+                                   state.host.access_storage(state.msg->recipient, key) :
+                                   EVMC_ACCESS_WARM;
+    const auto gas_cost_cold = access_status == EVMC_ACCESS_COLD ? instr::cold_sload_cost : 0;
     const auto status = state.host.set_storage(state.msg->recipient, key, value);
+
+    if (INTX_UNLIKELY(state.tracer != nullptr))
+        state.tracer->notify_storage_store(state.msg->recipient, key, access_status, status);
     const auto& storage_cost = state.eos_evm_version > 0 ? state.gas_params.get_storage_cost(state.eos_evm_version) : sstore_costs[state.rev];
 
     if( state.eos_evm_version >= 3) {
@@ -0,0 +1,14 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memory_counters.hpp"
+
+namespace evmone
+{
+MemoryCounters& memory_counters() noexcept
+{
+    thread_local MemoryCounters counters;
+    return counters;
+}
+}  // namespace evmone
@@ -0,0 +1,61 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <evmc/utils.h>
+#include <cstdint>
+
+/// Enables counting the memory expansions and the allocations of the execution
+/// (the EVMONE_MEMORY_COUNTERS CMake option).
+#ifndef EVMONE_MEMORY_COUNTERS
+#define EVMONE_MEMORY_COUNTERS 0
+#endif
+
+namespace evmone
+{
+/// The counters of the memory expansions and the allocations of the execution.
+struct MemoryCounters
+{
+    uint64_t memory_grows = 0;        ///< The number of the EVM memory expansions.
+    uint64_t memory_reallocs = 0;     ///< The number of the EVM memory reallocations.
+    uint64_t bytes_zeroed = 0;        ///< The number of bytes zeroed by the memory expansions.
+    uint64_t return_data_allocs = 0;  ///< The number of the return data buffer reallocations.
+    uint64_t output_allocs = 0;       ///< The number of the execution output buffers allocated.
+    uint64_t bytes_copied = 0;        ///< The number of bytes copied to these buffers.
+
+    MemoryCounters& operator+=(const MemoryCounters& other) noexcept
+    {
+        memory_grows += other.memory_grows;
+        memory_reallocs += other.memory_reallocs;
+        bytes_zeroed += other.bytes_zeroed;
+        return_data_allocs += other.return_data_allocs;
+        output_allocs += other.output_allocs;
+        bytes_copied += other.bytes_copied;
+        return *this;
+    }
+
+    friend MemoryCounters operator-(MemoryCounters a, const MemoryCounters& b) noexcept
+    {
+        a.memory_grows -= b.memory_grows;
+        a.memory_reallocs -= b.memory_reallocs;
+        a.bytes_zeroed -= b.bytes_zeroed;
+        a.return_data_allocs -= b.return_data_allocs;
+        a.output_allocs -= b.output_allocs;
+        a.bytes_copied -= b.bytes_copied;
+        return a;
+    }
+};
+
+#if EVMONE_MEMORY_COUNTERS
+/// Returns the counters of the executions in the current thread.
+/// The thread_local variable is behind the function because it cannot be exported from a DLL.
+EVMC_EXPORT MemoryCounters& memory_counters() noexcept;
+
+/// Increments the memory counter of the current thread.
+inline void count_memory(uint64_t MemoryCounters::*counter, uint64_t n = 1) noexcept
+{
+    memory_counters().*counter += n;
+}
+#endif
+}  // namespace evmone
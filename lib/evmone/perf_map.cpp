@@ -0,0 +1,183 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "perf_map.hpp"
+#include "baseline.hpp"
+#include "instructions_traits.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+namespace evmone::perf
+{
+namespace
+{
+#ifdef __linux__
+/// The jitdump format, see tools/perf/Documentation/jitdump-specification.txt in Linux.
+namespace jitdump
+{
+constexpr uint32_t magic = 0x4A695444;
+constexpr uint32_t version = 1;
+constexpr uint32_t code_load = 0;
+
+#if defined(__x86_64__)
+constexpr uint32_t elf_mach = EM_X86_64;
+#elif defined(__aarch64__)
+constexpr uint32_t elf_mach = EM_AARCH64;
+#else
+constexpr uint32_t elf_mach = EM_NONE;
+#endif
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+};
+
+struct CodeLoadRecord
+{
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+    // Followed by the null-terminated name and the code bytes.
+};
+
+/// Returns the timestamp of the CLOCK_MONOTONIC clock (perf record -k mono).
+uint64_t timestamp() noexcept
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+}  // namespace jitdump
+#endif
+}  // namespace
+
+std::vector<CodeRange> get_opcode_handler_ranges()
+{
+    std::vector<CodeRange> ranges;
+    const auto handlers = baseline::get_opcode_handlers();
+    if (handlers == nullptr)
+        return ranges;
+
+    for (size_t op = 0; op < 256; ++op)
+    {
+        const auto name = instr::traits[op].name;
+        const auto it = std::find_if(ranges.begin(), ranges.end(),
+            [&](const CodeRange& r) noexcept { return r.address == handlers[op]; });
+        if (it == ranges.end())
+            ranges.push_back({handlers[op], 0, name != nullptr ? name : "UNDEFINED"});
+        else if (name == nullptr)
+            it->name = "UNDEFINED";  // The handler shared by the undefined instructions.
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const CodeRange& a, const CodeRange& b) noexcept {
+        return std::less<>{}(a.address, b.address);
+    });
+    const auto begin = reinterpret_cast<uintptr_t>(ranges.front().address);
+    for (size_t i = 0; i + 1 < ranges.size(); ++i)
+    {
+        ranges[i].size = static_cast<size_t>(reinterpret_cast<uintptr_t>(ranges[i + 1].address) -
+                                             reinterpret_cast<uintptr_t>(ranges[i].address));
+    }
+    if (ranges.size() > 1)
+    {
+        ranges.back().size = (reinterpret_cast<uintptr_t>(ranges.back().address) - begin) /
+                             (ranges.size() - 1);
+    }
+
+    for (auto& r : ranges)
+        r.name = "evmone::baseline::" + r.name;
+    return ranges;
+}
+
+std::string get_perf_map_path()
+{
+#ifdef __linux__
+    return "/tmp/perf-" + std::to_string(::getpid()) + ".map";
+#else
+    return {};
+#endif
+}
+
+std::string get_jitdump_path()
+{
+#ifdef __linux__
+    return "/tmp/jit-" + std::to_string(::getpid()) + ".dump";
+#else
+    return {};
+#endif
+}
+
+bool write_perf_map(const std::string& path, const std::vector<CodeRange>& ranges)
+{
+    const auto file = std::fopen(path.c_str(), "a");
+    if (file == nullptr)
+        return false;
+    for (const auto& r : ranges)
+        std::fprintf(file, "%zx %zx %s\n", reinterpret_cast<uintptr_t>(r.address), r.size,
+            r.name.c_str());
+    return std::fclose(file) == 0;
+}
+
+bool write_jitdump(const std::string& path, const std::vector<CodeRange>& ranges)
+{
+#ifdef __linux__
+    const auto file = std::fopen(path.c_str(), "w+");
+    if (file == nullptr)
+        return false;
+
+    const auto pid = static_cast<uint32_t>(::getpid());
+    const auto tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+
+    const jitdump::FileHeader header{jitdump::magic, jitdump::version, sizeof(header),
+        jitdump::elf_mach, 0, pid, jitdump::timestamp(), 0};
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    uint64_t index = 0;
+    for (const auto& r : ranges)
+    {
+        const auto addr = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(r.address));
+        const jitdump::CodeLoadRecord record{jitdump::code_load,
+            static_cast<uint32_t>(sizeof(record) + r.name.size() + 1 + r.size),
+            jitdump::timestamp(), pid, tid, addr, addr, r.size, index++};
+        std::fwrite(&record, sizeof(record), 1, file);
+        std::fwrite(r.name.c_str(), r.name.size() + 1, 1, file);
+        std::fwrite(r.address, 1, r.size, file);
+    }
+    std::fflush(file);
+
+    // The executable mapping of the file is the marker perf looks for. It is kept forever.
+    const auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const auto marker =
+        ::mmap(nullptr, page_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, ::fileno(file), 0);
+    const auto ok = !std::ferror(file) && marker != MAP_FAILED;
+    return std::fclose(file) == 0 && ok;
+#else
+    (void)path;
+    (void)ranges;
+    return false;
+#endif
+}
+}  // namespace evmone::perf
@@ -0,0 +1,48 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+/// @file
+/// The symbols of the native code of evmone for the Linux perf profiler.
+///
+/// The perf map (perf-<pid>.map) is used by perf only for the code not backed by a file,
+/// so for the code of the evmone library the jitdump (jit-<pid>.dump) is needed:
+/// record with "perf record -k mono", then run "perf inject --jit" before "perf report".
+
+#include <evmc/utils.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace evmone::perf
+{
+/// The named range of the native code.
+struct CodeRange
+{
+    const void* address = nullptr;
+    size_t size = 0;
+    std::string name;
+};
+
+/// Returns the code ranges of the opcode handlers of the Baseline interpreter (only with
+/// the computed goto dispatch, empty otherwise), in the address order.
+///
+/// The handler of an opcode spans to the next handler. The compiler may move parts of them
+/// elsewhere so the ranges are approximate. The size of the last handler is unknown and
+/// it is assumed to be the average size.
+EVMC_EXPORT std::vector<CodeRange> get_opcode_handler_ranges();
+
+/// Returns the default perf map path: /tmp/perf-<pid>.map.
+EVMC_EXPORT std::string get_perf_map_path();
+
+/// Returns the default jitdump path: /tmp/jit-<pid>.dump.
+EVMC_EXPORT std::string get_jitdump_path();
+
+/// Appends the ranges to the perf map file. Returns false on error.
+EVMC_EXPORT bool write_perf_map(const std::string& path, const std::vector<CodeRange>& ranges);
+
+/// Writes the ranges as the code load records to the jitdump file and maps the file
+/// as executable (perf records this mapping to find the file). Returns false on error.
+EVMC_EXPORT bool write_jitdump(const std::string& path, const std::vector<CodeRange>& ranges);
+}  // namespace evmone::perf
@@ -3,10 +3,31 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "tracing.hpp"
+#include "binary_trace.hpp"
 #include "execution_state.hpp"
 #include "instructions_traits.hpp"
+#include <ethash/keccak.hpp>
+#include <evmc/evmc.hpp>
 #include <evmc/hex.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <mutex>
 #include <stack>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EVMONE_TRACING_RDTSC 1
+#include <x86intrin.h>
+#else
+#define EVMONE_TRACING_RDTSC 0
+#endif
 
 namespace evmone
 {
@@ -65,6 +86,224 @@ public:
     explicit HistogramTracer(std::ostream& out) noexcept : m_out{out} {}
 };
 
+/// Increments the counter of the current thread, which may be read concurrently by snapshot().
+/// Only the owning thread modifies the counter, so the increment does not need to be atomic.
+inline void increment(uint64_t& counter) noexcept
+{
+    const std::atomic_ref c{counter};
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/// Reads the counter possibly being incremented by its thread.
+inline uint64_t load(uint64_t& counter) noexcept
+{
+    return std::atomic_ref{counter}.load(std::memory_order_relaxed);
+}
+
+/// @see create_aggregated_histogram_tracer()
+class AggregatedHistogramTracerImpl : public AggregatedHistogramTracer
+{
+    static constexpr size_t NumRevisions = OpcodeHistogram::NumRevisions;
+
+    struct Frame
+    {
+        const uint8_t* code;
+        evmc_revision rev;
+        int prev_opcode = -1;
+    };
+
+    /// The counters of a single thread.
+    struct Counters : OpcodeHistogram
+    {
+        std::vector<Frame> frames;
+    };
+
+    /// The unique id of the tracer, identifies its counters in the thread caches.
+    const uint64_t m_id;
+
+    const bool m_opcode_pairs;
+
+    /// Guards the registry of the counters and the allocation of the pairs counters.
+    std::mutex m_mutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<Counters>> m_counters;
+    std::ostream& m_out;
+
+    static uint64_t next_id() noexcept
+    {
+        static std::atomic<uint64_t> id{0};
+        return ++id;
+    }
+
+    /// Returns the counters of the current thread, registering them on the first use.
+    ///
+    /// The thread caches the counters of the few recently used tracers. The ids are never reused,
+    /// so the entries of the destroyed tracers are not matched again and get replaced.
+    Counters& local_counters()
+    {
+        static constexpr size_t CacheSize = 4;
+        thread_local std::array<std::pair<uint64_t, Counters*>, CacheSize> t_cache{};
+        thread_local size_t t_next = 0;
+        for (const auto& [id, counters] : t_cache)
+        {
+            if (id == m_id)
+                return *counters;
+        }
+
+        Counters* counters = nullptr;
+        {
+            const std::lock_guard lock{m_mutex};
+            auto& c = m_counters[std::this_thread::get_id()];
+            if (c == nullptr)
+                c = std::make_unique<Counters>();
+            counters = c.get();
+        }
+        t_cache[t_next] = {m_id, counters};
+        t_next = (t_next + 1) % CacheSize;
+        return *counters;
+    }
+
+    void on_execution_start(
+        evmc_revision rev, const evmc_message& /*msg*/, bytes_view code) noexcept override
+    {
+        auto& counters = local_counters();
+        increment(counters.executions[rev]);
+        counters.frames.push_back({code.data(), rev});
+        if (m_opcode_pairs && counters.pairs[rev] == nullptr)
+        {
+            const std::lock_guard lock{m_mutex};
+            counters.pairs[rev] = std::make_unique<std::array<uint64_t, 256 * 256>>();
+        }
+    }
+
+    void on_instruction_start(uint32_t pc, const intx::uint256* /*stack_top*/, int /*stack_height*/,
+        int64_t /*gas*/, const ExecutionState& /*state*/) noexcept override
+    {
+        auto& counters = local_counters();
+        auto& frame = counters.frames.back();
+        const auto opcode = frame.code[pc];
+        increment(counters.opcodes[frame.rev][opcode]);
+        if (m_opcode_pairs && frame.prev_opcode >= 0)
+        {
+            const auto pair = static_cast<size_t>(frame.prev_opcode << 8 | opcode);
+            increment((*counters.pairs[frame.rev])[pair]);
+        }
+        frame.prev_opcode = opcode;
+    }
+
+    void on_execution_end(const evmc_result& /*result*/) noexcept override
+    {
+        local_counters().frames.pop_back();
+    }
+
+    /// Outputs the report of the merged counters.
+    void report()
+    {
+        const auto total_ptr = snapshot();
+        const auto& total = *total_ptr;
+        for (size_t rev = 0; rev < NumRevisions; ++rev)
+        {
+            if (total.executions[rev] == 0)
+                continue;
+
+            const auto rev_name = evmc::to_string(static_cast<evmc_revision>(rev));
+            m_out << "--- # HISTOGRAM rev=" << rev_name
+                  << " executions=" << total.executions[rev] << "\nopcode,count\n";
+            for (size_t i = 0; i < 256; ++i)
+            {
+                if (const auto count = total.opcodes[rev][i]; count != 0)
+                    m_out << get_name(static_cast<uint8_t>(i)) << ',' << count << '\n';
+            }
+
+            if (total.pairs[rev] == nullptr)
+                continue;
+            m_out << "--- # PAIRS rev=" << rev_name << "\nfirst,second,count\n";
+            for (size_t i = 0; i < 256 * 256; ++i)
+            {
+                if (const auto count = (*total.pairs[rev])[i]; count != 0)
+                {
+                    m_out << get_name(static_cast<uint8_t>(i >> 8)) << ','
+                          << get_name(static_cast<uint8_t>(i)) << ',' << count << '\n';
+                }
+            }
+        }
+    }
+
+public:
+    AggregatedHistogramTracerImpl(std::ostream& out, bool opcode_pairs) noexcept
+      : m_id{next_id()}, m_opcode_pairs{opcode_pairs}, m_out{out}
+    {}
+
+    ~AggregatedHistogramTracerImpl() override { report(); }
+
+    std::unique_ptr<OpcodeHistogram> snapshot() override
+    {
+        auto total = std::make_unique<OpcodeHistogram>();  // Too big for the stack.
+        const std::lock_guard lock{m_mutex};
+        for (const auto& [thread_id, counters] : m_counters)
+        {
+            for (size_t rev = 0; rev < NumRevisions; ++rev)
+            {
+                total->executions[rev] += load(counters->executions[rev]);
+                for (size_t i = 0; i < 256; ++i)
+                    total->opcodes[rev][i] += load(counters->opcodes[rev][i]);
+                if (counters->pairs[rev] == nullptr)
+                    continue;
+                if (total->pairs[rev] == nullptr)
+                    total->pairs[rev] = std::make_unique<std::array<uint64_t, 256 * 256>>();
+                for (size_t i = 0; i < 256 * 256; ++i)
+                    (*total->pairs[rev])[i] += load((*counters->pairs[rev])[i]);
+            }
+        }
+        return total;
+    }
+};
+
+
+void output_execution_start(std::ostream& out, int32_t depth, evmc_revision rev, bool is_static)
+{
+    out << "{";
+    out << R"("depth":)" << depth;
+    out << R"(,"rev":")" << rev << '"';
+    out << R"(,"static":)" << (is_static ? "true" : "false");
+    out << "}\n";
+}
+
+/// Outputs the instruction object without the closing brace, so fields can be appended.
+void output_instruction(std::ostream& out, uint32_t pc, uint8_t opcode, int64_t gas,
+    const intx::uint256* stack_begin, const intx::uint256* stack_end, size_t memory_size)
+{
+    out << "{";
+    out << R"("pc":)" << std::dec << pc;
+    out << R"(,"op":)" << std::dec << int{opcode};
+    out << R"(,"opName":")" << get_name(opcode) << '"';
+    out << R"(,"gas":0x)" << std::hex << gas;
+
+    out << R"(,"stack":[)";
+    for (auto it = stack_begin; it != stack_end; ++it)
+    {
+        if (it != stack_begin)
+            out << ',';
+        out << R"("0x)" << to_string(*it, 16) << '"';
+    }
+    out << ']';
+
+    out << R"(,"memorySize":)" << std::dec << memory_size;
+}
+
+void output_execution_end(std::ostream& out, evmc_status_code status_code, int64_t gas_left,
+    int64_t gas_used, bytes_view output)
+{
+    out << "{";
+    out << R"("error":)";
+    if (status_code == EVMC_SUCCESS)
+        out << "null";
+    else
+        out << '"' << status_code << '"';
+    out << R"(,"gas":)" << std::hex << "0x" << gas_left;
+    out << R"(,"gasUsed":)" << std::hex << "0x" << gas_used;
+    out << R"(,"output":")" << evmc::hex(output) << '"';
+    out << "}\n";
+}
 
 class InstructionTracer : public Tracer
 {
@@ -79,30 +318,11 @@ class InstructionTracer : public Tracer
     std::stack<Context> m_contexts;
     std::ostream& m_out;  ///< Output stream.
 
-    void output_stack(const intx::uint256* stack_top, int stack_height)
-    {
-        m_out << R"(,"stack":[)";
-        const auto stack_end = stack_top + 1;
-        const auto stack_begin = stack_end - stack_height;
-        for (auto it = stack_begin; it != stack_end; ++it)
-        {
-            if (it != stack_begin)
-                m_out << ',';
-            m_out << R"("0x)" << to_string(*it, 16) << '"';
-        }
-        m_out << ']';
-    }
-
     void on_execution_start(
         evmc_revision rev, const evmc_message& msg, bytes_view code) noexcept override
     {
         m_contexts.emplace(code.data(), msg.gas);
-
-        m_out << "{";
-        m_out << R"("depth":)" << msg.depth;
-        m_out << R"(,"rev":")" << rev << '"';
-        m_out << R"(,"static":)" << (((msg.flags & EVMC_STATIC) != 0) ? "true" : "false");
-        m_out << "}\n";
+        output_execution_start(m_out, msg.depth, rev, (msg.flags & EVMC_STATIC) != 0);
     }
 
     void on_instruction_start(uint32_t pc, const intx::uint256* stack_top, int stack_height,
@@ -110,18 +330,11 @@ class InstructionTracer : public Tracer
     {
         const auto& ctx = m_contexts.top();
 
-        const auto opcode = ctx.code[pc];
-        m_out << "{";
-        m_out << R"("pc":)" << std::dec << pc;
-        m_out << R"(,"op":)" << std::dec << int{opcode};
-        m_out << R"(,"opName":")" << get_name(opcode) << '"';
-        m_out << R"(,"gas":0x)" << std::hex << gas;
-        output_stack(stack_top, stack_height);
-
         // Full memory can be dumped as evmc::hex({state.memory.data(), state.memory.size()}),
         // but this should not be done by default. Adding --tracing=+memory option would be nice.
-        m_out << R"(,"memorySize":)" << std::dec << state.memory.size();
-
+        const auto stack_end = stack_top + 1;
+        output_instruction(m_out, pc, ctx.code[pc], gas, stack_end - stack_height, stack_end,
+            state.memory.size());
         m_out << "}\n";
     }
 
@@ -129,16 +342,8 @@ class InstructionTracer : public Tracer
     {
         const auto& ctx = m_contexts.top();
 
-        m_out << "{";
-        m_out << R"("error":)";
-        if (result.status_code == EVMC_SUCCESS)
-            m_out << "null";
-        else
-            m_out << '"' << result.status_code << '"';
-        m_out << R"(,"gas":)" << std::hex << "0x" << result.gas_left;
-        m_out << R"(,"gasUsed":)" << std::hex << "0x" << (ctx.start_gas - result.gas_left);
-        m_out << R"(,"output":")" << evmc::hex({result.output_data, result.output_size}) << '"';
-        m_out << "}\n";
+        output_execution_end(m_out, result.status_code, result.gas_left,
+            ctx.start_gas - result.gas_left, {result.output_data, result.output_size});
 
         m_contexts.pop();
     }
@@ -149,15 +354,877 @@ public:
         m_out << std::dec;  // Set number formatting to dec, JSON does not support other forms.
     }
 };
+
+/// @see create_profiler_tracer()
+class ProfilerTracer : public Tracer
+{
+    using clock = std::chrono::steady_clock;
+
+    /// The node of the tree of the call stacks. The root node (index 0) has no code.
+    struct Node
+    {
+        uint32_t parent = 0;
+        evmc::bytes32 code_hash;
+        std::unordered_map<evmc::bytes32, uint32_t> children;
+    };
+
+    struct InstructionStats
+    {
+        uint8_t opcode = 0;
+        uint64_t samples = 0;
+        int64_t gas = 0;
+        clock::duration time{};
+    };
+
+    struct Context
+    {
+        const uint32_t node;
+        const uint8_t* const code;
+        const int64_t start_gas;
+        const clock::time_point start_time;
+
+        /// The sampled instruction measured until the next notification in this frame.
+        bool sampled = false;
+        uint32_t pc = 0;
+        int64_t gas = 0;
+        clock::time_point time;
+
+        /// The gas and time of the child frames called by the sampled instruction.
+        int64_t child_gas = 0;
+        clock::duration child_time{};
+
+        Context(uint32_t n, const uint8_t* c, int64_t g, clock::time_point t) noexcept
+          : node{n}, code{c}, start_gas{g}, start_time{t}
+        {}
+    };
+
+    const uint32_t m_sample_period;
+    uint32_t m_countdown = 1;
+    std::vector<Node> m_nodes{1};
+    std::unordered_map<uint64_t, InstructionStats> m_stats;  ///< Keyed by the node and the pc.
+    std::stack<Context> m_contexts;
+    std::ostream& m_out;
+
+    /// Attributes the gas and the time since the sampled instruction start to this instruction,
+    /// excluding the costs of the child frames.
+    void finish_sample(Context& ctx, int64_t gas, clock::time_point now)
+    {
+        if (!ctx.sampled)
+            return;
+        ctx.sampled = false;
+
+        auto& stats = m_stats[(uint64_t{ctx.node} << 32) | ctx.pc];
+        stats.opcode = ctx.code[ctx.pc];
+        ++stats.samples;
+        stats.gas += std::max(ctx.gas - gas - ctx.child_gas, int64_t{0}) * m_sample_period;
+        stats.time +=
+            std::max(now - ctx.time - ctx.child_time, clock::duration{}) * m_sample_period;
+    }
+
+    uint32_t get_node(uint32_t parent, bytes_view code)
+    {
+        const auto h = ethash::keccak256(code.data(), code.size());
+        evmc::bytes32 code_hash;
+        std::copy(std::begin(h.bytes), std::end(h.bytes), code_hash.bytes);
+
+        const auto [it, inserted] =
+            m_nodes[parent].children.try_emplace(code_hash, static_cast<uint32_t>(m_nodes.size()));
+        if (inserted)
+            m_nodes.push_back({parent, code_hash, {}});
+        return it->second;
+    }
+
+    /// Returns the folded stack of the node: the ';'-separated abbreviated code hashes.
+    std::string get_stack_name(uint32_t node) const
+    {
+        std::string name;
+        for (; node != 0; node = m_nodes[node].parent)
+        {
+            const auto& h = m_nodes[node].code_hash;
+            name.insert(0, (m_nodes[node].parent != 0 ? ";0x" : "0x") +
+                               evmc::hex({h.bytes, 4}));
+        }
+        return name;
+    }
+
+    void on_execution_start(
+        evmc_revision /*rev*/, const evmc_message& msg, bytes_view code) noexcept override
+    {
+        const auto parent = m_contexts.empty() ? 0 : m_contexts.top().node;
+        m_contexts.emplace(get_node(parent, code), code.data(), msg.gas, clock::now());
+    }
+
+    void on_instruction_start(uint32_t pc, const intx::uint256* /*stack_top*/, int /*stack_height*/,
+        int64_t gas, const ExecutionState& /*state*/) noexcept override
+    {
+        auto& ctx = m_contexts.top();
+        if (ctx.sampled)
+            finish_sample(ctx, gas, clock::now());
+
+        if (--m_countdown != 0)
+            return;
+        m_countdown = m_sample_period;
+
+        ctx.sampled = true;
+        ctx.pc = pc;
+        ctx.gas = gas;
+        ctx.child_gas = 0;
+        ctx.child_time = {};
+        ctx.time = clock::now();
+    }
+
+    void on_execution_end(const evmc_result& result) noexcept override
+    {
+        const auto now = clock::now();
+        auto& ctx = m_contexts.top();
+        finish_sample(ctx, result.gas_left, now);
+        const auto gas_used = ctx.start_gas - result.gas_left;
+        const auto time = now - ctx.start_time;
+        m_contexts.pop();
+
+        if (!m_contexts.empty())
+        {
+            auto& parent = m_contexts.top();
+            parent.child_gas += gas_used;
+            parent.child_time += time;
+        }
+    }
+
+    void report() const
+    {
+        const auto to_ns = [](clock::duration d) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        };
+
+        std::map<std::pair<evmc::bytes32, uint32_t>, InstructionStats> instructions;
+        std::map<std::string, InstructionStats> stacks;
+        for (const auto& [key, stats] : m_stats)
+        {
+            const auto node = static_cast<uint32_t>(key >> 32);
+            const auto pc = static_cast<uint32_t>(key);
+            auto& i = instructions[{m_nodes[node].code_hash, pc}];
+            auto& s = stacks[get_stack_name(node) + ';' + get_name(stats.opcode)];
+            for (auto* r : {&i, &s})
+            {
+                r->opcode = stats.opcode;
+                r->samples += stats.samples;
+                r->gas += stats.gas;
+                r->time += stats.time;
+            }
+        }
+
+        m_out << "--- # PROFILE sample_period=" << m_sample_period
+              << "\ncode_hash,pc,opcode,samples,gas,time_ns\n";
+        for (const auto& [key, stats] : instructions)
+        {
+            m_out << evmc::hex(key.first) << ',' << key.second << ',' << get_name(stats.opcode)
+                  << ',' << stats.samples << ',' << stats.gas << ',' << to_ns(stats.time) << '\n';
+        }
+
+        m_out << "--- # FOLDED gas\n";
+        for (const auto& [stack, stats] : stacks)
+            m_out << stack << ' ' << stats.gas << '\n';
+
+        m_out << "--- # FOLDED time_ns\n";
+        for (const auto& [stack, stats] : stacks)
+            m_out << stack << ' ' << to_ns(stats.time) << '\n';
+    }
+
+public:
+    ProfilerTracer(std::ostream& out, uint32_t sample_period) noexcept
+      : m_sample_period{sample_period != 0 ? sample_period : 1}, m_out{out}
+    {}
+
+    ~ProfilerTracer() override { report(); }
+};
+
+/// The histogram of the values in the log-linear buckets: the values below 16 have exact buckets,
+/// each next power of 2 range is split into 8 buckets (the precision of 12.5%).
+class LogHistogram
+{
+    static constexpr size_t num_buckets = 16 + (64 - 4) * 8;
+    std::array<uint64_t, num_buckets> m_counts{};
+    uint64_t m_total = 0;
+
+    static size_t bucket(uint64_t v) noexcept
+    {
+        if (v < 16)
+            return static_cast<size_t>(v);
+        const auto e = static_cast<unsigned>(std::bit_width(v) - 1);
+        return 16 + (e - 4) * 8 + ((v >> (e - 3)) & 7);
+    }
+
+    static uint64_t lower_bound(size_t b) noexcept
+    {
+        if (b < 16)
+            return b;
+        const auto e = (b - 16) / 8 + 4;
+        return (uint64_t{8} | ((b - 16) % 8)) << (e - 3);
+    }
+
+public:
+    void add(uint64_t v) noexcept
+    {
+        ++m_counts[bucket(v)];
+        ++m_total;
+    }
+
+    /// Returns the lower bound of the bucket containing the given percentile.
+    [[nodiscard]] uint64_t percentile(unsigned p) const noexcept
+    {
+        const auto rank = (m_total * p + 99) / 100;
+        uint64_t count = 0;
+        for (size_t b = 0; b < num_buckets; ++b)
+        {
+            count += m_counts[b];
+            if (count >= rank && count != 0)
+                return lower_bound(b);
+        }
+        return 0;
+    }
+};
+
+/// @see create_cycle_tracer()
+class CycleTracer : public Tracer
+{
+    /// The rows of the report: the opcodes, then the precompiles.
+    static constexpr size_t num_precompiles = 10;
+    static constexpr size_t num_rows = 256 + num_precompiles + 1;
+
+    /// The fixed-point scale of the time per gas histograms.
+    static constexpr uint64_t per_gas_scale = 1024;
+
+    struct Row
+    {
+        uint64_t count = 0;
+        int64_t gas = 0;
+        uint64_t ticks = 0;
+        std::unique_ptr<LogHistogram> ticks_hist;
+        std::unique_ptr<LogHistogram> ticks_per_gas_hist;
+    };
+
+    struct Context
+    {
+        const uint8_t* const code;
+        const int64_t start_gas;
+        const uint64_t start_ticks;
+
+        /// The current instruction's row or -1 before the first instruction.
+        int row = -1;
+        int64_t gas = 0;
+        uint64_t ticks = 0;
+        int64_t child_gas = 0;
+        uint64_t child_ticks = 0;
+
+        Context(const uint8_t* c, int64_t g, uint64_t t) noexcept
+          : code{c}, start_gas{g}, start_ticks{t}
+        {}
+    };
+
+    std::array<Row, num_rows> m_rows;
+    std::stack<Context> m_contexts;
+    std::ostream& m_out;
+    const uint64_t m_start_ticks;
+    const std::chrono::steady_clock::time_point m_start_time;
+
+    /// Reads the CPU time stamp counter or the steady clock if the counter is not available.
+    static uint64_t read_ticks() noexcept
+    {
+#if EVMONE_TRACING_RDTSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+#endif
+    }
+
+    /// Returns the report row of the instruction: the precompile for the calls of
+    /// the precompile addresses (which are executed by the host without the child frame),
+    /// otherwise the opcode.
+    static int get_row(uint8_t opcode, const intx::uint256* stack_top, int stack_height) noexcept
+    {
+        const auto is_call = opcode == OP_CALL || opcode == OP_CALLCODE ||
+                             opcode == OP_DELEGATECALL || opcode == OP_STATICCALL;
+        if (is_call && stack_height >= 2)
+        {
+            const auto& address = stack_top[-1];
+            if (address != 0 && address <= num_precompiles)
+                return 256 + static_cast<int>(address[0]);
+        }
+        return opcode;
+    }
+
+    void finish_instruction(Context& ctx, int64_t gas, uint64_t now)
+    {
+        if (ctx.row < 0)
+            return;
+
+        auto& row = m_rows[static_cast<size_t>(ctx.row)];
+        if (row.ticks_hist == nullptr)
+        {
+            row.ticks_hist = std::make_unique<LogHistogram>();
+            row.ticks_per_gas_hist = std::make_unique<LogHistogram>();
+        }
+
+        const auto instr_gas = std::max(ctx.gas - gas - ctx.child_gas, int64_t{0});
+        const auto elapsed = now - ctx.ticks;
+        const auto ticks = elapsed > ctx.child_ticks ? elapsed - ctx.child_ticks : 0;
+        ++row.count;
+        row.gas += instr_gas;
+        row.ticks += ticks;
+        row.ticks_hist->add(ticks);
+        if (instr_gas != 0)
+            row.ticks_per_gas_hist->add(ticks * per_gas_scale / static_cast<uint64_t>(instr_gas));
+    }
+
+    void on_execution_start(
+        evmc_revision /*rev*/, const evmc_message& msg, bytes_view code) noexcept override
+    {
+        m_contexts.emplace(code.data(), msg.gas, read_ticks());
+    }
+
+    void on_instruction_start(uint32_t pc, const intx::uint256* stack_top, int stack_height,
+        int64_t gas, const ExecutionState& /*state*/) noexcept override
+    {
+        const auto now = read_ticks();
+        auto& ctx = m_contexts.top();
+        finish_instruction(ctx, gas, now);
+
+        ctx.row = get_row(ctx.code[pc], stack_top, stack_height);
+        ctx.gas = gas;
+        ctx.child_gas = 0;
+        ctx.child_ticks = 0;
+
+        // Exclude the time of this notification from the measurement.
+        ctx.ticks = read_ticks();
+    }
+
+    void on_execution_end(const evmc_result& result) noexcept override
+    {
+        const auto now = read_ticks();
+        auto& ctx = m_contexts.top();
+        finish_instruction(ctx, result.gas_left, now);
+        const auto gas_used = ctx.start_gas - result.gas_left;
+        const auto ticks = now - ctx.start_ticks;
+        m_contexts.pop();
+
+        if (!m_contexts.empty())
+        {
+            auto& parent = m_contexts.top();
+            parent.child_gas += gas_used;
+            parent.child_ticks += ticks;
+        }
+    }
+
+    void report() const
+    {
+        const auto elapsed_ticks = read_ticks() - m_start_ticks;
+        const auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_start_time)
+                                    .count();
+        const auto ns_per_tick = elapsed_ticks != 0 ? static_cast<double>(elapsed_ns) /
+                                                          static_cast<double>(elapsed_ticks) :
+                                                      1.0;
+        const auto ns = [ns_per_tick](double ticks) { return ticks * ns_per_tick; };
+
+        // The most expensive per gas first, then the instructions without gas cost.
+        std::vector<size_t> order;
+        for (size_t i = 0; i < m_rows.size(); ++i)
+        {
+            if (m_rows[i].count != 0)
+                order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            const auto& x = m_rows[a];
+            const auto& y = m_rows[b];
+            if ((x.gas != 0) != (y.gas != 0))
+                return x.gas != 0;
+            if (x.gas == 0)
+                return x.ticks > y.ticks;
+            return static_cast<double>(x.ticks) / static_cast<double>(x.gas) >
+                   static_cast<double>(y.ticks) / static_cast<double>(y.gas);
+        });
+
+        m_out << "--- # CYCLES clock=" << (EVMONE_TRACING_RDTSC ? "tsc" : "steady_clock")
+              << " ns_per_tick=" << ns_per_tick << '\n';
+        m_out << "name,count,gas,ns,ns_per_gas,p50_ns,p90_ns,p99_ns,"
+                 "p50_ns_per_gas,p99_ns_per_gas\n";
+        m_out << std::fixed << std::setprecision(2);
+        for (const auto i : order)
+        {
+            const auto& r = m_rows[i];
+            if (i < 256)
+                m_out << get_name(static_cast<uint8_t>(i));
+            else
+                m_out << "precompile/0x" << evmc::hex(static_cast<uint8_t>(i - 256));
+            m_out << ',' << r.count << ',' << r.gas << ',' << ns(static_cast<double>(r.ticks))
+                  << ',';
+            if (r.gas != 0)
+                m_out << ns(static_cast<double>(r.ticks) / static_cast<double>(r.gas));
+            for (const auto p : {50u, 90u, 99u})
+                m_out << ',' << ns(static_cast<double>(r.ticks_hist->percentile(p)));
+            for (const auto p : {50u, 99u})
+            {
+                m_out << ',';
+                if (r.gas != 0)
+                {
+                    m_out << ns(static_cast<double>(r.ticks_per_gas_hist->percentile(p)) /
+                                per_gas_scale);
+                }
+            }
+            m_out << '\n';
+        }
+        m_out << std::defaultfloat << std::setprecision(6);
+    }
+
+public:
+    explicit CycleTracer(std::ostream& out) noexcept
+      : m_out{out}, m_start_ticks{read_ticks()}, m_start_time{std::chrono::steady_clock::now()}
+    {}
+
+    ~CycleTracer() override { report(); }
+};
+
+/// @see create_storage_tracer()
+class StorageTracer : public Tracer
+{
+    struct SlotStats
+    {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+        uint64_t cold_reads = 0;
+        uint64_t cold_writes = 0;
+        std::array<uint64_t, EVMC_STORAGE_MODIFIED_RESTORED + 1> statuses{};
+    };
+
+    const size_t m_max_slots;
+    std::map<std::pair<evmc::address, evmc::bytes32>, SlotStats> m_slots;
+    std::ostream& m_out;
+
+    void on_execution_start(evmc_revision /*rev*/, const evmc_message& /*msg*/,
+        bytes_view /*code*/) noexcept override
+    {}
+
+    void on_instruction_start(uint32_t /*pc*/, const intx::uint256* /*stack_top*/,
+        int /*stack_height*/, int64_t /*gas*/, const ExecutionState& /*state*/) noexcept override
+    {}
+
+    void on_execution_end(const evmc_result& /*result*/) noexcept override {}
+
+    void on_storage_load(const evmc_address& addr, const evmc_bytes32& key,
+        evmc_access_status access_status) noexcept override
+    {
+        auto& slot = m_slots[{addr, key}];
+        ++slot.reads;
+        slot.cold_reads += access_status == EVMC_ACCESS_COLD;
+    }
+
+    void on_storage_store(const evmc_address& addr, const evmc_bytes32& key,
+        evmc_access_status access_status, evmc_storage_status storage_status) noexcept override
+    {
+        auto& slot = m_slots[{addr, key}];
+        ++slot.writes;
+        slot.cold_writes += access_status == EVMC_ACCESS_COLD;
+        ++slot.statuses[static_cast<size_t>(storage_status)];
+    }
+
+    void report() const
+    {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+        std::vector<const decltype(m_slots)::value_type*> slots;
+        slots.reserve(m_slots.size());
+        for (const auto& slot : m_slots)
+        {
+            reads += slot.second.reads;
+            writes += slot.second.writes;
+            slots.push_back(&slot);
+        }
+
+        // The most accessed first, the ties in the address and key order.
+        std::stable_sort(slots.begin(), slots.end(), [](const auto* a, const auto* b) noexcept {
+            return a->second.reads + a->second.writes > b->second.reads + b->second.writes;
+        });
+        slots.resize(std::min(slots.size(), m_max_slots));
+
+        m_out << "--- # STORAGE slots=" << m_slots.size() << " reads=" << reads
+              << " writes=" << writes
+              << "\naddress,key,reads,writes,cold_reads,cold_writes,assigned,added,deleted,"
+                 "modified,deleted_added,modified_deleted,deleted_restored,added_deleted,"
+                 "modified_restored\n";
+        for (const auto* slot : slots)
+        {
+            const auto& [addr, key] = slot->first;
+            const auto& stats = slot->second;
+            m_out << evmc::hex(addr) << ',' << evmc::hex(key) << ',' << stats.reads << ','
+                  << stats.writes << ',' << stats.cold_reads << ',' << stats.cold_writes;
+            for (const auto n : stats.statuses)
+                m_out << ',' << n;
+            m_out << '\n';
+        }
+    }
+
+public:
+    StorageTracer(std::ostream& out, size_t max_slots) noexcept
+      : m_max_slots{max_slots}, m_out{out}
+    {}
+
+    ~StorageTracer() override { report(); }
+};
+
+/// @see create_call_tree_tracer()
+class CallTreeTracer : public Tracer
+{
+    using clock = std::chrono::steady_clock;
+
+    struct Frame
+    {
+        const char* kind;
+        int32_t depth;
+        evmc::address sender;
+        evmc::address recipient;
+        evmc::address code_address;
+        size_t input_size;
+        int64_t gas;
+        clock::time_point start_time;
+
+        evmc_status_code status = EVMC_SUCCESS;
+        int64_t gas_used = 0;
+        int64_t storage_gas_consumed = 0;
+        int64_t speculative_cpu_gas_consumed = 0;
+        clock::duration time{};
+        clock::duration child_time{};
+        std::vector<size_t> calls{};  ///< The indexes of the frames called.
+    };
+
+    const CallTreeFormat m_format;
+    const clock::time_point m_start_time = clock::now();
+
+    /// The frames of the current top-level execution, the top-level frame first.
+    std::vector<Frame> m_frames;
+    std::stack<size_t> m_stack;  ///< The indexes of the frames being executed.
+
+    bool m_first_event = true;
+    std::ostream& m_out;
+
+    static const char* get_kind_name(const evmc_message& msg) noexcept
+    {
+        switch (msg.kind)
+        {
+        case EVMC_CALL:
+            return (msg.flags & EVMC_STATIC) != 0 ? "STATICCALL" : "CALL";
+        case EVMC_DELEGATECALL:
+            return "DELEGATECALL";
+        case EVMC_CALLCODE:
+            return "CALLCODE";
+        case EVMC_CREATE:
+            return "CREATE";
+        case EVMC_CREATE2:
+            return "CREATE2";
+        default:
+            return "UNKNOWN";
+        }
+    }
+
+    static auto to_ns(clock::duration d) noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    }
+
+    /// Outputs the duration in microseconds with the fixed nanosecond precision.
+    void output_us(clock::duration d)
+    {
+        const auto ns = to_ns(d);
+        m_out << ns / 1000 << '.' << std::to_string(1000 + ns % 1000).substr(1);
+    }
+
+    /// Outputs the frame fields of both formats (without the braces).
+    void output_fields(const Frame& f)
+    {
+        m_out << R"("kind":")" << f.kind << '"';
+        m_out << R"(,"depth":)" << f.depth;
+        m_out << R"(,"from":"0x)" << evmc::hex(f.sender) << '"';
+        m_out << R"(,"to":"0x)" << evmc::hex(f.recipient) << '"';
+        m_out << R"(,"code":"0x)" << evmc::hex(f.code_address) << '"';
+        m_out << R"(,"inputSize":)" << f.input_size;
+        m_out << R"(,"gas":)" << f.gas;
+        m_out << R"(,"gasUsed":)" << f.gas_used;
+        m_out << R"(,"storageGas":)" << f.storage_gas_consumed;
+        m_out << R"(,"speculativeCpuGas":)" << f.speculative_cpu_gas_consumed;
+        m_out << R"(,"status":")" << f.status << '"';
+    }
+
+    void output_json(size_t index)  // NOLINT(misc-no-recursion)
+    {
+        const auto& f = m_frames[index];
+        m_out << '{';
+        output_fields(f);
+        m_out << R"(,"timeNs":)" << to_ns(f.time);
+        m_out << R"(,"selfTimeNs":)" << to_ns(f.time - f.child_time);
+        m_out << R"(,"calls":[)";
+        for (size_t i = 0; i < f.calls.size(); ++i)
+        {
+            if (i != 0)
+                m_out << ',';
+            output_json(f.calls[i]);
+        }
+        m_out << "]}";
+    }
+
+    /// Outputs the frames as the Chrome trace "complete" events, the times in microseconds.
+    void output_chrome_events()
+    {
+        for (const auto& f : m_frames)
+        {
+            m_out << (m_first_event ? "" : ",\n");
+            m_first_event = false;
+            m_out << R"({"name":")" << f.kind << " 0x" << evmc::hex(f.code_address) << '"';
+            m_out << R"(,"ph":"X","pid":0,"tid":0)";
+            m_out << R"(,"ts":)";
+            output_us(f.start_time - m_start_time);
+            m_out << R"(,"dur":)";
+            output_us(f.time);
+            m_out << R"(,"args":{)";
+            output_fields(f);
+            m_out << R"(,"selfTimeUs":)";
+            output_us(f.time - f.child_time);
+            m_out << "}}";
+        }
+    }
+
+    void on_execution_start(
+        evmc_revision /*rev*/, const evmc_message& msg, bytes_view /*code*/) noexcept override
+    {
+        const auto index = m_frames.size();
+        if (!m_stack.empty())
+            m_frames[m_stack.top()].calls.push_back(index);
+        m_stack.push(index);
+        m_frames.push_back({get_kind_name(msg), msg.depth, msg.sender, msg.recipient,
+            msg.code_address, msg.input_size, msg.gas, clock::now()});
+    }
+
+    void on_instruction_start(uint32_t /*pc*/, const intx::uint256* /*stack_top*/,
+        int /*stack_height*/, int64_t /*gas*/, const ExecutionState& /*state*/) noexcept override
+    {}
+
+    void on_execution_end(const evmc_result& result) noexcept override
+    {
+        auto& f = m_frames[m_stack.top()];
+        m_stack.pop();
+        f.time = clock::now() - f.start_time;
+        f.status = result.status_code;
+        f.gas_used = f.gas - result.gas_left;
+        f.storage_gas_consumed = result.storage_gas_consumed;
+        f.speculative_cpu_gas_consumed = result.speculative_cpu_gas_consumed;
+        if (!m_stack.empty())
+        {
+            m_frames[m_stack.top()].child_time += f.time;
+            return;
+        }
+
+        // The call tree of the top-level execution is complete.
+        if (m_format == CallTreeFormat::json)
+        {
+            output_json(0);
+            m_out << '\n';
+        }
+        else
+            output_chrome_events();
+        m_frames.clear();
+    }
+
+public:
+    CallTreeTracer(std::ostream& out, CallTreeFormat format) noexcept
+      : m_format{format}, m_out{out}
+    {
+        if (m_format == CallTreeFormat::chrome)
+            m_out << "[\n";
+    }
+
+    ~CallTreeTracer() override
+    {
+        if (m_format == CallTreeFormat::chrome)
+            m_out << "\n]\n";
+    }
+};
 }  // namespace
 
+bool TracerFilter::matches(const evmc_message& msg, bytes_view code) const noexcept
+{
+    if (msg.depth < min_depth || msg.depth > max_depth || msg.gas < min_gas)
+        return false;
+    if (code_address.has_value() && *code_address != msg.code_address)
+        return false;
+    if (code_hash.has_value())
+    {
+        const auto h = ethash::keccak256(code.data(), code.size());
+        if (!std::equal(std::begin(h.bytes), std::end(h.bytes), code_hash->bytes))
+            return false;
+    }
+    return true;
+}
+
 std::unique_ptr<Tracer> create_histogram_tracer(std::ostream& out)
 {
     return std::make_unique<HistogramTracer>(out);
 }
 
+std::unique_ptr<AggregatedHistogramTracer> create_aggregated_histogram_tracer(
+    std::ostream& out, bool opcode_pairs)
+{
+    return std::make_unique<AggregatedHistogramTracerImpl>(out, opcode_pairs);
+}
+
 std::unique_ptr<Tracer> create_instruction_tracer(std::ostream& out)
 {
     return std::make_unique<InstructionTracer>(out);
 }
+
+bool convert_binary_trace(bytes_view trace, std::ostream& out)
+{
+    using namespace binary_trace;
+
+    struct Context
+    {
+        const int64_t start_gas;
+        uint32_t pc = 0;
+        int64_t gas;
+        size_t memory_size = 0;
+        std::vector<intx::uint256> stack;
+
+        /// The memory words written, the others are zero. Only these are stored so that
+        /// the allocation is bounded by the size of the trace, not by the memory size declared.
+        std::map<size_t, std::array<uint8_t, 32>> memory;
+
+        explicit Context(int64_t g) noexcept : start_gas{g}, gas{g} {}
+    };
+
+    Reader in{trace.data(), trace.data() + trace.size()};
+    const auto header = in.bytes(sizeof(magic));
+    if (header == nullptr || std::memcmp(header, magic, sizeof(magic)) != 0 ||
+        in.byte() != version)
+        return false;
+    const auto trace_memory = (in.byte() & flag_memory) != 0;
+
+    out << std::dec;
+    std::stack<Context> contexts;
+    while (!in.empty() && !in.error())
+    {
+        switch (in.byte())
+        {
+        case tag_execution_start:
+        {
+            const auto depth = static_cast<int32_t>(in.varint());
+            const auto rev = static_cast<evmc_revision>(in.byte());
+            const auto is_static = in.byte() != 0;
+            const auto gas = in.signed_varint();
+            if (in.error())
+                return false;
+            contexts.emplace(gas);
+            output_execution_start(out, depth, rev, is_static);
+            break;
+        }
+        case tag_instruction:
+        {
+            if (contexts.empty())
+                return false;
+            auto& ctx = contexts.top();
+            ctx.pc = static_cast<uint32_t>(ctx.pc + in.signed_varint());
+            const auto opcode = in.byte();
+            ctx.gas -= in.signed_varint();
+
+            const auto num_popped = in.varint();
+            const auto num_pushed = in.varint();
+            if (num_popped > ctx.stack.size() ||
+                num_pushed > size_t{StackSpace::limit} - (ctx.stack.size() - num_popped))
+                return false;
+            ctx.stack.resize(ctx.stack.size() - num_popped);
+            for (size_t i = 0; i < num_pushed; ++i)
+                ctx.stack.push_back(in.word());
+
+            const auto memory_size = static_cast<int64_t>(ctx.memory_size) + in.signed_varint();
+            if (memory_size < 0 || memory_size > int64_t{std::numeric_limits<uint32_t>::max()})
+                return false;
+            ctx.memory_size = static_cast<size_t>(memory_size);
+            if (trace_memory)
+            {
+                const auto num_ranges = in.varint();
+                size_t offset = 0;
+                for (size_t i = 0; i < num_ranges && !in.error(); ++i)
+                {
+                    const auto gap = in.varint();
+                    const auto size = in.varint();
+                    const auto data = in.bytes(size);
+                    if (data == nullptr || gap > ctx.memory_size - offset ||
+                        size > ctx.memory_size - offset - gap)
+                        return false;
+                    offset += gap;
+                    for (size_t j = 0; j < size; ++j, ++offset)
+                        ctx.memory[offset / 32][offset % 32] = data[j];
+                }
+            }
+            if (in.error())
+                return false;
+
+            output_instruction(out, ctx.pc, opcode, ctx.gas, ctx.stack.data(),
+                ctx.stack.data() + ctx.stack.size(), ctx.memory_size);
+            if (trace_memory)
+            {
+                static constexpr std::array<uint8_t, 32> zero_word{};
+                out << R"(,"memory":")";
+                auto it = ctx.memory.begin();
+                for (size_t offset = 0; offset < ctx.memory_size; offset += 32)
+                {
+                    const auto* word = zero_word.data();
+                    if (it != ctx.memory.end() && it->first == offset / 32)
+                        word = (it++)->second.data();
+                    out << evmc::hex({word, std::min<size_t>(32, ctx.memory_size - offset)});
+                }
+                out << '"';
+            }
+            out << "}\n";
+            break;
+        }
+        case tag_execution_end:
+        {
+            if (contexts.empty())
+                return false;
+            const auto status_code = static_cast<evmc_status_code>(in.signed_varint());
+            const auto gas_left = in.signed_varint();
+            const auto output_size = in.varint();
+            const auto output = in.bytes(output_size);
+            if (in.error())
+                return false;
+            output_execution_end(out, status_code, gas_left, contexts.top().start_gas - gas_left,
+                {output, output_size});
+            contexts.pop();
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return !in.error();
+}
+
+std::unique_ptr<Tracer> create_cycle_tracer(std::ostream& out)
+{
+    return std::make_unique<CycleTracer>(out);
+}
+
+std::unique_ptr<Tracer> create_storage_tracer(std::ostream& out, size_t max_slots)
+{
+    return std::make_unique<StorageTracer>(out, max_slots);
+}
+
+std::unique_ptr<Tracer> create_call_tree_tracer(std::ostream& out, CallTreeFormat format)
+{
+    return std::make_unique<CallTreeTracer>(out, format);
+}
+
+std::unique_ptr<Tracer> create_profiler_tracer(std::ostream& out, uint32_t sample_period)
+{
+    return std::make_unique<ProfilerTracer>(out, sample_period);
+}
 }  // namespace evmone
@@ -3,11 +3,15 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
-#include <evmc/evmc.h>
+#include <evmc/evmc.hpp>
 #include <evmc/utils.h>
 #include <intx/intx.hpp>
+#include <array>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <ostream>
+#include <string>
 #include <string_view>
 
 namespace evmone
@@ -48,12 +52,60 @@ public:
             m_next_tracer->notify_instruction_start(pc, stack_top, stack_height, gas, state);
     }
 
+    void notify_storage_load(  // NOLINT(misc-no-recursion)
+        const evmc_address& addr, const evmc_bytes32& key,
+        evmc_access_status access_status) noexcept
+    {
+        on_storage_load(addr, key, access_status);
+        if (m_next_tracer)
+            m_next_tracer->notify_storage_load(addr, key, access_status);
+    }
+
+    void notify_storage_store(  // NOLINT(misc-no-recursion)
+        const evmc_address& addr, const evmc_bytes32& key, evmc_access_status access_status,
+        evmc_storage_status storage_status) noexcept
+    {
+        on_storage_store(addr, key, access_status, storage_status);
+        if (m_next_tracer)
+            m_next_tracer->notify_storage_store(addr, key, access_status, storage_status);
+    }
+
 private:
     virtual void on_execution_start(
         evmc_revision rev, const evmc_message& msg, bytes_view code) noexcept = 0;
     virtual void on_instruction_start(uint32_t pc, const intx::uint256* stack_top, int stack_height,
         int64_t gas, const ExecutionState& state) noexcept = 0;
     virtual void on_execution_end(const evmc_result& result) noexcept = 0;
+
+    /// Called by SLOAD after the storage is accessed. The access is warm before Berlin.
+    virtual void on_storage_load(const evmc_address& /*addr*/, const evmc_bytes32& /*key*/,
+        evmc_access_status /*access_status*/) noexcept
+    {}
+
+    /// Called by SSTORE after the storage is modified. The access is warm before Berlin.
+    virtual void on_storage_store(const evmc_address& /*addr*/, const evmc_bytes32& /*key*/,
+        evmc_access_status /*access_status*/, evmc_storage_status /*storage_status*/) noexcept
+    {}
+};
+
+/// The predicate selecting the execution frames passed to the tracers, evaluated once
+/// at the start of every frame. The frames not selected are executed without tracing
+/// (at the full speed) and none of their notifications are passed to the tracers.
+struct TracerFilter
+{
+    /// The address of the executed code (evmc_message::code_address).
+    std::optional<evmc::address> code_address;
+
+    /// The Keccak hash of the executed code. Hashing the code adds cost to every frame.
+    std::optional<evmc::bytes32> code_hash;
+
+    int32_t min_depth = 0;
+    int32_t max_depth = std::numeric_limits<int32_t>::max();
+
+    /// The minimum amount of gas the frame starts with.
+    int64_t min_gas = 0;
+
+    [[nodiscard]] EVMC_EXPORT bool matches(const evmc_message& msg, bytes_view code) const noexcept;
 };
 
 /// Creates the "histogram" tracer which counts occurrences of individual opcodes during execution
@@ -63,6 +115,123 @@ private:
 /// @return     Histogram tracer object.
 EVMC_EXPORT std::unique_ptr<Tracer> create_histogram_tracer(std::ostream& out);
 
+/// The opcode counts per EVM revision.
+struct OpcodeHistogram
+{
+    static constexpr size_t NumRevisions = EVMC_MAX_REVISION + 1;
+
+    std::array<uint64_t, NumRevisions> executions{};
+    std::array<std::array<uint64_t, 256>, NumRevisions> opcodes{};
+
+    /// The counts of the opcode pairs indexed by (first << 8 | second), null if not counted.
+    std::array<std::unique_ptr<std::array<uint64_t, 256 * 256>>, NumRevisions> pairs;
+};
+
+/// The "aggregated histogram" tracer, see create_aggregated_histogram_tracer().
+class AggregatedHistogramTracer : public Tracer
+{
+public:
+    /// Merges the counters of all the threads. Can be called while the executions
+    /// are in progress, their counts up to this point are included.
+    [[nodiscard]] virtual std::unique_ptr<OpcodeHistogram> snapshot() = 0;
+};
+
+/// Creates the "aggregated histogram" tracer which counts occurrences of individual opcodes
+/// (and optionally of the pairs of the consecutive opcodes) per EVM revision over all executions.
+/// The counting is done in the counters of the executing thread, these are merged
+/// on snapshot() and the single report is output in CSV format when the tracer is destroyed.
+///
+/// @param out           Report output stream.
+/// @param opcode_pairs  Also count the pairs of the consecutive opcodes of the same frame.
+/// @return              Aggregated histogram tracer object.
+EVMC_EXPORT std::unique_ptr<AggregatedHistogramTracer> create_aggregated_histogram_tracer(
+    std::ostream& out, bool opcode_pairs = false);
+
 EVMC_EXPORT std::unique_ptr<Tracer> create_instruction_tracer(std::ostream& out);
 
+/// Creates the "binary" tracer which records the information of the instruction tracer
+/// in the compact binary format (see binary_trace.hpp). The records are passed through
+/// the lock-free ring buffer to the background thread writing them to the file.
+///
+/// @param path          Trace output file path.
+/// @param trace_memory  Also record the changes of the memory contents.
+/// @return              Binary tracer object or null if the file cannot be opened.
+EVMC_EXPORT std::unique_ptr<Tracer> create_binary_tracer(
+    const std::string& path, bool trace_memory = false);
+
+/// Converts the binary trace to the JSON format of the instruction tracer. If the memory changes
+/// are recorded, the instruction objects have additional "memory" field with the memory contents.
+///
+/// @param trace  The binary trace.
+/// @param out    JSON output stream.
+/// @return       False if the trace is invalid or truncated (the records before are converted).
+EVMC_EXPORT bool convert_binary_trace(bytes_view trace, std::ostream& out);
+
+/// Creates the "cycles" tracer which measures the CPU time of every instruction (using the CPU
+/// time stamp counter where available) for the calibration of the gas costs. The calls of
+/// the precompiles are reported separately by the precompile address. The time of the child
+/// frames is excluded.
+///
+/// When the tracer is destroyed the report is output as CSV with the count, the total gas and
+/// time, the time per gas and the percentiles of the time and the time per gas of the single
+/// execution of every opcode, the most expensive per gas first. The measurements include
+/// some of the tracing overhead.
+///
+/// @param out  Report output stream.
+/// @return     Cycle tracer object.
+EVMC_EXPORT std::unique_ptr<Tracer> create_cycle_tracer(std::ostream& out);
+
+/// Creates the "storage" tracer which counts the storage accesses by SLOAD and SSTORE
+/// per address and storage key, aggregated over all executions: the reads and the writes,
+/// the cold accesses (EIP-2929) and the storage statuses of the writes.
+///
+/// When the tracer is destroyed the most accessed slots are reported as CSV.
+///
+/// @param out        Report output stream.
+/// @param max_slots  The maximum number of the slots reported.
+/// @return           Storage tracer object.
+EVMC_EXPORT std::unique_ptr<Tracer> create_storage_tracer(
+    std::ostream& out, size_t max_slots = 100);
+
+/// The output format of the call tree tracer.
+enum class CallTreeFormat
+{
+    json,    ///< The JSON object of the call tree per top-level execution, one per line.
+    chrome,  ///< The JSON array of the Chrome trace "complete" events of the frames.
+};
+
+/// Creates the "call tree" tracer which records the tree of the execution frames (the calls
+/// and creates) with the kind, the addresses, the input size, the gas provided and used,
+/// the EOS storage gas and speculative CPU gas, the status and the wall time including and
+/// excluding the calls made. Only the execution start and end notifications are used.
+///
+/// The tree contains only the frames executed by the VM: the calls of the precompiles
+/// and of the accounts without code are handled by the host without the execution,
+/// so they are not recorded (their gas and time are attributed to the calling frame).
+///
+/// The call tree is output when the top-level execution ends. The Chrome trace events
+/// can be loaded to chrome://tracing or Perfetto, the array is closed when the tracer
+/// is destroyed.
+///
+/// @param out     Output stream.
+/// @param format  Output format.
+/// @return        Call tree tracer object.
+EVMC_EXPORT std::unique_ptr<Tracer> create_call_tree_tracer(
+    std::ostream& out, CallTreeFormat format = CallTreeFormat::json);
+
+/// Creates the "profiler" tracer which attributes the gas and the time spent in execution
+/// to the instructions (identified by the code hash and the pc) and to the call stacks,
+/// aggregated over all executions. The costs of the calls are attributed to the called frames.
+///
+/// When the tracer is destroyed the profile is reported as CSV (per instruction)
+/// and in the "folded stacks" format (per call stack, for flame graphs) weighted by gas
+/// and by time.
+///
+/// @param out            Report output stream.
+/// @param sample_period  Measure only every Nth instruction (1 measures all of them).
+///                       The reported gas and time are then estimated by multiplying by N.
+/// @return               Profiler tracer object.
+EVMC_EXPORT std::unique_ptr<Tracer> create_profiler_tracer(
+    std::ostream& out, uint32_t sample_period = 1);
+
 }  // namespace evmone
@@ -9,11 +9,15 @@
 
 #if not defined(ANTELOPE)
 #include "advanced_execution.hpp"
+#include "perf_map.hpp"
 #endif
 
 #include "baseline.hpp"
+#include <evmc/hex.hpp>
 #include <evmone/evmone.h>
 #include <cassert>
+#include <charconv>
+#include <optional>
 #if not defined(ANTELOPE)
 #include <iostream>
 #endif
@@ -33,6 +37,17 @@ constexpr evmc_capabilities_flagset get_capabilities(evmc_vm* /*vm*/) noexcept
     return EVMC_CAPABILITY_EVM1;
 }
 
+/// Parses the whole string as the decimal number.
+template <typename T>
+std::optional<T> parse_number(std::string_view s) noexcept
+{
+    T v{};
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc{} || end != s.data() + s.size())
+        return std::nullopt;
+    return v;
+}
+
 evmc_set_option_result set_option(evmc_vm* c_vm, char const* c_name, char const* c_value) noexcept
 {
     const auto name = (c_name != nullptr) ? std::string_view{c_name} : std::string_view{};
@@ -60,6 +75,13 @@ evmc_set_option_result set_option(evmc_vm* c_vm, char const* c_name, char const*
         return EVMC_SET_OPTION_INVALID_NAME;
 #endif
     }
+    else if (name == "stats")
+    {
+        #if not defined(ANTELOPE)
+        vm.enable_contract_stats();
+        return EVMC_SET_OPTION_SUCCESS;
+        #endif
+    }
     else if (name == "trace")
     {
         #if not defined(ANTELOPE)
@@ -70,7 +92,118 @@ evmc_set_option_result set_option(evmc_vm* c_vm, char const* c_name, char const*
     else if (name == "histogram")
     {
         #if not defined(ANTELOPE)
-        vm.add_tracer(create_histogram_tracer(std::cerr));
+        if (value.empty())
+            vm.add_tracer(create_histogram_tracer(std::cerr));
+        else if (value == "aggregate" || value == "pairs")
+            vm.add_tracer(create_aggregated_histogram_tracer(std::cerr, value == "pairs"));
+        else
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        return EVMC_SET_OPTION_SUCCESS;
+        #endif
+    }
+    else if (name == "trace_binary")
+    {
+        #if not defined(ANTELOPE)
+        auto tracer = create_binary_tracer(std::string{value});
+        if (tracer == nullptr)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.add_tracer(std::move(tracer));
+        return EVMC_SET_OPTION_SUCCESS;
+        #endif
+    }
+    else if (name == "cycles")
+    {
+        #if not defined(ANTELOPE)
+        vm.add_tracer(create_cycle_tracer(std::cerr));
+        return EVMC_SET_OPTION_SUCCESS;
+        #endif
+    }
+    else if (name == "storage")
+    {
+        #if not defined(ANTELOPE)
+        const auto max_slots = value.empty() ? 100 : parse_number<size_t>(value);
+        if (!max_slots.has_value())
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.add_tracer(create_storage_tracer(std::cerr, *max_slots));
+        return EVMC_SET_OPTION_SUCCESS;
+        #endif
+    }
+    else if (name == "profile")
+    {
+        #if not defined(ANTELOPE)
+        const auto sample_period = value.empty() ? 1 : parse_number<uint32_t>(value);
+        if (!sample_period.has_value() || *sample_period == 0)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.add_tracer(create_profiler_tracer(std::cerr, *sample_period));
+        return EVMC_SET_OPTION_SUCCESS;
+        #endif
+    }
+    else if (name == "calltree")
+    {
+        #if not defined(ANTELOPE)
+        if (value.empty() || value == "json")
+            vm.add_tracer(create_call_tree_tracer(std::cerr, CallTreeFormat::json));
+        else if (value == "chrome")
+            vm.add_tracer(create_call_tree_tracer(std::cerr, CallTreeFormat::chrome));
+        else
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        return EVMC_SET_OPTION_SUCCESS;
+        #endif
+    }
+    else if (name == "perf")
+    {
+        #if not defined(ANTELOPE)
+        const auto ranges = perf::get_opcode_handler_ranges();
+        if (value == "map" && perf::write_perf_map(perf::get_perf_map_path(), ranges))
+            return EVMC_SET_OPTION_SUCCESS;
+        if (value == "jitdump" && perf::write_jitdump(perf::get_jitdump_path(), ranges))
+            return EVMC_SET_OPTION_SUCCESS;
+        return EVMC_SET_OPTION_INVALID_VALUE;
+        #endif
+    }
+    else if (name == "trace_address")
+    {
+        #if not defined(ANTELOPE)
+        vm.tracer_filter.code_address = evmc::from_hex<evmc::address>(value);
+        return vm.tracer_filter.code_address.has_value() ? EVMC_SET_OPTION_SUCCESS :
+                                                           EVMC_SET_OPTION_INVALID_VALUE;
+        #endif
+    }
+    else if (name == "trace_code_hash")
+    {
+        #if not defined(ANTELOPE)
+        vm.tracer_filter.code_hash = evmc::from_hex<evmc::bytes32>(value);
+        return vm.tracer_filter.code_hash.has_value() ? EVMC_SET_OPTION_SUCCESS :
+                                                        EVMC_SET_OPTION_INVALID_VALUE;
+        #endif
+    }
+    else if (name == "trace_depth")
+    {
+        #if not defined(ANTELOPE)
+        // The single depth "N", or the range "N-M", or "N-" for the depths from N.
+        const auto sep = value.find('-');
+        const auto min_depth = parse_number<int32_t>(value.substr(0, sep));
+        auto max_depth = min_depth;
+        if (sep != std::string_view::npos)
+        {
+            const auto max = value.substr(sep + 1);
+            max_depth = max.empty() ? std::numeric_limits<int32_t>::max() :
+                                      parse_number<int32_t>(max);
+        }
+        if (!min_depth.has_value() || !max_depth.has_value() || *min_depth > *max_depth)
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.tracer_filter.min_depth = *min_depth;
+        vm.tracer_filter.max_depth = *max_depth;
+        return EVMC_SET_OPTION_SUCCESS;
+        #endif
+    }
+    else if (name == "trace_min_gas")
+    {
+        #if not defined(ANTELOPE)
+        const auto min_gas = parse_number<int64_t>(value);
+        if (!min_gas.has_value())
+            return EVMC_SET_OPTION_INVALID_VALUE;
+        vm.tracer_filter.min_gas = *min_gas;
         return EVMC_SET_OPTION_SUCCESS;
         #endif
     }
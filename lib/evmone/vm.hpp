@@ -6,6 +6,10 @@
 #include "tracing.hpp"
 #include <evmc/evmc.h>
 
+#if not defined(ANTELOPE)
+#include "contract_stats.hpp"
+#endif
+
 #if defined(_MSC_VER) && !defined(__clang__)
 #define EVMONE_CGOTO_SUPPORTED 0
 #else
@@ -20,8 +24,14 @@ class VM : public evmc_vm
 public:
     bool cgoto = EVMONE_CGOTO_SUPPORTED;
 
+    /// The filter of the execution frames passed to the tracers. All frames by default.
+    TracerFilter tracer_filter;
+
 private:
     std::unique_ptr<Tracer> m_first_tracer;
+#if not defined(ANTELOPE)
+    std::unique_ptr<ContractStatsRegistry> m_contract_stats;
+#endif
 
 public:
     inline constexpr VM() noexcept;
@@ -36,5 +46,21 @@ public:
     }
 
     [[nodiscard]] Tracer* get_tracer() const noexcept { return m_first_tracer.get(); }
+
+#if not defined(ANTELOPE)
+    /// Enables collecting the per-contract execution statistics.
+    /// Must not be called concurrently with the executions.
+    void enable_contract_stats() noexcept
+    {
+        if (!m_contract_stats)
+            m_contract_stats = std::make_unique<ContractStatsRegistry>();
+    }
+
+    /// Returns the per-contract execution statistics registry or null if not enabled.
+    [[nodiscard]] ContractStatsRegistry* get_contract_stats() const noexcept
+    {
+        return m_contract_stats.get();
+    }
+#endif
 };
 }  // namespace evmone
@@ -0,0 +1,198 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "blake2b.hpp"
+#include <bit>
+#include <cstddef>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EVMONE_BLAKE2B_AVX2 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace evmone::crypto
+{
+namespace
+{
+constexpr uint64_t IV[8] = {
+    0x6a09e667f3bcc908,
+    0xbb67ae8584caa73b,
+    0x3c6ef372fe94f82b,
+    0xa54ff53a5f1d36f1,
+    0x510e527fade682d1,
+    0x9b05688c2b3e6c1f,
+    0x1f83d9abfb41bd6b,
+    0x5be0cd19137e2179,
+};
+
+/// The message word permutations, the round i uses SIGMA[i % 10].
+constexpr uint8_t SIGMA[10][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+};
+
+inline void g(
+    uint64_t v[16], size_t a, size_t b, size_t c, size_t d, uint64_t x, uint64_t y) noexcept
+{
+    v[a] = v[a] + v[b] + x;
+    v[d] = std::rotr(v[d] ^ v[a], 32);
+    v[c] = v[c] + v[d];
+    v[b] = std::rotr(v[b] ^ v[c], 24);
+    v[a] = v[a] + v[b] + y;
+    v[d] = std::rotr(v[d] ^ v[a], 16);
+    v[c] = v[c] + v[d];
+    v[b] = std::rotr(v[b] ^ v[c], 63);
+}
+
+}  // namespace
+
+void internal::blake2b_compress_generic(
+    uint32_t rounds, uint64_t h[8], const uint64_t m[16], const uint64_t t[2], bool last) noexcept
+{
+    uint64_t v[16]{h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7], IV[0], IV[1], IV[2], IV[3],
+        IV[4] ^ t[0], IV[5] ^ t[1], last ? ~IV[6] : IV[6], IV[7]};
+
+    for (uint32_t r = 0, i = 0; r < rounds; ++r, i = (i == 9 ? 0 : i + 1))
+    {
+        const auto& s = SIGMA[i];
+        g(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        g(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        g(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        g(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        g(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        g(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        g(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        g(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (size_t i = 0; i < 8; ++i)
+        h[i] ^= v[i] ^ v[i + 8];
+}
+
+namespace
+{
+#if EVMONE_BLAKE2B_AVX2
+/// Computes the G function on the 4 columns (or diagonals) at once,
+/// the rows of the 4x4 state are in the AVX2 registers.
+__attribute__((target("avx2"))) inline void g_avx2(
+    __m256i& a, __m256i& b, __m256i& c, __m256i& d, __m256i x, __m256i y) noexcept
+{
+    // The rotations by 16 and 24 bits are the byte shuffles.
+    const auto rotr16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2,
+        3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    const auto rotr24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3,
+        4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+
+    a = _mm256_add_epi64(_mm256_add_epi64(a, b), x);
+    d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), 0xB1);
+    c = _mm256_add_epi64(c, d);
+    b = _mm256_shuffle_epi8(_mm256_xor_si256(b, c), rotr24);
+    a = _mm256_add_epi64(_mm256_add_epi64(a, b), y);
+    d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotr16);
+    c = _mm256_add_epi64(c, d);
+    b = _mm256_xor_si256(b, c);
+    b = _mm256_or_si256(_mm256_srli_epi64(b, 63), _mm256_add_epi64(b, b));
+}
+
+/// Compresses using AVX2: the rows of the state in 4 registers, the G functions
+/// of a round computed as 2 vector steps (the columns, then the diagonals).
+///
+/// The message words are permuted into the vectors once for all 10 distinct
+/// permutations, so the rounds (up to 2^32 - 1) only load them.
+__attribute__((target("avx2"))) void compress_avx2(
+    uint32_t rounds, uint64_t h[8], const uint64_t m[16], const uint64_t t[2], bool last) noexcept
+{
+    const auto num_schedules = rounds < 10 ? rounds : 10;
+    __m256i schedule[10][4];
+    for (size_t i = 0; i < num_schedules; ++i)
+    {
+        const auto& s = SIGMA[i];
+        for (size_t j = 0; j < 4; ++j)
+        {
+            // The x and y words of the 4 column G functions, then of the 4 diagonal ones.
+            const auto o = (j / 2) * 8 + (j % 2);
+            schedule[i][j] = _mm256_setr_epi64x(static_cast<long long>(m[s[o]]),
+                static_cast<long long>(m[s[o + 2]]), static_cast<long long>(m[s[o + 4]]),
+                static_cast<long long>(m[s[o + 6]]));
+        }
+    }
+
+    const auto h0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&h[0]));
+    const auto h1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&h[4]));
+    auto a = h0;
+    auto b = h1;
+    auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&IV[0]));
+    auto d = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&IV[4])),
+        _mm256_setr_epi64x(static_cast<long long>(t[0]), static_cast<long long>(t[1]),
+            last ? -1 : 0, 0));
+
+    for (uint32_t r = 0, i = 0; r < rounds; ++r, i = (i == 9 ? 0 : i + 1))
+    {
+        const auto& s = schedule[i];
+        g_avx2(a, b, c, d, s[0], s[1]);
+
+        // Rotate the rows to put the diagonals into the columns.
+        b = _mm256_permute4x64_epi64(b, 0x39);
+        c = _mm256_permute4x64_epi64(c, 0x4E);
+        d = _mm256_permute4x64_epi64(d, 0x93);
+        g_avx2(a, b, c, d, s[2], s[3]);
+        b = _mm256_permute4x64_epi64(b, 0x93);
+        c = _mm256_permute4x64_epi64(c, 0x4E);
+        d = _mm256_permute4x64_epi64(d, 0x39);
+    }
+
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(&h[0]), _mm256_xor_si256(h0, _mm256_xor_si256(a, c)));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(&h[4]), _mm256_xor_si256(h1, _mm256_xor_si256(b, d)));
+}
+
+bool has_avx2() noexcept
+{
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0 || (ecx & bit_OSXSAVE) == 0)
+        return false;
+
+    // The OS must save the YMM registers.
+    unsigned xcr0 = 0, xcr0_hi = 0;
+    __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0 & 0x6) != 0x6)
+        return false;
+
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+        return false;
+    return (ebx & bit_AVX2) != 0;
+}
+#endif
+
+}  // namespace
+
+internal::Blake2bCompressFn internal::get_blake2b_compress_avx2() noexcept
+{
+#if EVMONE_BLAKE2B_AVX2
+    if (has_avx2())
+        return compress_avx2;
+#endif
+    return nullptr;
+}
+
+void blake2b_compress(
+    uint32_t rounds, uint64_t h[8], const uint64_t m[16], const uint64_t t[2], bool last) noexcept
+{
+    static const auto compress = [] {
+        const auto avx2 = internal::get_blake2b_compress_avx2();
+        return avx2 != nullptr ? avx2 : internal::blake2b_compress_generic;
+    }();
+    compress(rounds, h, m, t, last);
+}
+}  // namespace evmone::crypto
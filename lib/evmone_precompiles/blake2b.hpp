@@ -0,0 +1,31 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstdint>
+
+namespace evmone::crypto
+{
+/// Computes the BLAKE2b compression function F with the given number of rounds
+/// (the BLAKE2F precompile, EIP-152). The state h is updated in place.
+///
+/// The implementation is selected once at runtime: AVX2 if supported by the CPU,
+/// the portable one otherwise.
+void blake2b_compress(
+    uint32_t rounds, uint64_t h[8], const uint64_t m[16], const uint64_t t[2], bool last) noexcept;
+
+/// The implementations of the compression function, exposed for testing.
+namespace internal
+{
+using Blake2bCompressFn = void (*)(uint32_t rounds, uint64_t h[8], const uint64_t m[16],
+    const uint64_t t[2], bool last) noexcept;
+
+/// The portable implementation.
+void blake2b_compress_generic(
+    uint32_t rounds, uint64_t h[8], const uint64_t m[16], const uint64_t t[2], bool last) noexcept;
+
+/// Returns the implementation using AVX2 or null if the CPU does not support it.
+Blake2bCompressFn get_blake2b_compress_avx2() noexcept;
+}  // namespace internal
+}  // namespace evmone::crypto
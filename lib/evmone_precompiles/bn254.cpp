@@ -0,0 +1,701 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bn254.hpp"
+#include <intx/intx.hpp>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <vector>
+
+namespace evmone::crypto
+{
+namespace
+{
+using intx::uint256;
+using intx::operator""_u256;
+
+/// The BN254 field prime p.
+constexpr auto FieldPrime = 0x30644e72e131a029b85045b68181585d97816a916871ca8d3c208c16d87cfd47_u256;
+
+/// The order r of the G1 and G2 groups.
+constexpr auto Order = 0x30644e72e131a029b85045b68181585d2833e84879b9709143e1f593f0000001_u256;
+
+/// The -p^-1 mod 2^64 of the Montgomery reduction.
+constexpr uint64_t FieldPrimeNegInv = 0x87d20782e4866389;
+
+/// The R^2 mod p (R = 2^256) converting the values to the Montgomery form.
+constexpr auto R2 = 0x06d89f71cab8351f47ab1eff0a417ff6b5e71911d44501fbf32cfc5b538afa89_u256;
+
+/// The curve parameter u defining p, r and the pairing loop.
+constexpr uint64_t U = 0x44e992b44a6909f1;
+
+/// The 6u + 2 in the non-adjacent form, the least significant digit first:
+/// the loop count of the optimal ate pairing.
+constexpr int8_t AteLoopNaf[]{0, 0, 0, 1, 0, 1, 0, -1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, -1, 0, 0,
+    0, 1, 0, -1, 0, 0, 0, 0, -1, 0, 0, 1, 0, -1, 0, 0, 1, 0, 0, 0, 0, 0, -1, 0, 0, -1, 0, 1, 0, -1,
+    0, 0, 0, -1, 0, -1, 0, 0, 0, 1, 0, -1, 0, 1};
+
+
+/// The element of the prime field in the Montgomery form x·R mod p, 4x64-bit limbs.
+struct Fp
+{
+    uint256 v;
+
+    bool operator==(const Fp&) const = default;
+};
+
+Fp operator+(const Fp& a, const Fp& b) noexcept
+{
+    const auto s = a.v + b.v;  // No overflow: p < 2^254.
+    return {s >= FieldPrime ? s - FieldPrime : s};
+}
+
+Fp operator-(const Fp& a, const Fp& b) noexcept
+{
+    const auto [d, borrow] = intx::subc(a.v, b.v);
+    return {borrow ? d + FieldPrime : d};
+}
+
+Fp operator-(const Fp& a) noexcept
+{
+    return Fp{} - a;
+}
+
+/// The Montgomery multiplication a·b·R^-1 mod p (the CIOS method).
+Fp operator*(const Fp& a, const Fp& b) noexcept
+{
+    uint64_t t[6]{};
+    for (size_t i = 0; i < 4; ++i)
+    {
+        uint64_t c = 0;
+        for (size_t j = 0; j < 4; ++j)
+        {
+            const auto p = intx::umul(a.v[j], b.v[i]) + t[j] + c;
+            t[j] = p[0];
+            c = p[1];
+        }
+        const auto [t4, t4_carry] = intx::addc(t[4], c);
+        t[4] = t4;
+        t[5] = t4_carry;
+
+        const auto q = t[0] * FieldPrimeNegInv;
+        c = (intx::umul(q, FieldPrime[0]) + t[0])[1];
+        for (size_t j = 1; j < 4; ++j)
+        {
+            const auto p = intx::umul(q, FieldPrime[j]) + t[j] + c;
+            t[j - 1] = p[0];
+            c = p[1];
+        }
+        const auto [s, s_carry] = intx::addc(t[4], c);
+        t[3] = s;
+        t[4] = t[5] + s_carry;
+    }
+    // The result is less than 2p < 2^255, so t[4] is 0.
+    const uint256 r{t[0], t[1], t[2], t[3]};
+    return {r >= FieldPrime ? r - FieldPrime : r};
+}
+
+Fp sqr(const Fp& a) noexcept
+{
+    return a * a;
+}
+
+Fp to_fp(const uint256& x) noexcept
+{
+    return Fp{x} * Fp{R2};
+}
+
+uint256 from_fp(const Fp& a) noexcept
+{
+    return (a * Fp{1}).v;
+}
+
+const Fp FpOne = to_fp(1);
+
+/// Computes the inverse a^(p-2) of the non-zero element.
+Fp inv(const Fp& a) noexcept
+{
+    static constexpr auto e = FieldPrime - 2;
+    auto r = FpOne;
+    for (unsigned i = 256; i-- != 0;)
+    {
+        r = sqr(r);
+        if (((e[i / 64] >> (i % 64)) & 1) != 0)
+            r = r * a;
+    }
+    return r;
+}
+
+
+/// The element of Fp2 = Fp[i] / (i^2 + 1).
+struct Fp2
+{
+    Fp c0;
+    Fp c1;
+
+    bool operator==(const Fp2&) const = default;
+};
+
+Fp2 operator+(const Fp2& a, const Fp2& b) noexcept
+{
+    return {a.c0 + b.c0, a.c1 + b.c1};
+}
+
+Fp2 operator-(const Fp2& a, const Fp2& b) noexcept
+{
+    return {a.c0 - b.c0, a.c1 - b.c1};
+}
+
+Fp2 operator-(const Fp2& a) noexcept
+{
+    return {-a.c0, -a.c1};
+}
+
+Fp2 operator*(const Fp2& a, const Fp2& b) noexcept
+{
+    const auto t0 = a.c0 * b.c0;
+    const auto t1 = a.c1 * b.c1;
+    return {t0 - t1, (a.c0 + a.c1) * (b.c0 + b.c1) - t0 - t1};
+}
+
+Fp2 operator*(const Fp2& a, const Fp& b) noexcept
+{
+    return {a.c0 * b, a.c1 * b};
+}
+
+Fp2 sqr(const Fp2& a) noexcept
+{
+    const auto t = a.c0 * a.c1;
+    return {(a.c0 + a.c1) * (a.c0 - a.c1), t + t};
+}
+
+/// Multiplies by the non-residue ξ = 9 + i defining Fp6 and the twist.
+Fp2 mul_by_xi(const Fp2& a) noexcept
+{
+    const auto a2 = a + a;
+    const auto a4 = a2 + a2;
+    const auto a9 = a4 + a4 + a;
+    return {a9.c0 - a.c1, a9.c1 + a.c0};
+}
+
+/// The conjugate, also the Frobenius map a^p.
+Fp2 conj(const Fp2& a) noexcept
+{
+    return {a.c0, -a.c1};
+}
+
+Fp2 inv(const Fp2& a) noexcept
+{
+    const auto t = inv(sqr(a.c0) + sqr(a.c1));
+    return {a.c0 * t, -(a.c1 * t)};
+}
+
+Fp2 to_fp2(const uint256& c0, const uint256& c1) noexcept
+{
+    return {to_fp(c0), to_fp(c1)};
+}
+
+/// The coefficient b' = 3 / ξ of the twist curve y^2 = x^3 + b'.
+const auto TwistB = to_fp2(0x2b149d40ceb8aaae81be18991be06ac3b5b4c5e559dbefa33267e6dc24a138e5_u256,
+    0x009713b03af0fed4cd2cafadeed8fdf4a74fa084e52d1852e4a2bd0685c315d2_u256);
+
+/// The Frobenius map coefficients: ξ^((p-1)/6), ξ^((p-1)/3), ξ^(2(p-1)/3) and ξ^((p-1)/2).
+const auto Xi1Over6 =
+    to_fp2(0x1284b71c2865a7dfe8b99fdd76e68b605c521e08292f2176d60b35dadcc9e470_u256,
+        0x246996f3b4fae7e6a6327cfe12150b8e747992778eeec7e5ca5cf05f80f362ac_u256);
+const auto Xi1Over3 =
+    to_fp2(0x2fb347984f7911f74c0bec3cf559b143b78cc310c2c3330c99e39557176f553d_u256,
+        0x16c9e55061ebae204ba4cc8bd75a079432ae2a1d0b7c9dce1665d51c640fcba2_u256);
+const auto Xi2Over3 =
+    to_fp2(0x05b54f5e64eea80180f3c0b75a181e84d33365f7be94ec72848a1f55921ea762_u256,
+        0x2c145edbe7fd8aee9f3a80b03b0b1c923685d2ea1bdec763c13b4711cd2b8126_u256);
+const auto Xi1Over2 =
+    to_fp2(0x063cf305489af5dcdc5ec698b6e2f9b9dbaae0eda9c95998dc54014671a0135a_u256,
+        0x07c03cbcac41049a0704b5a7ec796f2b21807dc98fa25bd282d37f632623b0e3_u256);
+
+
+/// The element of Fp6 = Fp2[v] / (v^3 - ξ).
+struct Fp6
+{
+    Fp2 c0;
+    Fp2 c1;
+    Fp2 c2;
+
+    bool operator==(const Fp6&) const = default;
+};
+
+Fp6 operator+(const Fp6& a, const Fp6& b) noexcept
+{
+    return {a.c0 + b.c0, a.c1 + b.c1, a.c2 + b.c2};
+}
+
+Fp6 operator-(const Fp6& a, const Fp6& b) noexcept
+{
+    return {a.c0 - b.c0, a.c1 - b.c1, a.c2 - b.c2};
+}
+
+Fp6 operator-(const Fp6& a) noexcept
+{
+    return {-a.c0, -a.c1, -a.c2};
+}
+
+Fp6 operator*(const Fp6& a, const Fp6& b) noexcept
+{
+    const auto t0 = a.c0 * b.c0;
+    const auto t1 = a.c1 * b.c1;
+    const auto t2 = a.c2 * b.c2;
+    return {
+        mul_by_xi((a.c1 + a.c2) * (b.c1 + b.c2) - t1 - t2) + t0,
+        (a.c0 + a.c1) * (b.c0 + b.c1) - t0 - t1 + mul_by_xi(t2),
+        (a.c0 + a.c2) * (b.c0 + b.c2) - t0 - t2 + t1,
+    };
+}
+
+/// Multiplies by the element b0 + b1·v.
+Fp6 mul_by_01(const Fp6& a, const Fp2& b0, const Fp2& b1) noexcept
+{
+    return {a.c0 * b0 + mul_by_xi(a.c2 * b1), a.c0 * b1 + a.c1 * b0, a.c1 * b1 + a.c2 * b0};
+}
+
+/// Multiplies by v.
+Fp6 mul_by_v(const Fp6& a) noexcept
+{
+    return {mul_by_xi(a.c2), a.c0, a.c1};
+}
+
+Fp6 inv(const Fp6& a) noexcept
+{
+    const auto c0 = sqr(a.c0) - mul_by_xi(a.c1 * a.c2);
+    const auto c1 = mul_by_xi(sqr(a.c2)) - a.c0 * a.c1;
+    const auto c2 = sqr(a.c1) - a.c0 * a.c2;
+    const auto t = inv(a.c0 * c0 + mul_by_xi(a.c2 * c1 + a.c1 * c2));
+    return {c0 * t, c1 * t, c2 * t};
+}
+
+/// The Frobenius map a^p.
+Fp6 frobenius(const Fp6& a) noexcept
+{
+    return {conj(a.c0), conj(a.c1) * Xi1Over3, conj(a.c2) * Xi2Over3};
+}
+
+
+/// The element of Fp12 = Fp6[w] / (w^2 - v).
+struct Fp12
+{
+    Fp6 c0;
+    Fp6 c1;
+
+    bool operator==(const Fp12&) const = default;
+};
+
+const Fp12 Fp12One{{{FpOne, {}}, {}, {}}, {}};
+
+Fp12 operator*(const Fp12& a, const Fp12& b) noexcept
+{
+    const auto t0 = a.c0 * b.c0;
+    const auto t1 = a.c1 * b.c1;
+    return {t0 + mul_by_v(t1), (a.c0 + a.c1) * (b.c0 + b.c1) - t0 - t1};
+}
+
+Fp12 sqr(const Fp12& a) noexcept
+{
+    const auto t = a.c0 * a.c1;
+    return {(a.c0 + a.c1) * (a.c0 + mul_by_v(a.c1)) - t - mul_by_v(t), t + t};
+}
+
+/// The conjugate a^(p^6), the inverse of the elements of the cyclotomic subgroup.
+Fp12 conj(const Fp12& a) noexcept
+{
+    return {a.c0, -a.c1};
+}
+
+Fp12 inv(const Fp12& a) noexcept
+{
+    const auto t = inv(a.c0 * a.c0 - mul_by_v(a.c1 * a.c1));
+    return {a.c0 * t, -(a.c1 * t)};
+}
+
+/// The Frobenius map a^p.
+Fp12 frobenius(const Fp12& a) noexcept
+{
+    const auto c1 = frobenius(a.c1);
+    return {frobenius(a.c0), {c1.c0 * Xi1Over6, c1.c1 * Xi1Over6, c1.c2 * Xi1Over6}};
+}
+
+/// Multiplies by the sparse element b0 + (b3 + b4·v)·w: the line function value.
+Fp12 mul_by_034(const Fp12& a, const Fp2& b0, const Fp2& b3, const Fp2& b4) noexcept
+{
+    const Fp6 t0{a.c0.c0 * b0, a.c0.c1 * b0, a.c0.c2 * b0};
+    const auto t1 = mul_by_01(a.c1, b3, b4);
+    return {t0 + mul_by_v(t1), mul_by_01(a.c0 + a.c1, b0 + b3, b4) - t0 - t1};
+}
+
+/// Computes a^u for the element of the cyclotomic subgroup.
+Fp12 exp_by_u(const Fp12& a) noexcept
+{
+    auto r = a;
+    for (auto i = 63 - std::countl_zero(U); i-- != 0;)
+    {
+        r = sqr(r);
+        if (((U >> i) & 1) != 0)
+            r = r * a;
+    }
+    return r;
+}
+
+/// Raises the Miller loop result to the power (p^12 - 1) / r.
+///
+/// The "hard part" is based on the Fuentes-Castañeda et al. "Faster hashing to G2":
+/// it computes a fixed power of the result coprime to r, good enough for the pairing check.
+Fp12 final_exponentiation(const Fp12& f) noexcept
+{
+    // The "easy part" f^((p^6 - 1)(p^2 + 1)) moves f to the cyclotomic subgroup.
+    auto r = conj(f) * inv(f);
+    r = frobenius(frobenius(r)) * r;
+
+    const auto y0 = conj(exp_by_u(r));
+    const auto y1 = sqr(y0);
+    const auto y2 = sqr(y1);
+    const auto y3 = y2 * y1;
+    const auto y4 = conj(exp_by_u(y3));
+    const auto y5 = sqr(y4);
+    const auto y6 = conj(exp_by_u(y5));
+    const auto y7 = conj(y6) * y4;
+    const auto y8 = y7 * conj(y3);
+    const auto y9 = y8 * y1;
+    const auto y10 = y8 * y4;
+    const auto y11 = y10 * r;
+    const auto y13 = frobenius(y9) * y11;
+    const auto y14 = frobenius(frobenius(y8)) * y13;
+    const auto y15 = frobenius(frobenius(frobenius(conj(r) * y9)));
+    return y15 * y14;
+}
+
+
+/// The point in the Jacobian coordinates: x = X/Z², y = Y/Z³. The point at infinity has Z = 0.
+/// The curve is y^2 = x^3 + b over the field F (Fp for G1, Fp2 for G2).
+template <typename F>
+struct JacobianPoint
+{
+    F x;
+    F y;
+    F z;
+
+    [[nodiscard]] bool is_infinity() const noexcept { return z == F{}; }
+};
+
+/// Doubles the point (the "dbl-2009-l" formulas for a = 0).
+template <typename F>
+JacobianPoint<F> dbl(const JacobianPoint<F>& p) noexcept
+{
+    const auto a = sqr(p.x);
+    const auto b = sqr(p.y);
+    const auto c = sqr(b);
+    const auto d2 = sqr(p.x + b) - a - c;
+    const auto d = d2 + d2;
+    const auto e = a + a + a;
+    const auto x3 = sqr(e) - (d + d);
+    const auto c2 = c + c;
+    const auto c4 = c2 + c2;
+    const auto y3 = e * (d - x3) - (c4 + c4);
+    const auto yz = p.y * p.z;
+    return {x3, y3, yz + yz};
+}
+
+/// Adds the points (the "add-2007-bl" formulas).
+template <typename F>
+JacobianPoint<F> add(const JacobianPoint<F>& p, const JacobianPoint<F>& q) noexcept
+{
+    if (p.is_infinity())
+        return q;
+    if (q.is_infinity())
+        return p;
+
+    const auto z1z1 = sqr(p.z);
+    const auto z2z2 = sqr(q.z);
+    const auto u1 = p.x * z2z2;
+    const auto u2 = q.x * z1z1;
+    const auto s1 = p.y * q.z * z2z2;
+    const auto s2 = q.y * p.z * z1z1;
+    const auto h = u2 - u1;
+    const auto r2 = s2 - s1;
+    if (h == F{})
+        return r2 == F{} ? dbl(p) : JacobianPoint<F>{};
+
+    const auto r = r2 + r2;
+    const auto i = sqr(h + h);
+    const auto j = h * i;
+    const auto v = u1 * i;
+    const auto x3 = sqr(r) - j - (v + v);
+    const auto s1j = s1 * j;
+    const auto y3 = r * (v - x3) - (s1j + s1j);
+    const auto z3 = (sqr(p.z + q.z) - z1z1 - z2z2) * h;
+    return {x3, y3, z3};
+}
+
+template <typename F>
+JacobianPoint<F> neg(const JacobianPoint<F>& p) noexcept
+{
+    return {p.x, -p.y, p.z};
+}
+
+/// Multiplies the point by the scalar less than 2^255 using the width-5 NAF.
+template <typename F>
+JacobianPoint<F> mul(const JacobianPoint<F>& p, uint256 k) noexcept
+{
+    assert((k >> 255) == 0);
+    static constexpr int Width = 5;
+
+    // The odd multiples P, 3P, ..., 15P.
+    JacobianPoint<F> odd_multiples[1 << (Width - 2)]{p};
+    const auto p2 = dbl(p);
+    for (size_t i = 1; i < std::size(odd_multiples); ++i)
+        odd_multiples[i] = add(odd_multiples[i - 1], p2);
+
+    // The digits are odd in (-2^(w-1), 2^(w-1)) or 0, every non-zero is followed by w-1 zeros.
+    int8_t naf[256]{};
+    size_t num_digits = 0;
+    for (; k != 0; ++num_digits)
+    {
+        if ((k[0] & 1) != 0)
+        {
+            auto d = static_cast<int>(k[0] & ((1 << Width) - 1));
+            if (d >= (1 << (Width - 1)))
+                d -= 1 << Width;
+            naf[num_digits] = static_cast<int8_t>(d);
+            if (d > 0)
+                k -= static_cast<uint64_t>(d);
+            else
+                k += static_cast<uint64_t>(-d);
+        }
+        k >>= 1;
+    }
+
+    JacobianPoint<F> r;
+    for (auto i = num_digits; i-- != 0;)
+    {
+        r = dbl(r);
+        if (const auto d = naf[i]; d > 0)
+            r = add(r, odd_multiples[d / 2]);
+        else if (d < 0)
+            r = add(r, neg(odd_multiples[-d / 2]));
+    }
+    return r;
+}
+
+
+struct G1Affine
+{
+    Fp x;
+    Fp y;
+};
+
+struct G2Affine
+{
+    Fp2 x;
+    Fp2 y;
+};
+
+/// Loads the field element, returns false if not less than p.
+bool load(Fp& out, const uint8_t* data) noexcept
+{
+    const auto x = intx::be::unsafe::load<uint256>(data);
+    if (x >= FieldPrime)
+        return false;
+    out = to_fp(x);
+    return true;
+}
+
+/// Loads the G1 point. Returns false if invalid, the point at infinity is (0, 0).
+bool load(G1Affine& p, const uint8_t* data) noexcept
+{
+    if (!load(p.x, &data[0]) || !load(p.y, &data[32]))
+        return false;
+    if (p.x == Fp{} && p.y == Fp{})
+        return true;
+    return sqr(p.y) == sqr(p.x) * p.x + to_fp(3);
+}
+
+/// Loads the G2 point (the Fp2 coordinates as the imaginary and the real parts).
+/// Returns false if invalid, including the points outside of the subgroup of order r.
+bool load(G2Affine& q, const uint8_t* data) noexcept
+{
+    if (!load(q.x.c1, &data[0]) || !load(q.x.c0, &data[32]) || !load(q.y.c1, &data[64]) ||
+        !load(q.y.c0, &data[96]))
+        return false;
+    if (q.x == Fp2{} && q.y == Fp2{})
+        return true;
+    if (sqr(q.y) != sqr(q.x) * q.x + TwistB)
+        return false;
+    // The twist curve has points of other orders, check the order is r.
+    const Fp2 one{FpOne, {}};
+    return mul(JacobianPoint<Fp2>{q.x, q.y, one}, Order).is_infinity();
+}
+
+void store(uint8_t* out, const JacobianPoint<Fp>& p) noexcept
+{
+    if (p.is_infinity())
+    {
+        std::fill_n(out, 64, uint8_t{0});
+        return;
+    }
+    const auto z_inv = inv(p.z);
+    const auto z_inv2 = sqr(z_inv);
+    intx::be::unsafe::store(&out[0], from_fp(p.x * z_inv2));
+    intx::be::unsafe::store(&out[32], from_fp(p.y * z_inv2 * z_inv));
+}
+
+JacobianPoint<Fp> to_jacobian(const G1Affine& p) noexcept
+{
+    if (p.x == Fp{} && p.y == Fp{})
+        return {};
+    return {p.x, p.y, FpOne};
+}
+
+
+/// The G2 point in the homogeneous projective coordinates: x = X/Z, y = Y/Z,
+/// the Miller loop accumulator.
+struct G2Projective
+{
+    Fp2 x;
+    Fp2 y;
+    Fp2 z;
+};
+
+/// The coefficients of the line function: its value at P is c0·y_P + c1·x_P·w + c2·v·w.
+struct LineCoeffs
+{
+    Fp2 c0;
+    Fp2 c1;
+    Fp2 c2;
+};
+
+/// Doubles the point and returns the tangent line (Costello, Lange, Naehrig,
+/// "Faster pairing computations on curves with high-degree twists", adapted to the D-twist).
+LineCoeffs dbl_step(G2Projective& t) noexcept
+{
+    static const auto two_inv = inv(to_fp(2));
+    const auto a = t.x * t.y * two_inv;
+    const auto b = sqr(t.y);
+    const auto c = sqr(t.z);
+    const auto e = TwistB * (c + c + c);
+    const auto f = e + e + e;
+    const auto g = (b + f) * two_inv;
+    const auto h = sqr(t.y + t.z) - (b + c);
+    const auto i = e - b;
+    const auto j = sqr(t.x);
+    const auto e2 = sqr(e);
+
+    t.x = a * (b - f);
+    t.y = sqr(g) - (e2 + e2 + e2);
+    t.z = b * h;
+    return {-h, j + j + j, i};
+}
+
+/// Adds the affine point and returns the line through the points.
+LineCoeffs add_step(G2Projective& t, const G2Affine& q) noexcept
+{
+    const auto theta = t.y - q.y * t.z;
+    const auto lambda = t.x - q.x * t.z;
+    const auto c = sqr(theta);
+    const auto d = sqr(lambda);
+    const auto e = lambda * d;
+    const auto f = t.z * c;
+    const auto g = t.x * d;
+    const auto h = e + f - (g + g);
+    t.x = lambda * h;
+    t.y = theta * (g - h) - e * t.y;
+    t.z = t.z * e;
+    return {lambda, -theta, theta * q.x - lambda * q.y};
+}
+
+/// Multiplies the Miller loop accumulator by the line function value at P.
+Fp12 mul_by_line(const Fp12& f, const LineCoeffs& l, const G1Affine& p) noexcept
+{
+    return mul_by_034(f, l.c0 * p.y, l.c1 * p.x, l.c2);
+}
+
+/// The Frobenius endomorphism of the twist: untwist, raise the coordinates to p, twist back.
+G2Affine frobenius(const G2Affine& q) noexcept
+{
+    return {conj(q.x) * Xi1Over3, conj(q.y) * Xi1Over2};
+}
+}  // namespace
+
+bool bn254_add(uint8_t out[64], const uint8_t a[64], const uint8_t b[64]) noexcept
+{
+    G1Affine p;
+    G1Affine q;
+    if (!load(p, a) || !load(q, b))
+        return false;
+    store(out, add(to_jacobian(p), to_jacobian(q)));
+    return true;
+}
+
+bool bn254_mul(uint8_t out[64], const uint8_t p[64], const uint8_t scalar[32]) noexcept
+{
+    G1Affine a;
+    if (!load(a, p))
+        return false;
+    // All the G1 points are of the order r, the scalar can be reduced.
+    const auto k = intx::be::unsafe::load<uint256>(scalar) % Order;
+    store(out, mul(to_jacobian(a), k));
+    return true;
+}
+
+std::optional<bool> bn254_pairing_check(std::span<const uint8_t> input) noexcept
+{
+    static constexpr size_t PairSize = 192;
+    if (input.size() % PairSize != 0)
+        return std::nullopt;
+
+    struct Pair
+    {
+        G1Affine p;
+        G2Affine q;
+        G2Projective t;
+    };
+    std::vector<Pair> pairs;
+    pairs.reserve(input.size() / PairSize);
+    for (size_t offset = 0; offset < input.size(); offset += PairSize)
+    {
+        G1Affine p;
+        G2Affine q;
+        if (!load(p, &input[offset]) || !load(q, &input[offset + 64]))
+            return std::nullopt;
+        // The pairing with the point at infinity is 1.
+        if ((p.x == Fp{} && p.y == Fp{}) || (q.x == Fp2{} && q.y == Fp2{}))
+            continue;
+        pairs.push_back({p, q, {q.x, q.y, {FpOne, {}}}});
+    }
+
+    // The Miller loops of all pairs at once, sharing the squarings of f.
+    auto f = Fp12One;
+    for (auto i = std::size(AteLoopNaf) - 1; i != 0; --i)
+    {
+        if (i != std::size(AteLoopNaf) - 1)
+            f = sqr(f);
+        for (auto& [p, q, t] : pairs)
+            f = mul_by_line(f, dbl_step(t), p);
+        if (const auto d = AteLoopNaf[i - 1]; d != 0)
+        {
+            for (auto& [p, q, t] : pairs)
+                f = mul_by_line(f, add_step(t, d > 0 ? q : G2Affine{q.x, -q.y}), p);
+        }
+    }
+
+    // The final steps of the optimal ate pairing with π(Q) and -π²(Q).
+    for (auto& [p, q, t] : pairs)
+    {
+        const auto q1 = frobenius(q);
+        auto q2 = frobenius(q1);
+        q2.y = -q2.y;
+        f = mul_by_line(f, add_step(t, q1), p);
+        f = mul_by_line(f, add_step(t, q2), p);
+    }
+
+    return final_exponentiation(f) == Fp12One;
+}
+}  // namespace evmone::crypto
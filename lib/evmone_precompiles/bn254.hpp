@@ -0,0 +1,30 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+
+/// The BN254 (alt_bn128) curve operations of the precompiles (EIP-196, EIP-197).
+///
+/// The G1 points are encoded as the 32-byte big-endian x and y coordinates, the G2 points
+/// as the Fp2 coordinates x and y, each as the imaginary and the real part. The point
+/// at infinity is encoded as all zeros. The inputs are invalid if a coordinate is not less
+/// than the field prime or the point is not on the curve (and for G2 not in the subgroup).
+namespace evmone::crypto
+{
+/// Adds the G1 points. Returns false if the input is invalid.
+bool bn254_add(uint8_t out[64], const uint8_t a[64], const uint8_t b[64]) noexcept;
+
+/// Multiplies the G1 point by the 256-bit scalar. Returns false if the input is invalid.
+bool bn254_mul(uint8_t out[64], const uint8_t p[64], const uint8_t scalar[32]) noexcept;
+
+/// Checks if the product of the pairings of the (G1, G2) pairs is 1.
+/// The input is the sequence of 192-byte pairs. Returns nullopt if the input is invalid.
+///
+/// The Miller loops of all pairs share the squarings of the accumulator
+/// and the single final exponentiation.
+std::optional<bool> bn254_pairing_check(std::span<const uint8_t> input) noexcept;
+}  // namespace evmone::crypto
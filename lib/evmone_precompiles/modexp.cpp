@@ -0,0 +1,518 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "modexp.hpp"
+#include <intx/intx.hpp>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <vector>
+
+namespace evmone::crypto
+{
+namespace
+{
+/// The big number as the little-endian sequence of 64-bit words.
+using Words = std::vector<uint64_t>;
+
+/// Removes the leading zero bytes of the big-endian number.
+std::span<const uint8_t> trim(std::span<const uint8_t> x) noexcept
+{
+    const auto it = std::find_if(x.begin(), x.end(), [](uint8_t b) noexcept { return b != 0; });
+    return x.subspan(static_cast<size_t>(it - x.begin()));
+}
+
+/// Loads the big-endian number into the words. The words must be big enough.
+void load(uint64_t* words, size_t num_words, std::span<const uint8_t> x) noexcept
+{
+    assert(x.size() <= num_words * 8);
+    std::fill_n(words, num_words, uint64_t{0});
+    for (size_t i = 0; i < x.size(); ++i)
+        words[i / 8] |= uint64_t{x[x.size() - 1 - i]} << (8 * (i % 8));
+}
+
+/// Stores the words as the big-endian number filling the whole output (truncated if needed).
+void store(std::span<uint8_t> out, const uint64_t* words, size_t num_words) noexcept
+{
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        out[out.size() - 1 - i] =
+            (i / 8 < num_words) ? static_cast<uint8_t>(words[i / 8] >> (8 * (i % 8))) : 0;
+    }
+}
+
+/// Computes the inverse of the odd value modulo 2^64 with the Newton's iteration:
+/// each step doubles the number of correct bits, the odd x is its own inverse modulo 8.
+uint64_t inv_mod_2_64(uint64_t x) noexcept
+{
+    assert((x & 1) != 0);
+    auto inv = x;
+    for (unsigned bits = 3; bits < 64; bits *= 2)
+        inv *= 2 - x * inv;
+    return inv;
+}
+
+/// The Montgomery multiplication for the odd moduli of up to N bits on intx::uint<N>.
+template <unsigned N>
+class FixedMontgomery
+{
+public:
+    using Value = intx::uint<N>;
+    static constexpr size_t num_words = N / 64;
+
+    explicit FixedMontgomery(const Words& mod) noexcept
+    {
+        assert(mod.size() <= num_words && (mod[0] & 1) != 0);
+        for (size_t i = 0; i < mod.size(); ++i)
+            m_mod[i] = mod[i];
+
+        // The inverse modulo 2^N with the Newton's iteration, see inv_mod_2_64().
+        auto inv = m_mod;
+        for (unsigned bits = 3; bits < N; bits *= 2)
+            inv *= Value{2} - m_mod * inv;
+        m_mod_neg_inv = Value{0} - inv;
+
+        m_one = (Value{0} - m_mod) % m_mod;  // R mod m, where 2^N - m ≡ R.
+        m_r2 = intx::udivrem(intx::umul(m_one, m_one), m_mod).rem;
+    }
+
+    [[nodiscard]] const Value& one() const noexcept { return m_one; }
+
+    void mul(Value& r, const Value& a, const Value& b) const noexcept
+    {
+        r = reduce(intx::umul(a, b));
+    }
+
+    /// Converts the big-endian number of any length to the Montgomery form.
+    [[nodiscard]] Value to_mont(std::span<const uint8_t> x) const noexcept
+    {
+        // Horner's method over the N-bit chunks: x·R = (... (c_k·R + c_{k-1})·R ...)·R,
+        // the Montgomery multiplication by R^2 converts both the accumulator and the chunks.
+        static constexpr size_t chunk_size = N / 8;
+        Value acc;
+        auto chunk_end = x.size() % chunk_size;
+        if (chunk_end == 0)
+            chunk_end = chunk_size;
+        for (size_t begin = 0; begin < x.size(); begin = chunk_end, chunk_end += chunk_size)
+        {
+            Value chunk;
+            load(&chunk[0], num_words, x.subspan(begin, chunk_end - begin));
+            mul(acc, acc, m_r2);
+            mul(chunk, chunk, m_r2);
+            const auto [s, carry] = intx::addc(acc, chunk);
+            acc = (carry || s >= m_mod) ? s - m_mod : s;
+        }
+        return acc;
+    }
+
+    [[nodiscard]] Words from_mont(const Value& x) const noexcept
+    {
+        const auto r = reduce(intx::uint<2 * N>{x});
+        return {&r[0], &r[0] + num_words};
+    }
+
+private:
+    /// The Montgomery reduction x·R^-1 mod m (REDC) for x < m·R.
+    [[nodiscard]] Value reduce(const intx::uint<2 * N>& x) const noexcept
+    {
+        const auto q = static_cast<Value>(x) * m_mod_neg_inv;
+        const auto [s, carry] = intx::addc(x, intx::umul(q, m_mod));
+        const auto r = static_cast<Value>(s >> N);
+        // The result is less than 2m, but may not fit N bits (the carry).
+        return (carry || r >= m_mod) ? r - m_mod : r;
+    }
+
+    Value m_mod;
+    Value m_mod_neg_inv;  ///< -m^-1 mod R.
+    Value m_one;          ///< R mod m: 1 in the Montgomery form.
+    Value m_r2;           ///< R^2 mod m.
+};
+
+
+/// The Montgomery multiplication for the odd moduli of any length.
+class Montgomery
+{
+public:
+    using Value = Words;
+
+    explicit Montgomery(Words mod) noexcept
+      : m_mod{std::move(mod)},
+        m_mod_neg_inv{uint64_t{0} - inv_mod_2_64(m_mod[0])},
+        m_t(m_mod.size() + 2)
+    {
+        assert(m_mod.size() > 1 || m_mod[0] > 1);
+
+        // R mod m by doubling the highest power of 2 less than m up to R = 2^(64·n).
+        const auto n = m_mod.size();
+        const auto top_bit = static_cast<size_t>(63 - std::countl_zero(m_mod.back()));
+        m_one.assign(n, 0);
+        m_one.back() = uint64_t{1} << top_bit;
+        for (auto i = 64 * (n - 1) + top_bit; i < 64 * n; ++i)
+            add(m_one, m_one);
+
+        // R^2 mod m is the Montgomery form of 2^(64·n): computed with the square-and-multiply
+        // where the multiplication by 2 is the doubling.
+        const auto e = 64 * n;
+        m_r2 = m_one;
+        for (auto i = static_cast<size_t>(std::bit_width(e)); i-- != 0;)
+        {
+            mul(m_r2, m_r2, m_r2);
+            if (((e >> i) & 1) != 0)
+                add(m_r2, m_r2);
+        }
+    }
+
+    [[nodiscard]] const Value& one() const noexcept { return m_one; }
+
+    /// The Montgomery multiplication r = a·b·R^-1 mod m with the CIOS method.
+    /// The result may alias the arguments.
+    void mul(Value& r, const Value& a, const Value& b) const noexcept
+    {
+        const auto n = m_mod.size();
+        auto* const t = m_t.data();
+        std::fill_n(t, n + 2, uint64_t{0});
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint64_t c = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                const auto p = intx::umul(a[j], b[i]) + t[j] + c;
+                t[j] = p[0];
+                c = p[1];
+            }
+            const auto [tn, tn_carry] = intx::addc(t[n], c);
+            t[n] = tn;
+            t[n + 1] = tn_carry;
+
+            // Add q·m making the lowest word zero and shift the sum right by one word.
+            const auto q = t[0] * m_mod_neg_inv;
+            c = (intx::umul(q, m_mod[0]) + t[0])[1];
+            for (size_t j = 1; j < n; ++j)
+            {
+                const auto p = intx::umul(q, m_mod[j]) + t[j] + c;
+                t[j - 1] = p[0];
+                c = p[1];
+            }
+            const auto [s, s_carry] = intx::addc(t[n], c);
+            t[n - 1] = s;
+            t[n] = t[n + 1] + s_carry;
+        }
+
+        // The result t < 2m, subtract m if needed.
+        r.resize(n);
+        bool borrow = false;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto [d, d_borrow] = intx::subc(t[i], m_mod[i], borrow);
+            r[i] = d;
+            borrow = d_borrow;
+        }
+        if (t[n] == 0 && borrow)
+            std::copy_n(t, n, r.data());
+    }
+
+    /// Converts the big-endian number of any length to the Montgomery form,
+    /// see FixedMontgomery::to_mont().
+    [[nodiscard]] Value to_mont(std::span<const uint8_t> x) const noexcept
+    {
+        const auto n = m_mod.size();
+        const auto chunk_size = n * 8;
+        Words acc(n);
+        Words chunk(n);
+        auto chunk_end = x.size() % chunk_size;
+        if (chunk_end == 0)
+            chunk_end = chunk_size;
+        for (size_t begin = 0; begin < x.size(); begin = chunk_end, chunk_end += chunk_size)
+        {
+            load(chunk.data(), n, x.subspan(begin, chunk_end - begin));
+            mul(acc, acc, m_r2);
+            mul(chunk, chunk, m_r2);
+            add(acc, chunk);
+        }
+        return acc;
+    }
+
+    [[nodiscard]] Words from_mont(const Value& x) const noexcept
+    {
+        Words unit(m_mod.size());
+        unit[0] = 1;
+        Words r;
+        mul(r, x, unit);
+        return r;
+    }
+
+private:
+    /// Computes x = x + y mod m.
+    void add(Words& x, const Words& y) const noexcept
+    {
+        const auto n = m_mod.size();
+        bool carry = false;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto [s, c] = intx::addc(x[i], y[i], carry);
+            x[i] = s;
+            carry = c;
+        }
+
+        // Subtract m if the sum (with the carry as its top bit) is not less than m.
+        auto* const d = m_t.data();
+        bool borrow = false;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto [v, b] = intx::subc(x[i], m_mod[i], borrow);
+            d[i] = v;
+            borrow = b;
+        }
+        if (carry || !borrow)
+            std::copy_n(d, n, x.data());
+    }
+
+    Words m_mod;
+    uint64_t m_mod_neg_inv;  ///< -m^-1 mod 2^64.
+    Words m_r2;              ///< R^2 mod m.
+    Words m_one;             ///< R mod m: 1 in the Montgomery form.
+    mutable Words m_t;       ///< The scratch space of the multiplication.
+};
+
+
+/// The arithmetic modulo 2^k: the truncated multiplication.
+class PowerOf2
+{
+public:
+    using Value = Words;
+
+    explicit PowerOf2(size_t k) noexcept
+      : m_num_words{(k + 63) / 64},
+        m_top_mask{~uint64_t{0} >> ((64 - k % 64) % 64)},
+        m_t(m_num_words)
+    {}
+
+    [[nodiscard]] Value one() const noexcept
+    {
+        Words r(m_num_words);
+        r[0] = 1;
+        return r;
+    }
+
+    /// The product truncated to k bits. The result may alias the arguments.
+    void mul(Value& r, const Value& a, const Value& b) const noexcept
+    {
+        const auto n = m_num_words;
+        auto* const t = m_t.data();
+        std::fill_n(t, n, uint64_t{0});
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint64_t c = 0;
+            for (size_t j = 0; j < n - i; ++j)
+            {
+                const auto p = intx::umul(a[j], b[i]) + t[i + j] + c;
+                t[i + j] = p[0];
+                c = p[1];
+            }
+        }
+        r.assign(t, t + n);
+        r.back() &= m_top_mask;
+    }
+
+    [[nodiscard]] Value to_mont(std::span<const uint8_t> x) const noexcept
+    {
+        Words r(m_num_words);
+        load(r.data(), m_num_words, x.subspan(x.size() - std::min(x.size(), m_num_words * 8)));
+        r.back() &= m_top_mask;
+        return r;
+    }
+
+    [[nodiscard]] Words from_mont(const Value& x) const noexcept { return x; }
+
+private:
+    size_t m_num_words;
+    uint64_t m_top_mask;
+    mutable Words m_t;  ///< The scratch space of the multiplication.
+};
+
+
+/// Computes base^exp with the left-to-right sliding window method.
+template <typename Arith>
+Words pow(const Arith& arith, std::span<const uint8_t> base, std::span<const uint8_t> exp)
+{
+    using Value = typename Arith::Value;
+
+    exp = trim(exp);
+    if (exp.empty())
+        return arith.from_mont(arith.one());
+
+    const auto num_bits = (exp.size() - 1) * 8 + static_cast<size_t>(std::bit_width(exp[0]));
+    const auto bit = [exp](size_t i) noexcept {
+        return static_cast<size_t>(exp[exp.size() - 1 - i / 8] >> (i % 8)) & 1;
+    };
+
+    // The window size minimizing the number of multiplications for the exponent size.
+    const size_t window_bits = num_bits <= 8   ? 1 :
+                               num_bits <= 24  ? 2 :
+                               num_bits <= 80  ? 3 :
+                               num_bits <= 240 ? 4 :
+                               num_bits <= 672 ? 5 :
+                                                 6;
+
+    // The odd powers base^1, base^3, ..., base^(2^window_bits - 1).
+    std::vector<Value> odd_powers(size_t{1} << (window_bits - 1), arith.to_mont(base));
+    auto base_sqr = odd_powers[0];
+    arith.mul(base_sqr, base_sqr, base_sqr);
+    for (size_t i = 1; i < odd_powers.size(); ++i)
+        arith.mul(odd_powers[i], odd_powers[i - 1], base_sqr);
+
+    // The top bit is set, so the first window starts at the top and initializes the result.
+    auto r = arith.one();
+    bool initialized = false;
+    for (auto i = num_bits; i != 0;)
+    {
+        const auto top = i - 1;
+        if (bit(top) == 0)
+        {
+            arith.mul(r, r, r);
+            i = top;
+            continue;
+        }
+
+        // The longest window ending with the set bit.
+        auto low = top + 1 > window_bits ? top + 1 - window_bits : 0;
+        while (bit(low) == 0)
+            ++low;
+
+        size_t window = 0;
+        for (auto j = top + 1; j != low; --j)
+        {
+            window = (window << 1) | bit(j - 1);
+            if (initialized)
+                arith.mul(r, r, r);
+        }
+
+        if (initialized)
+            arith.mul(r, r, odd_powers[window >> 1]);
+        else
+            r = odd_powers[window >> 1];
+        initialized = true;
+        i = low;
+    }
+    return arith.from_mont(r);
+}
+
+/// Computes base^exp mod m for the odd m > 1, choosing the arithmetic by the modulus size.
+Words modexp_odd(std::span<const uint8_t> base, std::span<const uint8_t> exp, const Words& mod)
+{
+    Words r;
+    if (mod.size() <= 4)
+        r = pow(FixedMontgomery<256>{mod}, base, exp);
+    else if (mod.size() <= 8)
+        r = pow(FixedMontgomery<512>{mod}, base, exp);
+    else
+        r = pow(Montgomery{mod}, base, exp);
+    r.resize(mod.size());
+    return r;
+}
+
+/// Computes base^exp mod m for the even m = m_odd·2^k with the CRT:
+/// x = x1 + m_odd·((x2 - x1)·m_odd^-1 mod 2^k), where x1 = x mod m_odd and x2 = x mod 2^k.
+Words modexp_even(std::span<const uint8_t> base, std::span<const uint8_t> exp, const Words& mod)
+{
+    size_t k = 0;
+    while (mod[k / 64] == 0)
+        k += 64;
+    k += static_cast<size_t>(std::countr_zero(mod[k / 64]));
+
+    // The odd factor m_odd = m >> k.
+    const auto word_shift = k / 64;
+    const auto bit_shift = k % 64;
+    Words mod_odd(mod.size() - word_shift);
+    for (size_t i = 0; i < mod_odd.size(); ++i)
+    {
+        mod_odd[i] = mod[word_shift + i] >> bit_shift;
+        if (bit_shift != 0 && word_shift + i + 1 < mod.size())
+            mod_odd[i] |= mod[word_shift + i + 1] << (64 - bit_shift);
+    }
+    while (mod_odd.size() > 1 && mod_odd.back() == 0)
+        mod_odd.pop_back();
+
+    const PowerOf2 pow2{k};
+    auto r = pow(pow2, base, exp);  // x2
+    if (mod_odd.size() == 1 && mod_odd[0] == 1)
+    {
+        r.resize(mod.size());
+        return r;
+    }
+
+    const auto x1 = modexp_odd(base, exp, mod_odd);
+
+    // The inverse of m_odd modulo 2^k with the Newton's iteration, see inv_mod_2_64().
+    const auto w = r.size();
+    Words m_odd_low(w);
+    std::copy_n(mod_odd.begin(), std::min(w, mod_odd.size()), m_odd_low.begin());
+    auto inv = m_odd_low;
+    inv[0] = inv_mod_2_64(m_odd_low[0]);
+    for (size_t bits = 64; bits < k; bits *= 2)
+    {
+        Words t;
+        pow2.mul(t, m_odd_low, inv);
+        bool t_borrow = false;
+        for (size_t i = 0; i < w; ++i)  // t = 2 - t.
+        {
+            const auto [v, b] = intx::subc(i == 0 ? uint64_t{2} : uint64_t{0}, t[i], t_borrow);
+            t[i] = v;
+            t_borrow = b;
+        }
+        pow2.mul(inv, inv, t);
+    }
+
+    // y = (x2 - x1)·m_odd^-1 mod 2^k.
+    Words x1_low(w);
+    std::copy_n(x1.begin(), std::min(w, x1.size()), x1_low.begin());
+    bool borrow = false;
+    for (size_t i = 0; i < w; ++i)
+    {
+        const auto [v, b] = intx::subc(r[i], x1_low[i], borrow);
+        r[i] = v;
+        borrow = b;
+    }
+    pow2.mul(r, r, inv);
+
+    // x = x1 + m_odd·y: less than m so fits its size.
+    Words x(mod.size() + 1);
+    std::copy(x1.begin(), x1.end(), x.begin());
+    for (size_t i = 0; i < w; ++i)
+    {
+        uint64_t c = 0;
+        for (size_t j = 0; j < mod_odd.size() && i + j < mod.size(); ++j)
+        {
+            const auto p = intx::umul(mod_odd[j], r[i]) + x[i + j] + c;
+            x[i + j] = p[0];
+            c = p[1];
+        }
+        for (auto j = i + mod_odd.size(); c != 0 && j < x.size(); ++j)
+        {
+            const auto [v, carry] = intx::addc(x[j], c);
+            x[j] = v;
+            c = carry;
+        }
+    }
+    x.resize(mod.size());
+    return x;
+}
+}  // namespace
+
+void modexp(std::span<const uint8_t> base, std::span<const uint8_t> exp,
+    std::span<const uint8_t> mod, uint8_t* output) noexcept
+{
+    const std::span out{output, mod.size()};
+    std::fill(out.begin(), out.end(), uint8_t{0});
+
+    mod = trim(mod);
+    if (mod.empty() || (mod.size() == 1 && mod[0] == 1))
+        return;  // The result is 0 for the modulus 0 or 1.
+
+    Words m((mod.size() + 7) / 8);
+    load(m.data(), m.size(), mod);
+    const auto r = (m[0] & 1) != 0 ? modexp_odd(base, exp, m) : modexp_even(base, exp, m);
+    store(out, r.data(), r.size());
+}
+}  // namespace evmone::crypto
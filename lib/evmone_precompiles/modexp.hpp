@@ -0,0 +1,22 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace evmone::crypto
+{
+/// Computes the modular exponentiation base^exp mod mod of the big-endian numbers
+/// of arbitrary lengths (the MODEXP precompile, EIP-198).
+///
+/// The result is stored in the output as the big-endian number of mod.size() bytes.
+/// The result is 0 if the modulus is 0.
+///
+/// The odd moduli use the Montgomery multiplication, with fixed-width implementations
+/// for moduli up to 256 and 512 bits. The even moduli are split into the odd and
+/// the power of 2 factors and the results are combined with the CRT.
+void modexp(std::span<const uint8_t> base, std::span<const uint8_t> exp,
+    std::span<const uint8_t> mod, uint8_t* output) noexcept;
+}  // namespace evmone::crypto
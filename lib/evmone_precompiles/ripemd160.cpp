@@ -0,0 +1,161 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ripemd160.hpp"
+#include <bit>
+#include <cstring>
+
+namespace evmone::crypto
+{
+namespace
+{
+constexpr size_t BLOCK_SIZE = 64;
+
+constexpr uint32_t INITIAL_STATE[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+/// The message word selection of the left and the right line, per round.
+constexpr uint8_t R_LEFT[5][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8},
+    {3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12},
+    {1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2},
+    {4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13},
+};
+constexpr uint8_t R_RIGHT[5][16] = {
+    {5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12},
+    {6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2},
+    {15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13},
+    {8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14},
+    {12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11},
+};
+
+/// The rotation amounts of the left and the right line, per round.
+constexpr uint8_t S_LEFT[5][16] = {
+    {11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8},
+    {7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12},
+    {11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5},
+    {11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12},
+    {9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6},
+};
+constexpr uint8_t S_RIGHT[5][16] = {
+    {8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6},
+    {9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11},
+    {9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5},
+    {15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8},
+    {8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11},
+};
+
+constexpr uint32_t K_LEFT[5] = {0x00000000, 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xa953fd4e};
+constexpr uint32_t K_RIGHT[5] = {0x50a28be6, 0x5c4dd124, 0x6d703ef3, 0x7a6d76e9, 0x00000000};
+
+/// The boolean function of the round. The right line uses them in the reverse order.
+template <size_t Round>
+inline uint32_t f(uint32_t x, uint32_t y, uint32_t z) noexcept
+{
+    if constexpr (Round == 0)
+        return x ^ y ^ z;
+    else if constexpr (Round == 1)
+        return (x & y) | (~x & z);
+    else if constexpr (Round == 2)
+        return (x | ~y) ^ z;
+    else if constexpr (Round == 3)
+        return (x & z) | (y & ~z);
+    else
+        return x ^ (y | ~z);
+}
+
+/// The state of one of the two parallel lines.
+struct Line
+{
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+    uint32_t e;
+};
+
+/// Computes the 16 steps of the round in both lines. The function, the constants
+/// and the tables are compile-time for the round, the lines are interleaved for ILP.
+template <size_t Round>
+inline void round(Line& l, Line& r, const uint32_t x[16]) noexcept
+{
+#pragma GCC unroll 16
+    for (size_t i = 0; i < 16; ++i)
+    {
+        const auto tl = std::rotl(l.a + f<Round>(l.b, l.c, l.d) + x[R_LEFT[Round][i]] +
+                                      K_LEFT[Round],
+                            S_LEFT[Round][i]) +
+                        l.e;
+        l = {l.e, tl, l.b, std::rotl(l.c, 10), l.d};
+
+        const auto tr = std::rotl(r.a + f<4 - Round>(r.b, r.c, r.d) + x[R_RIGHT[Round][i]] +
+                                      K_RIGHT[Round],
+                            S_RIGHT[Round][i]) +
+                        r.e;
+        r = {r.e, tr, r.b, std::rotl(r.c, 10), r.d};
+    }
+}
+
+void compress(uint32_t state[5], const uint8_t* blocks, size_t num_blocks) noexcept
+{
+    for (; num_blocks != 0; --num_blocks, blocks += BLOCK_SIZE)
+    {
+        uint32_t x[16];
+        for (size_t i = 0; i < 16; ++i)
+        {
+            const auto p = &blocks[i * 4];
+            x[i] = uint32_t{p[0]} | (uint32_t{p[1]} << 8) | (uint32_t{p[2]} << 16) |
+                   (uint32_t{p[3]} << 24);
+        }
+
+        Line l{state[0], state[1], state[2], state[3], state[4]};
+        auto r = l;
+        round<0>(l, r, x);
+        round<1>(l, r, x);
+        round<2>(l, r, x);
+        round<3>(l, r, x);
+        round<4>(l, r, x);
+
+        const auto t = state[1] + l.c + r.d;
+        state[1] = state[2] + l.d + r.e;
+        state[2] = state[3] + l.e + r.a;
+        state[3] = state[4] + l.a + r.b;
+        state[4] = state[0] + l.b + r.c;
+        state[0] = t;
+    }
+}
+}  // namespace
+
+void ripemd160(uint8_t hash[RIPEMD160_HASH_SIZE], const uint8_t* data, size_t size) noexcept
+{
+    uint32_t state[5];
+    std::memcpy(state, INITIAL_STATE, sizeof(state));
+
+    const auto num_full_blocks = size / BLOCK_SIZE;
+    compress(state, data, num_full_blocks);
+
+    // Pad the tail with the 0x80 byte and the little-endian message length in bits.
+    const auto tail_size = size % BLOCK_SIZE;
+    uint8_t tail[2 * BLOCK_SIZE]{};
+    if (tail_size != 0)
+        std::memcpy(tail, &data[num_full_blocks * BLOCK_SIZE], tail_size);
+    tail[tail_size] = 0x80;
+    const size_t tail_blocks = tail_size + 1 + sizeof(uint64_t) <= BLOCK_SIZE ? 1 : 2;
+    const auto bit_size = uint64_t{size} * 8;
+    for (size_t i = 0; i < sizeof(bit_size); ++i)
+    {
+        tail[tail_blocks * BLOCK_SIZE - sizeof(bit_size) + i] =
+            static_cast<uint8_t>(bit_size >> (i * 8));
+    }
+    compress(state, tail, tail_blocks);
+
+    for (size_t i = 0; i < 5; ++i)
+    {
+        hash[i * 4 + 0] = static_cast<uint8_t>(state[i]);
+        hash[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 8);
+        hash[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 16);
+        hash[i * 4 + 3] = static_cast<uint8_t>(state[i] >> 24);
+    }
+}
+}  // namespace evmone::crypto
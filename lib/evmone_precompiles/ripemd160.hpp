@@ -0,0 +1,16 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace evmone::crypto
+{
+/// The size (20 bytes) of the RIPEMD-160 hash.
+inline constexpr size_t RIPEMD160_HASH_SIZE = 20;
+
+/// Computes the RIPEMD-160 hash of the data.
+void ripemd160(uint8_t hash[RIPEMD160_HASH_SIZE], const uint8_t* data, size_t size) noexcept;
+}  // namespace evmone::crypto
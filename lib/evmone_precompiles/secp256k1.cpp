@@ -0,0 +1,584 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "secp256k1.hpp"
+#include <ethash/keccak.hpp>
+#include <intx/intx.hpp>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace evmone::crypto
+{
+namespace
+{
+using intx::uint256;
+using intx::uint512;
+using intx::operator""_u256;
+
+/// The secp256k1 field prime p = 2^256 - 2^32 - 977.
+constexpr auto FieldPrime = 0xfffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f_u256;
+
+/// The difference 2^256 - p, so 2^256 ≡ FieldC (mod p).
+constexpr uint64_t FieldC = 0x1000003d1;
+
+/// The order n of the curve group.
+constexpr auto Order = 0xfffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141_u256;
+
+constexpr auto Gx = 0x79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798_u256;
+constexpr auto Gy = 0x483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8_u256;
+
+/// The GLV endomorphism φ(x, y) = (β·x, y) = λ·(x, y).
+constexpr auto Beta = 0x7ae96a2b657c07106e64479eac3434e99cf0497512f58995c1396c28719501ee_u256;
+constexpr auto Lambda = 0x5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72_u256;
+
+/// The constants of the scalar decomposition k = k1 + k2·λ (mod n), |k1|, |k2| < 2^128.
+/// The lattice basis vectors b1, b2 and g1 = round(2^384 · b2 / n), g2 = round(2^384 · -b1 / n).
+/// See "Guide to Elliptic Curve Cryptography", Algorithm 3.74 and libsecp256k1.
+constexpr auto MinusB1 = 0xe4437ed6010e88286f547fa90abfe4c3_u256;
+constexpr auto MinusB2 = 0xfffffffffffffffffffffffffffffffe8a280ac50774346dd765cda83db1562c_u256;
+constexpr auto G1 = 0x3086d221a7d46bcde86c90e49284eb153daa8a1471e8ca7fe893209a45dbb031_u256;
+constexpr auto G2 = 0xe4437ed6010e88286f547fa90abfe4c4221208ac9df506c61571b4ae8ac47f71_u256;
+
+
+// The field arithmetic on the values in [0, p) stored in 4x64-bit limbs.
+
+uint256 fadd(const uint256& a, const uint256& b) noexcept
+{
+    const auto [s, carry] = intx::addc(a, b);
+    // With the carry the wrapped-around subtraction gives the right result.
+    return (carry || s >= FieldPrime) ? s - FieldPrime : s;
+}
+
+uint256 fsub(const uint256& a, const uint256& b) noexcept
+{
+    const auto [d, borrow] = intx::subc(a, b);
+    return borrow ? d + FieldPrime : d;
+}
+
+uint256 fneg(const uint256& a) noexcept
+{
+    return a == 0 ? a : FieldPrime - a;
+}
+
+/// Reduces the 512-bit product modulo p using 2^256 ≡ FieldC.
+uint256 freduce(const uint512& x) noexcept
+{
+    // Fold the high half multiplied by FieldC into the low half.
+    uint256 r;
+    intx::uint128 acc;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        acc += intx::umul(x[i + 4], FieldC);
+        acc += x[i];
+        r[i] = acc[0];
+        acc = acc[1];
+    }
+
+    // Fold the remaining high word (less than 2^34). The carry out is possible only
+    // if the sum wraps around to a small value, then adding FieldC again cannot carry.
+    const auto t = intx::umul(acc[0], FieldC);
+    auto [s, carry] = intx::addc(r, uint256{t[0], t[1], 0, 0});
+    if (carry)
+        s += FieldC;
+    return s >= FieldPrime ? s - FieldPrime : s;
+}
+
+uint256 fmul(const uint256& a, const uint256& b) noexcept
+{
+    return freduce(intx::umul(a, b));
+}
+
+uint256 fsqr(const uint256& a) noexcept
+{
+    return fmul(a, a);
+}
+
+/// Squares the value n times.
+uint256 fsqr_n(uint256 a, int n) noexcept
+{
+    for (int i = 0; i < n; ++i)
+        a = fsqr(a);
+    return a;
+}
+
+/// Computes a^(2^223 - 1) and the intermediate values of the addition chain shared
+/// by the inversion and the square root (the exponents p-2 and (p+1)/4 share the prefix).
+struct PowChain
+{
+    uint256 x2;   ///< a^(2^2 - 1)
+    uint256 x22;  ///< a^(2^22 - 1)
+    uint256 x223; ///< a^(2^223 - 1)
+};
+
+PowChain pow_chain(const uint256& a) noexcept
+{
+    const auto x2 = fmul(fsqr(a), a);
+    const auto x3 = fmul(fsqr(x2), a);
+    const auto x6 = fmul(fsqr_n(x3, 3), x3);
+    const auto x9 = fmul(fsqr_n(x6, 3), x3);
+    const auto x11 = fmul(fsqr_n(x9, 2), x2);
+    const auto x22 = fmul(fsqr_n(x11, 11), x11);
+    const auto x44 = fmul(fsqr_n(x22, 22), x22);
+    const auto x88 = fmul(fsqr_n(x44, 44), x44);
+    const auto x176 = fmul(fsqr_n(x88, 88), x88);
+    const auto x220 = fmul(fsqr_n(x176, 44), x44);
+    const auto x223 = fmul(fsqr_n(x220, 3), x3);
+    return {x2, x22, x223};
+}
+
+/// Computes the inverse a^(p-2) of the non-zero field element.
+uint256 finv(const uint256& a) noexcept
+{
+    const auto [x2, x22, x223] = pow_chain(a);
+    auto t = fmul(fsqr_n(x223, 23), x22);
+    t = fmul(fsqr_n(t, 5), a);
+    t = fmul(fsqr_n(t, 3), x2);
+    return fmul(fsqr_n(t, 2), a);
+}
+
+/// Computes a^((p+1)/4), the square root of a if it exists.
+uint256 fsqrt(const uint256& a) noexcept
+{
+    const auto [x2, x22, x223] = pow_chain(a);
+    auto t = fmul(fsqr_n(x223, 23), x22);
+    t = fmul(fsqr_n(t, 6), x2);
+    return fsqr_n(t, 2);
+}
+
+
+// The scalar arithmetic modulo the group order n.
+
+/// The difference 2^256 - n (129 bits), so 2^256 ≡ OrderC (mod n).
+constexpr auto OrderC = 0x14551231950b75fc4402da1732fc9bebf_u256;
+
+/// Reduces the 512-bit product modulo n by folding the high half multiplied by OrderC
+/// into the low half. Each fold shrinks the value by ~127 bits, so at most 4 folds are needed.
+/// This avoids the generic division of intx::mulmod().
+uint256 nmul(const uint256& a, const uint256& b) noexcept
+{
+    auto x = intx::umul(a, b);
+    for (auto hi = static_cast<uint256>(x >> 256); hi != 0; hi = static_cast<uint256>(x >> 256))
+        x = intx::umul(hi, OrderC) + uint512{static_cast<uint256>(x)};
+    const auto r = static_cast<uint256>(x);
+    return r >= Order ? r - Order : r;
+}
+
+uint256 nadd(const uint256& a, const uint256& b) noexcept
+{
+    const auto [s, carry] = intx::addc(a, b);
+    return (carry || s >= Order) ? s - Order : s;
+}
+
+uint256 nsub(const uint256& a, const uint256& b) noexcept
+{
+    return a >= b ? a - b : Order - (b - a);
+}
+
+/// Computes the inverse of the non-zero scalar with the binary extended Euclidean algorithm.
+/// Faster than the exponentiation a^(n-2) which needs ~300 modular multiplications.
+uint256 ninv(const uint256& a) noexcept
+{
+    assert(a != 0 && a < Order);
+
+    // Halves x modulo n: the odd x is made even by adding n, keeping the carry bit.
+    const auto half = [](uint256& x) noexcept {
+        if ((x[0] & 1) == 0)
+            x >>= 1;
+        else
+        {
+            const auto [s, carry] = intx::addc(x, Order);
+            x = (s >> 1) | (uint256{carry} << 255);
+        }
+    };
+
+    uint256 u = a;
+    uint256 v = Order;
+    uint256 x1 = 1;
+    uint256 x2 = 0;
+    while (u != 1 && v != 1)
+    {
+        while ((u[0] & 1) == 0)
+        {
+            u >>= 1;
+            half(x1);
+        }
+        while ((v[0] & 1) == 0)
+        {
+            v >>= 1;
+            half(x2);
+        }
+        if (u >= v)
+        {
+            u -= v;
+            x1 = nsub(x1, x2);
+        }
+        else
+        {
+            v -= u;
+            x2 = nsub(x2, x1);
+        }
+    }
+    return u == 1 ? x1 : x2;
+}
+
+/// Replaces the non-zero values with their inverses computing only a single inversion
+/// (Montgomery's trick).
+template <auto Mul, auto Inv>
+void batch_inverse(std::span<uint256> values)
+{
+    if (values.empty())
+        return;
+
+    std::vector<uint256> prefix(values.size());
+    prefix[0] = values[0];
+    for (size_t i = 1; i < values.size(); ++i)
+        prefix[i] = Mul(prefix[i - 1], values[i]);
+
+    auto inv = Inv(prefix.back());
+    for (size_t i = values.size() - 1; i > 0; --i)
+    {
+        const auto v = values[i];
+        values[i] = Mul(inv, prefix[i - 1]);
+        inv = Mul(inv, v);
+    }
+    values[0] = inv;
+}
+
+
+struct AffinePoint
+{
+    uint256 x;
+    uint256 y;
+};
+
+/// The point in the Jacobian coordinates: x = X/Z², y = Y/Z³. The point at infinity has Z = 0.
+struct JacobianPoint
+{
+    uint256 x;
+    uint256 y;
+    uint256 z;
+
+    [[nodiscard]] bool is_infinity() const noexcept { return z == 0; }
+};
+
+/// Doubles the point (the "dbl-2009-l" formulas for a = 0).
+JacobianPoint dbl(const JacobianPoint& p) noexcept
+{
+    // There are no points of order 2 on the curve (y = 0), only the infinity doubles to itself.
+    if (p.is_infinity())
+        return p;
+
+    const auto a = fsqr(p.x);
+    const auto b = fsqr(p.y);
+    const auto c = fsqr(b);
+    const auto d2 = fsub(fsub(fsqr(fadd(p.x, b)), a), c);
+    const auto d = fadd(d2, d2);
+    const auto e = fadd(fadd(a, a), a);
+    const auto x3 = fsub(fsqr(e), fadd(d, d));
+    const auto c2 = fadd(c, c);
+    const auto c4 = fadd(c2, c2);
+    const auto y3 = fsub(fmul(e, fsub(d, x3)), fadd(c4, c4));
+    const auto yz = fmul(p.y, p.z);
+    return {x3, y3, fadd(yz, yz)};
+}
+
+/// Adds the points (the "add-2007-bl" formulas).
+JacobianPoint add(const JacobianPoint& p, const JacobianPoint& q) noexcept
+{
+    if (p.is_infinity())
+        return q;
+    if (q.is_infinity())
+        return p;
+
+    const auto z1z1 = fsqr(p.z);
+    const auto z2z2 = fsqr(q.z);
+    const auto u1 = fmul(p.x, z2z2);
+    const auto u2 = fmul(q.x, z1z1);
+    const auto s1 = fmul(fmul(p.y, q.z), z2z2);
+    const auto s2 = fmul(fmul(q.y, p.z), z1z1);
+    const auto h = fsub(u2, u1);
+    const auto r2 = fsub(s2, s1);
+    if (h == 0)
+        return r2 == 0 ? dbl(p) : JacobianPoint{};
+
+    const auto r = fadd(r2, r2);
+    const auto h2 = fadd(h, h);
+    const auto i = fsqr(h2);
+    const auto j = fmul(h, i);
+    const auto v = fmul(u1, i);
+    const auto x3 = fsub(fsub(fsqr(r), j), fadd(v, v));
+    const auto s1j = fmul(s1, j);
+    const auto y3 = fsub(fmul(r, fsub(v, x3)), fadd(s1j, s1j));
+    const auto z3 = fmul(fsub(fsub(fsqr(fadd(p.z, q.z)), z1z1), z2z2), h);
+    return {x3, y3, z3};
+}
+
+/// Adds the affine point (the "madd-2007-bl" formulas, cheaper than the general addition).
+JacobianPoint add(const JacobianPoint& p, const AffinePoint& q) noexcept
+{
+    if (p.is_infinity())
+        return {q.x, q.y, 1};
+
+    const auto z1z1 = fsqr(p.z);
+    const auto u2 = fmul(q.x, z1z1);
+    const auto s2 = fmul(fmul(q.y, p.z), z1z1);
+    const auto h = fsub(u2, p.x);
+    const auto r2 = fsub(s2, p.y);
+    if (h == 0)
+        return r2 == 0 ? dbl(p) : JacobianPoint{};
+
+    const auto hh = fsqr(h);
+    const auto hh2 = fadd(hh, hh);
+    const auto i = fadd(hh2, hh2);
+    const auto j = fmul(h, i);
+    const auto r = fadd(r2, r2);
+    const auto v = fmul(p.x, i);
+    const auto x3 = fsub(fsub(fsqr(r), j), fadd(v, v));
+    const auto yj = fmul(p.y, j);
+    const auto y3 = fsub(fmul(r, fsub(v, x3)), fadd(yj, yj));
+    const auto z3 = fsub(fsub(fsqr(fadd(p.z, h)), z1z1), hh);
+    return {x3, y3, z3};
+}
+
+/// Converts the points to the affine coordinates with a single field inversion.
+/// The points at infinity are converted to (0, 0).
+void batch_normalize(std::span<const JacobianPoint> in, std::span<AffinePoint> out)
+{
+    assert(in.size() == out.size());
+    std::vector<uint256> zs(in.size());
+    for (size_t i = 0; i < in.size(); ++i)
+        zs[i] = in[i].is_infinity() ? 1 : in[i].z;
+    batch_inverse<fmul, finv>(zs);
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        if (in[i].is_infinity())
+        {
+            out[i] = {};
+            continue;
+        }
+        const auto zinv2 = fsqr(zs[i]);
+        out[i] = {fmul(in[i].x, zinv2), fmul(in[i].y, fmul(zinv2, zs[i]))};
+    }
+}
+
+/// Returns the 4-bit digit of the scalar at the position i.
+inline unsigned digit(const uint256& k, unsigned i) noexcept
+{
+    return static_cast<unsigned>(k[i / 16] >> ((i % 16) * 4)) & 0xf;
+}
+
+constexpr unsigned GenTableWindows = 64;
+constexpr unsigned GenTableWindowSize = 16;
+
+/// Returns the table of the generator multiples j·16^i·G for i in [0, 64) and j in [1, 16)
+/// at the index i·16 + j. Computed on first use (~60 KB).
+const AffinePoint* generator_table() noexcept
+{
+    static const auto table = [] {
+        std::vector<JacobianPoint> points(GenTableWindows * GenTableWindowSize);
+        JacobianPoint base{Gx, Gy, 1};
+        for (unsigned i = 0; i < GenTableWindows; ++i)
+        {
+            const auto window = &points[i * GenTableWindowSize];
+            window[1] = base;
+            for (unsigned j = 2; j < GenTableWindowSize; ++j)
+                window[j] = add(window[j - 1], base);
+            base = dbl(window[GenTableWindowSize / 2]);
+        }
+        std::vector<AffinePoint> affine(points.size());
+        batch_normalize(points, affine);
+        return affine;
+    }();
+    return table.data();
+}
+
+/// Computes k·G as the sum of the precomputed multiples of G, without doublings.
+JacobianPoint mul_generator(const uint256& k) noexcept
+{
+    const auto table = generator_table();
+    JacobianPoint r;
+    for (unsigned i = 0; i < GenTableWindows; ++i)
+    {
+        if (const auto d = digit(k, i); d != 0)
+            r = add(r, table[i * GenTableWindowSize + d]);
+    }
+    return r;
+}
+
+/// The scalar decomposed as k = k1 + k2·λ (mod n) with the signed 128-bit halves.
+struct SplitScalar
+{
+    uint256 k1;
+    uint256 k2;
+    bool k1_negative = false;
+    bool k2_negative = false;
+};
+
+/// Computes round(k·g / 2^384).
+uint256 mul_shift_384(const uint256& k, const uint256& g) noexcept
+{
+    const auto p = intx::umul(k, g);
+    auto r = static_cast<uint256>(p >> 384);
+    if ((p[5] >> 63) != 0)  // Round up if the bit 383 is set.
+        r += 1;
+    return r;
+}
+
+SplitScalar split(const uint256& k) noexcept
+{
+    const auto c1 = mul_shift_384(k, G1);
+    const auto c2 = mul_shift_384(k, G2);
+    const auto k2 = nadd(nmul(c1, MinusB1), nmul(c2, MinusB2));
+    const auto k1 = nsub(k, nmul(k2, Lambda));
+
+    // The "negative" halves are above n/2.
+    static constexpr auto half_order = Order >> 1;
+    SplitScalar s;
+    s.k1_negative = k1 > half_order;
+    s.k1 = s.k1_negative ? Order - k1 : k1;
+    s.k2_negative = k2 > half_order;
+    s.k2 = s.k2_negative ? Order - k2 : k2;
+    return s;
+}
+
+/// Computes k·P using the GLV endomorphism: k·P = k1·P + k2·φ(P) with 128-bit k1 and k2,
+/// so the number of doublings is halved. The multiples of P are added in 4-bit windows.
+JacobianPoint mul(const AffinePoint& p, const uint256& k) noexcept
+{
+    const auto [k1, k2, k1_negative, k2_negative] = split(k);
+
+    JacobianPoint table[16];
+    table[1] = {p.x, p.y, 1};
+    for (size_t j = 2; j < std::size(table); ++j)
+        table[j] = add(table[j - 1], p);
+
+    JacobianPoint r;
+    for (unsigned i = 128 / 4; i-- != 0;)
+    {
+        r = dbl(dbl(dbl(dbl(r))));
+        if (const auto d = digit(k1, i); d != 0)
+        {
+            auto q = table[d];
+            if (k1_negative)
+                q.y = fneg(q.y);
+            r = add(r, q);
+        }
+        if (const auto d = digit(k2, i); d != 0)
+        {
+            auto q = table[d];
+            q.x = fmul(q.x, Beta);
+            if (k2_negative)
+                q.y = fneg(q.y);
+            r = add(r, q);
+        }
+    }
+    return r;
+}
+
+/// The signature values checked and decoded for the recovery.
+struct Signature
+{
+    uint256 z;  ///< The message hash reduced modulo n.
+    uint256 r;
+    uint256 s;
+    AffinePoint point;  ///< The signature point R with the x coordinate r.
+};
+
+/// Checks the signature values and computes the signature point.
+bool decode(const uint8_t* hash, const uint8_t* r_bytes, const uint8_t* s_bytes, bool parity,
+    Signature& sig) noexcept
+{
+    sig.r = intx::be::unsafe::load<uint256>(r_bytes);
+    sig.s = intx::be::unsafe::load<uint256>(s_bytes);
+    if (sig.r == 0 || sig.r >= Order || sig.s == 0 || sig.s >= Order)
+        return false;
+
+    // The point R = (r, y) where y² = r³ + 7. The r < n < p is a valid field element.
+    const auto& x = sig.r;
+    const auto y2 = fadd(fmul(fsqr(x), x), 7);
+    auto y = fsqrt(y2);
+    if (fsqr(y) != y2)
+        return false;  // r is not the x coordinate of a curve point.
+    if (((y[0] & 1) != 0) != parity)
+        y = fneg(y);
+    sig.point = {x, y};
+
+    sig.z = intx::be::unsafe::load<uint256>(hash);
+    if (sig.z >= Order)
+        sig.z -= Order;
+    return true;
+}
+
+/// Computes the public key Q = r⁻¹·(s·R - z·G) = (-z·r⁻¹)·G + (s·r⁻¹)·R.
+JacobianPoint recover_public_key(const Signature& sig, const uint256& r_inv) noexcept
+{
+    const auto u1 = nmul(nsub(0, sig.z), r_inv);
+    const auto u2 = nmul(sig.s, r_inv);
+    return add(mul(sig.point, u2), mul_generator(u1));
+}
+
+evmc::address to_address(const AffinePoint& public_key) noexcept
+{
+    uint8_t serialized[64];
+    intx::be::unsafe::store(&serialized[0], public_key.x);
+    intx::be::unsafe::store(&serialized[32], public_key.y);
+    const auto hash = ethash::keccak256(serialized, sizeof(serialized));
+
+    evmc::address addr;
+    std::memcpy(addr.bytes, &hash.bytes[sizeof(hash) - sizeof(addr)], sizeof(addr));
+    return addr;
+}
+}  // namespace
+
+std::optional<evmc::address> ecrecover(std::span<const uint8_t, 32> hash,
+    std::span<const uint8_t, 32> r, std::span<const uint8_t, 32> s, bool parity) noexcept
+{
+    Signature sig;
+    if (!decode(hash.data(), r.data(), s.data(), parity, sig))
+        return {};
+
+    const auto q = recover_public_key(sig, ninv(sig.r));
+    if (q.is_infinity())
+        return {};
+
+    const auto zinv = finv(q.z);
+    const auto zinv2 = fsqr(zinv);
+    return to_address({fmul(q.x, zinv2), fmul(q.y, fmul(zinv2, zinv))});
+}
+
+void ecrecover(std::span<const EcrecoverInput> inputs,
+    std::span<std::optional<evmc::address>> outputs) noexcept
+{
+    assert(inputs.size() == outputs.size());
+
+    std::vector<Signature> sigs(inputs.size());
+    std::vector<bool> valid(inputs.size());
+    std::vector<uint256> r_invs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        const auto& in = inputs[i];
+        valid[i] = decode(in.hash.bytes, in.r.bytes, in.s.bytes, in.parity, sigs[i]);
+        r_invs[i] = valid[i] ? sigs[i].r : 1;
+    }
+    batch_inverse<nmul, ninv>(r_invs);
+
+    std::vector<JacobianPoint> keys(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        if (valid[i])
+            keys[i] = recover_public_key(sigs[i], r_invs[i]);
+    }
+
+    std::vector<AffinePoint> affine_keys(inputs.size());
+    batch_normalize(keys, affine_keys);
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        if (valid[i] && !keys[i].is_infinity())
+            outputs[i] = to_address(affine_keys[i]);
+        else
+            outputs[i].reset();
+    }
+}
+}  // namespace evmone::crypto
@@ -0,0 +1,35 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <evmc/evmc.hpp>
+#include <optional>
+#include <span>
+
+namespace evmone::crypto
+{
+/// The ECDSA signature of the message hash over the secp256k1 curve.
+struct EcrecoverInput
+{
+    evmc::bytes32 hash;
+    evmc::bytes32 r;
+    evmc::bytes32 s;
+
+    /// The parity of the y coordinate of the signature point (the recovery id).
+    bool parity = false;
+};
+
+/// Recovers the Ethereum address of the signer (the hash of the public key)
+/// from the ECDSA signature over secp256k1. Returns nullopt if the signature is invalid.
+std::optional<evmc::address> ecrecover(std::span<const uint8_t, 32> hash,
+    std::span<const uint8_t, 32> r, std::span<const uint8_t, 32> s, bool parity) noexcept;
+
+/// Recovers the signers of multiple signatures at once.
+///
+/// The results are the same as of ecrecover() for each signature, but the modular inversions
+/// are shared by all signatures (Montgomery's trick) so the batch is cheaper
+/// than the separate recoveries. The inputs and the outputs must have the same size.
+void ecrecover(std::span<const EcrecoverInput> inputs,
+    std::span<std::optional<evmc::address>> outputs) noexcept;
+}  // namespace evmone::crypto
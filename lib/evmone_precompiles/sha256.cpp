@@ -0,0 +1,218 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sha256.hpp"
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EVMONE_SHA256_SHANI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace evmone::crypto
+{
+namespace
+{
+constexpr size_t BLOCK_SIZE = 64;
+
+constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr uint32_t INITIAL_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+inline uint32_t load_be32(const uint8_t* p) noexcept
+{
+    return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | p[3];
+}
+
+}  // namespace
+
+void internal::sha256_compress_generic(
+    uint32_t state[8], const uint8_t* blocks, size_t num_blocks) noexcept
+{
+    for (; num_blocks != 0; --num_blocks, blocks += BLOCK_SIZE)
+    {
+        uint32_t w[64];
+        for (size_t i = 0; i < 16; ++i)
+            w[i] = load_be32(&blocks[i * 4]);
+        for (size_t i = 16; i < 64; ++i)
+        {
+            const auto s0 =
+                std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        auto a = state[0];
+        auto b = state[1];
+        auto c = state[2];
+        auto d = state[3];
+        auto e = state[4];
+        auto f = state[5];
+        auto g = state[6];
+        auto h = state[7];
+        for (size_t i = 0; i < 64; ++i)
+        {
+            const auto s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+            const auto ch = (e & f) ^ (~e & g);
+            const auto t1 = h + s1 + ch + K[i] + w[i];
+            const auto s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+            const auto maj = (a & b) ^ (a & c) ^ (b & c);
+            const auto t2 = s0 + maj;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+namespace
+{
+#if EVMONE_SHA256_SHANI
+/// Compresses the blocks using the x86 SHA extensions.
+/// The SHA256RNDS2 instruction computes 2 rounds and keeps the state in the ABEF/CDGH layout.
+__attribute__((target("sha,sse4.1"))) void compress_shani(
+    uint32_t state[8], const uint8_t* blocks, size_t num_blocks) noexcept
+{
+    // Converts the big-endian message words.
+    const auto bswap_mask = _mm_set_epi64x(0x0c0d0e0f08090a0b, 0x0405060700010203);
+
+    // Convert the state to the ABEF/CDGH layout.
+    const auto dcba =
+        _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+    const auto efgh =
+        _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+    auto abef = _mm_alignr_epi8(dcba, efgh, 8);
+    auto cdgh = _mm_blend_epi16(efgh, dcba, 0xF0);
+
+    for (; num_blocks != 0; --num_blocks, blocks += BLOCK_SIZE)
+    {
+        const auto abef_save = abef;
+        const auto cdgh_save = cdgh;
+
+        // The message schedule of the last 16 words in 4 groups, the group i % 4 holds
+        // the words 4i..4i+3.
+        __m128i msg[4];
+#pragma GCC unroll 16
+        for (size_t i = 0; i < 16; ++i)
+        {
+            auto& m = msg[i % 4];
+            if (i < 4)
+            {
+                m = _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(&blocks[i * 16])),
+                    bswap_mask);
+            }
+            else
+            {
+                // The words 4i-16..4i-13 are in the place of the new group.
+                const auto w16 = _mm_sha256msg1_epu32(m, msg[(i + 1) % 4]);
+                const auto w7 = _mm_alignr_epi8(msg[(i + 3) % 4], msg[(i + 2) % 4], 4);
+                m = _mm_sha256msg2_epu32(_mm_add_epi32(w16, w7), msg[(i + 3) % 4]);
+            }
+
+            auto wk =
+                _mm_add_epi32(m, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[i * 4])));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+            wk = _mm_shuffle_epi32(wk, 0x0E);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, wk);
+        }
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    // Convert the state back to the ABCD/EFGH layout.
+    const auto feba = _mm_shuffle_epi32(abef, 0x1B);
+    const auto dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+bool has_shani() noexcept
+{
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+        return false;
+    const auto sha = (ebx & bit_SHA) != 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+        return false;
+    return sha && (ecx & bit_SSE4_1) != 0 && (ecx & bit_SSSE3) != 0;
+}
+#endif
+
+}  // namespace
+
+internal::Sha256CompressFn internal::get_sha256_compress_shani() noexcept
+{
+#if EVMONE_SHA256_SHANI
+    if (has_shani())
+        return compress_shani;
+#endif
+    return nullptr;
+}
+
+void sha256(uint8_t hash[SHA256_HASH_SIZE], const uint8_t* data, size_t size) noexcept
+{
+    static const auto compress = [] {
+        const auto shani = internal::get_sha256_compress_shani();
+        return shani != nullptr ? shani : internal::sha256_compress_generic;
+    }();
+    internal::sha256(hash, data, size, compress);
+}
+
+void internal::sha256(uint8_t hash[SHA256_HASH_SIZE], const uint8_t* data, size_t size,
+    Sha256CompressFn compress) noexcept
+{
+    uint32_t state[8];
+    std::memcpy(state, INITIAL_STATE, sizeof(state));
+
+    const auto num_full_blocks = size / BLOCK_SIZE;
+    compress(state, data, num_full_blocks);
+
+    // Pad the tail with the 0x80 byte and the message length in bits into 1 or 2 blocks.
+    const auto tail_size = size % BLOCK_SIZE;
+    uint8_t tail[2 * BLOCK_SIZE]{};
+    if (tail_size != 0)
+        std::memcpy(tail, &data[num_full_blocks * BLOCK_SIZE], tail_size);
+    tail[tail_size] = 0x80;
+    const size_t tail_blocks = tail_size + 1 + sizeof(uint64_t) <= BLOCK_SIZE ? 1 : 2;
+    const auto bit_size = uint64_t{size} * 8;
+    for (size_t i = 0; i < sizeof(bit_size); ++i)
+        tail[tail_blocks * BLOCK_SIZE - 1 - i] = static_cast<uint8_t>(bit_size >> (i * 8));
+    compress(state, tail, tail_blocks);
+
+    for (size_t i = 0; i < 8; ++i)
+    {
+        hash[i * 4 + 0] = static_cast<uint8_t>(state[i] >> 24);
+        hash[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        hash[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        hash[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+}  // namespace evmone::crypto
@@ -0,0 +1,38 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace evmone::crypto
+{
+/// The size (32 bytes) of the SHA-256 hash.
+inline constexpr size_t SHA256_HASH_SIZE = 32;
+
+/// Computes the SHA-256 hash of the data.
+///
+/// The implementation is selected once at runtime: the x86 SHA extensions (SHA-NI)
+/// if supported by the CPU, the portable one otherwise.
+void sha256(uint8_t hash[SHA256_HASH_SIZE], const uint8_t* data, size_t size) noexcept;
+
+/// The implementations of the compression function, exposed for testing.
+namespace internal
+{
+/// The function compressing the consecutive 64-byte blocks into the state.
+using Sha256CompressFn = void (*)(
+    uint32_t state[8], const uint8_t* blocks, size_t num_blocks) noexcept;
+
+/// The portable implementation.
+void sha256_compress_generic(uint32_t state[8], const uint8_t* blocks, size_t num_blocks) noexcept;
+
+/// Returns the implementation using the x86 SHA extensions (SHA-NI)
+/// or null if the CPU does not support them.
+Sha256CompressFn get_sha256_compress_shani() noexcept;
+
+/// Computes the SHA-256 hash of the data using the given compression function.
+void sha256(uint8_t hash[SHA256_HASH_SIZE], const uint8_t* data, size_t size,
+    Sha256CompressFn compress) noexcept;
+}  // namespace internal
+}  // namespace evmone::crypto
@@ -2,6 +2,11 @@
 // Copyright 2019 The evmone Authors.
 // SPDX-License-Identifier: Apache-2.0
 
+#ifdef _MSC_VER
+// Disable warning C4996: 'getenv': This function or variable may be unsafe.
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
 #include "../statetest/statetest.hpp"
 #include "helpers.hpp"
 #include "synthetic_benchmarks.hpp"
@@ -9,6 +14,7 @@
 #include <evmc/evmc.hpp>
 #include <evmc/loader.h>
 #include <evmone/evmone.h>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -274,6 +280,11 @@ int main(int argc, char** argv)
         registered_vms["advanced"] = evmc::VM{evmc_create_evmone(), {{"advanced", ""}}};
         registered_vms["baseline"] = evmc::VM{evmc_create_evmone()};
         registered_vms["bnocgoto"] = evmc::VM{evmc_create_evmone(), {{"cgoto", "no"}}};
+        if (std::getenv("EVMONE_BENCH_CYCLES") != nullptr)
+        {
+            // Reports the per-opcode CPU time to stderr at exit, run with the filter "cycles/".
+            registered_vms["cycles"] = evmc::VM{evmc_create_evmone(), {{"cycles", ""}}};
+        }
         register_benchmarks(benchmark_cases);
         register_synthetic_benchmarks();
         RunSpecifiedBenchmarks();
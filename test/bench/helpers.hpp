@@ -131,6 +131,9 @@ inline void bench_execute(benchmark::State& state, evmc::VM& vm, bytes_view code
         }
     }
 
+#if EVMONE_MEMORY_COUNTERS
+    const auto start_memory_counters = memory_counters();
+#endif
     auto total_gas_used = int64_t{0};
     auto iteration_gas_used = int64_t{0};
     for (auto _ : state)
@@ -143,6 +146,20 @@ inline void bench_execute(benchmark::State& state, evmc::VM& vm, bytes_view code
     using benchmark::Counter;
     state.counters["gas_used"] = Counter(static_cast<double>(iteration_gas_used));
     state.counters["gas_rate"] = Counter(static_cast<double>(total_gas_used), Counter::kIsRate);
+
+#if EVMONE_MEMORY_COUNTERS
+    // The memory counters per iteration.
+    const auto c = memory_counters() - start_memory_counters;
+    const auto avg = [](uint64_t n) {
+        return Counter(static_cast<double>(n), Counter::kAvgIterations);
+    };
+    state.counters["mem_grows"] = avg(c.memory_grows);
+    state.counters["mem_reallocs"] = avg(c.memory_reallocs);
+    state.counters["mem_zeroed"] = avg(c.bytes_zeroed);
+    state.counters["return_data_allocs"] = avg(c.return_data_allocs);
+    state.counters["output_allocs"] = avg(c.output_allocs);
+    state.counters["bytes_copied"] = avg(c.bytes_copied);
+#endif
 }
 
 
@@ -0,0 +1,73 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <benchmark/benchmark.h>
+#include <test/state/mpt.hpp>
+#include <vector>
+
+namespace
+{
+using namespace evmone;
+
+/// Generates the (key, value) pairs resembling a state trie: 32-byte keccak keys
+/// and values of the size of a typical RLP-encoded account.
+std::vector<std::pair<hash256, bytes>> generate_entries(size_t n)
+{
+    std::vector<std::pair<hash256, bytes>> entries;
+    entries.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const auto key = keccak256({reinterpret_cast<const uint8_t*>(&i), sizeof(i)});
+        const auto value_hash = keccak256(key);
+        bytes value{value_hash.bytes, sizeof(value_hash)};
+        value += bytes{value_hash.bytes, sizeof(value_hash)};
+        value.resize(70);
+        entries.emplace_back(key, std::move(value));
+    }
+    return entries;
+}
+
+void fill_trie(state::MPT& trie, const std::vector<std::pair<hash256, bytes>>& entries)
+{
+    for (const auto& [key, value] : entries)
+        trie.insert(key, value);
+}
+
+void mpt_insert(benchmark::State& state)
+{
+    const auto entries = generate_entries(static_cast<size_t>(state.range(0)));
+
+    size_t capacity = 0;
+    size_t bytes_allocated = 0;
+    for ([[maybe_unused]] auto _ : state)
+    {
+        state::MPT trie;
+        fill_trie(trie, entries);
+        capacity = trie.arena_capacity();
+        bytes_allocated = trie.arena_bytes_allocated();
+        benchmark::DoNotOptimize(&trie);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    // The memory owned by the trie (nodes, keys and values) per inserted key
+    // and the part of it actually used.
+    const auto num_keys = static_cast<double>(entries.size());
+    state.counters["bytes_per_key"] = static_cast<double>(capacity) / num_keys;
+    state.counters["used_bytes_per_key"] = static_cast<double>(bytes_allocated) / num_keys;
+}
+BENCHMARK(mpt_insert)->Arg(100)->Arg(10'000)->Arg(100'000);
+
+void mpt_hash(benchmark::State& state)
+{
+    state::MPT trie;
+    fill_trie(trie, generate_entries(static_cast<size_t>(state.range(0))));
+
+    for ([[maybe_unused]] auto _ : state)
+        benchmark::DoNotOptimize(trie.hash());
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(mpt_hash)->Arg(100)->Arg(10'000)->Arg(100'000);
+
+}  // namespace
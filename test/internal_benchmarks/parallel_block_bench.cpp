@@ -0,0 +1,79 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <benchmark/benchmark.h>
+#include <evmone/evmone.h>
+#include <test/state/parallel.hpp>
+#include <test/utils/bytecode.hpp>
+
+namespace
+{
+using namespace evmone;
+using namespace evmone::state;
+using namespace evmc::literals;
+
+constexpr auto Token = 0x70c0_address;
+constexpr size_t NumTransactions = 200;
+
+BlockInfo make_block()
+{
+    BlockInfo block;
+    block.gas_limit = 30'000'000;
+    block.coinbase = 0xc014bace_address;
+    block.base_fee = 1;
+    return block;
+}
+
+/// Creates the block of token transfers, each from a different sender to a different recipient.
+/// The token contract also hashes some memory to have more computation than state access.
+std::pair<State, std::vector<Transaction>> generate_token_transfers()
+{
+    const auto transfer = sstore(calldataload(0), add(sload(calldataload(0)), 1)) +
+                          sstore(OP_CALLER, add(sload(OP_CALLER), 1));
+    bytecode work;
+    for (int i = 0; i < 100; ++i)
+        work += keccak256(0, 256) + OP_POP;
+
+    State state;
+    state.insert(Token, {.code = transfer + work});
+    std::vector<Transaction> txs;
+    for (uint64_t i = 0; i < NumTransactions; ++i)
+    {
+        const address sender{0x5e0000 + i};
+        state.insert(sender, {.balance = 1'000'000'000'000'000});
+        auto& tx = txs.emplace_back();
+        tx.gas_limit = 100'000;
+        tx.max_gas_price = 2;
+        tx.max_priority_gas_price = 1;
+        tx.sender = sender;
+        tx.to = Token;
+        tx.data = bytes32{0x7ec0000 + i};
+    }
+    state.clear_accessed_accounts();
+    for (auto& [_, acc] : state.get_accounts())
+        acc.accessed = false;
+    return {std::move(state), std::move(txs)};
+}
+
+void apply_token_transfers(benchmark::State& bench_state)
+{
+    const auto num_threads = static_cast<unsigned>(bench_state.range(0));
+    evmc::VM vm{evmc_create_evmone()};
+    const auto block = make_block();
+    const auto [pre, txs] = generate_token_transfers();
+
+    for ([[maybe_unused]] auto _ : bench_state)
+    {
+        auto state = pre;
+        auto res = num_threads == 1 ? apply_block(state, block, txs, EVMC_SHANGHAI, vm) :
+                                      apply_block_parallel(state, block, txs, EVMC_SHANGHAI, vm,
+                                          num_threads);
+        if (std::holds_alternative<std::error_code>(res))
+            return bench_state.SkipWithError(std::get<std::error_code>(res).message().c_str());
+        benchmark::DoNotOptimize(res);
+    }
+    bench_state.SetItemsProcessed(bench_state.iterations() * static_cast<int64_t>(txs.size()));
+}
+BENCHMARK(apply_token_transfers)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+}  // namespace
@@ -0,0 +1,238 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <benchmark/benchmark.h>
+#include <evmc/hex.hpp>
+#include <evmone_precompiles/secp256k1.hpp>
+#include <test/state/precompiles_internal.hpp>
+#include <vector>
+
+namespace
+{
+using namespace evmone::state;
+using namespace evmc::literals;
+
+using AnalyzeFn = decltype(&identity_analyze);
+using ExecuteFn = decltype(&identity_execute);
+
+/// Benchmarks the precompile execution for the input size given as the benchmark argument.
+/// The "gas_rate" counter is the gas charged by the precompile per second of execution time:
+/// comparing it between the precompiles and the input sizes checks the gas pricing
+/// against the actual cost.
+template <AnalyzeFn Analyze, ExecuteFn Execute>
+void precompile(benchmark::State& state)
+{
+    std::vector<uint8_t> input(static_cast<size_t>(state.range(0)));
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<uint8_t>(i * 0x9e + 1);
+
+    const auto [gas_cost, max_output_size] = Analyze({input.data(), input.size()}, EVMC_SHANGHAI);
+    std::vector<uint8_t> output(max_output_size);
+
+    for ([[maybe_unused]] auto _ : state)
+    {
+        const auto res = Execute(input.data(), input.size(), output.data(), output.size());
+        if (res.status_code != EVMC_SUCCESS)
+            return state.SkipWithError("precompile execution failed");
+        benchmark::DoNotOptimize(output.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+    state.counters["gas_cost"] = static_cast<double>(gas_cost);
+    state.counters["gas_rate"] = benchmark::Counter(
+        static_cast<double>(gas_cost * static_cast<int64_t>(state.iterations())),
+        benchmark::Counter::kIsRate);
+}
+
+#define BENCHMARK_PRECOMPILE(NAME)                                   \
+    BENCHMARK_TEMPLATE(precompile, NAME##_analyze, NAME##_execute) \
+        ->Name("precompile/" #NAME)
+
+BENCHMARK_PRECOMPILE(identity)->RangeMultiplier(4)->Range(0, 16384);
+BENCHMARK_PRECOMPILE(sha256)->RangeMultiplier(4)->Range(0, 16384);
+BENCHMARK_PRECOMPILE(ripemd160)->RangeMultiplier(4)->Range(0, 16384);
+
+/// Benchmarks the blake2bf precompile for the number of rounds given as the benchmark argument.
+/// The cost is 1 gas per round, the "gas_rate" should not depend on the round count.
+void precompile_blake2bf(benchmark::State& state)
+{
+    const auto rounds = static_cast<uint32_t>(state.range(0));
+    uint8_t input[213]{};
+    for (size_t i = 0; i < std::size(input); ++i)
+        input[i] = static_cast<uint8_t>(i * 0x9e + 1);
+    input[0] = static_cast<uint8_t>(rounds >> 24);
+    input[1] = static_cast<uint8_t>(rounds >> 16);
+    input[2] = static_cast<uint8_t>(rounds >> 8);
+    input[3] = static_cast<uint8_t>(rounds);
+    input[212] = 1;
+
+    const auto [gas_cost, max_output_size] = blake2bf_analyze({input, std::size(input)}, EVMC_CANCUN);
+    std::vector<uint8_t> output(max_output_size);
+
+    for ([[maybe_unused]] auto _ : state)
+    {
+        const auto res =
+            blake2bf_execute(input, std::size(input), output.data(), output.size());
+        if (res.status_code != EVMC_SUCCESS)
+            return state.SkipWithError("precompile execution failed");
+        benchmark::DoNotOptimize(output.data());
+    }
+
+    state.counters["gas_cost"] = static_cast<double>(gas_cost);
+    state.counters["gas_rate"] = benchmark::Counter(
+        static_cast<double>(gas_cost * static_cast<int64_t>(state.iterations())),
+        benchmark::Counter::kIsRate);
+}
+BENCHMARK(precompile_blake2bf)->Name("precompile/blake2bf")->RangeMultiplier(8)->Range(1, 1 << 18);
+
+/// Benchmarks the expmod precompile for the modulus length, the exponent length
+/// and the modulus parity given as the benchmark arguments. The base has the modulus length.
+/// The "gas_rate" counter much lower than for other inputs indicates the EIP-2565 formula
+/// under-prices the input.
+void precompile_expmod(benchmark::State& state)
+{
+    const auto mod_len = static_cast<size_t>(state.range(0));
+    const auto exp_len = static_cast<size_t>(state.range(1));
+    const auto odd = state.range(2) != 0;
+
+    std::vector<uint8_t> input(96 + 2 * mod_len + exp_len);
+    input[31] = static_cast<uint8_t>(mod_len);
+    input[30] = static_cast<uint8_t>(mod_len >> 8);
+    input[63] = static_cast<uint8_t>(exp_len);
+    input[62] = static_cast<uint8_t>(exp_len >> 8);
+    input[95] = static_cast<uint8_t>(mod_len);
+    input[94] = static_cast<uint8_t>(mod_len >> 8);
+    for (size_t i = 96; i < input.size(); ++i)
+        input[i] = static_cast<uint8_t>(i * 0x9e + 1) | 0x80;  // All exponent bytes nonzero.
+    if (!odd)
+        input.back() &= 0xfe;
+    else
+        input.back() |= 1;
+
+    const auto [gas_cost, max_output_size] =
+        expmod_analyze({input.data(), input.size()}, EVMC_CANCUN);
+    std::vector<uint8_t> output(max_output_size);
+
+    for ([[maybe_unused]] auto _ : state)
+    {
+        const auto res = expmod_execute(input.data(), input.size(), output.data(), output.size());
+        if (res.status_code != EVMC_SUCCESS)
+            return state.SkipWithError("precompile execution failed");
+        benchmark::DoNotOptimize(output.data());
+    }
+
+    state.counters["gas_cost"] = static_cast<double>(gas_cost);
+    state.counters["gas_rate"] = benchmark::Counter(
+        static_cast<double>(gas_cost * static_cast<int64_t>(state.iterations())),
+        benchmark::Counter::kIsRate);
+}
+BENCHMARK(precompile_expmod)
+    ->Name("precompile/expmod")
+    ->ArgNames({"mod_len", "exp_len", "odd"})
+    ->ArgsProduct({{32, 64, 128, 256, 512}, {1, 32, 128}, {1}})
+    ->ArgsProduct({{32, 256}, {32}, {0}});
+
+/// The valid signature: the ecrecover cost does not depend on the input size,
+/// but the invalid inputs are rejected early.
+const evmone::crypto::EcrecoverInput ecrecover_input{
+    0x456e9aea5e197a1f1af7a3e85a3212fa4049a3ba34c2289b4c860fc0b0c64ef3_bytes32,
+    0x9242685bf161793cc25603c231bc2f568eb630ea16aa137d2664ac8038825608_bytes32,
+    0x4f8ae3bd7535248d0bd448298cc2e2071e56992d0774dc340c368ae950852ada_bytes32, true};
+
+void precompile_ecrecover(benchmark::State& state)
+{
+    uint8_t input[128]{};
+    std::copy_n(ecrecover_input.hash.bytes, 32, &input[0]);
+    input[63] = 28;
+    std::copy_n(ecrecover_input.r.bytes, 32, &input[64]);
+    std::copy_n(ecrecover_input.s.bytes, 32, &input[96]);
+
+    const auto [gas_cost, max_output_size] = ecrecover_analyze(input, EVMC_SHANGHAI);
+    std::vector<uint8_t> output(max_output_size);
+
+    for ([[maybe_unused]] auto _ : state)
+    {
+        const auto res = ecrecover_execute(input, std::size(input), output.data(), output.size());
+        if (res.output_size != 32)
+            return state.SkipWithError("invalid signature");
+        benchmark::DoNotOptimize(output.data());
+    }
+
+    state.counters["gas_cost"] = static_cast<double>(gas_cost);
+    state.counters["gas_rate"] = benchmark::Counter(
+        static_cast<double>(gas_cost * static_cast<int64_t>(state.iterations())),
+        benchmark::Counter::kIsRate);
+}
+BENCHMARK(precompile_ecrecover)->Name("precompile/ecrecover");
+
+/// Benchmarks the batch signature recovery, compare the per item time with precompile/ecrecover.
+void ecrecover_batch(benchmark::State& state)
+{
+    const auto batch_size = static_cast<size_t>(state.range(0));
+    const std::vector inputs(batch_size, ecrecover_input);
+    std::vector<std::optional<evmc::address>> outputs(batch_size);
+
+    for ([[maybe_unused]] auto _ : state)
+    {
+        evmone::crypto::ecrecover(inputs, outputs);
+        benchmark::DoNotOptimize(outputs.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch_size));
+}
+BENCHMARK(ecrecover_batch)->Arg(1)->Arg(16)->Arg(256);
+
+/// The G1 generator and the point 12345·G1, the G2 generator and the 256-bit scalar.
+constexpr auto bn254_g1 =
+    "0000000000000000000000000000000000000000000000000000000000000001"
+    "0000000000000000000000000000000000000000000000000000000000000002";
+constexpr auto bn254_p =
+    "1936f7b07be20ac4b7faac53aba252c44112b369f437c12d75b8157882b390aa"
+    "055c38c27b1dc7fbbdfbb7b4795e92d0d838126c25b6771908f9a23c35c8921a";
+constexpr auto bn254_g2 =
+    "198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c2"
+    "1800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed"
+    "090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b"
+    "12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa";
+constexpr auto bn254_scalar = "e8c1c58a3ad2ab5c8e8b5d7a1b9f8e4c3a2b1d0e9f8a7b6c5d4e3f2a1b0c9d8e";
+
+/// Benchmarks the precompile execution for the fixed valid input.
+void precompile_fixed_input(
+    benchmark::State& state, AnalyzeFn analyze, ExecuteFn execute, const evmc::bytes& input)
+{
+    const auto [gas_cost, max_output_size] = analyze(input, EVMC_CANCUN);
+    std::vector<uint8_t> output(max_output_size);
+
+    for ([[maybe_unused]] auto _ : state)
+    {
+        const auto res = execute(input.data(), input.size(), output.data(), output.size());
+        if (res.status_code != EVMC_SUCCESS)
+            return state.SkipWithError("precompile execution failed");
+        benchmark::DoNotOptimize(output.data());
+    }
+
+    state.counters["gas_cost"] = static_cast<double>(gas_cost);
+    state.counters["gas_rate"] = benchmark::Counter(
+        static_cast<double>(gas_cost * static_cast<int64_t>(state.iterations())),
+        benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(precompile_fixed_input, ecadd, ecadd_analyze, ecadd_execute,
+    *evmc::from_hex(std::string{bn254_g1} + bn254_p))
+    ->Name("precompile/ecadd");
+BENCHMARK_CAPTURE(precompile_fixed_input, ecmul, ecmul_analyze, ecmul_execute,
+    *evmc::from_hex(std::string{bn254_p} + bn254_scalar))
+    ->Name("precompile/ecmul");
+
+/// Benchmarks the ecpairing precompile for the number of pairs given as the benchmark argument.
+/// The pairs share the final exponentiation, the time per pair should drop with the count.
+void precompile_ecpairing(benchmark::State& state)
+{
+    evmc::bytes input;
+    const auto pair = *evmc::from_hex(std::string{bn254_g1} + bn254_g2);
+    for (int64_t i = 0; i < state.range(0); ++i)
+        input += pair;
+    precompile_fixed_input(state, ecpairing_analyze, ecpairing_execute, input);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(precompile_ecpairing)->Name("precompile/ecpairing")->Arg(1)->Arg(2)->Arg(4);
+}  // namespace
@@ -0,0 +1,128 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <benchmark/benchmark.h>
+#include <test/state/block.hpp>
+#include <test/state/rlp.hpp>
+#include <test/utils/utils.hpp>
+#include <vector>
+
+namespace
+{
+using namespace evmone;
+using namespace evmone::state;
+using namespace evmc::literals;
+
+/// The already RLP-encoded item to be embedded in another encoding as is.
+struct RawRlp
+{
+    bytes encoded;
+};
+
+void rlp_write(rlp::Writer& w, const RawRlp& raw)
+{
+    w.write(raw.encoded.data(), raw.encoded.size());
+}
+
+/// Generates the transaction of the mix resembling a mainnet block:
+/// mostly EIP-1559 transactions, some legacy and EIP-2930 ones, varying call data sizes
+/// and occasional access lists.
+Transaction generate_transaction(size_t i)
+{
+    static constexpr size_t data_sizes[]{0, 68, 68, 132, 196, 324, 580, 1092};
+
+    const auto seed = keccak256({reinterpret_cast<const uint8_t*>(&i), sizeof(i)});
+    Transaction tx;
+    tx.kind = (i % 10 < 7) ? Transaction::Kind::eip1559 :
+              (i % 10 < 9) ? Transaction::Kind::legacy :
+                             Transaction::Kind::eip2930;
+    tx.chain_id = 1;
+    tx.nonce = i * 7;
+    tx.gas_limit = 21000 + static_cast<int64_t>(i * 1000);
+    tx.max_gas_price = intx::uint256{30'000'000'000} + i;
+    tx.max_priority_gas_price =
+        tx.kind == Transaction::Kind::eip1559 ? intx::uint256{1'500'000'000} : tx.max_gas_price;
+    std::copy_n(seed.bytes, sizeof(address), tx.to.emplace().bytes);
+    tx.value = intx::be::load<intx::uint256>(seed) >> 180;
+    for (auto n = data_sizes[i % std::size(data_sizes)]; tx.data.size() < n;)
+        tx.data += bytes{seed.bytes, std::min(sizeof(seed), n - tx.data.size())};
+    if (tx.kind != Transaction::Kind::legacy && i % 3 == 0)
+        tx.access_list = {{*tx.to, {seed, keccak256(seed)}}};
+    tx.r = intx::be::load<intx::uint256>(keccak256(seed));
+    tx.s = intx::be::load<intx::uint256>(seed) >> 1;
+    tx.v = tx.kind == Transaction::Kind::legacy ? 37 : (i % 2);
+    return tx;
+}
+
+/// Generates the encoded Shanghai block with the given number of transactions and 16 withdrawals.
+/// Real mainnet blocks are not available to the benchmark, the synthetic one mimics their shape.
+bytes generate_block(size_t num_txs)
+{
+    std::vector<RawRlp> transactions;
+    for (size_t i = 0; i < num_txs; ++i)
+    {
+        const auto tx = generate_transaction(i);
+        const auto encoded = rlp::encode(tx);
+        transactions.push_back({tx.kind == Transaction::Kind::legacy ?
+                                    encoded :
+                                    rlp::encode(bytes_view{encoded})});
+    }
+
+    std::vector<RawRlp> withdrawals;
+    for (uint64_t i = 0; i < 16; ++i)
+    {
+        withdrawals.push_back(
+            {rlp::encode_tuple(1'000'000 + i, 500'000 + i, 0x0a_address, 12'345'678 + i)});
+    }
+
+    const bytes logs_bloom(256, 0xab);
+    const bytes nonce(8, 0);
+    const auto header = rlp::encode_tuple(0x01_bytes32, 0x02_bytes32, 0xc0_address,
+        0x03_bytes32, 0x04_bytes32, 0x05_bytes32, bytes_view{logs_bloom}, uint64_t{0},
+        uint64_t{17'000'000}, uint64_t{30'000'000}, uint64_t{15'000'000},
+        uint64_t{1'700'000'000}, "6265617665726275696c642e6f7267"_hex, 0x06_bytes32,
+        bytes_view{nonce}, uint64_t{20'000'000'000}, 0x07_bytes32);
+
+    return rlp::encode_tuple(RawRlp{header}, transactions, std::vector<RawRlp>{}, withdrawals);
+}
+
+void rlp_decode_block(benchmark::State& state)
+{
+    const auto block = generate_block(static_cast<size_t>(state.range(0)));
+
+    for ([[maybe_unused]] auto _ : state)
+    {
+        auto res = decode_block(block);
+        if (std::holds_alternative<std::error_code>(res))
+            return state.SkipWithError(std::get<std::error_code>(res).message().c_str());
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(block.size()));
+    state.counters["block_size"] = static_cast<double>(block.size());
+}
+BENCHMARK(rlp_decode_block)->Arg(20)->Arg(150)->Arg(600);
+
+void rlp_decode_transaction(benchmark::State& state)
+{
+    std::vector<bytes> txs;
+    size_t total_size = 0;
+    for (size_t i = 0; i < 150; ++i)
+    {
+        txs.emplace_back(rlp::encode(generate_transaction(i)));
+        total_size += txs.back().size();
+    }
+
+    for ([[maybe_unused]] auto _ : state)
+    {
+        for (const auto& tx : txs)
+        {
+            auto res = decode_transaction(tx);
+            benchmark::DoNotOptimize(res);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(total_size));
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(txs.size()));
+}
+BENCHMARK(rlp_decode_transaction);
+}  // namespace
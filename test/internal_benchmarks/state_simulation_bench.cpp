@@ -0,0 +1,76 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <benchmark/benchmark.h>
+#include <evmone/evmone.h>
+#include <test/state/state.hpp>
+#include <test/utils/bytecode.hpp>
+
+namespace
+{
+using namespace evmone;
+using namespace evmone::state;
+using namespace evmc::literals;
+
+constexpr auto Token = 0x70c0_address;
+
+/// Creates the base state with the given number of token holders,
+/// each being an account with the balance and the token contract's storage slot.
+State generate_state(size_t num_holders)
+{
+    State state;
+    const auto transfer = sstore(calldataload(0), add(sload(calldataload(0)), 1)) +
+                          sstore(OP_CALLER, add(sload(OP_CALLER), 1));
+    auto& token = state.insert(Token, {.code = transfer});
+    for (uint64_t i = 0; i < num_holders; ++i)
+    {
+        const address holder{0x5e0000 + i};
+        state.insert(holder, {.balance = 1'000'000'000'000'000});
+        bytes32 key;
+        std::copy_n(holder.bytes, sizeof(holder), &key.bytes[sizeof(key) - sizeof(holder)]);
+        token.storage.insert({key, {0x01_bytes32, 0x01_bytes32}});
+    }
+    state.clear_accessed_accounts();
+    for (auto& [_, acc] : state.get_accounts())
+        acc.accessed = false;
+    return state;
+}
+
+Transaction make_transfer(uint64_t from, uint64_t to)
+{
+    Transaction tx;
+    tx.gas_limit = 100'000;
+    tx.max_gas_price = 1;
+    tx.sender = address{0x5e0000 + from};
+    tx.to = Token;
+    tx.data = bytes32{0x5e0000 + to};
+    return tx;
+}
+
+/// Evaluates candidate transactions against the shared base state:
+/// each one is executed in a temporary state which is then discarded.
+template <bool Fork>
+void simulate_transaction(benchmark::State& bench_state)
+{
+    const auto num_holders = static_cast<size_t>(bench_state.range(0));
+    evmc::VM vm{evmc_create_evmone()};
+    BlockInfo block;
+    block.gas_limit = 30'000'000;
+    const auto base = generate_state(num_holders);
+
+    uint64_t i = 0;
+    for ([[maybe_unused]] auto _ : bench_state)
+    {
+        const auto tx = make_transfer(i % num_holders, (i + 1) % num_holders);
+        ++i;
+        auto state = Fork ? base.fork() : base;
+        auto res = transition(state, block, tx, EVMC_SHANGHAI, vm);
+        if (std::holds_alternative<std::error_code>(res))
+            return bench_state.SkipWithError(std::get<std::error_code>(res).message().c_str());
+        benchmark::DoNotOptimize(res);
+    }
+}
+BENCHMARK_TEMPLATE(simulate_transaction, false)->Arg(100)->Arg(10'000);
+BENCHMARK_TEMPLATE(simulate_transaction, true)->Arg(100)->Arg(10'000);
+}  // namespace
@@ -0,0 +1,92 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+/// The tool converting the precompiles cache files (see evmone::state::PrecompilesCacheFile)
+/// from and to the JSON format: the array indexed by the precompile id of the objects
+/// mapping the hex Keccak hash of the input to the hex output or null for the failure.
+
+#include "../state/precompiles_cache_file.hpp"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+using evmone::state::PrecompileId;
+using evmone::state::PrecompilesCacheFile;
+
+void import_json(const std::filesystem::path& json_file, const std::filesystem::path& cache_file)
+{
+    std::ifstream in{json_file};
+    if (!in)
+        throw std::invalid_argument{"cannot open " + json_file.string()};
+
+    const auto j = nlohmann::json::parse(in);
+    std::vector<PrecompilesCacheFile::Entry> entries;
+    for (size_t id = 0; id < j.size(); ++id)
+    {
+        if (j[id].is_null())
+            continue;
+        if (id >= evmone::state::NumPrecompiles)
+            throw std::invalid_argument{"invalid precompile id " + std::to_string(id)};
+        for (const auto& [key, output] : j[id].items())
+        {
+            auto& e = entries.emplace_back();
+            e.id = static_cast<PrecompileId>(id);
+            e.key = evmc::from_hex<evmone::hash256>(key).value();
+            if (!output.is_null())
+                e.output = evmc::from_hex(output.get<std::string>()).value();
+        }
+    }
+    PrecompilesCacheFile::write(cache_file, std::move(entries));
+}
+
+void export_json(const std::filesystem::path& cache_file, const std::filesystem::path& json_file)
+{
+    auto j = nlohmann::json::array();
+    for (size_t id = 0; id < evmone::state::NumPrecompiles; ++id)
+        j[id] = nlohmann::json::object();
+
+    for (const auto& [id, key, output] : PrecompilesCacheFile{cache_file}.entries())
+    {
+        auto& v = j[stdx::to_underlying(id)][evmc::hex(key)];
+        if (output.has_value())
+            v = evmc::hex(*output);
+    }
+
+    std::ofstream out{json_file};
+    out << std::setw(2) << j << '\n';
+    if (!out)
+        throw std::invalid_argument{"cannot write " + json_file.string()};
+}
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    try
+    {
+        const std::string_view command = argc > 1 ? argv[1] : "";
+        if (command == "import" && argc == 4)
+            import_json(argv[2], argv[3]);
+        else if (command == "export" && argc == 4)
+            export_json(argv[2], argv[3]);
+        else if (command == "compact" && argc == 3)
+            PrecompilesCacheFile::compact(argv[2]);
+        else
+        {
+            std::cerr << "Usage:\n"
+                      << "  " << argv[0] << " import <json file> <cache file>\n"
+                      << "  " << argv[0] << " export <cache file> <json file>\n"
+                      << "  " << argv[0] << " compact <cache file>\n";
+            return 2;
+        }
+        return 0;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+}
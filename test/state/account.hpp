@@ -6,6 +6,7 @@
 #include <evmc/evmc.hpp>
 #include <intx/intx.hpp>
 #include <unordered_map>
+#include <vector>
 
 namespace evmone::state
 {
@@ -53,6 +54,14 @@ struct Account
 
     evmc_access_status access_status = EVMC_ACCESS_COLD;
 
+    /// The account has been accessed in the current transaction and is listed
+    /// in the State's accessed accounts. Not to be confused with the EIP-2929 access status.
+    bool accessed = false;
+
+    /// The keys of the storage slots warmed up or modified in the current transaction.
+    /// Only these slots need their statuses reset at the end of the transaction.
+    std::vector<bytes32> accessed_storage_keys = {};
+
     [[nodiscard]] bool is_empty() const noexcept
     {
         return code.empty() && nonce == 0 && balance == 0;
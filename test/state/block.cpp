@@ -0,0 +1,487 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "block.hpp"
+#include "rlp.hpp"
+#include <evmone_precompiles/secp256k1.hpp>
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace evmone::state
+{
+namespace
+{
+using rlp::ListView;
+
+/// Checks if the decoded value fits the int64_t type used for gas amounts.
+[[nodiscard]] ErrorCode to_int64(uint64_t x, int64_t& out) noexcept
+{
+    if (x > uint64_t{std::numeric_limits<int64_t>::max()})
+        return RLP_UINT_OVERFLOW;
+    out = static_cast<int64_t>(x);
+    return SUCCESS;
+}
+
+/// Validates the access list: [[address, [storage_key, ...]], ...].
+[[nodiscard]] ErrorCode validate_access_list(ListView list) noexcept
+{
+    while (!list.payload.empty())
+    {
+        address addr;
+        ListView keys;
+        if (const auto ec = rlp::decode_tuple(list.payload, addr, keys); ec != SUCCESS)
+            return ec;
+        while (!keys.payload.empty())
+        {
+            bytes32 key;
+            if (const auto ec = rlp::decode(keys.payload, key); ec != SUCCESS)
+                return ec;
+        }
+    }
+    return SUCCESS;
+}
+
+/// Validates the list of logs: [[address, [topic, ...], data], ...].
+[[nodiscard]] ErrorCode validate_logs(ListView list) noexcept
+{
+    while (!list.payload.empty())
+    {
+        address addr;
+        ListView topics;
+        bytes_view data;
+        if (const auto ec = rlp::decode_tuple(list.payload, addr, topics, data); ec != SUCCESS)
+            return ec;
+        while (!topics.payload.empty())
+        {
+            bytes32 topic;
+            if (const auto ec = rlp::decode(topics.payload, topic); ec != SUCCESS)
+                return ec;
+        }
+    }
+    return SUCCESS;
+}
+
+/// Decodes the legacy transaction: the RLP list at the front of the input.
+[[nodiscard]] ErrorCode decode_legacy_transaction(bytes_view& input, TransactionView& tx) noexcept
+{
+    const auto begin = input;
+    uint64_t gas_limit = 0;
+    // rlp [nonce, gas_price, gas_limit, to, value, data, v, r, s];
+    if (const auto ec = rlp::decode_tuple(input, tx.nonce, tx.max_gas_price, gas_limit, tx.to,
+            tx.value, tx.data, tx.v, tx.r, tx.s);
+        ec != SUCCESS)
+        return ec;
+
+    tx.kind = Transaction::Kind::legacy;
+    tx.max_priority_gas_price = tx.max_gas_price;
+    tx.access_list = {};
+    tx.chain_id = tx.v >= 35 ? (tx.v - 35) / 2 : 0;  // EIP-155.
+    tx.encoded = begin.substr(0, begin.size() - input.size());
+    return to_int64(gas_limit, tx.gas_limit);
+}
+
+/// Decodes the typed transaction (EIP-2718): the type byte followed by the RLP list.
+/// The whole input must be consumed.
+[[nodiscard]] ErrorCode decode_typed_transaction(bytes_view encoded, TransactionView& tx) noexcept
+{
+    if (encoded.empty())
+        return RLP_INPUT_TOO_SHORT;
+
+    auto input = encoded.substr(1);
+    uint64_t gas_limit = 0;
+    bool y_parity = false;
+    ErrorCode ec = SUCCESS;
+    switch (encoded[0])
+    {
+    case 0x01:
+        // tx_type +
+        // rlp [chain_id, nonce, gas_price, gas_limit, to, value, data, access_list, v, r, s];
+        tx.kind = Transaction::Kind::eip2930;
+        ec = rlp::decode_tuple(input, tx.chain_id, tx.nonce, tx.max_gas_price, gas_limit, tx.to,
+            tx.value, tx.data, tx.access_list, y_parity, tx.r, tx.s);
+        tx.max_priority_gas_price = tx.max_gas_price;
+        break;
+    case 0x02:
+        // tx_type +
+        // rlp [chain_id, nonce, max_priority_fee_per_gas, max_fee_per_gas, gas_limit, to, value,
+        // data, access_list, sig_parity, r, s];
+        tx.kind = Transaction::Kind::eip1559;
+        ec = rlp::decode_tuple(input, tx.chain_id, tx.nonce, tx.max_priority_gas_price,
+            tx.max_gas_price, gas_limit, tx.to, tx.value, tx.data, tx.access_list, y_parity, tx.r,
+            tx.s);
+        break;
+    default:
+        return TX_TYPE_NOT_SUPPORTED;
+    }
+    if (ec != SUCCESS)
+        return ec;
+    if (!input.empty())
+        return RLP_TRAILING_BYTES;
+    if (ec = validate_access_list(tx.access_list); ec != SUCCESS)
+        return ec;
+
+    tx.v = y_parity;
+    tx.encoded = encoded;
+    return to_int64(gas_limit, tx.gas_limit);
+}
+
+/// Decodes the transaction being the item of the block's transaction list:
+/// the RLP list for legacy transactions or the byte string wrapping a typed transaction.
+[[nodiscard]] ErrorCode decode_block_transaction(bytes_view& input, TransactionView& tx) noexcept
+{
+    if (!input.empty() && input[0] >= 0xc0)
+        return decode_legacy_transaction(input, tx);
+
+    bytes_view typed;
+    if (const auto ec = rlp::decode(input, typed); ec != SUCCESS)
+        return ec;
+    return decode_typed_transaction(typed, tx);
+}
+
+[[nodiscard]] ErrorCode decode_header_item(bytes_view& input, BlockHeaderView& header) noexcept
+{
+    const auto begin = input;
+    ListView fields;
+    if (const auto ec = rlp::decode(input, fields); ec != SUCCESS)
+        return ec;
+    header.encoded = begin.substr(0, begin.size() - input.size());
+
+    auto& in = fields.payload;
+    const auto decode_field = [&in](auto& field) noexcept {
+        if (in.empty())
+            return RLP_TOO_FEW_ELEMENTS;
+        return rlp::decode(in, field);
+    };
+
+    ErrorCode ec = SUCCESS;
+    if ((ec = decode_field(header.parent_hash)) != SUCCESS ||
+        (ec = decode_field(header.ommers_hash)) != SUCCESS ||
+        (ec = decode_field(header.coinbase)) != SUCCESS ||
+        (ec = decode_field(header.state_root)) != SUCCESS ||
+        (ec = decode_field(header.transactions_root)) != SUCCESS ||
+        (ec = decode_field(header.receipts_root)) != SUCCESS ||
+        (ec = decode_field(header.logs_bloom)) != SUCCESS ||
+        (ec = decode_field(header.difficulty)) != SUCCESS ||
+        (ec = decode_field(header.number)) != SUCCESS ||
+        (ec = decode_field(header.gas_limit)) != SUCCESS ||
+        (ec = decode_field(header.gas_used)) != SUCCESS ||
+        (ec = decode_field(header.timestamp)) != SUCCESS ||
+        (ec = decode_field(header.extra_data)) != SUCCESS ||
+        (ec = decode_field(header.prev_randao)) != SUCCESS ||
+        (ec = decode_field(header.nonce)) != SUCCESS)
+        return ec;
+
+    if (header.logs_bloom.size() != 256 || header.nonce.size() != 8)
+        return RLP_UNEXPECTED_SIZE;
+
+    // The optional fields added by later hard forks.
+    if (!in.empty())
+    {
+        if (ec = rlp::decode(in, header.base_fee.emplace()); ec != SUCCESS)
+            return ec;
+    }
+    if (!in.empty())
+    {
+        if (ec = rlp::decode(in, header.withdrawals_root.emplace()); ec != SUCCESS)
+            return ec;
+    }
+    if (!in.empty())
+        return RLP_TOO_MANY_ELEMENTS;
+    return SUCCESS;
+}
+
+/// Decodes the body items: transactions, ommers and optional withdrawals.
+/// The whole input (the payload of the body or block list) must be consumed.
+[[nodiscard]] ErrorCode decode_body_items(bytes_view input, BlockBodyView& body)
+{
+    ListView transactions;
+    if (input.empty())
+        return RLP_TOO_FEW_ELEMENTS;
+    if (const auto ec = rlp::decode(input, transactions); ec != SUCCESS)
+        return ec;
+    body.transactions.reserve(rlp::count_items(transactions));
+    while (!transactions.payload.empty())
+    {
+        if (const auto ec =
+                decode_block_transaction(transactions.payload, body.transactions.emplace_back());
+            ec != SUCCESS)
+            return ec;
+    }
+
+    if (input.empty())
+        return RLP_TOO_FEW_ELEMENTS;
+    if (const auto ec = rlp::decode(input, body.ommers); ec != SUCCESS)
+        return ec;
+    for (auto ommers = body.ommers.payload; !ommers.empty();)
+    {
+        BlockHeaderView ommer;
+        if (const auto ec = decode_header_item(ommers, ommer); ec != SUCCESS)
+            return ec;
+    }
+
+    if (!input.empty())  // Since Shanghai.
+    {
+        ListView withdrawals;
+        if (const auto ec = rlp::decode(input, withdrawals); ec != SUCCESS)
+            return ec;
+        auto& out = body.withdrawals.emplace();
+        while (!withdrawals.payload.empty())
+        {
+            // rlp [index, validator_index, address, amount];
+            uint64_t index = 0;
+            uint64_t validator_index = 0;
+            auto& w = out.emplace_back();
+            if (const auto ec = rlp::decode_tuple(
+                    withdrawals.payload, index, validator_index, w.recipient, w.amount_in_gwei);
+                ec != SUCCESS)
+                return ec;
+        }
+    }
+
+    if (!input.empty())
+        return RLP_TOO_MANY_ELEMENTS;
+    return SUCCESS;
+}
+
+/// Writes the transaction fields signed by the sender as the RLP list.
+void write_signing_payload(rlp::Writer& w, const TransactionView& tx)
+{
+    const auto to = tx.to.has_value() ? bytes_view{*tx.to} : bytes_view{};
+    const auto gas_limit = static_cast<uint64_t>(tx.gas_limit);
+    w.list([&](rlp::Writer& lw) {
+        if (tx.kind != Transaction::Kind::legacy)
+            rlp::write(lw, tx.chain_id);
+        rlp::write(lw, tx.nonce);
+        if (tx.kind == Transaction::Kind::eip1559)
+            rlp::write(lw, tx.max_priority_gas_price);
+        rlp::write(lw, tx.max_gas_price);
+        rlp::write(lw, gas_limit);
+        rlp::write(lw, to);
+        rlp::write(lw, tx.value);
+        rlp::write(lw, tx.data);
+        if (tx.kind != Transaction::Kind::legacy)
+        {
+            // The access list is kept encoded in the view.
+            const auto& payload = tx.access_list.payload;
+            rlp::internal::write_length<192, 247>(lw, payload.size());
+            lw.write(payload.data(), payload.size());
+        }
+        else if (tx.v >= 35)  // EIP-155.
+        {
+            rlp::write(lw, tx.chain_id);
+            rlp::write(lw, uint64_t{0});
+            rlp::write(lw, uint64_t{0});
+        }
+    });
+}
+
+/// Prepares the signature of the transaction for the recovery.
+/// The invalid signature is left zero, so it fails the recovery.
+crypto::EcrecoverInput to_ecrecover_input(const TransactionView& tx)
+{
+    // The EIP-2 upper bound of s: n/2 where n is the secp256k1 group order.
+    static constexpr auto max_s = intx::from_string<intx::uint256>(
+        "0x7fffffffffffffffffffffffffffffff5d576e7357a4501ddfe92f46681b20a0");
+
+    bool parity = false;
+    if (tx.kind != Transaction::Kind::legacy && tx.v <= 1)
+        parity = tx.v == 1;
+    else if (tx.kind == Transaction::Kind::legacy && (tx.v == 27 || tx.v == 28))
+        parity = tx.v == 28;
+    else if (tx.kind == Transaction::Kind::legacy && tx.v >= 35)
+        parity = (tx.v - 35) % 2 == 1;
+    else
+        return {};
+
+    if (tx.s > max_s)
+        return {};
+
+    return {signing_hash(tx), intx::be::store<bytes32>(tx.r), intx::be::store<bytes32>(tx.s),
+        parity};
+}
+}  // namespace
+
+std::variant<TransactionView, std::error_code> decode_transaction(bytes_view encoded)
+{
+    TransactionView tx;
+    if (!encoded.empty() && encoded[0] >= 0xc0)
+    {
+        if (const auto ec = decode_legacy_transaction(encoded, tx); ec != SUCCESS)
+            return make_error_code(ec);
+        if (!encoded.empty())
+            return make_error_code(RLP_TRAILING_BYTES);
+    }
+    else if (const auto ec = decode_typed_transaction(encoded, tx); ec != SUCCESS)
+        return make_error_code(ec);
+    return tx;
+}
+
+std::variant<TransactionReceiptView, std::error_code> decode_receipt(bytes_view encoded)
+{
+    TransactionReceiptView receipt;
+    if (encoded.empty())
+        return make_error_code(RLP_INPUT_TOO_SHORT);
+    if (encoded[0] < 0xc0)
+    {
+        if (encoded[0] != 0x01 && encoded[0] != 0x02)
+            return make_error_code(TX_TYPE_NOT_SUPPORTED);
+        receipt.kind = static_cast<Transaction::Kind>(encoded[0]);
+        encoded.remove_prefix(1);
+    }
+
+    // rlp [status_or_post_state, cumulative_gas_used, logs_bloom, logs];
+    bytes_view status;
+    if (const auto ec = rlp::decode_tuple(
+            encoded, status, receipt.cumulative_gas_used, receipt.logs_bloom, receipt.logs);
+        ec != SUCCESS)
+        return make_error_code(ec);
+    if (!encoded.empty())
+        return make_error_code(RLP_TRAILING_BYTES);
+    if (receipt.logs_bloom.size() != 256)
+        return make_error_code(RLP_UNEXPECTED_SIZE);
+
+    if (status.size() == sizeof(bytes32))  // Before Byzantium.
+        std::copy(status.begin(), status.end(), receipt.post_state.emplace().bytes);
+    else if (status.empty() || (status.size() == 1 && status[0] == 0x01))
+        receipt.success = !status.empty();
+    else
+        return make_error_code(RLP_UNEXPECTED_SIZE);
+
+    if (const auto ec = validate_logs(receipt.logs); ec != SUCCESS)
+        return make_error_code(ec);
+    return receipt;
+}
+
+std::variant<BlockHeaderView, std::error_code> decode_block_header(bytes_view encoded)
+{
+    BlockHeaderView header;
+    if (const auto ec = decode_header_item(encoded, header); ec != SUCCESS)
+        return make_error_code(ec);
+    if (!encoded.empty())
+        return make_error_code(RLP_TRAILING_BYTES);
+    return header;
+}
+
+std::variant<BlockBodyView, std::error_code> decode_block_body(bytes_view encoded)
+{
+    BlockBodyView body;
+    ListView items;
+    if (const auto ec = rlp::decode(encoded, items); ec != SUCCESS)
+        return make_error_code(ec);
+    if (!encoded.empty())
+        return make_error_code(RLP_TRAILING_BYTES);
+    if (const auto ec = decode_body_items(items.payload, body); ec != SUCCESS)
+        return make_error_code(ec);
+    return body;
+}
+
+std::variant<BlockView, std::error_code> decode_block(bytes_view encoded)
+{
+    BlockView block;
+    ListView items;
+    if (const auto ec = rlp::decode(encoded, items); ec != SUCCESS)
+        return make_error_code(ec);
+    if (!encoded.empty())
+        return make_error_code(RLP_TRAILING_BYTES);
+    if (items.payload.empty())
+        return make_error_code(RLP_TOO_FEW_ELEMENTS);
+    if (const auto ec = decode_header_item(items.payload, block.header); ec != SUCCESS)
+        return make_error_code(ec);
+    if (const auto ec = decode_body_items(items.payload, block.body); ec != SUCCESS)
+        return make_error_code(ec);
+    return block;
+}
+
+Transaction to_transaction(const TransactionView& view, const address& sender)
+{
+    Transaction tx;
+    tx.kind = view.kind;
+    tx.data = view.data;
+    tx.gas_limit = view.gas_limit;
+    tx.max_gas_price = view.max_gas_price;
+    tx.max_priority_gas_price = view.max_priority_gas_price;
+    tx.sender = sender;
+    tx.to = view.to;
+    tx.value = view.value;
+    tx.chain_id = view.chain_id;
+    tx.nonce = view.nonce;
+    tx.r = view.r;
+    tx.s = view.s;
+    tx.v = view.v;
+
+    for (auto list = view.access_list.payload; !list.empty();)
+    {
+        auto& [addr, keys] = tx.access_list.emplace_back();
+        ListView keys_list;
+        [[maybe_unused]] auto ec = rlp::decode_tuple(list, addr, keys_list);
+        assert(ec == SUCCESS);  // The access list has been validated by the decoder.
+        while (!keys_list.payload.empty())
+        {
+            ec = rlp::decode(keys_list.payload, keys.emplace_back());
+            assert(ec == SUCCESS);
+        }
+    }
+    return tx;
+}
+
+BlockInfo to_block_info(const BlockView& block)
+{
+    const auto& h = block.header;
+    BlockInfo info;
+    info.number = static_cast<int64_t>(h.number);
+    info.timestamp = static_cast<int64_t>(h.timestamp);
+    info.gas_limit = static_cast<int64_t>(h.gas_limit);
+    info.coinbase = h.coinbase;
+    info.prev_randao = h.prev_randao;
+    info.base_fee = h.base_fee.value_or(0);
+    if (block.body.withdrawals.has_value())
+        info.withdrawals = *block.body.withdrawals;
+    return info;
+}
+
+
+hash256 signing_hash(const TransactionView& tx)
+{
+    Keccak256Hasher hasher;
+    if (tx.kind != Transaction::Kind::legacy)
+    {
+        const auto type = static_cast<uint8_t>(tx.kind);
+        hasher.write(&type, 1);
+    }
+    rlp::write_to(hasher, [&](rlp::Writer& w) { write_signing_payload(w, tx); });
+    return hasher.finalize();
+}
+
+std::vector<std::optional<address>> recover_senders(
+    std::span<const TransactionView> transactions, unsigned num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::vector<std::optional<address>> senders(transactions.size());
+    const auto recover_chunk = [&](size_t begin, size_t size) {
+        std::vector<crypto::EcrecoverInput> inputs(size);
+        for (size_t i = 0; i < size; ++i)
+            inputs[i] = to_ecrecover_input(transactions[begin + i]);
+        crypto::ecrecover(inputs, std::span{senders}.subspan(begin, size));
+    };
+
+    // Smaller chunks do not pay off the thread start and lose on the shared inversions.
+    static constexpr size_t min_chunk_size = 16;
+    const auto num_chunks =
+        std::clamp(transactions.size() / min_chunk_size, size_t{1}, size_t{num_threads});
+    const auto chunk_size = (transactions.size() + num_chunks - 1) / num_chunks;
+    {
+        std::vector<std::jthread> workers;
+        for (auto begin = chunk_size; begin < transactions.size(); begin += chunk_size)
+        {
+            workers.emplace_back(
+                recover_chunk, begin, std::min(chunk_size, transactions.size() - begin));
+        }
+        recover_chunk(0, std::min(chunk_size, transactions.size()));
+    }
+    return senders;
+}
+}  // namespace evmone::state
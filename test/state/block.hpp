@@ -0,0 +1,137 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "rlp_decode.hpp"
+#include "state.hpp"
+#include <optional>
+#include <span>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+/// Decoding of the RLP-encoded transactions, receipts and blocks.
+///
+/// The decoded "views" reference the byte fields (e.g. transaction data) in the input buffer
+/// instead of copying them, therefore the input buffer must outlive the views.
+/// The decoding fully validates the RLP structure of the input.
+namespace evmone::state
+{
+/// The zero-copy view of a RLP-encoded transaction.
+struct TransactionView
+{
+    Transaction::Kind kind = Transaction::Kind::legacy;
+    uint64_t chain_id = 0;
+    uint64_t nonce = 0;
+    intx::uint256 max_priority_gas_price;
+    intx::uint256 max_gas_price;
+    int64_t gas_limit = 0;
+    std::optional<address> to;
+    intx::uint256 value;
+    bytes_view data;
+    rlp::ListView access_list;
+
+    /// The signature "v" value: the y-parity for typed transactions,
+    /// {27, 28} or the EIP-155 value {chain_id * 2 + 35, chain_id * 2 + 36} for legacy ones.
+    uint64_t v = 0;
+    intx::uint256 r;
+    intx::uint256 s;
+
+    /// The complete encoding of the transaction. Its Keccak hash is the transaction hash.
+    bytes_view encoded;
+};
+
+/// The zero-copy view of a RLP-encoded transaction receipt.
+struct TransactionReceiptView
+{
+    Transaction::Kind kind = Transaction::Kind::legacy;
+
+    /// The post-transaction state root, used instead of the status before Byzantium.
+    std::optional<bytes32> post_state;
+    bool success = false;
+    uint64_t cumulative_gas_used = 0;
+    bytes_view logs_bloom;
+    rlp::ListView logs;
+};
+
+/// The zero-copy view of a RLP-encoded block header.
+struct BlockHeaderView
+{
+    bytes32 parent_hash;
+    bytes32 ommers_hash;
+    address coinbase;
+    bytes32 state_root;
+    bytes32 transactions_root;
+    bytes32 receipts_root;
+    bytes_view logs_bloom;
+    intx::uint256 difficulty;
+    uint64_t number = 0;
+    uint64_t gas_limit = 0;
+    uint64_t gas_used = 0;
+    uint64_t timestamp = 0;
+    bytes_view extra_data;
+    bytes32 prev_randao;  ///< The "mix hash" before the Merge.
+    bytes_view nonce;
+    std::optional<uint64_t> base_fee;          ///< Since London.
+    std::optional<bytes32> withdrawals_root;  ///< Since Shanghai.
+
+    /// The complete encoding of the header. Its Keccak hash is the block hash.
+    bytes_view encoded;
+};
+
+/// The zero-copy view of a RLP-encoded block body.
+struct BlockBodyView
+{
+    std::vector<TransactionView> transactions;
+    rlp::ListView ommers;
+    std::optional<std::vector<Withdrawal>> withdrawals;  ///< Since Shanghai.
+};
+
+/// The zero-copy view of a RLP-encoded block.
+struct BlockView
+{
+    BlockHeaderView header;
+    BlockBodyView body;
+};
+
+/// Decodes the transaction in the "canonical" encoding: the RLP list for legacy transactions
+/// or the transaction type byte followed by the RLP list for typed transactions (EIP-2718).
+[[nodiscard]] std::variant<TransactionView, std::error_code> decode_transaction(
+    bytes_view encoded);
+
+/// Decodes the transaction receipt in the "canonical" encoding (see decode_transaction()).
+[[nodiscard]] std::variant<TransactionReceiptView, std::error_code> decode_receipt(
+    bytes_view encoded);
+
+[[nodiscard]] std::variant<BlockHeaderView, std::error_code> decode_block_header(
+    bytes_view encoded);
+
+/// Decodes the block body: RLP list [transactions, ommers, withdrawals (optional)].
+[[nodiscard]] std::variant<BlockBodyView, std::error_code> decode_block_body(bytes_view encoded);
+
+/// Decodes the block: RLP list [header, transactions, ommers, withdrawals (optional)].
+[[nodiscard]] std::variant<BlockView, std::error_code> decode_block(bytes_view encoded);
+
+/// Creates the Transaction out of the view, so it can be executed by transition().
+///
+/// The sender is not part of the encoding, it must be recovered from the signature
+/// by the caller.
+[[nodiscard]] Transaction to_transaction(const TransactionView& view, const address& sender);
+
+/// Creates the BlockInfo for transition() out of the decoded block.
+[[nodiscard]] BlockInfo to_block_info(const BlockView& block);
+
+/// Computes the hash signed by the transaction sender: the hash of the transaction encoding
+/// without the signature (and with the chain id for EIP-155 legacy transactions).
+[[nodiscard]] hash256 signing_hash(const TransactionView& tx);
+
+/// Recovers the senders of the transactions from their signatures.
+///
+/// The signatures are split into chunks recovered by multiple threads (all hardware threads
+/// if num_threads is 0); each chunk is recovered as a batch sharing the modular inversions.
+/// The sender is nullopt if the signature is invalid, including the EIP-2 "high s" signatures.
+[[nodiscard]] std::vector<std::optional<address>> recover_senders(
+    std::span<const TransactionView> transactions, unsigned num_threads = 0);
+
+}  // namespace evmone::state
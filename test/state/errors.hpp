@@ -21,6 +21,16 @@ enum ErrorCode : int
     GAS_LIMIT_REACHED,
     SENDER_NOT_EOA,
     INIT_CODE_SIZE_LIMIT_EXCEEDED,
+    RLP_INPUT_TOO_SHORT,
+    RLP_NON_CANONICAL_SIZE,
+    RLP_NON_CANONICAL_INTEGER,
+    RLP_UINT_OVERFLOW,
+    RLP_UNEXPECTED_SIZE,
+    RLP_EXPECTED_LIST,
+    RLP_EXPECTED_STRING,
+    RLP_TOO_FEW_ELEMENTS,
+    RLP_TOO_MANY_ELEMENTS,
+    RLP_TRAILING_BYTES,
     UNKNOWN_ERROR,
 };
 
@@ -55,6 +65,26 @@ inline const std::error_category& evmone_category() noexcept
                 return "sender not an eoa:";
             case INIT_CODE_SIZE_LIMIT_EXCEEDED:
                 return "max initcode size exceeded";
+            case RLP_INPUT_TOO_SHORT:
+                return "rlp: value size exceeds available input length";
+            case RLP_NON_CANONICAL_SIZE:
+                return "rlp: non-canonical size information";
+            case RLP_NON_CANONICAL_INTEGER:
+                return "rlp: non-canonical integer (leading zero bytes)";
+            case RLP_UINT_OVERFLOW:
+                return "rlp: uint overflow";
+            case RLP_UNEXPECTED_SIZE:
+                return "rlp: unexpected string size";
+            case RLP_EXPECTED_LIST:
+                return "rlp: expected List";
+            case RLP_EXPECTED_STRING:
+                return "rlp: expected String or Byte";
+            case RLP_TOO_FEW_ELEMENTS:
+                return "rlp: too few elements";
+            case RLP_TOO_MANY_ELEMENTS:
+                return "rlp: input list has too many elements";
+            case RLP_TRAILING_BYTES:
+                return "rlp: input contains more than one value";
             case UNKNOWN_ERROR:
                 return "Unknown error";
             default:
@@ -2,6 +2,7 @@
 // Copyright 2023 The evmone Authors.
 // SPDX-License-Identifier: Apache-2.0
 #include "hash_utils.hpp"
+#include <ethash/keccak.h>
 
 std::ostream& operator<<(std::ostream& out, const evmone::address& a)
 {
@@ -12,3 +13,67 @@ std::ostream& operator<<(std::ostream& out, const evmone::bytes32& b)
 {
     return out << "0x" << hex(b);
 }
+
+namespace evmone
+{
+namespace
+{
+/// XORs the byte into the Keccak state at the given byte position.
+inline void absorb_byte(uint64_t* state, size_t pos, uint8_t b) noexcept
+{
+    state[pos / 8] ^= uint64_t{b} << (8 * (pos % 8));
+}
+
+/// Loads 64-bit little-endian word.
+inline uint64_t load_le64(const uint8_t* data) noexcept
+{
+    uint64_t w = 0;
+    for (size_t i = 0; i < sizeof(w); ++i)
+        w |= uint64_t{data[i]} << (8 * i);
+    return w;
+}
+}  // namespace
+
+void Keccak256Hasher::write(const uint8_t* data, size_t size) noexcept
+{
+    while (size != 0)
+    {
+        // Absorb leading bytes until the position is aligned to full state words.
+        while (size != 0 && m_pos % 8 != 0)
+        {
+            absorb_byte(m_state, m_pos++, *data++);
+            --size;
+        }
+
+        // Absorb full words.
+        for (; size >= 8 && m_pos != rate; size -= 8, data += 8, m_pos += 8)
+            m_state[m_pos / 8] ^= load_le64(data);
+
+        // Absorb trailing bytes.
+        while (size != 0 && size < 8 && m_pos != rate)
+        {
+            absorb_byte(m_state, m_pos++, *data++);
+            --size;
+        }
+
+        if (m_pos == rate)
+        {
+            ethash_keccakf1600(m_state);
+            m_pos = 0;
+        }
+    }
+}
+
+hash256 Keccak256Hasher::finalize() noexcept
+{
+    // Keccak padding (the original Keccak, not SHA-3).
+    absorb_byte(m_state, m_pos, 0x01);
+    absorb_byte(m_state, rate - 1, 0x80);
+    ethash_keccakf1600(m_state);
+
+    hash256 h;
+    for (size_t i = 0; i < sizeof(h); ++i)
+        h.bytes[i] = static_cast<uint8_t>(m_state[i / 8] >> (8 * (i % 8)));
+    return h;
+}
+}  // namespace evmone
@@ -30,6 +30,27 @@ inline hash256 keccak256(bytes_view data) noexcept
     std::memcpy(h.bytes, eh.bytes, sizeof(h));  // TODO: Use std::bit_cast.
     return h;
 }
+
+/// Incremental Keccak-256 hasher.
+///
+/// The data can be provided in many write() calls. This makes it also usable as the output sink
+/// of the RLP encoder so the RLP encoding can be hashed without being materialized.
+class Keccak256Hasher
+{
+    /// The Keccak-256 rate in bytes.
+    static constexpr size_t rate = 136;
+
+    uint64_t m_state[25]{};
+
+    /// The number of bytes absorbed into the current block.
+    size_t m_pos = 0;
+
+public:
+    void write(const uint8_t* data, size_t size) noexcept;
+
+    /// Finishes the hashing and returns the hash. The hasher must not be used afterwards.
+    [[nodiscard]] hash256 finalize() noexcept;
+};
 }  // namespace evmone
 
 std::ostream& operator<<(std::ostream& out, const evmone::address& a);
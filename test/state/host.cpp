@@ -17,9 +17,9 @@ bool Host::account_exists(const address& addr) const noexcept
 
 bytes32 Host::get_storage(const address& addr, const bytes32& key) const noexcept
 {
-    const auto& acc = m_state.get(addr);
-    if (const auto it = acc.storage.find(key); it != acc.storage.end())
-        return it->second.current;
+    auto& acc = m_state.get(addr);
+    if (const auto slot = m_state.find_storage(addr, acc, key); slot != nullptr)
+        return slot->current;
     return {};
 }
 
@@ -29,10 +29,14 @@ evmc_storage_status Host::set_storage(
     // Follow EVMC documentation https://evmc.ethereum.org/storagestatus.html#autotoc_md3
     // and EIP-2200 specification https://eips.ethereum.org/EIPS/eip-2200.
 
-    auto& storage_slot = m_state.get(addr).storage[key];
-    const auto& [current, original, _] = storage_slot;
+    auto& acc = m_state.get(addr);
+    auto& storage_slot = m_state.get_storage(addr, acc, key);
+    const auto& [current, original, access_status] = storage_slot;
 
     const auto dirty = original != current;
+    if (!dirty && access_status == EVMC_ACCESS_COLD && value != current)
+        acc.accessed_storage_keys.push_back(key);  // First modification in the transaction.
+
     const auto restored = original == value;
     const auto current_is_zero = is_zero(current);
     const auto value_is_zero = is_zero(value);
@@ -185,6 +189,7 @@ evmc::Result Host::create(const evmc_message& msg) noexcept
 
     // Clear the new account storage, but keep the access status (from tx access list).
     // This is only needed for tests and cannot happen in real networks.
+    m_state.load_all_storage(msg.recipient, new_acc);
     for (auto& [_, v] : new_acc.storage) [[unlikely]]
         v = StorageValue{.access_status = v.access_status};
 
@@ -349,6 +354,10 @@ evmc_access_status Host::access_account(const address& addr) noexcept
 
 evmc_access_status Host::access_storage(const address& addr, const bytes32& key) noexcept
 {
-    return std::exchange(m_state.get(addr).storage[key].access_status, EVMC_ACCESS_WARM);
+    auto& acc = m_state.get(addr);
+    auto& [current, original, access_status] = m_state.get_storage(addr, acc, key);
+    if (access_status == EVMC_ACCESS_COLD && original == current)
+        acc.accessed_storage_keys.push_back(key);  // First access in the transaction.
+    return std::exchange(access_status, EVMC_ACCESS_WARM);
 }
 }  // namespace evmone::state
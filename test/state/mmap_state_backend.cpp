@@ -0,0 +1,667 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "mmap_state_backend.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_set>
+
+namespace evmone::state
+{
+namespace
+{
+enum Kind : uint8_t
+{
+    /// The account has been erased together with its storage.
+    /// Ordered first so the account recreated in the same commit follows it.
+    erased = 0,
+    account = 1,
+    storage = 2,
+};
+
+constexpr char Magic[8] = {'e', 'v', 'm', 's', 't', 'a', 't', 'e'};
+constexpr uint32_t FormatVersion = 1;
+
+/// The value identifying the byte order of the numbers in the file.
+constexpr uint32_t ByteOrderMark = 0x01020304;
+
+struct FileHeader
+{
+    char magic[8];
+    uint64_t end;  ///< The end of the last segment.
+    uint32_t byte_order;
+    uint32_t version;
+};
+
+constexpr uint64_t SegmentsOffset = 64;  ///< The first segment is after the file header.
+
+struct SegmentHeader
+{
+    uint64_t num_records;
+    uint64_t num_buckets;
+    uint64_t code_size;
+    uint64_t num_replaced;  ///< The number of the preceding live segments merged into this one.
+};
+
+/// The newest segments are merged while the newest one has at least 1/MergeRatio
+/// of the records of the previous one.
+constexpr uint64_t MergeRatio = 2;
+
+/// The number of the records written at once by the merge.
+constexpr size_t MergeChunkSize = 4096;
+
+[[noreturn]] void throw_io_error(const std::string& what)
+{
+    throw std::system_error{errno, std::generic_category(), what};
+}
+
+void write_all(int fd, const uint8_t* data, size_t size, uint64_t offset)
+{
+    while (size != 0)
+    {
+        const auto n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw_io_error("cannot write state file");
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+}
+
+void sync(int fd)
+{
+    if (::fsync(fd) != 0)
+        throw_io_error("cannot sync state file");
+}
+
+/// Writes the header of the file without segments.
+void write_file_header(int fd)
+{
+    FileHeader file_header{{}, SegmentsOffset, ByteOrderMark, FormatVersion};
+    std::memcpy(file_header.magic, Magic, sizeof(Magic));
+    uint8_t header[SegmentsOffset]{};
+    std::memcpy(header, &file_header, sizeof(file_header));
+    write_all(fd, header, sizeof(header), 0);
+    sync(fd);
+}
+
+/// Updates the end of the last segment in the file header, this commits the segments written.
+void write_end(int fd, uint64_t end)
+{
+    write_all(fd, reinterpret_cast<const uint8_t*>(&end), sizeof(end), offsetof(FileHeader, end));
+    sync(fd);
+}
+
+constexpr uint64_t align8(uint64_t x) noexcept
+{
+    return (x + 7) & ~uint64_t{7};
+}
+}  // namespace
+
+/// The fixed-size record of the account, the storage slot or the erased account.
+struct MmapStateBackend::Record
+{
+    uint8_t kind;
+    uint8_t padding[3];
+    address addr;
+    bytes32 key;    ///< The storage key.
+    bytes32 value;  ///< The storage value or the big-endian account balance.
+    uint64_t nonce;
+    uint64_t code_offset;  ///< The code position in the file.
+    uint64_t code_size;
+
+    /// The order of the records in the segment: by the address, the kind and the key.
+    friend bool operator<(const Record& a, const Record& b) noexcept
+    {
+        if (const auto c = std::memcmp(a.addr.bytes, b.addr.bytes, sizeof(a.addr)); c != 0)
+            return c < 0;
+        if (a.kind != b.kind)
+            return a.kind < b.kind;
+        return std::memcmp(a.key.bytes, b.key.bytes, sizeof(a.key)) < 0;
+    }
+};
+static_assert(sizeof(MmapStateBackend::Record) == 112);
+
+namespace
+{
+/// Computes the hash of the record key. It is persisted in the hash index,
+/// so it must not depend on the process (unlike std::hash).
+uint64_t hash_key(uint8_t kind, const address& addr, const bytes32& key) noexcept
+{
+    uint8_t buf[56]{};
+    buf[0] = kind;
+    std::memcpy(&buf[1], addr.bytes, sizeof(addr));
+    std::memcpy(&buf[1 + sizeof(addr)], key.bytes, sizeof(key));
+
+    uint64_t h = 0;
+    for (size_t i = 0; i < sizeof(buf); i += 8)
+    {
+        uint64_t w;
+        std::memcpy(&w, &buf[i], sizeof(w));
+        h = (h ^ w) * 0x9e3779b97f4a7c15;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+/// The range of the records of the address in the sorted records.
+std::span<const MmapStateBackend::Record> equal_range(
+    std::span<const MmapStateBackend::Record> records, const address& addr) noexcept
+{
+    const auto cmp = [](const address& a, const address& b) noexcept {
+        return std::memcmp(a.bytes, b.bytes, sizeof(a)) < 0;
+    };
+    const auto [first, last] = std::equal_range(records.begin(), records.end(), addr,
+        [cmp]<typename A, typename B>(const A& a, const B& b) noexcept {
+            if constexpr (std::is_same_v<A, address>)
+                return cmp(a, b.addr);
+            else
+                return cmp(a.addr, b);
+        });
+    return {first, last};
+}
+
+/// Merges the sorted records of the segments (in the commit order) and calls the visitor
+/// for the resulting records in the same order: the newest record of every key unless
+/// the account has been erased in a newer segment. If drop_deleted is set, the records
+/// of the erased accounts and the zero storage values are omitted as well.
+template <typename Visitor>
+void merge_records(std::span<const std::span<const MmapStateBackend::Record>> inputs,
+    bool drop_deleted, const Visitor& visitor)
+{
+    using Record = MmapStateBackend::Record;
+    std::vector<const Record*> positions;
+    for (const auto& input : inputs)
+        positions.push_back(input.data());
+
+    // The address erased and the index of the newest input erasing it.
+    // The records of the address in the older inputs are shadowed.
+    std::optional<address> erased_addr;
+    size_t erased_input = 0;
+
+    while (true)
+    {
+        // Find the smallest record, the newest one if equal.
+        const Record* next = nullptr;
+        size_t newest = 0;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            const auto p = positions[i];
+            if (p != inputs[i].data() + inputs[i].size() && (next == nullptr || !(*next < *p)))
+            {
+                next = p;
+                newest = i;
+            }
+        }
+        if (next == nullptr)
+            break;
+
+        const auto r = *next;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            if (positions[i] != inputs[i].data() + inputs[i].size() && !(r < *positions[i]))
+                ++positions[i];
+        }
+
+        if (r.kind == Kind::erased)
+        {
+            erased_addr = r.addr;
+            erased_input = newest;
+            if (!drop_deleted)
+                visitor(r);
+        }
+        else if (erased_addr == r.addr && newest < erased_input)
+            continue;
+        else if (!drop_deleted || r.kind != Kind::storage || !is_zero(r.value))
+            visitor(r);
+    }
+}
+}  // namespace
+
+MmapStateBackend::MmapStateBackend(std::filesystem::path path, bool auto_merge)
+  : m_path{std::move(path)}, m_auto_merge{auto_merge}
+{
+    open();
+}
+
+MmapStateBackend::~MmapStateBackend()
+{
+    close();
+}
+
+void MmapStateBackend::open()
+{
+    m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0)
+        throw_io_error("cannot open state file " + m_path.string());
+
+    struct stat st = {};
+    if (::fstat(m_fd, &st) != 0)
+        throw_io_error("cannot stat state file");
+
+    if (st.st_size == 0)
+        write_file_header(m_fd);
+    map();
+    if (m_size < SegmentsOffset)
+        throw std::invalid_argument{"invalid state file " + m_path.string()};
+
+    FileHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.end > m_size)
+        throw std::invalid_argument{"invalid state file " + m_path.string()};
+    if (header.byte_order != ByteOrderMark || header.version != FormatVersion)
+        throw std::invalid_argument{"unsupported state file format " + m_path.string()};
+    m_end = header.end;
+
+    for (auto offset = SegmentsOffset; offset < m_end;)
+    {
+        SegmentHeader h;
+        if (offset + sizeof(h) > m_end)
+            throw std::invalid_argument{"invalid state file segment"};
+        std::memcpy(&h, m_data + offset, sizeof(h));
+
+        Segment segment;
+        segment.begin = offset;
+        segment.records_offset = offset + sizeof(h);
+        segment.num_records = h.num_records;
+        segment.buckets_offset = segment.records_offset + h.num_records * sizeof(Record);
+        segment.num_buckets = h.num_buckets;
+        offset = align8(segment.buckets_offset + h.num_buckets * sizeof(uint32_t) + h.code_size);
+        segment.end = offset;
+        if (offset > m_end || std::popcount(h.num_buckets) != 1 ||
+            h.num_replaced > m_segments.size())
+            throw std::invalid_argument{"invalid state file segment"};
+        m_segments.resize(m_segments.size() - h.num_replaced);
+        m_segments.push_back(segment);
+    }
+}
+
+void MmapStateBackend::close() noexcept
+{
+    if (m_data != nullptr)
+        ::munmap(const_cast<uint8_t*>(m_data), m_size);
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_data = nullptr;
+    m_size = 0;
+    m_fd = -1;
+    m_segments.clear();
+    m_accounts.clear();
+}
+
+void MmapStateBackend::map()
+{
+    if (m_data != nullptr)
+        ::munmap(const_cast<uint8_t*>(m_data), m_size);
+
+    struct stat st = {};
+    if (::fstat(m_fd, &st) != 0)
+        throw_io_error("cannot stat state file");
+    m_size = static_cast<size_t>(st.st_size);
+    const auto p = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED)
+        throw_io_error("cannot map state file");
+    m_data = static_cast<const uint8_t*>(p);
+}
+
+std::span<const MmapStateBackend::Record> MmapStateBackend::records(
+    const Segment& segment) const noexcept
+{
+    return {reinterpret_cast<const Record*>(m_data + segment.records_offset),
+        segment.num_records};
+}
+
+const MmapStateBackend::Record* MmapStateBackend::find_in_segment(const Segment& segment,
+    uint8_t kind, const address& addr, const bytes32& key) const noexcept
+{
+    const auto buckets = reinterpret_cast<const uint32_t*>(m_data + segment.buckets_offset);
+    const auto segment_records = records(segment);
+    const auto mask = segment.num_buckets - 1;
+    for (auto i = hash_key(kind, addr, key) & mask;; i = (i + 1) & mask)
+    {
+        const auto entry = buckets[i];
+        if (entry == 0)
+            return nullptr;
+        const auto& r = segment_records[entry - 1];
+        if (r.kind == kind && r.addr == addr && r.key == key)
+            return &r;
+    }
+}
+
+const MmapStateBackend::Record* MmapStateBackend::find(
+    uint8_t kind, const address& addr, const bytes32& key) const noexcept
+{
+    for (auto it = m_segments.rbegin(); it != m_segments.rend(); ++it)
+    {
+        if (const auto r = find_in_segment(*it, kind, addr, key); r != nullptr)
+            return r;
+        if (find_in_segment(*it, Kind::erased, addr, {}) != nullptr)
+            return nullptr;
+    }
+    return nullptr;
+}
+
+const Account* MmapStateBackend::get_account(const address& addr) const
+{
+    const std::lock_guard lock{m_accounts_mutex};
+    if (const auto it = m_accounts.find(addr); it != m_accounts.end())
+        return &it->second;
+
+    const auto r = find(Kind::account, addr, {});
+    if (r == nullptr)
+        return nullptr;
+
+    Account acc;
+    acc.nonce = r->nonce;
+    acc.balance = intx::be::load<intx::uint256>(r->value);
+    acc.code = bytes{m_data + r->code_offset, r->code_size};
+    return &m_accounts.emplace(addr, std::move(acc)).first->second;
+}
+
+bytes32 MmapStateBackend::get_storage(const address& addr, const bytes32& key) const
+{
+    const auto r = find(Kind::storage, addr, key);
+    return r != nullptr ? r->value : bytes32{};
+}
+
+std::vector<bytes32> MmapStateBackend::get_storage_keys(const address& addr) const
+{
+    std::unordered_map<bytes32, bytes32> slots;
+    for (auto it = m_segments.rbegin(); it != m_segments.rend(); ++it)
+    {
+        bool erased = false;
+        for (const auto& r : equal_range(records(*it), addr))
+        {
+            if (r.kind == Kind::storage)
+                slots.try_emplace(r.key, r.value);
+            else if (r.kind == Kind::erased)
+                erased = true;
+        }
+        if (erased)
+            break;
+    }
+
+    std::vector<bytes32> keys;
+    for (const auto& [key, value] : slots)
+    {
+        if (!is_zero(value))
+            keys.push_back(key);
+    }
+    return keys;
+}
+
+void MmapStateBackend::for_each_address(const std::function<void(const address&)>& visitor) const
+{
+    // The addresses for which the newest record deciding the existence has been seen.
+    std::unordered_set<address> decided;
+    for (auto it = m_segments.rbegin(); it != m_segments.rend(); ++it)
+    {
+        for (const auto& r : records(*it))
+        {
+            // The erased record precedes the account record of the same address.
+            if (r.kind == Kind::storage || !decided.insert(r.addr).second)
+                continue;
+            if (r.kind == Kind::account)
+                visitor(r.addr);
+            else if (const auto next = &r + 1;
+                     next != records(*it).data() + it->num_records && next->addr == r.addr &&
+                     next->kind == Kind::account)
+                visitor(r.addr);  // Erased and recreated.
+        }
+    }
+}
+
+void MmapStateBackend::commit(
+    std::span<const address> erased, const std::unordered_map<address, Account>& accounts)
+{
+    std::vector<address> erased_sorted{erased.begin(), erased.end()};
+    std::sort(erased_sorted.begin(), erased_sorted.end());
+    erased_sorted.erase(
+        std::unique(erased_sorted.begin(), erased_sorted.end()), erased_sorted.end());
+
+    std::vector<Record> new_records;
+    bytes code;
+
+    for (const auto& addr : erased_sorted)
+    {
+        if (find(Kind::account, addr, {}) != nullptr)
+            new_records.push_back({Kind::erased, {}, addr, {}, {}, 0, 0, 0});
+    }
+
+    for (const auto& [addr, acc] : accounts)
+    {
+        const auto is_erased = std::binary_search(erased_sorted.begin(), erased_sorted.end(), addr);
+        const auto old = is_erased ? nullptr : find(Kind::account, addr, {});
+        const auto same_code =
+            old != nullptr &&
+            evmc::bytes_view{m_data + old->code_offset, old->code_size} == acc.code;
+        if (old == nullptr || old->nonce != acc.nonce ||
+            intx::be::load<intx::uint256>(old->value) != acc.balance || !same_code)
+        {
+            auto& r = new_records.emplace_back(Record{Kind::account, {}, addr, {},
+                intx::be::store<bytes32>(acc.balance), acc.nonce, 0, acc.code.size()});
+            if (same_code)
+                r.code_offset = old->code_offset;
+            else if (!acc.code.empty())
+            {
+                // The offset relative to the code of this segment is relocated when
+                // the segment layout is known. Mark the record via the padding.
+                r.padding[0] = 1;
+                r.code_offset = code.size();
+                code += acc.code;
+            }
+        }
+
+        for (const auto& [key, slot] : acc.storage)
+        {
+            const auto old_value = is_erased ? bytes32{} : get_storage(addr, key);
+            if (slot.current != old_value)
+                new_records.push_back({Kind::storage, {}, addr, key, slot.current, 0, 0, 0});
+        }
+    }
+
+    if (new_records.empty())
+        return;
+
+    std::sort(new_records.begin(), new_records.end());
+
+    const auto num_records = new_records.size();
+    const auto num_buckets = std::bit_ceil(2 * num_records);
+    const auto records_offset = m_end + sizeof(SegmentHeader);
+    const auto buckets_offset = records_offset + num_records * sizeof(Record);
+    const auto code_offset = buckets_offset + num_buckets * sizeof(uint32_t);
+    const auto segment_end = align8(code_offset + code.size());
+
+    std::vector<uint32_t> buckets(num_buckets);
+    for (size_t i = 0; i < num_records; ++i)
+    {
+        auto& r = new_records[i];
+        if (r.padding[0] != 0)
+        {
+            r.padding[0] = 0;
+            r.code_offset += code_offset;
+        }
+        auto b = hash_key(r.kind, r.addr, r.key) & (num_buckets - 1);
+        while (buckets[b] != 0)
+            b = (b + 1) & (num_buckets - 1);
+        buckets[b] = static_cast<uint32_t>(i + 1);
+    }
+
+    bytes segment(segment_end - m_end, 0);
+    const SegmentHeader header{num_records, num_buckets, code.size(), 0};
+    std::memcpy(&segment[0], &header, sizeof(header));
+    std::memcpy(&segment[records_offset - m_end], new_records.data(), num_records * sizeof(Record));
+    std::memcpy(&segment[buckets_offset - m_end], buckets.data(), num_buckets * sizeof(uint32_t));
+    std::copy(code.begin(), code.end(), &segment[code_offset - m_end]);
+
+    write_all(m_fd, segment.data(), segment.size(), m_end);
+    sync(m_fd);
+    write_end(m_fd, segment_end);
+
+    m_segments.push_back(
+        {m_end, segment_end, records_offset, num_records, buckets_offset, num_buckets});
+    m_end = segment_end;
+    map();
+    m_accounts.clear();
+
+    if (!m_auto_merge)
+        return;
+
+    while (m_segments.size() >= 2 && MergeRatio * m_segments.back().num_records >=
+                                         m_segments[m_segments.size() - 2].num_records)
+        merge(m_segments.size() - 2);
+
+    // Rewrite the file when the replaced segments take more space than the live ones.
+    if (const auto dead = dead_size(); dead > m_end - SegmentsOffset - dead)
+        compact();
+}
+
+uint64_t MmapStateBackend::dead_size() const noexcept
+{
+    uint64_t live_size = 0;
+    for (const auto& segment : m_segments)
+        live_size += segment.end - segment.begin;
+    return m_end - SegmentsOffset - live_size;
+}
+
+MmapStateBackend::Segment MmapStateBackend::write_merged_segment(
+    int fd, uint64_t offset, size_t first, bool new_file) const
+{
+    std::vector<std::span<const Record>> inputs;
+    for (auto i = first; i < m_segments.size(); ++i)
+        inputs.push_back(records(m_segments[i]));
+    const auto drop_deleted = first == 0;
+
+    // The first pass computes the layout of the segment.
+    uint64_t num_records = 0;
+    uint64_t code_size = 0;
+    merge_records(inputs, drop_deleted, [&](const Record& r) {
+        ++num_records;
+        if (new_file && r.kind == Kind::account)
+            code_size += r.code_size;
+    });
+    if (num_records >= std::numeric_limits<uint32_t>::max())
+        throw std::length_error{"too many records in state file segment"};
+
+    Segment segment;
+    segment.begin = offset;
+    segment.records_offset = offset + sizeof(SegmentHeader);
+    segment.num_records = num_records;
+    segment.buckets_offset = segment.records_offset + num_records * sizeof(Record);
+    segment.num_buckets = std::bit_ceil(2 * num_records);
+    const auto code_offset = segment.buckets_offset + segment.num_buckets * sizeof(uint32_t);
+    segment.end = align8(code_offset + code_size);
+
+    // The hash index is built in the shared mapping of the file, not in memory.
+    if (::ftruncate(fd, static_cast<off_t>(segment.end)) != 0)
+        throw_io_error("cannot resize state file");
+    const auto page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const auto map_offset = segment.buckets_offset & ~(page_size - 1);
+    const auto map_size = static_cast<size_t>(code_offset - map_offset);
+    const auto map =
+        ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(map_offset));
+    if (map == MAP_FAILED)
+        throw_io_error("cannot map state file");
+    const std::unique_ptr<void, std::function<void(void*)>> map_guard{
+        map, [map_size](void* p) { ::munmap(p, map_size); }};
+    const auto buckets = reinterpret_cast<uint32_t*>(
+        static_cast<uint8_t*>(map) + (segment.buckets_offset - map_offset));
+    std::fill_n(buckets, segment.num_buckets, uint32_t{0});
+
+    // The second pass writes the records, the code and the hash index.
+    std::vector<Record> chunk;
+    chunk.reserve(MergeChunkSize);
+    auto records_pos = segment.records_offset;
+    const auto flush = [&] {
+        const auto size = chunk.size() * sizeof(Record);
+        write_all(fd, reinterpret_cast<const uint8_t*>(chunk.data()), size, records_pos);
+        records_pos += size;
+        chunk.clear();
+    };
+    auto code_pos = code_offset;
+    uint32_t index = 0;
+    merge_records(inputs, drop_deleted, [&](const Record& merged) {
+        auto& r = chunk.emplace_back(merged);
+        if (new_file && r.kind == Kind::account)
+        {
+            write_all(fd, m_data + r.code_offset, r.code_size, code_pos);
+            r.code_offset = code_pos;
+            code_pos += r.code_size;
+        }
+
+        auto b = hash_key(r.kind, r.addr, r.key) & (segment.num_buckets - 1);
+        while (buckets[b] != 0)
+            b = (b + 1) & (segment.num_buckets - 1);
+        buckets[b] = ++index;
+
+        if (chunk.size() == MergeChunkSize)
+            flush();
+    });
+    flush();
+
+    const SegmentHeader header{num_records, segment.num_buckets, code_size,
+        new_file ? 0 : m_segments.size() - first};
+    write_all(fd, reinterpret_cast<const uint8_t*>(&header), sizeof(header), offset);
+    if (::msync(map, map_size, MS_SYNC) != 0)
+        throw_io_error("cannot sync state file");
+    sync(fd);
+    return segment;
+}
+
+void MmapStateBackend::merge(size_t first)
+{
+    const auto segment = write_merged_segment(m_fd, m_end, first, false);
+    write_end(m_fd, segment.end);
+
+    m_segments.resize(first);
+    m_segments.push_back(segment);
+    m_end = segment.end;
+    map();
+    m_accounts.clear();
+}
+
+void MmapStateBackend::compact()
+{
+    if (m_segments.empty() || (m_segments.size() == 1 && dead_size() == 0))
+        return;
+
+    auto tmp_path = m_path;
+    tmp_path += ".tmp";
+    const auto fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw_io_error("cannot create state file " + tmp_path.string());
+    try
+    {
+        write_file_header(fd);
+        write_end(fd, write_merged_segment(fd, SegmentsOffset, 0, true).end);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        std::filesystem::remove(tmp_path);
+        throw;
+    }
+    ::close(fd);
+
+    close();
+    std::filesystem::rename(tmp_path, m_path);
+    open();
+}
+}  // namespace evmone::state
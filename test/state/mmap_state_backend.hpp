@@ -0,0 +1,127 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "state_backend.hpp"
+#include <filesystem>
+#include <mutex>
+
+namespace evmone::state
+{
+/// The state backend persisted in a local file and accessed via the memory mapping.
+///
+/// The file is a sequence of immutable segments, one per commit, the newest one taking
+/// precedence. A segment contains the fixed-size records of the accounts, the storage slots
+/// and the erased accounts sorted by the address (the records of an account are adjacent),
+/// the open-addressing hash index of the records for point lookups and the code.
+/// The file header is updated only after the new segment is synced,
+/// so a partially written segment is ignored after a crash.
+///
+/// The lookups probe the segments from the newest one, so commit() keeps their number
+/// logarithmic in the state size: the newest segments are merged into a new segment
+/// replacing them while the newest one is at least half the size of the previous one.
+/// The merged records are streamed from the mapped segments, the state is not loaded
+/// into memory. The space of the replaced segments is reclaimed by rewriting the file
+/// when it exceeds the space of the live ones.
+///
+/// The file is mapped directly, so the numbers are stored in the native byte order.
+/// The header records the byte order and the files of the other one are rejected.
+/// The backend uses the POSIX file and memory mapping API and is not available on Windows.
+///
+/// The lookups are safe to be used from multiple threads, but not concurrently with commit().
+class MmapStateBackend : public StateBackend
+{
+public:
+    struct Record;
+
+private:
+    /// The location of the segment, its records and the hash index in the file.
+    struct Segment
+    {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        uint64_t records_offset = 0;
+        uint64_t num_records = 0;
+        uint64_t buckets_offset = 0;
+        uint64_t num_buckets = 0;
+    };
+
+    std::filesystem::path m_path;
+    bool m_auto_merge = true;
+    int m_fd = -1;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+    /// The end of the last committed segment.
+    uint64_t m_end = 0;
+
+    /// The live segments in the commit order.
+    std::vector<Segment> m_segments;
+
+    /// The decoded accounts returned by get_account(). Cleared by commit().
+    mutable std::unordered_map<address, Account> m_accounts;
+    mutable std::mutex m_accounts_mutex;
+
+public:
+    /// Opens the state file or creates the empty one if it does not exist.
+    ///
+    /// @param path        The state file path.
+    /// @param auto_merge  Merge the segments and reclaim the space automatically in commit().
+    /// @throws std::system_error     In case of the I/O error.
+    /// @throws std::invalid_argument If the file is not a valid state file.
+    explicit MmapStateBackend(std::filesystem::path path, bool auto_merge = true);
+
+    ~MmapStateBackend() override;
+
+    MmapStateBackend(const MmapStateBackend&) = delete;
+    MmapStateBackend& operator=(const MmapStateBackend&) = delete;
+
+    [[nodiscard]] const Account* get_account(const address& addr) const override;
+
+    [[nodiscard]] bytes32 get_storage(const address& addr, const bytes32& key) const override;
+
+    [[nodiscard]] std::vector<bytes32> get_storage_keys(const address& addr) const override;
+
+    void for_each_address(const std::function<void(const address&)>& visitor) const override;
+
+    void commit(std::span<const address> erased,
+        const std::unordered_map<address, Account>& accounts) override;
+
+    /// Rewrites the file with the live state only, as a single segment.
+    /// The records are streamed from the current file.
+    void compact();
+
+    /// Returns the number of the live segments in the file.
+    [[nodiscard]] size_t num_segments() const noexcept { return m_segments.size(); }
+
+    /// Returns the size of the file space taken by the replaced segments.
+    [[nodiscard]] uint64_t dead_size() const noexcept;
+
+private:
+    void open();
+    void close() noexcept;
+    void map();
+
+    /// Writes the segment of the merged records of the live segments starting with the first
+    /// one to the file at the offset. If the merge includes the oldest segment, the erased
+    /// accounts and the zero storage slots are omitted. The segment written to a new file
+    /// gets the copy of the code, otherwise it refers the code of the merged segments.
+    /// Returns the segment location.
+    Segment write_merged_segment(int fd, uint64_t offset, size_t first, bool new_file) const;
+
+    /// Replaces the live segments starting with the first one with their merge.
+    void merge(size_t first);
+
+    [[nodiscard]] std::span<const Record> records(const Segment& segment) const noexcept;
+
+    /// Finds the record in the segment using the hash index.
+    [[nodiscard]] const Record* find_in_segment(const Segment& segment, uint8_t kind,
+        const address& addr, const bytes32& key) const noexcept;
+
+    /// Finds the newest record of the kind, unless the account has been erased after it.
+    [[nodiscard]] const Record* find(
+        uint8_t kind, const address& addr, const bytes32& key) const noexcept;
+};
+}  // namespace evmone::state
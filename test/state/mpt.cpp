@@ -6,79 +6,189 @@
 #include "rlp.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
 
 namespace evmone::state
 {
+/// The bump allocator for MPT nodes and the (key, value) bytes they reference.
+///
+/// Allocated objects must be trivially destructible because they are never destroyed
+/// individually. The memory is released when the arena is destroyed.
+class MPTArena
+{
+    /// The size of the first block. Next blocks double the size up to max_block_size
+    /// so that small tries (e.g. the storage tries) do not waste memory.
+    static constexpr size_t min_block_size = 1024;
+    static constexpr size_t max_block_size = 64 * 1024;
+
+    /// The allocations bigger than this get a dedicated block.
+    static constexpr size_t max_small_size = min_block_size / 4;
+
+    std::vector<std::unique_ptr<uint8_t[]>> m_blocks;
+    uint8_t* m_pos = nullptr;
+    uint8_t* m_end = nullptr;
+    size_t m_next_block_size = min_block_size;
+    size_t m_capacity = 0;
+    size_t m_bytes_allocated = 0;
+
+    uint8_t* new_block(size_t size)
+    {
+        m_capacity += size;
+        // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+        return m_blocks.emplace_back(new uint8_t[size]).get();
+    }
+
+public:
+    /// Returns the total size of the memory blocks owned by the arena.
+    [[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+
+    /// Returns the total size of the allocations made, excluding the alignment padding.
+    [[nodiscard]] size_t bytes_allocated() const noexcept { return m_bytes_allocated; }
+
+    [[nodiscard]] void* allocate(size_t size, size_t alignment)
+    {
+        assert(alignment <= alignof(std::max_align_t));
+
+        m_bytes_allocated += size;
+        if (size > max_small_size)
+            return new_block(size);
+
+        const auto misalignment = reinterpret_cast<uintptr_t>(m_pos) % alignment;
+        auto* p = m_pos + (misalignment != 0 ? alignment - misalignment : 0);
+        if (m_pos == nullptr || p + size > m_end)
+        {
+            p = new_block(m_next_block_size);
+            m_end = p + m_next_block_size;
+            m_next_block_size = std::min(2 * m_next_block_size, max_block_size);
+        }
+        m_pos = p + size;
+        return p;
+    }
+
+    template <typename T>
+    [[nodiscard]] T* create(const T& obj)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return new (allocate(sizeof(T), alignof(T))) T{obj};
+    }
+
+    [[nodiscard]] bytes_view copy(bytes_view data)
+    {
+        auto* const p = static_cast<uint8_t*>(allocate(data.size(), 1));
+        std::copy(data.begin(), data.end(), p);
+        return {p, data.size()};
+    }
+};
+
 namespace
 {
-/// The collection of nibbles (4-bit values) representing a path in a MPT.
+/// The view of the collection of nibbles (4-bit values) representing a path in a MPT.
+///
+/// The nibbles are not unpacked: the view references the bytes of the original key
+/// and the [begin, end) range of nibble positions in them.
+/// Therefore, the path can be shortened during trie descent without copying.
 struct Path
 {
-    size_t length = 0;  // TODO: Can be converted to uint8_t.
-    uint8_t nibbles[64]{};
+    const uint8_t* packed = nullptr;
+    uint8_t begin = 0;
+    uint8_t end = 0;
 
     Path() = default;
 
-    explicit Path(bytes_view key) noexcept : length{2 * key.size()}
+    Path(const uint8_t* packed_nibbles, size_t begin_pos, size_t end_pos) noexcept
+      : packed{packed_nibbles}, begin{static_cast<uint8_t>(begin_pos)}, end{static_cast<uint8_t>(end_pos)}
     {
-        assert(length <= std::size(nibbles));
-        size_t i = 0;
-        for (const auto b : key)
-        {
-            // static_cast is only needed in GCC <= 8.
-            nibbles[i++] = static_cast<uint8_t>(b >> 4);
-            nibbles[i++] = static_cast<uint8_t>(b & 0x0f);
-        }
+        assert(begin_pos <= end_pos);
+    }
+
+    explicit Path(bytes_view key) noexcept : Path{key.data(), 0, 2 * key.size()}
+    {
+        assert(key.size() <= 32);  // The nibble positions must fit uint8_t.
+    }
+
+    [[nodiscard]] size_t length() const noexcept { return size_t{end} - size_t{begin}; }
+
+    [[nodiscard]] uint8_t operator[](size_t i) const noexcept
+    {
+        assert(i < length());
+        const auto pos = begin + i;
+        const auto b = packed[pos / 2];
+        return (pos % 2 == 0) ? static_cast<uint8_t>(b >> 4) : static_cast<uint8_t>(b & 0x0f);
     }
 
     [[nodiscard]] Path tail(size_t pos) const noexcept
     {
-        assert(pos > 0 && pos <= length);  // MPT never requests whole path copy (pos == 0).
-        Path p;
-        p.length = length - pos;
-        std::copy_n(&nibbles[pos], p.length, p.nibbles);
-        return p;
+        assert(pos > 0 && pos <= length());  // MPT never requests whole path copy (pos == 0).
+        return {packed, begin + pos, end};
     }
 
     [[nodiscard]] Path head(size_t size) const noexcept
     {
-        assert(size < length);  // MPT never requests whole path copy (size == length).
-        Path p;
-        p.length = size;
-        std::copy_n(nibbles, size, p.nibbles);
-        return p;
+        assert(size < length());  // MPT never requests whole path copy (size == length).
+        return {packed, begin, begin + size};
+    }
+
+    /// Finds the position at witch this path differs from the other path.
+    [[nodiscard]] size_t mismatch(const Path& other) const noexcept
+    {
+        assert(length() <= other.length());
+        size_t i = 0;
+        while (i < length() && (*this)[i] == other[i])
+            ++i;
+        return i;
     }
 
-    [[nodiscard]] bytes encode(bool extended) const
+    /// The maximum size of the encoded path.
+    static constexpr size_t max_encoded_size = 33;
+
+    /// Writes the hex-prefix encoding of the path to the output buffer
+    /// of at least max_encoded_size bytes. Returns the number of bytes written.
+    [[nodiscard]] size_t encode(uint8_t* out, bool extended) const noexcept
     {
-        bytes bs;
-        const auto is_even = length % 2 == 0;
+        const auto len = length();
+        size_t n = 0;
+        const auto is_even = len % 2 == 0;
         if (is_even)
-            bs.push_back(0x00);
+            out[n++] = 0x00;
         else
-            bs.push_back(0x10 | nibbles[0]);
-        for (size_t i = is_even ? 0 : 1; i < length; ++i)
+            out[n++] = 0x10 | (*this)[0];
+        for (size_t i = is_even ? 0 : 1; i < len; ++i)
         {
-            const auto h = nibbles[i++];
-            const auto l = nibbles[i];
-            assert(h <= 0x0f);
-            assert(l <= 0x0f);
-            bs.push_back(static_cast<uint8_t>((h << 4) | l));
+            const auto h = (*this)[i++];
+            const auto l = (*this)[i];
+            out[n++] = static_cast<uint8_t>((h << 4) | l);
         }
         if (!extended)
-            bs[0] |= 0x20;
-        return bs;
+            out[0] |= 0x20;
+        assert(n <= max_encoded_size);
+        return n;
     }
 };
+
+/// Computes the Keccak-256 hash of the RLP list of the values
+/// without materializing the RLP encoding.
+template <typename... Types>
+hash256 hash_rlp_tuple(const Types&... elements)
+{
+    Keccak256Hasher hasher;
+    rlp::encode_tuple_to(hasher, elements...);
+    return hasher.finalize();
+}
 }  // namespace
 
 /// The MPT Node.
 ///
 /// The implementation is based on StackTrie from go-ethereum.
+/// This is the header common for all node kinds. The node kind determines the actual
+/// node type (MPTLeaf, MPTExt or MPTBranch) so only branch nodes pay for the children table.
 // clang-tidy bug: https://github.com/llvm/llvm-project/issues/50006
 // NOLINTNEXTLINE(bugprone-reserved-identifier)
 class MPTNode
 {
+protected:
     enum class Kind : uint8_t
     {
         leaf,
@@ -88,135 +198,186 @@ class MPTNode
 
     static constexpr size_t num_children = 16;
 
-    Kind m_kind = Kind::leaf;
-    Path m_path;
-    bytes m_value;
-    std::unique_ptr<MPTNode> m_children[num_children];
+    // The path is stored unpacked to share the padding with the kind.
+    Kind m_kind;
+    uint8_t m_path_begin = 0;
+    uint8_t m_path_end = 0;
+    const uint8_t* m_path_packed = nullptr;
 
-    explicit MPTNode(Kind kind, const Path& path = {}, bytes&& value = {}) noexcept
-      : m_kind{kind}, m_path{path}, m_value{std::move(value)}
+    explicit MPTNode(Kind kind, const Path& path = {}) noexcept
+      : m_kind{kind}, m_path_begin{path.begin}, m_path_end{path.end}, m_path_packed{path.packed}
     {}
 
-    /// Creates an extended node.
-    static MPTNode ext(const Path& path, std::unique_ptr<MPTNode> child) noexcept
+    [[nodiscard]] Path path() const noexcept { return {m_path_packed, m_path_begin, m_path_end}; }
+
+    void set_path(const Path& path) noexcept
     {
-        assert(child->m_kind == Kind::branch);
-        MPTNode node{Kind::ext, path};
-        node.m_children[0] = std::move(child);
-        return node;
+        m_path_begin = path.begin;
+        m_path_end = path.end;
+        m_path_packed = path.packed;
     }
 
+    /// Creates an extended node.
+    static MPTNode* ext(MPTArena& arena, const Path& path, MPTNode* child);
+
     /// Optionally wraps the child node with newly created extended node in case
     /// the provided path is not empty.
-    static std::unique_ptr<MPTNode> optional_ext(
-        const Path& path, std::unique_ptr<MPTNode> child) noexcept
+    static MPTNode* optional_ext(MPTArena& arena, const Path& path, MPTNode* child)
     {
-        return (path.length != 0) ? std::make_unique<MPTNode>(ext(path, std::move(child))) :
-                                    std::move(child);
+        return (path.length() != 0) ? ext(arena, path, child) : child;
     }
 
     /// Creates a branch node out of two children and optionally extends it with an extended
     /// node in case the path is not empty.
-    static MPTNode ext_branch(const Path& path, size_t idx1, std::unique_ptr<MPTNode> child1,
-        size_t idx2, std::unique_ptr<MPTNode> child2) noexcept
-    {
-        assert(idx1 != idx2);
-        assert(idx1 < num_children);
-        assert(idx2 < num_children);
+    static MPTNode* ext_branch(MPTArena& arena, const Path& path, size_t idx1, MPTNode* child1,
+        size_t idx2, MPTNode* child2);
 
-        MPTNode br{Kind::branch};
-        br.m_children[idx1] = std::move(child1);
-        br.m_children[idx2] = std::move(child2);
+public:
+    /// Creates new leaf node.
+    static MPTNode* leaf(MPTArena& arena, const Path& path, bytes_view value);
 
-        return (path.length != 0) ? ext(path, std::make_unique<MPTNode>(std::move(br))) :
-                                    std::move(br);
-    }
+    /// Inserts the new (path, value) pair into the subtrie of the given node.
+    /// Returns the new root node of the subtrie.
+    [[nodiscard]] static MPTNode* insert(
+        MPTArena& arena, MPTNode* node, const Path& path, bytes_view value);
 
-    /// Finds the position at witch two paths differ.
-    static size_t mismatch(const Path& p1, const Path& p2) noexcept
-    {
-        assert(p1.length <= p2.length);
-        return static_cast<size_t>(
-            std::mismatch(p1.nibbles, p1.nibbles + p1.length, p2.nibbles).first - p1.nibbles);
-    }
+    [[nodiscard]] hash256 hash() const;
+};
 
+namespace
+{
+class MPTLeaf : public MPTNode
+{
 public:
-    MPTNode() = default;
+    const uint8_t* value_data;
+    size_t value_size;
 
-    /// Creates new leaf node.
-    static std::unique_ptr<MPTNode> leaf(const Path& path, bytes&& value) noexcept
-    {
-        return std::make_unique<MPTNode>(MPTNode{Kind::leaf, path, std::move(value)});
-    }
+    MPTLeaf(const Path& path, bytes_view value) noexcept
+      : MPTNode{Kind::leaf, path}, value_data{value.data()}, value_size{value.size()}
+    {}
 
-    void insert(const Path& path, bytes&& value);
+    using MPTNode::path;
+    using MPTNode::set_path;
 
-    [[nodiscard]] hash256 hash() const;
+    [[nodiscard]] bytes_view value() const noexcept { return {value_data, value_size}; }
+};
+
+class MPTExt : public MPTNode
+{
+public:
+    MPTNode* child;
+
+    MPTExt(const Path& path, MPTNode* c) noexcept : MPTNode{Kind::ext, path}, child{c} {}
+
+    using MPTNode::path;
+    using MPTNode::set_path;
 };
 
-void MPTNode::insert(const Path& path, bytes&& value)  // NOLINT(misc-no-recursion)
+class MPTBranch : public MPTNode
+{
+public:
+    MPTNode* children[num_children]{};
+
+    MPTBranch() noexcept : MPTNode{Kind::branch} {}
+};
+}  // namespace
+
+MPTNode* MPTNode::leaf(MPTArena& arena, const Path& path, bytes_view value)
+{
+    return arena.create(MPTLeaf{path, value});
+}
+
+MPTNode* MPTNode::ext(MPTArena& arena, const Path& path, MPTNode* child)
+{
+    assert(child->m_kind == Kind::branch);
+    return arena.create(MPTExt{path, child});
+}
+
+MPTNode* MPTNode::ext_branch(MPTArena& arena, const Path& path, size_t idx1, MPTNode* child1,
+    size_t idx2, MPTNode* child2)
+{
+    assert(idx1 != idx2);
+    assert(idx1 < num_children);
+    assert(idx2 < num_children);
+
+    auto* const br = arena.create(MPTBranch{});
+    br->children[idx1] = child1;
+    br->children[idx2] = child2;
+
+    return optional_ext(arena, path, br);
+}
+
+// NOLINTNEXTLINE(misc-no-recursion)
+MPTNode* MPTNode::insert(MPTArena& arena, MPTNode* node, const Path& path, bytes_view value)
 {
     // The insertion is all about branch nodes. In happy case we will find an empty slot
     // in an existing branch node. Otherwise, we need to create new branch node
     // (possibly with an adjusted extended node) and transform existing nodes around it.
+    // The existing nodes are reused with shortened paths where possible.
 
-    switch (m_kind)
+    switch (node->m_kind)
     {
     case Kind::branch:
     {
-        assert(m_path.length == 0);  // Branch has no path.
+        auto* const branch = static_cast<MPTBranch*>(node);
+        assert(branch->m_path_begin == branch->m_path_end);  // Branch has no path.
 
-        const auto idx = path.nibbles[0];
-        auto& child = m_children[idx];
-        if (!child)
-            child = leaf(path.tail(1), std::move(value));
-        else
-            child->insert(path.tail(1), std::move(value));
-        break;
+        auto& child = branch->children[path[0]];
+        child = (child == nullptr) ? leaf(arena, path.tail(1), value) :
+                                     insert(arena, child, path.tail(1), value);
+        return branch;
     }
 
     case Kind::ext:
     {
-        assert(m_path.length != 0);  // Ext must have non-empty path.
+        auto* const ext = static_cast<MPTExt*>(node);
+        const auto ext_path = ext->path();
+        assert(ext_path.length() != 0);  // Ext must have non-empty path.
 
-        const auto mismatch_pos = mismatch(m_path, path);
+        const auto mismatch_pos = ext_path.mismatch(path);
 
-        if (mismatch_pos == m_path.length)  // Paths match: go into the child.
-            return m_children[0]->insert(path.tail(mismatch_pos), std::move(value));
+        if (mismatch_pos == ext_path.length())  // Paths match: go into the child.
+        {
+            ext->child = insert(arena, ext->child, path.tail(mismatch_pos), value);
+            return ext;
+        }
 
-        const auto orig_idx = m_path.nibbles[mismatch_pos];
-        const auto new_idx = path.nibbles[mismatch_pos];
+        const auto orig_idx = ext_path[mismatch_pos];
+        const auto new_idx = path[mismatch_pos];
 
         // The original branch node must be pushed down, possible extended with
         // the adjusted extended node if the path split point is not directly at the branch node.
-        // Clang Analyzer bug: https://github.com/llvm/llvm-project/issues/47814
-        // NOLINTNEXTLINE(clang-analyzer-cplusplus.NewDeleteLeaks)
-        auto orig_branch = optional_ext(m_path.tail(mismatch_pos + 1), std::move(m_children[0]));
-        auto new_leaf = leaf(path.tail(mismatch_pos + 1), std::move(value));
-        *this = ext_branch(m_path.head(mismatch_pos), orig_idx, std::move(orig_branch), new_idx,
-            std::move(new_leaf));
-        break;
+        MPTNode* orig_branch = ext->child;
+        if (mismatch_pos + 1 != ext_path.length())
+        {
+            ext->set_path(ext_path.tail(mismatch_pos + 1));
+            orig_branch = ext;
+        }
+        auto* const new_leaf = leaf(arena, path.tail(mismatch_pos + 1), value);
+        return ext_branch(
+            arena, ext_path.head(mismatch_pos), orig_idx, orig_branch, new_idx, new_leaf);
     }
 
     case Kind::leaf:
     {
-        assert(m_path.length != 0);  // Leaf must have non-empty path.
-
-        const auto mismatch_pos = mismatch(m_path, path);
-        assert(mismatch_pos != m_path.length);  // Paths must be different.
-
-        const auto orig_idx = m_path.nibbles[mismatch_pos];
-        const auto new_idx = path.nibbles[mismatch_pos];
-        auto orig_leaf = leaf(m_path.tail(mismatch_pos + 1), std::move(m_value));
-        auto new_leaf = leaf(path.tail(mismatch_pos + 1), std::move(value));
-        *this = ext_branch(m_path.head(mismatch_pos), orig_idx, std::move(orig_leaf), new_idx,
-            std::move(new_leaf));
-        break;
+        auto* const orig_leaf = static_cast<MPTLeaf*>(node);
+        const auto leaf_path = orig_leaf->path();
+        assert(leaf_path.length() != 0);  // Leaf must have non-empty path.
+
+        const auto mismatch_pos = leaf_path.mismatch(path);
+        assert(mismatch_pos != leaf_path.length());  // Paths must be different.
+
+        const auto orig_idx = leaf_path[mismatch_pos];
+        const auto new_idx = path[mismatch_pos];
+        orig_leaf->set_path(leaf_path.tail(mismatch_pos + 1));
+        auto* const new_leaf = leaf(arena, path.tail(mismatch_pos + 1), value);
+        return ext_branch(
+            arena, leaf_path.head(mismatch_pos), orig_idx, orig_leaf, new_idx, new_leaf);
     }
-
-    default:
-        assert(false);
     }
+
+    assert(false);
+    return node;
 }
 
 hash256 MPTNode::hash() const  // NOLINT(misc-no-recursion)
@@ -225,11 +386,14 @@ hash256 MPTNode::hash() const  // NOLINT(misc-no-recursion)
     {
     case Kind::leaf:
     {
-        return keccak256(rlp::encode_tuple(m_path.encode(false), m_value));
+        const auto& leaf = static_cast<const MPTLeaf&>(*this);
+        uint8_t encoded_path[Path::max_encoded_size];
+        const auto encoded_path_size = leaf.path().encode(encoded_path, false);
+        return hash_rlp_tuple(bytes_view{encoded_path, encoded_path_size}, leaf.value());
     }
     case Kind::branch:
     {
-        assert(m_path.length == 0);
+        const auto& branch = static_cast<const MPTBranch&>(*this);
 
         // Temporary storage for children hashes.
         // The `bytes` type could be used instead, but this way dynamic allocation is avoided.
@@ -242,18 +406,23 @@ hash256 MPTNode::hash() const  // NOLINT(misc-no-recursion)
 
         for (size_t i = 0; i < num_children; ++i)
         {
-            if (m_children[i])
+            if (branch.children[i] != nullptr)
             {
-                children_hashes[i] = m_children[i]->hash();
+                children_hashes[i] = branch.children[i]->hash();
                 children_hash_bytes[i] = children_hashes[i];
             }
         }
 
-        return keccak256(rlp::encode(children_hash_bytes));
+        Keccak256Hasher hasher;
+        rlp::encode_to(hasher, children_hash_bytes);
+        return hasher.finalize();
     }
     case Kind::ext:
     {
-        return keccak256(rlp::encode_tuple(m_path.encode(true), m_children[0]->hash()));
+        const auto& ext = static_cast<const MPTExt&>(*this);
+        uint8_t encoded_path[Path::max_encoded_size];
+        const auto encoded_path_size = ext.path().encode(encoded_path, true);
+        return hash_rlp_tuple(bytes_view{encoded_path, encoded_path_size}, ext.child->hash());
     }
     }
 
@@ -265,12 +434,27 @@ hash256 MPTNode::hash() const  // NOLINT(misc-no-recursion)
 MPT::MPT() noexcept = default;
 MPT::~MPT() noexcept = default;
 
-void MPT::insert(bytes_view key, bytes&& value)
+void MPT::insert(bytes_view key, bytes_view value)
 {
-    if (m_root == nullptr)
-        m_root = MPTNode::leaf(Path{key}, std::move(value));
-    else
-        m_root->insert(Path{key}, std::move(value));
+    if (m_arena == nullptr)
+        m_arena = std::make_unique<MPTArena>();
+
+    // The key and the value are copied to the arena so that the nodes can reference them.
+    const Path path{m_arena->copy(key)};
+    const auto value_copy = m_arena->copy(value);
+
+    m_root = (m_root == nullptr) ? MPTNode::leaf(*m_arena, path, value_copy) :
+                                   MPTNode::insert(*m_arena, m_root, path, value_copy);
+}
+
+size_t MPT::arena_capacity() const noexcept
+{
+    return m_arena != nullptr ? m_arena->capacity() : 0;
+}
+
+size_t MPT::arena_bytes_allocated() const noexcept
+{
+    return m_arena != nullptr ? m_arena->bytes_allocated() : 0;
 }
 
 [[nodiscard]] hash256 MPT::hash() const
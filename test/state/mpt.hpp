@@ -13,15 +13,25 @@ constexpr auto emptyMPTHash =
 
 /// Insert-only Merkle Patricia Trie implementation for getting the root hash
 /// out of (key, value) pairs.
+///
+/// All nodes, keys and values are allocated from the arena owned by the trie
+/// and released all at once when the trie is destroyed.
 class MPT
 {
-    std::unique_ptr<class MPTNode> m_root;
+    std::unique_ptr<class MPTArena> m_arena;
+    class MPTNode* m_root = nullptr;
 
 public:
     MPT() noexcept;
     ~MPT() noexcept;
 
-    void insert(bytes_view key, bytes&& value);
+    void insert(bytes_view key, bytes_view value);
+
+    /// Returns the size of the memory owned by the trie (the nodes, the keys and the values).
+    [[nodiscard]] size_t arena_capacity() const noexcept;
+
+    /// Returns the size of the memory used by the trie out of arena_capacity().
+    [[nodiscard]] size_t arena_bytes_allocated() const noexcept;
 
     [[nodiscard]] hash256 hash() const;
 };
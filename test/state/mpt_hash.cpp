@@ -22,16 +22,27 @@ hash256 mpt_hash(const std::unordered_map<hash256, StorageValue>& storage)
     }
     return trie.hash();
 }
+
+void insert_account(MPT& trie, const address& addr, const Account& acc)
+{
+    trie.insert(keccak256(addr),
+        rlp::encode_tuple(acc.nonce, acc.balance, mpt_hash(acc.storage), keccak256(acc.code)));
+}
 }  // namespace
 
 hash256 mpt_hash(const std::unordered_map<address, Account>& accounts)
 {
     MPT trie;
     for (const auto& [addr, acc] : accounts)
-    {
-        trie.insert(keccak256(addr),
-            rlp::encode_tuple(acc.nonce, acc.balance, mpt_hash(acc.storage), keccak256(acc.code)));
-    }
+        insert_account(trie, addr, acc);
+    return trie.hash();
+}
+
+hash256 mpt_hash(const State& state)
+{
+    MPT trie;
+    state.for_each_account(
+        [&trie](const address& addr, const Account& acc) { insert_account(trie, addr, acc); });
     return trie.hash();
 }
 
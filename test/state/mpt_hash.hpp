@@ -10,12 +10,17 @@
 namespace evmone::state
 {
 struct Account;
+class State;
 struct Transaction;
 struct TransactionReceipt;
 
 /// Computes Merkle Patricia Trie root hash for the given collection of state accounts.
 hash256 mpt_hash(const std::unordered_map<address, Account>& accounts);
 
+/// Computes Merkle Patricia Trie root hash for the state accounts,
+/// including the ones in the base layers of an overlay state.
+hash256 mpt_hash(const State& state);
+
 /// Computes Merkle Patricia Trie root hash for the given collection of transactions.
 hash256 mpt_hash(std::span<const Transaction> transactions);
 
@@ -0,0 +1,196 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "parallel.hpp"
+#include "errors.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+
+namespace evmone::state
+{
+namespace
+{
+/// The result of the speculative execution of a transaction on top of the pre-block state.
+struct Speculation
+{
+    StateReads reads;
+    State overlay;
+    std::variant<TransactionReceipt, std::error_code> result = std::error_code{};
+    intx::uint256 coinbase_fee;
+};
+
+struct StorageSlotHash
+{
+    size_t operator()(const std::pair<address, bytes32>& slot) const noexcept
+    {
+        return std::hash<address>{}(slot.first) ^ std::hash<bytes32>{}(slot.second);
+    }
+};
+
+/// The accounts and storage slots modified by the committed transactions of the block.
+/// The account entry covers its existence, nonce, balance and code.
+/// Every storage read is preceded by the read of the account,
+/// so the erasure of an account also invalidates the reads of its storage.
+struct WriteSet
+{
+    std::unordered_set<address> accounts;
+    std::unordered_set<std::pair<address, bytes32>, StorageSlotHash> storage;
+
+    [[nodiscard]] bool conflicts_with(const StateReads& reads) const noexcept
+    {
+        for (const auto& addr : reads.accounts)
+        {
+            if (accounts.contains(addr))
+                return true;
+        }
+        for (const auto& slot : reads.storage)
+        {
+            if (storage.contains(slot))
+                return true;
+        }
+        return false;
+    }
+};
+
+/// Finds the account in the state being committed to. The state API is used instead of
+/// the accounts map so the accounts are loaded from the state backend if one is used.
+/// The account is not left marked as accessed: the committed state is between transactions.
+Account* find_committed(State& state, const address& addr)
+{
+    const auto acc = state.find(addr);
+    if (acc != nullptr)
+        acc->accessed = false;
+    return acc;
+}
+
+/// Applies the changes of the transaction executed in the overlay to the base state.
+/// The overlay must have been validated against the base state.
+void commit(State& state, const State& overlay, WriteSet& written)
+{
+    for (const auto& addr : overlay.get_erased_accounts())
+    {
+        if (state.peek(addr) != nullptr)
+        {
+            state.erase(addr);
+            written.accounts.insert(addr);
+        }
+    }
+
+    for (const auto& [addr, acc] : overlay.get_accounts())
+    {
+        auto dst = find_committed(state, addr);
+        if (dst == nullptr || dst->nonce != acc.nonce || dst->balance != acc.balance ||
+            dst->code != acc.code)
+        {
+            if (dst == nullptr)
+                dst = &state.insert(addr);
+            dst->nonce = acc.nonce;
+            dst->balance = acc.balance;
+            if (dst->code != acc.code)
+                dst->code = acc.code;
+            written.accounts.insert(addr);
+        }
+
+        for (const auto& [key, slot] : acc.storage)
+        {
+            const auto dst_slot = state.find_storage(addr, *dst, key);
+            if (dst_slot != nullptr ? dst_slot->current == slot.current : is_zero(slot.current))
+                continue;  // Unchanged or loaded but missing in the base state.
+            state.get_storage(addr, *dst, key) = {slot.current, slot.current};
+            written.storage.insert({addr, key});
+        }
+    }
+    state.clear_accessed_accounts();
+}
+
+/// Credits the priority fee of a speculatively executed transaction to the coinbase
+/// the same way as transition() does: the coinbase is touched and erased if it is empty.
+void credit_coinbase(State& state, const address& coinbase, const intx::uint256& fee,
+    evmc_revision rev, WriteSet& written)
+{
+    auto acc = find_committed(state, coinbase);
+    if (acc == nullptr)
+        acc = &state.insert(coinbase);
+    acc->balance += fee;
+    if (rev >= EVMC_SPURIOUS_DRAGON && acc->is_empty())
+        state.erase(coinbase);
+    state.clear_accessed_accounts();
+    written.accounts.insert(coinbase);
+}
+}  // namespace
+
+std::variant<BlockResult, std::error_code> apply_block_parallel(State& state,
+    const BlockInfo& block, std::span<const Transaction> transactions, evmc_revision rev,
+    evmc::VM& vm, unsigned num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // Speculative execution. The pre-block state is not modified until all threads finish.
+    std::vector<Speculation> speculations(transactions.size());
+    std::atomic<size_t> next_tx = 0;
+    const auto speculate = [&] {
+        while (true)
+        {
+            const auto i = next_tx.fetch_add(1, std::memory_order_relaxed);
+            if (i >= transactions.size())
+                break;
+            auto& s = speculations[i];
+            s.overlay = State{state, &s.reads};
+            s.result = transition_without_coinbase(
+                s.overlay, block, transactions[i], rev, vm, s.coinbase_fee);
+        }
+    };
+    {
+        std::vector<std::jthread> workers;
+        const auto num_workers = std::min<size_t>(num_threads, transactions.size());
+        for (size_t t = 1; t < num_workers; ++t)
+            workers.emplace_back(speculate);
+        speculate();
+    }
+
+    // Validation and commit in the block order.
+    // The coinbase is considered modified by every transaction because of the fee credit.
+    // Moreover, the coinbase has not been warmed up in the speculative execution.
+    WriteSet written;
+    written.accounts.insert(block.coinbase);
+
+    BlockResult result;
+    result.receipts.reserve(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i)
+    {
+        const auto& tx = transactions[i];
+        auto& s = speculations[i];
+
+        // The transaction must fit into the gas left in the block.
+        if (tx.gas_limit > block.gas_limit - result.gas_used)
+            return make_error_code(GAS_LIMIT_REACHED);
+
+        if (!written.conflicts_with(s.reads))
+        {
+            if (holds_alternative<std::error_code>(s.result))
+                return get<std::error_code>(s.result);
+            commit(state, s.overlay, written);
+            credit_coinbase(state, block.coinbase, s.coinbase_fee, rev, written);
+        }
+        else
+        {
+            // Execute again on top of the committed state. No other transaction is executed
+            // at this point so the overlay is valid.
+            s.overlay = State{state, nullptr};
+            s.result = transition(s.overlay, block, tx, rev, vm);
+            if (holds_alternative<std::error_code>(s.result))
+                return get<std::error_code>(s.result);
+            commit(state, s.overlay, written);
+        }
+
+        auto& receipt = result.receipts.emplace_back(std::move(get<TransactionReceipt>(s.result)));
+        result.gas_used += receipt.gas_used;
+        s.overlay = {};  // Release the memory early.
+    }
+    return result;
+}
+}  // namespace evmone::state
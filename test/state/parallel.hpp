@@ -0,0 +1,29 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "state.hpp"
+
+namespace evmone::state
+{
+/// Applies the block's transactions to the state like apply_block() but using multiple threads.
+///
+/// All transactions are first executed speculatively in parallel, each in its own overlay
+/// of the pre-block state recording the accounts and storage slots it has read.
+/// Then the results are committed in the block order. A transaction which has read anything
+/// modified by a preceding transaction of the block is executed again on top of the committed
+/// state. The coinbase priority fees are accumulated outside of the speculative execution
+/// so they do not make every pair of transactions conflict, but a transaction accessing
+/// the coinbase account is always executed again.
+///
+/// The receipts and the resulting state are identical to the ones of apply_block().
+/// The VM must be safe to be used from multiple threads (e.g. no tracer attached).
+///
+/// @param num_threads  The number of threads to use, including the calling one.
+///                     If 0, the number of hardware threads is used.
+[[nodiscard]] std::variant<BlockResult, std::error_code> apply_block_parallel(State& state,
+    const BlockInfo& block, std::span<const Transaction> transactions, evmc_revision rev,
+    evmc::VM& vm, unsigned num_threads = 0);
+}  // namespace evmone::state
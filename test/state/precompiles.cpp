@@ -4,11 +4,18 @@
 
 #include "precompiles.hpp"
 #include "precompiles_cache.hpp"
+#include "precompiles_internal.hpp"
+#include <evmone_precompiles/blake2b.hpp>
+#include <evmone_precompiles/bn254.hpp>
+#include <evmone_precompiles/modexp.hpp>
+#include <evmone_precompiles/ripemd160.hpp>
+#include <evmone_precompiles/secp256k1.hpp>
+#include <evmone_precompiles/sha256.hpp>
 #include <intx/intx.hpp>
 #include <bit>
 #include <cassert>
-#include <iostream>
 #include <limits>
+#include <memory>
 #include <unordered_map>
 
 namespace evmone::state
@@ -19,12 +26,6 @@ namespace
 {
 constexpr auto GasCostMax = std::numeric_limits<int64_t>::max();
 
-struct PrecompileAnalysis
-{
-    int64_t gas_cost;
-    size_t max_output_size;
-};
-
 inline constexpr int64_t num_words(size_t size_in_bytes) noexcept
 {
     return static_cast<int64_t>((size_in_bytes + 31) / 32);
@@ -35,6 +36,7 @@ inline constexpr int64_t cost_per_input_word(size_t input_size) noexcept
 {
     return BaseCost + WordCost * num_words(input_size);
 }
+}  // namespace
 
 PrecompileAnalysis ecrecover_analyze(bytes_view /*input*/, evmc_revision /*rev*/) noexcept
 {
@@ -96,7 +98,8 @@ PrecompileAnalysis expmod_analyze(bytes_view input, evmc_revision rev) noexcept
     if (base_len == 0 && mod_len == 0)
         return {min_gas, 0};
 
-    static constexpr auto len_limit = std::numeric_limits<size_t>::max();
+    // The limit also keeps the adjusted exponent length (8 * exp_len) from overflowing.
+    static constexpr auto len_limit = std::numeric_limits<size_t>::max() / 8;
     if (base_len > len_limit || exp_len > len_limit || mod_len > len_limit)
         return {GasCostMax, 0};
 
@@ -138,6 +141,114 @@ PrecompileAnalysis expmod_analyze(bytes_view input, evmc_revision rev) noexcept
         static_cast<size_t>(mod_len)};
 }
 
+ExecutionResult ecrecover_execute(const uint8_t* input, size_t input_size, uint8_t* output,
+    [[maybe_unused]] size_t output_size) noexcept
+{
+    assert(output_size >= 32);
+
+    // The input is [hash, v, r, s], each 32 bytes, missing bytes are zeros.
+    uint8_t input_buffer[128]{};
+    if (input_size != 0)
+        std::copy_n(input, std::min(input_size, std::size(input_buffer)), input_buffer);
+
+    const auto v = intx::be::unsafe::load<intx::uint256>(&input_buffer[32]);
+    if (v != 27 && v != 28)
+        return {EVMC_SUCCESS, 0};
+
+    const std::span<const uint8_t, 32> hash{&input_buffer[0], 32};
+    const std::span<const uint8_t, 32> r{&input_buffer[64], 32};
+    const std::span<const uint8_t, 32> s{&input_buffer[96], 32};
+    const auto addr = crypto::ecrecover(hash, r, s, v == 28);
+    if (!addr.has_value())
+        return {EVMC_SUCCESS, 0};
+
+    // The address left-padded to 32 bytes.
+    std::fill_n(output, 12, uint8_t{0});
+    std::copy_n(addr->bytes, sizeof(addr->bytes), &output[12]);
+    return {EVMC_SUCCESS, 32};
+}
+
+ExecutionResult expmod_execute(const uint8_t* input, size_t input_size, uint8_t* output,
+    [[maybe_unused]] size_t output_size) noexcept
+{
+    // The lengths fit size_t, otherwise expmod_analyze() makes the precompile unaffordable.
+    static constexpr size_t header_size = 3 * 32;
+    uint8_t header[header_size]{};
+    std::copy_n(input, std::min(input_size, header_size), header);
+    const auto base_len = static_cast<size_t>(intx::be::unsafe::load<intx::uint256>(&header[0]));
+    const auto exp_len = static_cast<size_t>(intx::be::unsafe::load<intx::uint256>(&header[32]));
+    const auto mod_len = static_cast<size_t>(intx::be::unsafe::load<intx::uint256>(&header[64]));
+    assert(output_size == mod_len);
+    if (mod_len == 0)
+        return {EVMC_SUCCESS, 0};
+
+    // The arguments missing in the input are zeros.
+    const auto args_size = base_len + exp_len + mod_len;
+    bytes_view args;
+    if (input_size > header_size)
+        args = {&input[header_size], input_size - header_size};
+    bytes padded_args;
+    if (args.size() < args_size)
+    {
+        padded_args = args;
+        padded_args.resize(args_size);
+        args = padded_args;
+    }
+
+    crypto::modexp({&args[0], base_len}, {&args[base_len], exp_len},
+        {&args[base_len + exp_len], mod_len}, output);
+    return {EVMC_SUCCESS, mod_len};
+}
+
+ExecutionResult ecadd_execute(const uint8_t* input, size_t input_size, uint8_t* output,
+    [[maybe_unused]] size_t output_size) noexcept
+{
+    assert(output_size >= 64);
+    uint8_t input_buffer[128]{};
+    if (input_size != 0)
+        std::copy_n(input, std::min(input_size, std::size(input_buffer)), input_buffer);
+
+    if (!crypto::bn254_add(output, &input_buffer[0], &input_buffer[64]))
+        return {EVMC_PRECOMPILE_FAILURE, 0};
+    return {EVMC_SUCCESS, 64};
+}
+
+ExecutionResult ecmul_execute(const uint8_t* input, size_t input_size, uint8_t* output,
+    [[maybe_unused]] size_t output_size) noexcept
+{
+    assert(output_size >= 64);
+    uint8_t input_buffer[96]{};
+    if (input_size != 0)
+        std::copy_n(input, std::min(input_size, std::size(input_buffer)), input_buffer);
+
+    if (!crypto::bn254_mul(output, &input_buffer[0], &input_buffer[64]))
+        return {EVMC_PRECOMPILE_FAILURE, 0};
+    return {EVMC_SUCCESS, 64};
+}
+
+ExecutionResult ecpairing_execute(const uint8_t* input, size_t input_size, uint8_t* output,
+    [[maybe_unused]] size_t output_size) noexcept
+{
+    assert(output_size >= 32);
+    const auto res = crypto::bn254_pairing_check({input, input_size});
+    if (!res.has_value())
+        return {EVMC_PRECOMPILE_FAILURE, 0};
+
+    std::fill_n(output, 31, uint8_t{0});
+    output[31] = *res ? 1 : 0;
+    return {EVMC_SUCCESS, 32};
+}
+
+ExecutionResult ripemd160_execute(const uint8_t* input, size_t input_size, uint8_t* output,
+    [[maybe_unused]] size_t output_size) noexcept
+{
+    assert(output_size >= 32);
+    // The hash left-padded to 32 bytes.
+    std::fill_n(output, 32 - crypto::RIPEMD160_HASH_SIZE, uint8_t{0});
+    crypto::ripemd160(&output[32 - crypto::RIPEMD160_HASH_SIZE], input, input_size);
+    return {EVMC_SUCCESS, 32};
+}
+
 ExecutionResult identity_execute(const uint8_t* input, size_t input_size, uint8_t* output,
     [[maybe_unused]] size_t output_size) noexcept
 {
@@ -146,31 +257,65 @@ ExecutionResult identity_execute(const uint8_t* input, size_t input_size, uint8_
     return {EVMC_SUCCESS, input_size};
 }
 
+ExecutionResult sha256_execute(const uint8_t* input, size_t input_size, uint8_t* output,
+    [[maybe_unused]] size_t output_size) noexcept
+{
+    assert(output_size >= crypto::SHA256_HASH_SIZE);
+    crypto::sha256(output, input, input_size);
+    return {EVMC_SUCCESS, crypto::SHA256_HASH_SIZE};
+}
+
+ExecutionResult blake2bf_execute(const uint8_t* input, size_t input_size, uint8_t* output,
+    [[maybe_unused]] size_t output_size) noexcept
+{
+    assert(output_size >= 64);
+    // The other input sizes are rejected by blake2bf_analyze().
+    static constexpr size_t input_size_required = 213;
+    if (input_size != input_size_required)
+        return {EVMC_PRECOMPILE_FAILURE, 0};
+
+    const auto last = input[212];
+    if (last > 1)
+        return {EVMC_PRECOMPILE_FAILURE, 0};
+
+    const auto rounds = intx::be::unsafe::load<uint32_t>(input);
+    uint64_t h[8];
+    uint64_t m[16];
+    uint64_t t[2];
+    for (size_t i = 0; i < std::size(h); ++i)
+        h[i] = intx::le::unsafe::load<uint64_t>(&input[4 + i * 8]);
+    for (size_t i = 0; i < std::size(m); ++i)
+        m[i] = intx::le::unsafe::load<uint64_t>(&input[68 + i * 8]);
+    for (size_t i = 0; i < std::size(t); ++i)
+        t[i] = intx::le::unsafe::load<uint64_t>(&input[196 + i * 8]);
+
+    crypto::blake2b_compress(rounds, h, m, t, last != 0);
+
+    for (size_t i = 0; i < std::size(h); ++i)
+        intx::le::unsafe::store(&output[i * 8], h[i]);
+    return {EVMC_SUCCESS, 64};
+}
+
+namespace
+{
 struct PrecompileTraits
 {
     decltype(identity_analyze)* analyze = nullptr;
     decltype(identity_execute)* execute = nullptr;
 };
 
-template <PrecompileId Id>
-ExecutionResult dummy_execute(const uint8_t*, size_t, uint8_t*, size_t) noexcept
-{
-    std::cerr << "Precompile " << static_cast<int>(Id) << " not implemented!\n";
-    return ExecutionResult{EVMC_INTERNAL_ERROR, 0};
-}
-
 inline constexpr auto traits = []() noexcept {
     std::array<PrecompileTraits, NumPrecompiles> tbl{{
         {},  // undefined for 0
-        {ecrecover_analyze, dummy_execute<PrecompileId::ecrecover>},
-        {sha256_analyze, dummy_execute<PrecompileId::sha256>},
-        {ripemd160_analyze, dummy_execute<PrecompileId::ripemd160>},
+        {ecrecover_analyze, ecrecover_execute},
+        {sha256_analyze, sha256_execute},
+        {ripemd160_analyze, ripemd160_execute},
         {identity_analyze, identity_execute},
-        {expmod_analyze, dummy_execute<PrecompileId::expmod>},
-        {ecadd_analyze, dummy_execute<PrecompileId::ecadd>},
-        {ecmul_analyze, dummy_execute<PrecompileId::ecmul>},
-        {ecpairing_analyze, dummy_execute<PrecompileId::ecpairing>},
-        {blake2bf_analyze, dummy_execute<PrecompileId::blake2bf>},
+        {expmod_analyze, expmod_execute},
+        {ecadd_analyze, ecadd_execute},
+        {ecmul_analyze, ecmul_execute},
+        {ecpairing_analyze, ecpairing_execute},
+        {blake2bf_analyze, blake2bf_execute},
     }};
     return tbl;
 }();
@@ -203,12 +348,20 @@ std::optional<evmc::Result> call_precompile(evmc_revision rev, const evmc_messag
     if (gas_left < 0)
         return evmc::Result{EVMC_OUT_OF_GAS};
 
-    static Cache cache;
+    // The cache is shared by the threads of the parallel block execution.
+    auto& cache = Cache::global();
     if (auto r = cache.find(static_cast<PrecompileId>(id), input, gas_left); r.has_value())
         return r;
 
-    uint8_t output_buf[256];  // Big enough to handle all "expmod" tests.
-    assert(std::size(output_buf) >= max_output_size);
+    // The output of "expmod" can be of any size, allocate the buffer for the big ones.
+    uint8_t small_output_buf[256];
+    std::unique_ptr<uint8_t[]> big_output_buf;
+    auto* output_buf = small_output_buf;
+    if (max_output_size > std::size(small_output_buf))
+    {
+        big_output_buf = std::make_unique<uint8_t[]>(max_output_size);
+        output_buf = big_output_buf.get();
+    }
 
     const auto [status_code, output_size] =
         execute(msg.input_data, msg.input_size, output_buf, max_output_size);
@@ -8,89 +8,231 @@
 #endif
 
 #include "precompiles_cache.hpp"
-#include <nlohmann/json.hpp>
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 namespace evmone::state
 {
-std::optional<evmc::Result> Cache::find(PrecompileId id, bytes_view input, int64_t gas_left) const
+namespace
 {
-    if (const auto& cache = m_cache.at(stdx::to_underlying(id)); !cache.empty())
+/// Computes the fast non-cryptographic hash of the input (the multiply-xorshift of 8-byte words).
+/// The cache entries are still matched by the full input, so collisions are harmless.
+uint64_t hash_input(PrecompileId id, bytes_view input) noexcept
+{
+    uint64_t h = (uint64_t{stdx::to_underlying(id)} << 56) ^ input.size();
+    size_t i = 0;
+    for (; i + 8 <= input.size(); i += 8)
+    {
+        uint64_t w;
+        std::memcpy(&w, &input[i], sizeof(w));
+        h = (h ^ w) * 0x9e3779b97f4a7c15;
+        h ^= h >> 29;
+    }
+    if (i != input.size())
+    {
+        uint64_t w = 0;
+        std::memcpy(&w, &input[i], input.size() - i);
+        h = (h ^ w) * 0x9e3779b97f4a7c15;
+        h ^= h >> 29;
+    }
+    return (h ^ (h >> 32)) * 0xd6e8feb86659fd93;
+}
+
+/// Returns true for the precompiles worth caching: the cost of these greatly exceeds
+/// hashing and comparing the input. The others are cheaper to execute again.
+bool is_cached(PrecompileId id) noexcept
+{
+    return id == PrecompileId::expmod || id == PrecompileId::ecpairing;
+}
+
+/// Estimates the memory used by the entry, including the LRU list and the index nodes.
+size_t entry_memory_usage(bytes_view input, const std::optional<bytes>& output) noexcept
+{
+    static constexpr size_t overhead = 128;
+    return overhead + input.size() + (output.has_value() ? output->size() : 0);
+}
+
+evmc::Result make_result(const std::optional<bytes_view>& output, int64_t gas_left)
+{
+    if (!output.has_value())
+        return evmc::Result{EVMC_PRECOMPILE_FAILURE};
+    return evmc::Result{EVMC_SUCCESS, gas_left, 0, output->data(), output->size()};
+}
+
+/// Selects the shard by the hash bits not used by the shard's index buckets.
+template <typename Shards>
+auto& select_shard(Shards& shards, uint64_t h) noexcept
+{
+    return shards[(h >> 32) % std::size(shards)];
+}
+
+size_t memory_budget_from_env() noexcept
+{
+    const auto size_str = std::getenv("EVMONE_PRECOMPILES_CACHE_SIZE");
+    if (size_str == nullptr)
+        return Cache::DefaultMemoryBudget;
+    return static_cast<size_t>(std::strtoull(size_str, nullptr, 10)) << 20;
+}
+
+/// Opens the dump file or returns null and reports the error to stderr.
+std::unique_ptr<PrecompilesCacheFile> open_dump(const std::filesystem::path& dump_file) noexcept
+{
+    if (dump_file.empty())
+        return nullptr;
+
+    try
+    {
+        return std::make_unique<PrecompilesCacheFile>(dump_file);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "evmone: Opening precompiles dump '" << dump_file.string()
+                  << "' has failed: " << ex.what() << "\n";
+        return nullptr;
+    }
+}
+}  // namespace
+
+Cache& Cache::global() noexcept
+{
+    const auto path_from_env = [](const char* name) {
+        const auto value = std::getenv(name);
+        return value != nullptr ? std::filesystem::path{value} : std::filesystem::path{};
+    };
+    static Cache cache{memory_budget_from_env(), path_from_env("EVMONE_PRECOMPILES_STUB"),
+        path_from_env("EVMONE_PRECOMPILES_DUMP")};
+    return cache;
+}
+
+std::optional<evmc::Result> Cache::find(PrecompileId id, bytes_view input, int64_t gas_left)
+{
+    if (m_stub != nullptr)
     {
-        const auto input_hash = keccak256(input);
-        if (const auto it = cache.find(input_hash); it != cache.end())
+        if (const auto output = m_stub->find(id, keccak256(input)); output.has_value())
+            return make_result(*output, gas_left);
+    }
+
+    if (!is_cached(id))
+        return {};
+
+    const auto h = hash_input(id, input);
+    auto& shard = select_shard(m_shards, h);
+    const std::lock_guard lock{shard.mutex};
+    const auto [first, last] = shard.index.equal_range(h);
+    for (auto it = first; it != last; ++it)
+    {
+        const auto e = it->second;
+        if (e->id == id && e->input == input)
         {
-            if (const auto& o = it->second; !o.has_value())
-                return evmc::Result{EVMC_PRECOMPILE_FAILURE};
-            else
-                return evmc::Result{EVMC_SUCCESS, gas_left, 0, o->data(), o->size()};
+            ++shard.hits;
+            shard.lru.splice(shard.lru.begin(), shard.lru, e);
+            return make_result(e->output, gas_left);
         }
     }
+    ++shard.misses;
     return {};
 }
 
 void Cache::insert(PrecompileId id, bytes_view input, const evmc::Result& result)
 {
-    if (id == PrecompileId::identity)  // Do not cache "identity".
-        return;
-    const auto input_hash = keccak256(input);
-    std::optional<bytes> cached_output;
+    std::optional<bytes_view> output_view;
     if (result.status_code == EVMC_SUCCESS)
-        cached_output = bytes{result.output_data, result.output_size};
-    m_cache.at(stdx::to_underlying(id)).insert({input_hash, std::move(cached_output)});
+        output_view = bytes_view{result.output_data, result.output_size};
+
+    if (m_dump != nullptr && id != PrecompileId::identity)
+        dump(id, input, output_view);
+
+    if (!is_cached(id))
+        return;
+
+    std::optional<bytes> output;
+    if (output_view.has_value())
+        output = bytes{*output_view};
+    const auto memory_usage = entry_memory_usage(input, output);
+    if (memory_usage > m_shard_budget)
+        return;
+
+    const auto h = hash_input(id, input);
+    auto& shard = select_shard(m_shards, h);
+    const std::lock_guard lock{shard.mutex};
+
+    // Other thread may have inserted the same entry after the missed lookup.
+    const auto [first, last] = shard.index.equal_range(h);
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->second->id == id && it->second->input == input)
+            return;
+    }
+
+    shard.lru.push_front({h, id, bytes{input}, std::move(output)});
+    shard.index.emplace(h, shard.lru.begin());
+    shard.memory_usage += memory_usage;
+
+    while (shard.memory_usage > m_shard_budget)
+    {
+        const auto& e = shard.lru.back();
+        auto it = shard.index.equal_range(e.hash).first;
+        while (it->second != std::prev(shard.lru.end()))
+            ++it;
+        shard.index.erase(it);
+        shard.memory_usage -= entry_memory_usage(e.input, e.output);
+        shard.lru.pop_back();
+        ++shard.evictions;
+    }
 }
 
-Cache::Cache() noexcept
+void Cache::dump(PrecompileId id, bytes_view input, const std::optional<bytes_view>& output)
 {
-    const auto stub_file = std::getenv("EVMONE_PRECOMPILES_STUB");
-    if (stub_file == nullptr)
+    const auto key = keccak256(input);
+    const std::lock_guard lock{m_dump_mutex};
+    if (m_dump_failed || !m_dumped.at(stdx::to_underlying(id)).insert(key).second ||
+        m_dump->find(id, key).has_value())
         return;
 
     try
     {
-        const auto j = nlohmann::json::parse(std::ifstream{stub_file});
-        for (size_t id = 0; id < j.size(); ++id)
-        {
-            auto& cache = m_cache.at(id);
-            for (const auto& [h_str, j_input] : j[id].items())
-            {
-                auto& e = cache[evmc::from_hex<hash256>(h_str).value()];
-                if (!j_input.is_null())
-                    e = evmc::from_hex(j_input.get<std::string>());
-            }
-        }
+        m_dump->append(id, key, output);
     }
-    catch (...)
+    catch (const std::exception& ex)
     {
-        std::cerr << "evmone: Loading precompiles stub from '" << stub_file << "' has failed!\n";
+        std::cerr << "evmone: Dumping precompiles has failed: " << ex.what() << "\n";
+        m_dump_failed = true;
     }
 }
 
-Cache::~Cache() noexcept
+CacheStats Cache::stats() const noexcept
 {
-    const auto dump_file = std::getenv("EVMONE_PRECOMPILES_DUMP");
-    if (dump_file == nullptr)
-        return;
+    CacheStats s;
+    for (const auto& shard : m_shards)
+    {
+        const std::lock_guard lock{shard.mutex};
+        s.hits += shard.hits;
+        s.misses += shard.misses;
+        s.evictions += shard.evictions;
+        s.num_entries += shard.lru.size();
+        s.memory_usage += shard.memory_usage;
+    }
+    return s;
+}
 
-    try
+Cache::Cache(size_t memory_budget, const std::filesystem::path& stub_file,
+    const std::filesystem::path& dump_file) noexcept
+  : m_shard_budget{memory_budget / NumShards}, m_dump{open_dump(dump_file)}
+{
+    if (!stub_file.empty())
     {
-        nlohmann::json j;
-        for (size_t id = 0; id < std::size(m_cache); ++id)
+        try
         {
-            auto& q = j[id];
-            for (const auto& [h, o] : m_cache[id])
-            {
-                auto& v = q[evmc::hex(h)];
-                if (o)
-                    v = evmc::hex(*o);
-            }
+            m_stub = std::make_unique<PrecompilesCacheFile>(stub_file);
+        }
+        catch (const std::exception& ex)
+        {
+            std::cerr << "evmone: Loading precompiles stub from '" << stub_file.string()
+                      << "' has failed: " << ex.what() << "\n";
         }
-        std::ofstream{dump_file} << std::setw(2) << j << '\n';
-    }
-    catch (...)
-    {
-        std::cerr << "evmone: Dumping precompiles to '" << dump_file << "' has failed!\n";
     }
 }
+
+Cache::~Cache() noexcept = default;
 }  // namespace evmone::state
@@ -1,28 +1,105 @@
 // evmone: Fast Ethereum Virtual Machine implementation
 // Copyright 2022 The evmone Authors.
 // SPDX-License-Identifier: Apache-2.0
+#pragma once
 
 #include "hash_utils.hpp"
 #include "precompiles.hpp"
+#include "precompiles_cache_file.hpp"
 #include <evmc/evmc.hpp>
 #include <array>
 #include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace evmone::state
 {
 using evmc::bytes;
 using evmc::bytes_view;
 
+/// The precompiles cache statistics.
+struct CacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t num_entries = 0;
+    size_t memory_usage = 0;  ///< The estimated memory used by the entries in bytes.
+};
+
+/// The cache of the precompiles results, safe to be used by concurrent threads.
+///
+/// The entries are distributed into the shards by the fast non-cryptographic hash of the input.
+/// Each shard has its own mutex and is the LRU list bounded by its share of the memory budget.
+/// The entries are matched by the hash and the full input comparison.
+///
+/// Only the expensive precompiles are cached. Additionally, the results of all precompiles
+/// can be looked up in the stub file and the newly computed ones appended to the dump file
+/// (see PrecompilesCacheFile).
 class Cache
 {
-    std::array<std::unordered_map<hash256, std::optional<bytes>>, NumPrecompiles> m_cache;
+public:
+    static constexpr size_t NumShards = 16;
+
+    /// The default memory budget, overridden by the EVMONE_PRECOMPILES_CACHE_SIZE environment
+    /// variable (in MiB) for the cache used by call_precompile().
+    static constexpr size_t DefaultMemoryBudget = size_t{64} << 20;
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        PrecompileId id;
+        bytes input;
+        std::optional<bytes> output;  ///< The output or std::nullopt for the failure.
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;  ///< The entries, the most recently used first.
+        std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index;
+        size_t memory_usage = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    size_t m_shard_budget;
+    std::array<Shard, NumShards> m_shards;
+
+    std::unique_ptr<PrecompilesCacheFile> m_stub;
+
+    /// The dump file. Only set by the constructor, so it can be checked without the lock.
+    const std::unique_ptr<PrecompilesCacheFile> m_dump;
+    std::mutex m_dump_mutex;
+
+    /// Set after the first append to the dump file has failed. Guarded by m_dump_mutex.
+    bool m_dump_failed = false;
+
+    /// The keys of the results appended to the dump file.
+    std::array<std::unordered_set<hash256>, NumPrecompiles> m_dumped;
 
 public:
-    Cache() noexcept;
+    /// Creates the cache, optionally with the stub and the dump files.
+    /// The errors of opening the files are reported to stderr and the files are not used then.
+    explicit Cache(size_t memory_budget = DefaultMemoryBudget,
+        const std::filesystem::path& stub_file = {},
+        const std::filesystem::path& dump_file = {}) noexcept;
     ~Cache() noexcept;
 
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+
+    /// Returns the cache shared by call_precompile(). The stub and the dump files are named
+    /// by the EVMONE_PRECOMPILES_STUB and EVMONE_PRECOMPILES_DUMP environment variables.
+    static Cache& global() noexcept;
+
     /// Lookups the precompiles cache.
     ///
     /// @param id        The precompile ID.
@@ -31,9 +108,17 @@ public:
     ///                  used for constructing the result for successful execution.
     /// @return          The cached execution result
     ///                  or std::nullopt if the matching cache entry is not found.
-    std::optional<evmc::Result> find(PrecompileId id, bytes_view input, int64_t gas_left) const;
+    std::optional<evmc::Result> find(PrecompileId id, bytes_view input, int64_t gas_left);
 
-    /// Inserts new precompiles cache entry.
+    /// Inserts new precompiles cache entry, evicting the least recently used ones
+    /// if over the memory budget. Ignored for the precompiles not worth caching.
+    /// Appends the result to the dump file (except "identity").
     void insert(PrecompileId id, bytes_view input, const evmc::Result& result);
+
+    /// Returns the statistics summed over the shards.
+    [[nodiscard]] CacheStats stats() const noexcept;
+
+private:
+    void dump(PrecompileId id, bytes_view input, const std::optional<bytes_view>& output);
 };
 }  // namespace evmone::state
@@ -0,0 +1,281 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "precompiles_cache_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace evmone::state
+{
+struct PrecompilesCacheFile::IndexEntry
+{
+    hash256 key;
+    uint8_t id;
+    uint8_t failed;
+    uint8_t padding[2];
+    uint32_t output_size;
+
+    /// The offset of the output in the outputs blob. Unused in the log records.
+    uint64_t output_offset;
+};
+static_assert(sizeof(PrecompilesCacheFile::IndexEntry) == 48);
+
+namespace
+{
+using IndexEntry = PrecompilesCacheFile::IndexEntry;
+
+constexpr char Magic[8] = {'e', 'v', 'm', 'p', 'r', 'e', 'c', 'c'};
+
+struct FileHeader
+{
+    char magic[8];
+    uint64_t num_entries;
+    uint64_t outputs_size;
+    uint64_t reserved;
+};
+static_assert(sizeof(FileHeader) == 32);
+
+/// Orders the index entries by the precompile id and the key.
+bool less(const IndexEntry& a, const IndexEntry& b) noexcept
+{
+    if (a.id != b.id)
+        return a.id < b.id;
+    return std::memcmp(a.key.bytes, b.key.bytes, sizeof(a.key)) < 0;
+}
+
+[[noreturn]] void throw_io_error(const std::string& what)
+{
+    throw std::system_error{errno, std::generic_category(), what};
+}
+
+IndexEntry make_index_entry(
+    PrecompileId id, const hash256& key, const std::optional<bytes_view>& output) noexcept
+{
+    IndexEntry e{};
+    e.key = key;
+    e.id = stdx::to_underlying(id);
+    e.failed = !output.has_value();
+    e.output_size = output.has_value() ? static_cast<uint32_t>(output->size()) : 0;
+    return e;
+}
+}  // namespace
+
+PrecompilesCacheFile::PrecompilesCacheFile(std::filesystem::path path) : m_path{std::move(path)}
+{
+    if (!std::filesystem::exists(m_path))
+        write(m_path, {});
+
+    map();
+    FileHeader header;
+    if (m_size < sizeof(header))
+        throw std::invalid_argument{"invalid precompiles cache file " + m_path.string()};
+    std::memcpy(&header, m_data, sizeof(header));
+    const auto max_entries = (m_size - sizeof(header)) / sizeof(IndexEntry);
+    const auto index_size = header.num_entries * sizeof(IndexEntry);
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.num_entries > max_entries ||
+        header.outputs_size > m_size - sizeof(header) - index_size)
+        throw std::invalid_argument{"invalid precompiles cache file " + m_path.string()};
+
+    m_index = {reinterpret_cast<const IndexEntry*>(m_data + sizeof(header)), header.num_entries};
+    m_outputs = {m_data + sizeof(header) + index_size, header.outputs_size};
+
+    // Index the log records in memory.
+    m_end = sizeof(header) + index_size + header.outputs_size;
+    while (m_end + sizeof(IndexEntry) <= m_size)
+    {
+        IndexEntry e;
+        std::memcpy(&e, m_data + m_end, sizeof(e));
+        const auto output_offset = m_end + sizeof(e);
+        if (e.id >= NumPrecompiles || e.output_size > m_size - output_offset)
+            break;
+        m_log[e.id][e.key] = {output_offset, e.output_size, e.failed != 0};
+        m_end = output_offset + e.output_size;
+    }
+}
+
+PrecompilesCacheFile::~PrecompilesCacheFile()
+{
+    unmap();
+}
+
+void PrecompilesCacheFile::map()
+{
+#ifdef _WIN32
+    std::ifstream in{m_path, std::ios::binary};
+    if (!in)
+        throw_io_error("cannot open precompiles cache file " + m_path.string());
+    m_buffer.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#else
+    const auto fd = ::open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw_io_error("cannot open precompiles cache file " + m_path.string());
+    struct stat st = {};
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw_io_error("cannot stat precompiles cache file");
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    const auto p = m_size != 0 ? ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw_io_error("cannot map precompiles cache file");
+    m_data = static_cast<const uint8_t*>(p);
+#endif
+}
+
+void PrecompilesCacheFile::unmap() noexcept
+{
+#ifndef _WIN32
+    if (m_data != nullptr)
+        ::munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+std::optional<PrecompilesCacheFile::Output> PrecompilesCacheFile::find(
+    PrecompileId id, const hash256& key) const noexcept
+{
+    const auto& log = m_log.at(stdx::to_underlying(id));
+    if (const auto it = log.find(key); it != log.end())
+    {
+        if (it->second.failed)
+            return Output{};
+        return Output{bytes_view{m_data + it->second.offset, it->second.size}};
+    }
+
+    const auto needle = make_index_entry(id, key, {});
+    const auto it = std::lower_bound(m_index.begin(), m_index.end(), needle, less);
+    if (it == m_index.end() || it->id != needle.id || it->key != key)
+        return std::nullopt;
+    if (it->failed != 0)
+        return Output{};
+    if (it->output_offset > m_outputs.size() ||
+        it->output_size > m_outputs.size() - it->output_offset)
+        return std::nullopt;  // Corrupted entry.
+    return Output{m_outputs.substr(it->output_offset, it->output_size)};
+}
+
+void PrecompilesCacheFile::append(PrecompileId id, const hash256& key, const Output& output)
+{
+    const std::lock_guard lock{m_append_mutex};
+    if (!m_append_stream.is_open())
+    {
+        // Drop the partially written record so the new ones follow the complete ones.
+        if (std::filesystem::file_size(m_path) != m_end)
+            std::filesystem::resize_file(m_path, m_end);
+        m_append_stream.open(m_path, std::ios::binary | std::ios::app);
+        if (!m_append_stream)
+            throw_io_error("cannot open precompiles cache file " + m_path.string());
+    }
+
+    const auto e = make_index_entry(id, key, output);
+    m_append_stream.write(reinterpret_cast<const char*>(&e), sizeof(e));
+    if (output.has_value())
+    {
+        m_append_stream.write(reinterpret_cast<const char*>(output->data()),
+            static_cast<std::streamsize>(output->size()));
+    }
+    m_append_stream.flush();
+    if (!m_append_stream)
+        throw_io_error("cannot write precompiles cache file " + m_path.string());
+}
+
+std::vector<PrecompilesCacheFile::Entry> PrecompilesCacheFile::entries() const
+{
+    std::vector<Entry> r;
+    for (const auto& e : m_index)
+    {
+        const auto id = static_cast<PrecompileId>(e.id);
+        if (e.id >= NumPrecompiles || m_log[e.id].contains(e.key))
+            continue;  // Invalid or replaced by the log entry.
+        if (const auto output = find(id, e.key); output.has_value())
+        {
+            r.push_back(
+                {id, e.key, output->has_value() ? std::optional{bytes{**output}} : std::nullopt});
+        }
+    }
+    for (size_t id = 0; id < m_log.size(); ++id)
+    {
+        for (const auto& [key, e] : m_log[id])
+        {
+            r.push_back({static_cast<PrecompileId>(id), key,
+                e.failed ? std::nullopt : std::optional{bytes{m_data + e.offset, e.size}}});
+        }
+    }
+    return r;
+}
+
+void PrecompilesCacheFile::write(const std::filesystem::path& path, std::vector<Entry> entries)
+{
+    // Sort by the key keeping the order of the duplicates, then keep the last one of these.
+    std::vector<std::pair<IndexEntry, const Entry*>> index;
+    index.reserve(entries.size());
+    for (const auto& e : entries)
+    {
+        index.emplace_back(make_index_entry(e.id, e.key,
+                               e.output.has_value() ? std::optional<bytes_view>{*e.output} :
+                                                      std::nullopt),
+            &e);
+    }
+    std::stable_sort(index.begin(), index.end(),
+        [](const auto& a, const auto& b) noexcept { return less(a.first, b.first); });
+    const auto last = std::unique(index.rbegin(), index.rend(), [](const auto& a, const auto& b) {
+        return !less(a.first, b.first) && !less(b.first, a.first);
+    });
+    index.erase(index.begin(), last.base());
+
+    uint64_t outputs_size = 0;
+    for (auto& [e, entry] : index)
+    {
+        e.output_offset = outputs_size;
+        outputs_size += e.output_size;
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.num_entries = index.size();
+    header.outputs_size = outputs_size;
+
+    // Write the new file next to the existing one and replace it atomically.
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream out{tmp_path, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& [e, entry] : index)
+            out.write(reinterpret_cast<const char*>(&e), sizeof(e));
+        for (const auto& [e, entry] : index)
+        {
+            if (entry->output.has_value())
+            {
+                out.write(reinterpret_cast<const char*>(entry->output->data()),
+                    static_cast<std::streamsize>(entry->output->size()));
+            }
+        }
+        out.flush();
+        if (!out)
+            throw_io_error("cannot write precompiles cache file " + tmp_path.string());
+    }
+    std::filesystem::rename(tmp_path, path);
+}
+
+void PrecompilesCacheFile::compact(const std::filesystem::path& path)
+{
+    auto entries = PrecompilesCacheFile{path}.entries();
+    write(path, std::move(entries));
+}
+}  // namespace evmone::state
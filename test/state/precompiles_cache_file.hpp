@@ -0,0 +1,109 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "hash_utils.hpp"
+#include "precompiles.hpp"
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace evmone::state
+{
+/// The binary file of the precompiles results, keyed by the precompile id and the Keccak hash
+/// of the input.
+///
+/// The file consists of the header, the index of the entries sorted by the key, the blob
+/// of their outputs and the log of the entries appended later, each followed by its output.
+/// The file is memory-mapped and the sorted index is binary searched in place, so opening
+/// the file only scans the log. compact() merges the log into the sorted index.
+/// The partially written log record at the end of the file (after a crash) is ignored.
+/// The numbers are stored in the native byte order.
+///
+/// The lookups are safe to be used from multiple threads, also concurrently with append().
+class PrecompilesCacheFile
+{
+public:
+    /// The cached result: the output or std::nullopt for the failure.
+    using Output = std::optional<bytes_view>;
+
+    struct Entry
+    {
+        PrecompileId id{};
+        hash256 key;
+        std::optional<bytes> output;
+    };
+
+    struct IndexEntry;
+
+private:
+    /// The location of the output of the log entry in the file.
+    struct LogEntry
+    {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        bool failed = false;
+    };
+
+    std::filesystem::path m_path;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+    /// The file contents if the memory mapping is not available.
+    std::vector<uint8_t> m_buffer;
+
+    std::span<const IndexEntry> m_index;
+    bytes_view m_outputs;
+    std::array<std::unordered_map<hash256, LogEntry>, NumPrecompiles> m_log;
+
+    /// The end of the last complete log record.
+    uint64_t m_end = 0;
+
+    std::mutex m_append_mutex;
+    std::ofstream m_append_stream;
+
+public:
+    /// Opens the file or creates the empty one if it does not exist.
+    ///
+    /// @throws std::system_error     In case of the I/O error.
+    /// @throws std::invalid_argument If the file is not a valid precompiles cache file.
+    explicit PrecompilesCacheFile(std::filesystem::path path);
+
+    ~PrecompilesCacheFile();
+
+    PrecompilesCacheFile(const PrecompilesCacheFile&) = delete;
+    PrecompilesCacheFile& operator=(const PrecompilesCacheFile&) = delete;
+
+    /// Finds the result in the file. The entries appended by this object are not visible
+    /// until the file is opened again.
+    [[nodiscard]] std::optional<Output> find(PrecompileId id, const hash256& key) const noexcept;
+
+    /// Appends the result to the log at the end of the file.
+    ///
+    /// @throws std::system_error In case of the I/O error.
+    void append(PrecompileId id, const hash256& key, const Output& output);
+
+    /// Returns all the entries of the file.
+    [[nodiscard]] std::vector<Entry> entries() const;
+
+    /// Writes the entries sorted by the key into the new file, replacing the existing one.
+    /// The entry occurring later takes precedence over the one with the same key.
+    ///
+    /// @throws std::system_error In case of the I/O error.
+    static void write(const std::filesystem::path& path, std::vector<Entry> entries);
+
+    /// Rewrites the file merging the log into the sorted index.
+    /// The file must not be open by other objects.
+    static void compact(const std::filesystem::path& path);
+
+private:
+    void map();
+    void unmap() noexcept;
+};
+}  // namespace evmone::state
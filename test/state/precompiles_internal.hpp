@@ -0,0 +1,49 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include "precompiles.hpp"
+#include <evmc/evmc.hpp>
+
+/// The precompiles' analysis and execution functions, exposed for testing and benchmarking.
+namespace evmone::state
+{
+using evmc::bytes_view;
+
+/// The result of the precompile analysis: the gas cost and the maximum output size.
+struct PrecompileAnalysis
+{
+    int64_t gas_cost;
+    size_t max_output_size;
+};
+
+PrecompileAnalysis ecrecover_analyze(bytes_view input, evmc_revision rev) noexcept;
+PrecompileAnalysis sha256_analyze(bytes_view input, evmc_revision rev) noexcept;
+PrecompileAnalysis ripemd160_analyze(bytes_view input, evmc_revision rev) noexcept;
+PrecompileAnalysis identity_analyze(bytes_view input, evmc_revision rev) noexcept;
+PrecompileAnalysis expmod_analyze(bytes_view input, evmc_revision rev) noexcept;
+PrecompileAnalysis ecadd_analyze(bytes_view input, evmc_revision rev) noexcept;
+PrecompileAnalysis ecmul_analyze(bytes_view input, evmc_revision rev) noexcept;
+PrecompileAnalysis ecpairing_analyze(bytes_view input, evmc_revision rev) noexcept;
+PrecompileAnalysis blake2bf_analyze(bytes_view input, evmc_revision rev) noexcept;
+
+ExecutionResult ecrecover_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+ExecutionResult expmod_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+ExecutionResult blake2bf_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+ExecutionResult ecadd_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+ExecutionResult ecmul_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+ExecutionResult ecpairing_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+ExecutionResult identity_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+ExecutionResult ripemd160_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+ExecutionResult sha256_execute(
+    const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) noexcept;
+}  // namespace evmone::state
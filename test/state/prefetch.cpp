@@ -0,0 +1,133 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "prefetch.hpp"
+#include "state_backend.hpp"
+#include <evmone/instructions_opcodes.hpp>
+#include <algorithm>
+
+namespace evmone::state
+{
+std::vector<bytes32> find_static_storage_keys(bytes_view code)
+{
+    const auto is_storage_access = [code](size_t pos) noexcept {
+        return pos < code.size() && (code[pos] == OP_SLOAD || code[pos] == OP_SSTORE);
+    };
+
+    std::vector<bytes32> keys;
+    for (size_t i = 0; i < code.size();)
+    {
+        const auto op = code[i++];
+        if (op == OP_PUSH0 && is_storage_access(i))
+            keys.emplace_back();
+        else if (op >= OP_PUSH1 && op <= OP_PUSH32)
+        {
+            const auto push_size = static_cast<size_t>(op - OP_PUSH1 + 1);
+            if (is_storage_access(i + push_size))
+            {
+                auto& key = keys.emplace_back();
+                std::copy_n(&code[i], push_size, &key.bytes[sizeof(key) - push_size]);
+            }
+            i += push_size;
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+PrefetchRequest collect_prefetch_request(const BlockInfo& block, const Transaction& tx)
+{
+    PrefetchRequest request;
+    request.accounts.push_back(tx.sender);
+    request.accounts.push_back(block.coinbase);
+    if (tx.to.has_value())
+    {
+        request.accounts.push_back(*tx.to);
+        request.code_storage.push_back(*tx.to);
+    }
+    for (const auto& [addr, keys] : tx.access_list)
+    {
+        request.accounts.push_back(addr);
+        for (const auto& key : keys)
+            request.storage.emplace_back(addr, key);
+    }
+    return request;
+}
+
+AsyncPrefetcher::AsyncPrefetcher(const StateBackend& backend)
+  : m_backend{backend}, m_worker{&AsyncPrefetcher::run, this}
+{}
+
+AsyncPrefetcher::~AsyncPrefetcher()
+{
+    {
+        const std::lock_guard lock{m_mutex};
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_worker.join();
+}
+
+void AsyncPrefetcher::prefetch(const PrefetchRequest& request)
+{
+    {
+        const std::lock_guard lock{m_mutex};
+        m_queue.push_back(request);
+    }
+    m_cv.notify_all();
+}
+
+void AsyncPrefetcher::wait()
+{
+    std::unique_lock lock{m_mutex};
+    m_cv.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+}
+
+void AsyncPrefetcher::run()
+{
+    std::unique_lock lock{m_mutex};
+    while (true)
+    {
+        m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_stop)
+            return;
+
+        const auto request = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_busy = true;
+        lock.unlock();
+        load(request);
+        lock.lock();
+        m_busy = false;
+        m_cv.notify_all();
+    }
+}
+
+void AsyncPrefetcher::load(const PrefetchRequest& request)
+{
+    for (const auto& addr : request.accounts)
+    {
+        (void)m_backend.get_account(addr);
+        ++m_num_accounts;
+    }
+    for (const auto& [addr, key] : request.storage)
+    {
+        (void)m_backend.get_storage(addr, key);
+        ++m_num_storage_slots;
+    }
+    for (const auto& addr : request.code_storage)
+    {
+        const auto acc = m_backend.get_account(addr);
+        if (acc == nullptr)
+            continue;
+        for (const auto& key : find_static_storage_keys(acc->code))
+        {
+            (void)m_backend.get_storage(addr, key);
+            ++m_num_storage_slots;
+        }
+    }
+}
+}  // namespace evmone::state
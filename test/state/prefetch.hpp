@@ -0,0 +1,95 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "state.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace evmone::state
+{
+/// The accounts and storage slots to be loaded ahead of the transaction execution.
+struct PrefetchRequest
+{
+    std::vector<address> accounts;
+    std::vector<std::pair<address, bytes32>> storage;
+
+    /// The accounts the code of which is scanned for the static storage keys
+    /// (see find_static_storage_keys()) to be loaded as well once the code is loaded.
+    std::vector<address> code_storage;
+};
+
+/// The hook of a slow state backing store (e.g. a disk database) to load the state
+/// ahead of the transaction execution so the loads overlap with the execution
+/// of the preceding transactions.
+class StatePrefetcher
+{
+public:
+    virtual ~StatePrefetcher() = default;
+
+    /// Requests the asynchronous load of the accounts and storage slots.
+    /// The request is only a hint: the call should not block
+    /// and must not modify the state observable by the execution.
+    virtual void prefetch(const PrefetchRequest& request) = 0;
+};
+
+/// Finds the storage keys statically visible in the code: the constants pushed
+/// right before SLOAD or SSTORE, e.g. the slots of Solidity's value-type state variables.
+/// The keys are sorted and unique.
+[[nodiscard]] std::vector<bytes32> find_static_storage_keys(bytes_view code);
+
+/// Collects the state the transaction is going to access: the sender, the recipient,
+/// the coinbase, the access list and the static storage keys of the recipient's code.
+/// Nothing is loaded here, the recipient's code is left to be scanned by the prefetcher.
+[[nodiscard]] PrefetchRequest collect_prefetch_request(
+    const BlockInfo& block, const Transaction& tx);
+
+/// The prefetcher loading the requested state from the backend in a worker thread.
+/// The loads fill the backend's caches and bring in the pages of the file of a disk backend
+/// (e.g. MmapStateBackend), so the execution does not wait for the disk.
+///
+/// The backend must not be committed while the prefetcher is loading: call wait() before
+/// committing the State using the backend.
+class AsyncPrefetcher : public StatePrefetcher
+{
+    const StateBackend& m_backend;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<PrefetchRequest> m_queue;
+    bool m_busy = false;
+    bool m_stop = false;
+    std::atomic<uint64_t> m_num_accounts = 0;
+    std::atomic<uint64_t> m_num_storage_slots = 0;
+    std::thread m_worker;
+
+    void run();
+
+    void load(const PrefetchRequest& request);
+
+public:
+    explicit AsyncPrefetcher(const StateBackend& backend);
+
+    /// Stops the worker thread. The pending requests are dropped.
+    ~AsyncPrefetcher() override;
+
+    AsyncPrefetcher(const AsyncPrefetcher&) = delete;
+    AsyncPrefetcher& operator=(const AsyncPrefetcher&) = delete;
+
+    /// Queues the request for the worker thread.
+    void prefetch(const PrefetchRequest& request) override;
+
+    /// Waits until all the queued requests are loaded.
+    void wait();
+
+    /// Returns the number of the accounts loaded so far.
+    [[nodiscard]] uint64_t num_accounts() const noexcept { return m_num_accounts; }
+
+    /// Returns the number of the storage slots loaded so far.
+    [[nodiscard]] uint64_t num_storage_slots() const noexcept { return m_num_storage_slots; }
+};
+}  // namespace evmone::state
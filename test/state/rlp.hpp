@@ -6,43 +6,146 @@
 
 #include <intx/intx.hpp>
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+/// The RLP encoder.
+///
+/// The values are encoded in two passes by the rlp::Writer: the first pass computes the size
+/// of the encoding and records the sizes of all the lists, the second pass writes the encoding
+/// to an output sink using the recorded sizes. The sink is any object having
+/// the `write(const uint8_t* data, size_t size)` method, e.g. rlp::BufferWriter
+/// writing to a pre-allocated buffer or a streaming hasher.
+/// Custom types are supported by providing the `rlp_write(rlp::Writer&, const T&)` function
+/// writing the items of the value, the same function is used in both passes.
 namespace evmone::rlp
 {
 using bytes = std::basic_string<uint8_t>;
 using bytes_view = std::basic_string_view<uint8_t>;
 
+/// The output sink writing to a pre-allocated buffer of sufficient size.
+struct BufferWriter
+{
+    uint8_t* pos = nullptr;
+
+    void write(const uint8_t* data, size_t size) noexcept
+    {
+        if (size != 0)  // Skip for empty data to avoid memcpy() with null pointer.
+            std::memcpy(pos, data, size);
+        pos += size;
+    }
+};
+
 namespace internal
 {
-template <uint8_t ShortBase, uint8_t LongBase>
-inline bytes encode_length(size_t l)
+template <uint8_t ShortBase, uint8_t LongBase, typename Sink>
+inline void write_length(Sink& sink, size_t l)
 {
     static constexpr auto short_cutoff = 55;
     static_assert(ShortBase + short_cutoff <= 0xff);
     assert(l <= 0xffffff);
 
+    const auto l0 = static_cast<uint8_t>(l);
+    const auto l1 = static_cast<uint8_t>(l >> 8);
+    const auto l2 = static_cast<uint8_t>(l >> 16);
+
     if (l <= short_cutoff)
-        return {static_cast<uint8_t>(ShortBase + l)};
-    else if (const auto l0 = static_cast<uint8_t>(l); l <= 0xff)
-        return {LongBase + 1, l0};
-    else if (const auto l1 = static_cast<uint8_t>(l >> 8); l <= 0xffff)
-        return {LongBase + 2, l1, l0};
+    {
+        const uint8_t prefix[]{static_cast<uint8_t>(ShortBase + l)};
+        sink.write(prefix, std::size(prefix));
+    }
+    else if (l <= 0xff)
+    {
+        const uint8_t prefix[]{LongBase + 1, l0};
+        sink.write(prefix, std::size(prefix));
+    }
+    else if (l <= 0xffff)
+    {
+        const uint8_t prefix[]{LongBase + 2, l1, l0};
+        sink.write(prefix, std::size(prefix));
+    }
     else
-        return {LongBase + 3, static_cast<uint8_t>(l >> 16), l1, l0};
+    {
+        const uint8_t prefix[]{LongBase + 3, l2, l1, l0};
+        sink.write(prefix, std::size(prefix));
+    }
 }
+}  // namespace internal
 
-inline bytes wrap_list(const bytes& content)
+/// The writer of the RLP items.
+///
+/// In the sizing pass (the initial state) the writer only counts the bytes and records
+/// the content size of every list in the order the lists are started. After start() it
+/// writes to the sink taking the list sizes from the record, so the items must be written
+/// exactly as in the sizing pass. The sizes of the first lists are stored inline, so the
+/// encoding does not allocate unless it has many lists.
+class Writer
 {
-    return internal::encode_length<192, 247>(content.size()) + content;
-}
+    static constexpr size_t num_inline_list_sizes = 16;
 
-template <typename InputIterator>
-inline bytes encode_container(InputIterator begin, InputIterator end);
-}  // namespace internal
+    using WriteFn = void (*)(void* sink, const uint8_t* data, size_t size);
+
+    WriteFn m_write = nullptr;  ///< The sink write function, null in the sizing pass.
+    void* m_sink = nullptr;
+    size_t m_size = 0;       ///< The size of the encoding, computed in the sizing pass.
+    size_t m_num_lists = 0;  ///< The number of the lists started in the current pass.
+    size_t m_inline_list_sizes[num_inline_list_sizes]{};
+    std::vector<size_t> m_list_sizes;  ///< The sizes of the lists beyond the inline ones.
+
+    size_t& list_size(size_t index) noexcept
+    {
+        return index < num_inline_list_sizes ? m_inline_list_sizes[index] :
+                                               m_list_sizes[index - num_inline_list_sizes];
+    }
+
+public:
+    /// Ends the sizing pass and starts writing the encoding to the sink.
+    template <typename Sink>
+    void start(Sink& sink) noexcept
+    {
+        m_write = [](void* s, const uint8_t* data, size_t size) {
+            static_cast<Sink*>(s)->write(data, size);
+        };
+        m_sink = &sink;
+        m_num_lists = 0;
+    }
+
+    /// The size of the encoding computed in the sizing pass.
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+    void write(const uint8_t* data, size_t size)
+    {
+        if (m_write != nullptr)
+            m_write(m_sink, data, size);
+        else
+            m_size += size;
+    }
+
+    /// Writes the RLP list out of the list items written by the provided function.
+    template <typename WriteItemsFn>
+    void list(const WriteItemsFn& write_items)
+    {
+        const auto index = m_num_lists++;
+        if (m_write != nullptr)
+        {
+            internal::write_length<192, 247>(*this, list_size(index));
+            write_items(*this);
+            return;
+        }
+
+        // Reserve the size slot before the nested lists take the following ones.
+        if (index >= num_inline_list_sizes)
+            m_list_sizes.push_back(0);
+        const auto content_begin = m_size;
+        write_items(*this);
+        const auto content_size = m_size - content_begin;
+        list_size(index) = content_size;
+        internal::write_length<192, 247>(*this, content_size);
+    }
+};
 
 inline bytes_view trim(bytes_view b) noexcept
 {
@@ -50,52 +153,191 @@ inline bytes_view trim(bytes_view b) noexcept
     return b;
 }
 
+// The declarations of all write() overloads, so they can be used recursively
+// by the container overloads.
+
+inline void write(Writer& w, bytes_view data);
+
+inline void write(Writer& w, uint64_t x);
+
+inline void write(Writer& w, const intx::uint256& x);
+
 template <typename T>
-inline decltype(rlp_encode(std::declval<T>())) encode(const T& v)
+inline void write(Writer& w, const std::vector<T>& v);
+
+template <typename T, size_t N>
+inline void write(Writer& w, const T (&v)[N]);
+
+template <typename T1, typename T2>
+inline void write(Writer& w, const std::pair<T1, T2>& p);
+
+template <typename T>
+inline auto write(Writer& w, const T& v) -> decltype(rlp_write(w, v), void());
+
+/// Writes the fixed-size collection of heterogeneous values as RLP list.
+template <typename... Types>
+inline void write_tuple(Writer& w, const Types&... elements)
 {
-    return rlp_encode(v);
+    w.list([&](Writer& lw) { (write(lw, elements), ...); });
 }
 
-inline bytes encode(bytes_view data)
+inline void write(Writer& w, bytes_view data)
 {
     static constexpr uint8_t short_base = 128;
     if (data.size() == 1 && data[0] < short_base)
-        return {data[0]};
+        return w.write(data.data(), 1);
 
-    return internal::encode_length<short_base, 183>(data.size()) += data;  // Op + not available.
+    internal::write_length<short_base, 183>(w, data.size());
+    w.write(data.data(), data.size());
 }
 
-inline bytes encode(uint64_t x)
+inline void write(Writer& w, uint64_t x)
 {
     uint8_t b[sizeof(x)];
     intx::be::store(b, x);
-    return encode(trim({b, sizeof(b)}));
+    write(w, trim({b, sizeof(b)}));
 }
 
-inline bytes encode(const intx::uint256& x)
+inline void write(Writer& w, const intx::uint256& x)
 {
     uint8_t b[sizeof(x)];
     intx::be::store(b, x);
-    return encode(trim({b, sizeof(b)}));
+    write(w, trim({b, sizeof(b)}));
+}
+
+/// Writes the container as RLP list.
+template <typename T>
+inline void write(Writer& w, const std::vector<T>& v)
+{
+    w.list([&](Writer& lw) {
+        for (const auto& x : v)
+            write(lw, x);
+    });
+}
+
+template <typename T, size_t N>
+inline void write(Writer& w, const T (&v)[N])
+{
+    w.list([&](Writer& lw) {
+        for (const auto& x : v)
+            write(lw, x);
+    });
+}
+
+/// Writes a pair of values as RLP list.
+template <typename T1, typename T2>
+inline void write(Writer& w, const std::pair<T1, T2>& p)
+{
+    write_tuple(w, p.first, p.second);
+}
+
+/// Writes a custom type by the rlp_write() function.
+template <typename T>
+inline auto write(Writer& w, const T& v) -> decltype(rlp_write(w, v), void())
+{
+    rlp_write(w, v);
+}
+
+/// Writes the RLP encoding of the items written by the function to the output sink.
+/// The function is called twice: in the sizing pass and in the writing pass.
+template <typename Sink, typename WriteFn>
+inline void write_to(Sink& sink, const WriteFn& write_fn)
+{
+    Writer w;
+    write_fn(w);
+    w.start(sink);
+    write_fn(w);
+}
+
+/// Writes the RLP encoding of the value to the output sink.
+template <typename Sink, typename T>
+inline void encode_to(Sink& sink, const T& v)
+{
+    write_to(sink, [&](Writer& w) { write(w, v); });
+}
+
+/// Writes the RLP encoding of the fixed-size collection of heterogeneous values
+/// as RLP list to the output sink.
+template <typename Sink, typename... Types>
+inline void encode_tuple_to(Sink& sink, const Types&... elements)
+{
+    write_to(sink, [&](Writer& w) { write_tuple(w, elements...); });
+}
+
+/// Computes the size of the RLP encoding of the value.
+template <typename T>
+[[nodiscard]] inline size_t encoded_size(const T& v)
+{
+    Writer w;
+    write(w, v);
+    return w.size();
+}
+
+/// Computes the size of the RLP encoding of the fixed-size collection of heterogeneous values.
+template <typename... Types>
+[[nodiscard]] inline size_t encoded_tuple_size(const Types&... elements)
+{
+    Writer w;
+    write_tuple(w, elements...);
+    return w.size();
+}
+
+namespace internal
+{
+/// Encodes the items written by the function into the buffer of the size computed
+/// in the sizing pass.
+template <typename WriteFn>
+inline bytes encode_sized(const WriteFn& write_fn)
+{
+    Writer w;
+    write_fn(w);
+    bytes out(w.size(), 0);
+    BufferWriter buffer{out.data()};
+    w.start(buffer);
+    write_fn(w);
+    assert(buffer.pos == out.data() + out.size());
+    return out;
+}
+}  // namespace internal
+
+template <typename T>
+inline auto encode(const T& v) -> decltype(rlp_write(std::declval<Writer&>(), v), bytes())
+{
+    return internal::encode_sized([&](Writer& w) { rlp_write(w, v); });
+}
+
+inline bytes encode(bytes_view data)
+{
+    return internal::encode_sized([&](Writer& w) { write(w, data); });
+}
+
+inline bytes encode(uint64_t x)
+{
+    return internal::encode_sized([&](Writer& w) { write(w, x); });
+}
+
+inline bytes encode(const intx::uint256& x)
+{
+    return internal::encode_sized([&](Writer& w) { write(w, x); });
 }
 
 template <typename T>
 inline bytes encode(const std::vector<T>& v)
 {
-    return internal::encode_container(v.begin(), v.end());
+    return internal::encode_sized([&](Writer& w) { write(w, v); });
 }
 
 template <typename T, size_t N>
 inline bytes encode(const T (&v)[N])
 {
-    return internal::encode_container(std::begin(v), std::end(v));
+    return internal::encode_sized([&](Writer& w) { write(w, v); });
 }
 
 /// Encodes the fixed-size collection of heterogeneous values as RLP list.
 template <typename... Types>
 inline bytes encode_tuple(const Types&... elements)
 {
-    return internal::wrap_list((encode(elements) + ...));
+    return internal::encode_sized([&](Writer& w) { write_tuple(w, elements...); });
 }
 
 /// Encodes a pair of values as RPL list.
@@ -104,19 +346,4 @@ inline bytes encode(const std::pair<T1, T2>& p)
 {
     return encode_tuple(p.first, p.second);
 }
-
-/// Encodes the container as RLP list.
-///
-/// @tparam InputIterator  Type of the input iterator.
-/// @param  begin          Begin iterator.
-/// @param  end            End iterator.
-/// @return                Bytes of the RLP list.
-template <typename InputIterator>
-inline bytes internal::encode_container(InputIterator begin, InputIterator end)
-{
-    bytes content;
-    for (auto it = begin; it != end; ++it)
-        content += encode(*it);
-    return wrap_list(content);
-}
 }  // namespace evmone::rlp
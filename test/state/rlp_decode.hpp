@@ -0,0 +1,214 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "errors.hpp"
+#include "hash_utils.hpp"
+#include <intx/intx.hpp>
+#include <algorithm>
+#include <optional>
+
+/// The validating zero-copy RLP decoder.
+///
+/// Each decode() function consumes a single RLP item from the front of the input
+/// and stores the decoded value in the output argument. The decoded strings and lists
+/// are views into the input buffer. Only canonical encodings are accepted.
+namespace evmone::rlp
+{
+using state::ErrorCode;
+
+/// The view of the RLP list: the concatenation of the encoded list items.
+struct ListView
+{
+    bytes_view payload;
+};
+
+/// The decoded header of an RLP item.
+struct Header
+{
+    bool is_list = false;
+    bytes_view payload;
+};
+
+/// Decodes the header of the next RLP item. The item payload is a view into the input.
+[[nodiscard]] inline ErrorCode decode_header(bytes_view& input, Header& header) noexcept
+{
+    if (input.empty())
+        return state::RLP_INPUT_TOO_SHORT;
+
+    const auto prefix = input[0];
+    if (prefix < 0x80)  // The single byte is its own encoding.
+    {
+        header = {false, input.substr(0, 1)};
+        input.remove_prefix(1);
+        return state::SUCCESS;
+    }
+    input.remove_prefix(1);
+
+    static constexpr size_t short_cutoff = 55;
+    header.is_list = prefix >= 0xc0;
+    const auto short_size = static_cast<size_t>(prefix - (header.is_list ? 0xc0 : 0x80));
+    size_t size = short_size;
+    if (short_size > short_cutoff)
+    {
+        const auto size_of_size = short_size - short_cutoff;  // In range [1, 8].
+        if (input.size() < size_of_size)
+            return state::RLP_INPUT_TOO_SHORT;
+        if (input[0] == 0)
+            return state::RLP_NON_CANONICAL_SIZE;
+        size = 0;
+        for (size_t i = 0; i < size_of_size; ++i)
+            size = (size << 8) | input[i];
+        input.remove_prefix(size_of_size);
+        if (size <= short_cutoff)
+            return state::RLP_NON_CANONICAL_SIZE;
+    }
+
+    if (input.size() < size)
+        return state::RLP_INPUT_TOO_SHORT;
+    header.payload = input.substr(0, size);
+    input.remove_prefix(size);
+
+    if (!header.is_list && size == 1 && header.payload[0] < 0x80)
+        return state::RLP_NON_CANONICAL_SIZE;  // Must have been encoded as single byte.
+    return state::SUCCESS;
+}
+
+/// Decodes the next RLP item being a byte string.
+[[nodiscard]] inline ErrorCode decode(bytes_view& input, bytes_view& out) noexcept
+{
+    Header header;
+    if (const auto ec = decode_header(input, header); ec != state::SUCCESS)
+        return ec;
+    if (header.is_list)
+        return state::RLP_EXPECTED_STRING;
+    out = header.payload;
+    return state::SUCCESS;
+}
+
+/// Decodes the next RLP item being a list. The list items are not decoded.
+[[nodiscard]] inline ErrorCode decode(bytes_view& input, ListView& out) noexcept
+{
+    Header header;
+    if (const auto ec = decode_header(input, header); ec != state::SUCCESS)
+        return ec;
+    if (!header.is_list)
+        return state::RLP_EXPECTED_LIST;
+    out = {header.payload};
+    return state::SUCCESS;
+}
+
+namespace internal
+{
+template <typename T>
+[[nodiscard]] inline ErrorCode decode_uint(bytes_view& input, T& out) noexcept
+{
+    bytes_view payload;
+    if (const auto ec = decode(input, payload); ec != state::SUCCESS)
+        return ec;
+    if (payload.size() > sizeof(T))
+        return state::RLP_UINT_OVERFLOW;
+    if (!payload.empty() && payload[0] == 0)
+        return state::RLP_NON_CANONICAL_INTEGER;
+
+    // Load the big-endian value at once from the zero-padded buffer
+    // instead of shifting it in byte by byte.
+    uint8_t padded[sizeof(T)]{};
+    std::copy(payload.begin(), payload.end(), &padded[sizeof(T) - payload.size()]);
+    out = intx::be::unsafe::load<T>(padded);
+    return state::SUCCESS;
+}
+
+template <typename T>
+[[nodiscard]] inline ErrorCode decode_fixed_bytes(bytes_view& input, T& out) noexcept
+{
+    bytes_view payload;
+    if (const auto ec = decode(input, payload); ec != state::SUCCESS)
+        return ec;
+    if (payload.size() != sizeof(out.bytes))
+        return state::RLP_UNEXPECTED_SIZE;
+    std::copy(payload.begin(), payload.end(), out.bytes);
+    return state::SUCCESS;
+}
+}  // namespace internal
+
+[[nodiscard]] inline ErrorCode decode(bytes_view& input, uint64_t& out) noexcept
+{
+    return internal::decode_uint(input, out);
+}
+
+[[nodiscard]] inline ErrorCode decode(bytes_view& input, intx::uint256& out) noexcept
+{
+    return internal::decode_uint(input, out);
+}
+
+[[nodiscard]] inline ErrorCode decode(bytes_view& input, bool& out) noexcept
+{
+    uint64_t x = 0;
+    if (const auto ec = decode(input, x); ec != state::SUCCESS)
+        return ec;
+    if (x > 1)
+        return state::RLP_UINT_OVERFLOW;
+    out = x != 0;
+    return state::SUCCESS;
+}
+
+[[nodiscard]] inline ErrorCode decode(bytes_view& input, address& out) noexcept
+{
+    return internal::decode_fixed_bytes(input, out);
+}
+
+[[nodiscard]] inline ErrorCode decode(bytes_view& input, bytes32& out) noexcept
+{
+    return internal::decode_fixed_bytes(input, out);
+}
+
+/// Decodes the optional address: the empty string means no address
+/// (e.g. the "to" field of a contract creation transaction).
+[[nodiscard]] inline ErrorCode decode(bytes_view& input, std::optional<address>& out) noexcept
+{
+    if (!input.empty() && input[0] == 0x80)
+    {
+        input.remove_prefix(1);
+        out.reset();
+        return state::SUCCESS;
+    }
+    return decode(input, out.emplace());
+}
+
+/// Counts the items of the list by skipping over their headers. Returns 0 for a malformed list,
+/// the errors are reported when the items are actually decoded.
+[[nodiscard]] inline size_t count_items(ListView list) noexcept
+{
+    size_t count = 0;
+    for (Header header; !list.payload.empty(); ++count)
+    {
+        if (decode_header(list.payload, header) != state::SUCCESS)
+            return 0;
+    }
+    return count;
+}
+
+/// Decodes the RLP list of the fixed number of heterogeneous values.
+template <typename... Types>
+[[nodiscard]] inline ErrorCode decode_tuple(bytes_view& input, Types&... elements) noexcept
+{
+    ListView list;
+    if (const auto ec = decode(input, list); ec != state::SUCCESS)
+        return ec;
+
+    const auto decode_element = [&list](auto& element) noexcept {
+        if (list.payload.empty())
+            return state::RLP_TOO_FEW_ELEMENTS;
+        return decode(list.payload, element);
+    };
+
+    auto ec = state::SUCCESS;
+    ((ec = (ec == state::SUCCESS) ? decode_element(elements) : ec), ...);
+    if (ec == state::SUCCESS && !list.payload.empty())
+        return state::RLP_TOO_MANY_ELEMENTS;
+    return ec;
+}
+}  // namespace evmone::rlp
@@ -5,9 +5,13 @@
 #include "state.hpp"
 #include "errors.hpp"
 #include "host.hpp"
+#include "prefetch.hpp"
 #include "rlp.hpp"
+#include "state_backend.hpp"
 #include <evmone/evmone.h>
 #include <evmone/execution_state.hpp>
+#include <algorithm>
+#include <unordered_set>
 
 namespace evmone::state
 {
@@ -115,29 +119,48 @@ evmc_message build_message(const Transaction& tx, int64_t execution_gas_limit) n
         recipient,
     };
 }
-}  // namespace
 
-void finalize(State& state, evmc_revision rev, const address& coinbase,
-    std::optional<uint64_t> block_reward, std::span<Withdrawal> withdrawals)
+/// Cleans up the accounts accessed since the previous cleanup (e.g. by a transaction):
+/// erases the destructed accounts and, after Spurious Dragon, the touched empty accounts,
+/// and resets the per-transaction account and storage statuses.
+/// Only the accessed accounts are visited so the cost does not depend on the state size.
+void finalize_accessed_accounts(State& state, evmc_revision rev) noexcept
 {
-    if (block_reward.has_value())
-        state.touch(coinbase).balance += *block_reward;
-
-    if (rev >= EVMC_SPURIOUS_DRAGON)
+    auto& accounts = state.get_accounts();
+    for (const auto& addr : state.get_accessed_accounts())
     {
-        std::erase_if(
-            state.get_accounts(), [](const std::pair<const address, Account>& p) noexcept {
-                const auto& acc = p.second;
-                return acc.erasable && acc.is_empty();
-            });
+        const auto it = accounts.find(addr);
+        if (it == accounts.end())
+            continue;  // Removed by direct modification of the accounts map.
+
+        auto& acc = it->second;
+        if (acc.destructed || (rev >= EVMC_SPURIOUS_DRAGON && acc.erasable && acc.is_empty()))
+        {
+            state.erase(addr);
+            continue;
+        }
+
+        acc.accessed = false;
+        acc.erasable = false;
+        acc.access_status = EVMC_ACCESS_COLD;
+        for (const auto& key : acc.accessed_storage_keys)
+        {
+            if (const auto slot = acc.storage.find(key); slot != acc.storage.end())
+            {
+                slot->second.original = slot->second.current;
+                slot->second.access_status = EVMC_ACCESS_COLD;
+            }
+        }
+        acc.accessed_storage_keys.clear();
     }
-
-    for (const auto& withdrawal : withdrawals)
-        state.touch(withdrawal.recipient).balance += withdrawal.get_amount();
+    state.clear_accessed_accounts();
 }
 
-std::variant<TransactionReceipt, std::error_code> transition(
-    State& state, const BlockInfo& block, const Transaction& tx, evmc_revision rev, evmc::VM& vm)
+/// Executes the transaction. If the coinbase_fee is provided, the coinbase account is not
+/// accessed and the priority fee is stored there instead of being credited to the coinbase.
+std::variant<TransactionReceipt, std::error_code> execute_transaction(State& state,
+    const BlockInfo& block, const Transaction& tx, evmc_revision rev, evmc::VM& vm,
+    intx::uint256* coinbase_fee)
 {
     auto& sender_acc = state.get(tx.sender);
     const auto validation_result = validate_transaction(sender_acc, block, tx, rev);
@@ -167,14 +190,19 @@ std::variant<TransactionReceipt, std::error_code> transition(
     for (const auto& [a, storage_keys] : tx.access_list)
     {
         host.access_account(a);  // TODO: Return account ref.
-        auto& storage = state.get(a).storage;
+        auto& acc = state.get(a);
         for (const auto& key : storage_keys)
-            storage[key].access_status = EVMC_ACCESS_WARM;
+        {
+            auto& slot = state.get_storage(a, acc, key);
+            if (slot.access_status == EVMC_ACCESS_COLD && slot.original == slot.current)
+                acc.accessed_storage_keys.push_back(key);
+            slot.access_status = EVMC_ACCESS_WARM;
+        }
     }
     // EIP-3651: Warm COINBASE.
     // This may create an empty coinbase account. The account cannot be created unconditionally
     // because this breaks old revisions.
-    if (rev >= EVMC_SHANGHAI)
+    if (rev >= EVMC_SHANGHAI && coinbase_fee == nullptr)
         host.access_account(block.coinbase);
 
     const auto result = host.call(build_message(tx, execution_gas_limit));
@@ -188,11 +216,13 @@ std::variant<TransactionReceipt, std::error_code> transition(
     assert(gas_used > 0);
 
     state.get(tx.sender).balance += tx_max_cost - gas_used * effective_gas_price;
-    state.touch(block.coinbase).balance += gas_used * priority_gas_price;
+    if (coinbase_fee != nullptr)
+        *coinbase_fee = gas_used * priority_gas_price;
+    else
+        state.touch(block.coinbase).balance += gas_used * priority_gas_price;
 
-    // Apply destructs.
-    std::erase_if(state.get_accounts(),
-        [](const std::pair<const address, Account>& p) noexcept { return p.second.destructed; });
+    // Apply destructs, clear touched empty accounts and reset statuses for the next transaction.
+    finalize_accessed_accounts(state, rev);
 
     auto receipt = TransactionReceipt{tx.kind, result.status_code, gas_used, host.take_logs(), {}};
 
@@ -201,18 +231,237 @@ std::variant<TransactionReceipt, std::error_code> transition(
 
     return receipt;
 }
+}  // namespace
+
+bool State::is_erased(const address& addr) const noexcept
+{
+    return std::find(m_erased.begin(), m_erased.end(), addr) != m_erased.end();
+}
+
+const Account* State::peek_base(const address& addr) const
+{
+    return m_base != nullptr ? m_base->peek(addr) : m_backend->get_account(addr);
+}
+
+bytes32 State::peek_base_storage(const address& addr, const bytes32& key) const
+{
+    return m_base != nullptr ? m_base->peek_storage(addr, key) : m_backend->get_storage(addr, key);
+}
+
+const Account* State::peek(const address& addr) const
+{
+    if (const auto it = m_accounts.find(addr); it != m_accounts.end())
+        return &it->second;
+    if (!has_base() || is_erased(addr))
+        return nullptr;
+    return peek_base(addr);
+}
+
+bytes32 State::peek_storage(const address& addr, const bytes32& key) const
+{
+    if (const auto it = m_accounts.find(addr); it != m_accounts.end())
+    {
+        if (const auto slot = it->second.storage.find(key); slot != it->second.storage.end())
+            return slot->second.current;
+    }
+    if (!has_base() || is_erased(addr))
+        return {};
+    return peek_base_storage(addr, key);
+}
+
+void State::merge_base_storage(const address& addr, Account& acc) const
+{
+    for (auto upper = this; upper->has_base() && !upper->is_erased(addr);)
+    {
+        if (upper->m_backend != nullptr)
+        {
+            for (const auto& key : upper->m_backend->get_storage_keys(addr))
+            {
+                if (!acc.storage.contains(key))
+                {
+                    const auto value = upper->m_backend->get_storage(addr, key);
+                    acc.storage.insert({key, {value, value}});
+                }
+            }
+            break;
+        }
+
+        upper = upper->m_base;
+        if (const auto it = upper->m_accounts.find(addr); it != upper->m_accounts.end())
+        {
+            for (const auto& [key, slot] : it->second.storage)
+                acc.storage.try_emplace(key, slot);
+        }
+    }
+}
+
+void State::for_each_account(
+    const std::function<void(const address&, const Account&)>& visitor) const
+{
+    // The accounts visited or erased in the upper layers.
+    std::unordered_set<address> hidden;
+    for (auto layer = this; layer != nullptr; layer = layer->m_base)
+    {
+        for (const auto& [addr, acc] : layer->m_accounts)
+        {
+            if (!hidden.insert(addr).second)
+                continue;
+
+            if (!layer->has_base())
+            {
+                visitor(addr, acc);
+                continue;
+            }
+
+            auto merged = acc;
+            layer->merge_base_storage(addr, merged);
+            visitor(addr, merged);
+        }
+        hidden.insert(layer->m_erased.begin(), layer->m_erased.end());
+
+        if (layer->m_backend != nullptr)
+        {
+            layer->m_backend->for_each_address([&](const address& addr) {
+                if (hidden.contains(addr))
+                    return;
+                auto acc = *layer->m_backend->get_account(addr);
+                layer->merge_base_storage(addr, acc);
+                visitor(addr, acc);
+            });
+        }
+    }
+}
+
+Account* State::load(const address& addr)
+{
+    if (is_erased(addr))
+        return nullptr;
+
+    if (m_reads != nullptr)
+        m_reads->accounts.push_back(addr);
+
+    const auto base_acc_ptr = peek_base(addr);
+    if (base_acc_ptr == nullptr)
+        return nullptr;
+
+    // The storage is loaded lazily slot by slot. The statuses are not copied:
+    // the base state is in between transactions.
+    const auto& base_acc = *base_acc_ptr;
+    return &m_accounts
+                .insert({addr, {.nonce = base_acc.nonce,
+                                   .balance = base_acc.balance,
+                                   .code = base_acc.code}})
+                .first->second;
+}
 
-[[nodiscard]] bytes rlp_encode(const Log& log)
+StorageValue& State::load_storage(const address& addr, Account& acc, const bytes32& key)
 {
-    return rlp::encode_tuple(log.addr, log.topics, log.data);
+    const auto [it, inserted] = acc.storage.try_emplace(key);
+    if (!inserted)
+        return it->second;
+
+    if (m_reads != nullptr)
+        m_reads->storage.emplace_back(addr, key);
+
+    if (!is_erased(addr))
+    {
+        const auto value = peek_base_storage(addr, key);
+        it->second.current = value;
+        it->second.original = value;
+    }
+    return it->second;
+}
+
+void State::load_all_storage(const address& addr, Account& acc)
+{
+    if (!has_base())
+        return;
+
+    Account base_acc;
+    merge_base_storage(addr, base_acc);
+    for (const auto& [key, _] : base_acc.storage)
+        load_storage(addr, acc, key);
 }
 
-[[nodiscard]] bytes rlp_encode(const Transaction& tx)
+void State::commit()
+{
+    assert(m_backend != nullptr);
+    m_backend->commit(m_erased, m_accounts);
+    m_accounts.clear();
+    m_erased.clear();
+    m_accessed_accounts.clear();
+}
+
+void finalize(State& state, evmc_revision rev, const address& coinbase,
+    std::optional<uint64_t> block_reward, std::span<Withdrawal> withdrawals)
+{
+    if (block_reward.has_value())
+        state.touch(coinbase).balance += *block_reward;
+
+    finalize_accessed_accounts(state, rev);
+
+    for (const auto& withdrawal : withdrawals)
+        state.touch(withdrawal.recipient).balance += withdrawal.get_amount();
+}
+
+std::variant<TransactionReceipt, std::error_code> transition(
+    State& state, const BlockInfo& block, const Transaction& tx, evmc_revision rev, evmc::VM& vm)
+{
+    return execute_transaction(state, block, tx, rev, vm, nullptr);
+}
+
+std::variant<TransactionReceipt, std::error_code> transition_without_coinbase(State& state,
+    const BlockInfo& block, const Transaction& tx, evmc_revision rev, evmc::VM& vm,
+    intx::uint256& coinbase_fee)
+{
+    return execute_transaction(state, block, tx, rev, vm, &coinbase_fee);
+}
+
+std::variant<BlockResult, std::error_code> apply_block(State& state, const BlockInfo& block,
+    std::span<const Transaction> transactions, evmc_revision rev, evmc::VM& vm,
+    StatePrefetcher* prefetcher)
+{
+    /// The number of transactions the prefetch requests are issued ahead of the execution.
+    static constexpr size_t prefetch_distance = 4;
+    const auto prefetch = [&](size_t i) {
+        if (prefetcher != nullptr && i < transactions.size())
+            prefetcher->prefetch(collect_prefetch_request(block, transactions[i]));
+    };
+    for (size_t i = 0; i < prefetch_distance; ++i)
+        prefetch(i);
+
+    BlockResult result;
+    result.receipts.reserve(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i)
+    {
+        const auto& tx = transactions[i];
+        prefetch(i + prefetch_distance);
+
+        // The transaction must fit into the gas left in the block.
+        if (tx.gas_limit > block.gas_limit - result.gas_used)
+            return make_error_code(GAS_LIMIT_REACHED);
+
+        auto res = transition(state, block, tx, rev, vm);
+        if (holds_alternative<std::error_code>(res))
+            return get<std::error_code>(res);
+
+        auto& receipt = result.receipts.emplace_back(std::move(get<TransactionReceipt>(res)));
+        result.gas_used += receipt.gas_used;
+    }
+    return result;
+}
+
+void rlp_write(rlp::Writer& w, const Log& log)
+{
+    rlp::write_tuple(w, log.addr, log.topics, log.data);
+}
+
+void rlp_write(rlp::Writer& w, const Transaction& tx)
 {
     if (tx.kind == Transaction::Kind::legacy)
     {
         // rlp [nonce, gas_price, gas_limit, to, value, data, v, r, s];
-        return rlp::encode_tuple(tx.nonce, tx.max_gas_price, static_cast<uint64_t>(tx.gas_limit),
+        rlp::write_tuple(w, tx.nonce, tx.max_gas_price, static_cast<uint64_t>(tx.gas_limit),
             tx.to.has_value() ? tx.to.value() : bytes_view(), tx.value, tx.data, tx.v, tx.r, tx.s);
     }
     else if (tx.kind == Transaction::Kind::eip2930)
@@ -221,11 +470,11 @@ std::variant<TransactionReceipt, std::error_code> transition(
             throw std::invalid_argument("`v` value for eip2930 transaction must be 0 or 1");
         // tx_type +
         // rlp [nonce, gas_price, gas_limit, to, value, data, access_list, v, r, s];
-        return bytes{0x01} +  // Transaction type (eip2930 type == 1)
-               rlp::encode_tuple(tx.chain_id, tx.nonce, tx.max_gas_price,
-                   static_cast<uint64_t>(tx.gas_limit),
-                   tx.to.has_value() ? tx.to.value() : bytes_view(), tx.value, tx.data,
-                   tx.access_list, static_cast<bool>(tx.v), tx.r, tx.s);
+        static constexpr uint8_t tx_type = 0x01;  // Transaction type (eip2930 type == 1)
+        w.write(&tx_type, 1);
+        rlp::write_tuple(w, tx.chain_id, tx.nonce, tx.max_gas_price,
+            static_cast<uint64_t>(tx.gas_limit), tx.to.has_value() ? tx.to.value() : bytes_view(),
+            tx.value, tx.data, tx.access_list, static_cast<bool>(tx.v), tx.r, tx.s);
     }
     else
     {
@@ -234,20 +483,23 @@ std::variant<TransactionReceipt, std::error_code> transition(
         // tx_type +
         // rlp [chain_id, nonce, max_priority_fee_per_gas, max_fee_per_gas, gas_limit, to, value,
         // data, access_list, sig_parity, r, s];
-        return bytes{0x02} +  // Transaction type (eip1559 type == 2)
-               rlp::encode_tuple(tx.chain_id, tx.nonce, tx.max_priority_gas_price, tx.max_gas_price,
-                   static_cast<uint64_t>(tx.gas_limit),
-                   tx.to.has_value() ? tx.to.value() : bytes_view(), tx.value, tx.data,
-                   tx.access_list, static_cast<bool>(tx.v), tx.r, tx.s);
+        static constexpr uint8_t tx_type = 0x02;  // Transaction type (eip1559 type == 2)
+        w.write(&tx_type, 1);
+        rlp::write_tuple(w, tx.chain_id, tx.nonce, tx.max_priority_gas_price, tx.max_gas_price,
+            static_cast<uint64_t>(tx.gas_limit), tx.to.has_value() ? tx.to.value() : bytes_view(),
+            tx.value, tx.data, tx.access_list, static_cast<bool>(tx.v), tx.r, tx.s);
     }
 }
 
-[[nodiscard]] bytes rlp_encode(const TransactionReceipt& receipt)
+void rlp_write(rlp::Writer& w, const TransactionReceipt& receipt)
 {
-    const auto prefix = receipt.kind == Transaction::Kind::eip1559 ? bytes{0x02} : bytes{};
-    return prefix + rlp::encode_tuple(receipt.status == EVMC_SUCCESS,
-                        static_cast<uint64_t>(receipt.gas_used),
-                        bytes_view(receipt.logs_bloom_filter), receipt.logs);
+    if (receipt.kind == Transaction::Kind::eip1559)
+    {
+        static constexpr uint8_t tx_type = 0x02;
+        w.write(&tx_type, 1);
+    }
+    rlp::write_tuple(w, receipt.status == EVMC_SUCCESS, static_cast<uint64_t>(receipt.gas_used),
+        bytes_view(receipt.logs_bloom_filter), receipt.logs);
 }
 
 }  // namespace evmone::state
@@ -8,24 +8,110 @@
 #include "bloom_filter.hpp"
 #include "hash_utils.hpp"
 #include <cassert>
+#include <functional>
 #include <optional>
 #include <variant>
 #include <vector>
 
+namespace evmone::rlp
+{
+class Writer;
+}
+
 namespace evmone::state
 {
+class StateBackend;
+class StatePrefetcher;
+
+/// The record of the base state reads of an overlay State.
+struct StateReads
+{
+    /// The addresses of the accounts looked up in the base state, including the missing ones.
+    std::vector<address> accounts;
+
+    /// The storage slots looked up in the base state.
+    std::vector<std::pair<address, bytes32>> storage;
+};
+
 class State
 {
     std::unordered_map<address, Account> m_accounts;
 
+    /// The base state of an overlay: the accounts and the storage slots not present
+    /// in this state are loaded from the base on first access. Null for a standalone state.
+    /// The base state is only read and must not be modified while the overlay is in use.
+    const State* m_base = nullptr;
+
+    /// The persistent storage the accounts and the storage slots are loaded from
+    /// on first access, like from the base state of an overlay. Null if not used.
+    StateBackend* m_backend = nullptr;
+
+    /// The record of the base state reads. It is shared by all copies of the overlay
+    /// so the reads made by reverted calls are also recorded.
+    StateReads* m_reads = nullptr;
+
+    /// The accounts erased from the overlay. They must not be loaded from the base again.
+    std::vector<address> m_erased;
+
+    /// The addresses of the accounts accessed in the current transaction.
+    /// Only these accounts can be destructed, touched or have modified statuses,
+    /// so the end-of-transaction cleanup does not have to scan all accounts.
+    std::vector<address> m_accessed_accounts;
+
+    Account& mark_accessed(const address& addr, Account& acc)
+    {
+        if (!acc.accessed)
+        {
+            acc.accessed = true;
+            m_accessed_accounts.push_back(addr);
+        }
+        return acc;
+    }
+
+    /// Checks if the accounts missing in this state are loaded from the base state or the backend.
+    [[nodiscard]] bool has_base() const noexcept { return m_base != nullptr || m_backend != nullptr; }
+
+    /// Checks if the account has been erased from the overlay.
+    [[nodiscard]] bool is_erased(const address& addr) const noexcept;
+
+    /// Looks up the account in the base state or the backend.
+    [[nodiscard]] const Account* peek_base(const address& addr) const;
+
+    /// Looks up the storage slot value in the base state or the backend.
+    [[nodiscard]] bytes32 peek_base_storage(const address& addr, const bytes32& key) const;
+
+    /// Copies the account's storage slots missing in the account from the lower layers.
+    void merge_base_storage(const address& addr, Account& acc) const;
+
+    /// Loads the account from the base state into the overlay.
+    Account* load(const address& addr);
+
+    /// Loads the storage slot from the base state into the overlay.
+    StorageValue& load_storage(const address& addr, Account& acc, const bytes32& key);
+
 public:
+    State() = default;
+
+    /// Creates the overlay of the base state recording the base reads in the optional record.
+    explicit State(const State& base, StateReads* reads) noexcept : m_base{&base}, m_reads{reads}
+    {}
+
+    /// Creates the state lazily loaded from the backend. The modifications are kept in memory
+    /// until commit().
+    explicit State(StateBackend& backend) noexcept : m_backend{&backend} {}
+
+    /// Creates the copy-on-write child of this state in O(1).
+    /// The child records only the modifications and can be discarded cheaply.
+    /// This state must outlive the child and must not be modified while the child is in use.
+    [[nodiscard]] State fork() const noexcept { return State{*this, nullptr}; }
+
     /// Inserts the new account at the address.
     /// There must not exist any account under this address before.
     Account& insert(const address& addr, Account account = {})
     {
         const auto r = m_accounts.insert({addr, std::move(account)});
         assert(r.second);
-        return r.first->second;
+        return mark_accessed(addr, r.first->second);
     }
 
     /// Returns the pointer to the account at the address if the account exists. Null otherwise.
@@ -33,10 +119,28 @@ public:
     {
         const auto it = m_accounts.find(addr);
         if (it != m_accounts.end())
-            return &it->second;
+            return &mark_accessed(addr, it->second);
+        if (has_base())
+        {
+            if (const auto acc = load(addr); acc != nullptr)
+                return &mark_accessed(addr, *acc);
+        }
         return nullptr;
     }
 
+    /// Returns the pointer to the account at the address if the account exists. Null otherwise.
+    /// Unlike find() this does not load the account into an overlay nor record the access.
+    /// The storage of an account in an overlay may be incomplete, use peek_storage().
+    [[nodiscard]] const Account* peek(const address& addr) const;
+
+    /// Returns the current value of the storage slot, looking through the overlay layers.
+    [[nodiscard]] bytes32 peek_storage(const address& addr, const bytes32& key) const;
+
+    /// Calls the visitor for every account of the state, including the ones
+    /// in the base layers of an overlay. The accounts present in an overlay are passed
+    /// as temporary copies with the complete storage merged from the layers.
+    void for_each_account(const std::function<void(const address&, const Account&)>& visitor) const;
+
     /// Gets the account at the address (the account must exist).
     Account& get(const address& addr) noexcept
     {
@@ -61,9 +165,56 @@ public:
         return acc;
     }
 
+    /// Erases the account at the address.
+    void erase(const address& addr)
+    {
+        m_accounts.erase(addr);
+        if (has_base())
+            m_erased.push_back(addr);
+    }
+
+    /// Returns the pointer to the account's storage slot if the slot exists. Null otherwise.
+    /// In an overlay the slot is loaded from the base state (always "exists").
+    StorageValue* find_storage(const address& addr, Account& acc, const bytes32& key)
+    {
+        if (has_base())
+            return &load_storage(addr, acc, key);
+        const auto it = acc.storage.find(key);
+        return it != acc.storage.end() ? &it->second : nullptr;
+    }
+
+    /// Gets an existing account's storage slot or inserts new empty one.
+    StorageValue& get_storage(const address& addr, Account& acc, const bytes32& key)
+    {
+        if (has_base())
+            return load_storage(addr, acc, key);
+        return acc.storage[key];
+    }
+
+    /// Loads all the account's storage slots from the base state into the overlay.
+    /// Does nothing for a standalone state.
+    void load_all_storage(const address& addr, Account& acc);
+
+    /// Writes the modifications to the backend and releases the loaded accounts.
+    /// Must be called in between transactions, e.g. after the block is finalized.
+    void commit();
+
+    /// Returns the addresses of the base state accounts erased from the overlay.
+    [[nodiscard]] const auto& get_erased_accounts() const noexcept { return m_erased; }
+
     [[nodiscard]] auto& get_accounts() noexcept { return m_accounts; }
 
     [[nodiscard]] const auto& get_accounts() const noexcept { return m_accounts; }
+
+    /// Returns the addresses of the accounts accessed since the last clear_accessed_accounts().
+    [[nodiscard]] const auto& get_accessed_accounts() const noexcept
+    {
+        return m_accessed_accounts;
+    }
+
+    /// Clears the list of the accessed accounts. The accounts' accessed flags must be reset
+    /// by the caller.
+    void clear_accessed_accounts() noexcept { m_accessed_accounts.clear(); }
 };
 
 struct Withdrawal
@@ -113,7 +264,10 @@ struct Transaction
     uint64_t nonce = 0;
     intx::uint256 r;
     intx::uint256 s;
-    uint8_t v = 0;
+
+    /// The signature's v: the y-parity of the typed transactions, 27 or 28 of the legacy ones,
+    /// or chain_id * 2 + 35 + y-parity of the EIP-155 ones.
+    uint64_t v = 0;
 };
 
 struct Log
@@ -142,13 +296,42 @@ void finalize(State& state, evmc_revision rev, const address& coinbase,
 [[nodiscard]] std::variant<TransactionReceipt, std::error_code> transition(
     State& state, const BlockInfo& block, const Transaction& tx, evmc_revision rev, evmc::VM& vm);
 
+/// Executes the transaction like transition() but without accessing the coinbase account:
+/// the coinbase is not warmed up (EIP-3651) and the priority fee is stored in the coinbase_fee
+/// instead of being credited. The caller is responsible for applying both.
+[[nodiscard]] std::variant<TransactionReceipt, std::error_code> transition_without_coinbase(
+    State& state, const BlockInfo& block, const Transaction& tx, evmc_revision rev, evmc::VM& vm,
+    intx::uint256& coinbase_fee);
+
+/// The result of applying the block's transactions.
+struct BlockResult
+{
+    std::vector<TransactionReceipt> receipts;
+
+    /// The cumulative gas used by all the transactions.
+    int64_t gas_used = 0;
+};
+
+/// Applies the block's transactions to the state.
+///
+/// Each transaction only visits the accounts it has accessed to clean up the state,
+/// so the cost of a block does not grow with the state size.
+/// In case of an invalid transaction the error is returned and the state is left
+/// with the effects of the preceding transactions. The block is finalized with finalize().
+///
+/// If the prefetcher is provided, the state accessed by a transaction is requested
+/// a few transactions ahead of its execution.
+[[nodiscard]] std::variant<BlockResult, std::error_code> apply_block(State& state,
+    const BlockInfo& block, std::span<const Transaction> transactions, evmc_revision rev,
+    evmc::VM& vm, StatePrefetcher* prefetcher = nullptr);
+
 /// Defines how to RLP-encode a Transaction.
-[[nodiscard]] bytes rlp_encode(const Transaction& tx);
+void rlp_write(rlp::Writer& w, const Transaction& tx);
 
 /// Defines how to RLP-encode a TransactionReceipt.
-[[nodiscard]] bytes rlp_encode(const TransactionReceipt& receipt);
+void rlp_write(rlp::Writer& w, const TransactionReceipt& receipt);
 
 /// Defines how to RLP-encode a Log.
-[[nodiscard]] bytes rlp_encode(const Log& log);
+void rlp_write(rlp::Writer& w, const Log& log);
 
 }  // namespace evmone::state
@@ -0,0 +1,38 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "account.hpp"
+#include <functional>
+#include <span>
+
+namespace evmone::state
+{
+/// The persistent storage of the accounts the State loads them from on first access.
+class StateBackend
+{
+public:
+    virtual ~StateBackend() = default;
+
+    /// Returns the account without its storage or null if the account does not exist.
+    /// The account stays valid until the next commit().
+    /// Must be safe to call concurrently with the other const methods.
+    [[nodiscard]] virtual const Account* get_account(const address& addr) const = 0;
+
+    /// Returns the value of the storage slot, zero if the slot is not set.
+    [[nodiscard]] virtual bytes32 get_storage(const address& addr, const bytes32& key) const = 0;
+
+    /// Returns the keys of all non-zero storage slots of the account.
+    [[nodiscard]] virtual std::vector<bytes32> get_storage_keys(const address& addr) const = 0;
+
+    /// Calls the visitor for the address of every account.
+    virtual void for_each_address(const std::function<void(const address&)>& visitor) const = 0;
+
+    /// Durably stores the modifications: first erases the accounts together with their storage,
+    /// then writes the accounts and the storage slots (zero values delete the slots).
+    virtual void commit(std::span<const address> erased,
+        const std::unordered_map<address, Account>& accounts) = 0;
+};
+}  // namespace evmone::state
@@ -23,9 +23,10 @@ void run_state_test(const StateTransitionTest& test, evmc::VM& vm)
 
             const auto& expected = cases[case_index];
             const auto tx = test.multi_tx.get(expected.indexes);
-            auto state = test.pre_state;
+            // The pre-state is shared by all the cases, each case only records its modifications.
+            auto state = test.pre_state.fork();
 
-            validate_deployed_code(state, rev);
+            validate_deployed_code(test.pre_state, rev);
 
             const auto res = state::transition(state, test.block, tx, rev, vm);
 
@@ -37,7 +38,7 @@ void run_state_test(const StateTransitionTest& test, evmc::VM& vm)
             else
                 EXPECT_TRUE(expected.exception);
 
-            EXPECT_EQ(state::mpt_hash(state.get_accounts()), expected.state_hash);
+            EXPECT_EQ(state::mpt_hash(state), expected.state_hash);
         }
     }
 }
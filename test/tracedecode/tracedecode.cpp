@@ -0,0 +1,35 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+/// Converts the binary trace (see the "trace_binary" VM option) to the JSON trace format.
+
+#include <evmone/tracing.hpp>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+int main(int argc, const char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <binary trace file>\n";
+        return 2;
+    }
+
+    std::ifstream in{argv[1], std::ios::binary};
+    if (!in)
+    {
+        std::cerr << "Cannot open " << argv[1] << "\n";
+        return 1;
+    }
+
+    const std::basic_string<uint8_t> trace{
+        std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    if (!evmone::convert_binary_trace(trace, std::cout))
+    {
+        std::cerr << "Invalid or truncated trace\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,202 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test/utils/bytecode.hpp"
+#include <ethash/keccak.hpp>
+#include <evmc/evmc.hpp>
+#include <evmc/mocked_host.hpp>
+#include <evmone/evmone.h>
+#include <evmone/vm.hpp>
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace
+{
+class contract_stats : public testing::Test
+{
+private:
+    evmc::VM m_baseline_vm{evmc_create_evmone()};
+
+protected:
+    evmone::VM& vm{*static_cast<evmone::VM*>(m_baseline_vm.get_raw_pointer())};
+
+    evmc::Result execute(bytes_view code, int64_t gas = 1000000, int32_t depth = 0)
+    {
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.depth = depth;
+        msg.gas = gas;
+        return execute(host, msg, code);
+    }
+
+    evmc::Result execute(evmc::MockedHost& host, const evmc_message& msg, bytes_view code)
+    {
+        return m_baseline_vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size());
+    }
+};
+
+evmc::bytes32 code_hash(bytes_view code)
+{
+    const auto h = ethash::keccak256(code.data(), code.size());
+    evmc::bytes32 r;
+    std::copy(std::begin(h.bytes), std::end(h.bytes), r.bytes);
+    return r;
+}
+}  // namespace
+
+TEST_F(contract_stats, disabled_by_default)
+{
+    EXPECT_EQ(vm.get_contract_stats(), nullptr);
+    execute(push(1));
+    EXPECT_EQ(vm.get_contract_stats(), nullptr);
+}
+
+TEST_F(contract_stats, set_option)
+{
+    auto& c_vm = static_cast<evmc_vm&>(vm);
+    EXPECT_EQ(c_vm.set_option(&c_vm, "stats", ""), EVMC_SET_OPTION_SUCCESS);
+    ASSERT_NE(vm.get_contract_stats(), nullptr);
+}
+
+TEST_F(contract_stats, record)
+{
+    vm.enable_contract_stats();
+    auto& registry = *vm.get_contract_stats();
+
+    const auto code_a = mstore8(0x3f, 1);  // Expands the memory to 64 bytes.
+    const auto code_b = bytecode{OP_INVALID};
+
+    EXPECT_EQ(execute(code_a, 1000, 0).gas_left, 1000 - 15);
+    EXPECT_EQ(execute(code_a, 1000, 3).gas_left, 1000 - 15);
+    EXPECT_EQ(execute(code_b, 100, 1).gas_left, 0);
+
+    const auto stats = registry.snapshot();
+    ASSERT_EQ(stats.size(), 2u);
+
+    const auto& a = stats.at(code_hash(code_a));
+    EXPECT_EQ(a.calls, 2u);
+    EXPECT_EQ(a.gas_used, 2 * 15);
+    EXPECT_EQ(a.max_depth, 3);
+    EXPECT_EQ(a.max_memory_size, 64u);
+    EXPECT_LE(a.self_time, a.time);
+
+    const auto& b = stats.at(code_hash(code_b));
+    EXPECT_EQ(b.calls, 1u);
+    EXPECT_EQ(b.gas_used, 100);
+    EXPECT_EQ(b.max_depth, 1);
+    EXPECT_EQ(b.max_memory_size, 0u);
+}
+
+TEST_F(contract_stats, snapshot_and_reset)
+{
+    vm.enable_contract_stats();
+    auto& registry = *vm.get_contract_stats();
+
+    execute(push(1));
+    EXPECT_EQ(registry.snapshot().size(), 1u);
+    EXPECT_EQ(registry.snapshot(true).size(), 1u);
+    EXPECT_TRUE(registry.snapshot().empty());
+
+    execute(push(1));
+    registry.reset();
+    EXPECT_TRUE(registry.snapshot().empty());
+}
+
+TEST_F(contract_stats, memory_counters)
+{
+    vm.enable_contract_stats();
+    auto& registry = *vm.get_contract_stats();
+
+    const auto code = mstore8(0x3f, 1) + ret(0, 0x20);
+    execute(code);
+
+    const auto& memory = registry.snapshot().at(code_hash(code)).memory;
+    if (!EVMONE_MEMORY_COUNTERS)
+    {
+        EXPECT_EQ(memory.memory_grows, 0u);
+        EXPECT_EQ(memory.bytes_copied, 0u);
+        return;
+    }
+    EXPECT_EQ(memory.memory_grows, 1u);
+    EXPECT_EQ(memory.memory_reallocs, 0u);  // The initial allocation is done before execution.
+    EXPECT_EQ(memory.bytes_zeroed, 64u);
+    EXPECT_EQ(memory.return_data_allocs, 0u);
+    EXPECT_EQ(memory.output_allocs, 1u);
+    EXPECT_EQ(memory.bytes_copied, 32u);
+}
+
+TEST_F(contract_stats, code_hash_from_host)
+{
+    vm.enable_contract_stats();
+    auto& registry = *vm.get_contract_stats();
+
+    const auto code = push(1);
+    const auto host_code_hash = evmc::bytes32{0xc0de};
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000;
+    msg.code_address = evmc::address{0xc0de};
+    host.accounts[msg.code_address].codehash = host_code_hash;
+
+    // The call takes the code hash of the code address from the host.
+    execute(host, msg, code);
+    // The code of the create execution is hashed.
+    msg.kind = EVMC_CREATE;
+    execute(host, msg, code);
+
+    const auto stats = registry.snapshot();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats.at(host_code_hash).calls, 1u);
+    EXPECT_EQ(stats.at(code_hash(code)).calls, 1u);
+}
+
+TEST_F(contract_stats, advanced)
+{
+    evmc::VM advanced_vm{evmc_create_evmone(), {{"advanced", ""}, {"stats", ""}}};
+    auto& registry =
+        *static_cast<evmone::VM*>(advanced_vm.get_raw_pointer())->get_contract_stats();
+
+    const auto code = mstore8(0x3f, 1);
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.depth = 2;
+    msg.gas = 1000;
+    EXPECT_EQ(advanced_vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size()).gas_left,
+        1000 - 15);
+
+    const auto& stats = registry.snapshot().at(code_hash(code));
+    EXPECT_EQ(stats.calls, 1u);
+    EXPECT_EQ(stats.gas_used, 15);
+    EXPECT_EQ(stats.max_depth, 2);
+    EXPECT_EQ(stats.max_memory_size, 64u);
+}
+
+TEST_F(contract_stats, concurrent_executions)
+{
+    vm.enable_contract_stats();
+    auto& registry = *vm.get_contract_stats();
+
+    static constexpr int num_threads = 4;
+    static constexpr int num_executions = 100;
+    const auto code = push(1);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < num_executions; ++i)
+                execute(code, 1000, t);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    // The statistics of all the threads are merged.
+    const auto stats = registry.snapshot(true);
+    ASSERT_EQ(stats.size(), 1u);
+    const auto& s = stats.at(code_hash(code));
+    EXPECT_EQ(s.calls, uint64_t{num_threads * num_executions});
+    EXPECT_EQ(s.gas_used, num_threads * num_executions * 3);
+    EXPECT_EQ(s.max_depth, num_threads - 1);
+    EXPECT_TRUE(registry.snapshot().empty());
+}
@@ -7,6 +7,8 @@
 #include <evmone/vm.hpp>
 #include <gtest/gtest.h>
 
+using namespace evmc::literals;
+
 TEST(evmone, info)
 {
     auto vm = evmc::VM{evmc_create_evmone()};
@@ -53,3 +55,73 @@ TEST(evmone, set_option_cgoto)
     EXPECT_EQ(vm.set_option("cgoto", "no"), EVMC_SET_OPTION_INVALID_NAME);
 #endif
 }
+
+TEST(evmone, set_option_profile)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    EXPECT_EQ(vm.set_option("profile", "0"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(vm.set_option("profile", "x"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(vm.set_option("profile", "10x"), EVMC_SET_OPTION_INVALID_VALUE);
+    const auto& evmone_vm = *static_cast<evmone::VM*>(vm.get_raw_pointer());
+    EXPECT_EQ(evmone_vm.get_tracer(), nullptr);
+    EXPECT_EQ(vm.set_option("profile", "100"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_NE(evmone_vm.get_tracer(), nullptr);
+}
+
+TEST(evmone, set_option_trace_filter)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    const auto& filter = static_cast<evmone::VM*>(vm.get_raw_pointer())->tracer_filter;
+
+    EXPECT_EQ(vm.set_option("trace_address", "0xc0dx"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(vm.set_option("trace_address", "0xc0de"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_EQ(filter.code_address, 0xc0de_address);
+
+    EXPECT_EQ(vm.set_option("trace_code_hash", "0x"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_EQ(filter.code_hash, evmc::bytes32{});
+
+    EXPECT_EQ(vm.set_option("trace_depth", "x"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(vm.set_option("trace_depth", "2-1"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(vm.set_option("trace_depth", "1"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_EQ(filter.min_depth, 1);
+    EXPECT_EQ(filter.max_depth, 1);
+    EXPECT_EQ(vm.set_option("trace_depth", "1-3"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_EQ(filter.max_depth, 3);
+    EXPECT_EQ(vm.set_option("trace_depth", "2-"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_EQ(filter.min_depth, 2);
+    EXPECT_EQ(filter.max_depth, std::numeric_limits<int32_t>::max());
+
+    EXPECT_EQ(vm.set_option("trace_min_gas", "-"), EVMC_SET_OPTION_INVALID_VALUE);
+    EXPECT_EQ(vm.set_option("trace_min_gas", "100000"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_EQ(filter.min_gas, 100000);
+}
+
+TEST(evmone, set_option_histogram)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    EXPECT_EQ(vm.set_option("histogram", "x"), EVMC_SET_OPTION_INVALID_VALUE);
+    const auto& evmone_vm = *static_cast<evmone::VM*>(vm.get_raw_pointer());
+    EXPECT_EQ(evmone_vm.get_tracer(), nullptr);
+    EXPECT_EQ(vm.set_option("histogram", "pairs"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_NE(evmone_vm.get_tracer(), nullptr);
+}
+
+TEST(evmone, set_option_storage)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    EXPECT_EQ(vm.set_option("storage", "x"), EVMC_SET_OPTION_INVALID_VALUE);
+    const auto& evmone_vm = *static_cast<evmone::VM*>(vm.get_raw_pointer());
+    EXPECT_EQ(evmone_vm.get_tracer(), nullptr);
+    EXPECT_EQ(vm.set_option("storage", "10"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_NE(evmone_vm.get_tracer(), nullptr);
+}
+
+TEST(evmone, set_option_calltree)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    EXPECT_EQ(vm.set_option("calltree", "x"), EVMC_SET_OPTION_INVALID_VALUE);
+    const auto& evmone_vm = *static_cast<evmone::VM*>(vm.get_raw_pointer());
+    EXPECT_EQ(evmone_vm.get_tracer(), nullptr);
+    EXPECT_EQ(vm.set_option("calltree", "json"), EVMC_SET_OPTION_SUCCESS);
+    EXPECT_NE(evmone_vm.get_tracer(), nullptr);
+}
@@ -0,0 +1,88 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmone/perf_map.hpp>
+#include <evmone/vm.hpp>
+#include <gmock/gmock.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace evmone::perf;
+using namespace testing;
+
+TEST(perf_map, opcode_handler_ranges)
+{
+    const auto ranges = get_opcode_handler_ranges();
+    if (!EVMONE_CGOTO_SUPPORTED)
+    {
+        EXPECT_TRUE(ranges.empty());
+        return;
+    }
+
+    // All the defined instructions and the handler of the undefined ones.
+    ASSERT_GT(ranges.size(), 100u);
+    EXPECT_EQ(std::count_if(ranges.begin(), ranges.end(),
+                  [](const auto& r) { return r.name == "evmone::baseline::ADD"; }),
+        1);
+    EXPECT_EQ(std::count_if(ranges.begin(), ranges.end(),
+                  [](const auto& r) { return r.name == "evmone::baseline::UNDEFINED"; }),
+        1);
+
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        EXPECT_GT(ranges[i].size, 0u);
+        if (i + 1 < ranges.size())
+        {
+            EXPECT_EQ(static_cast<const uint8_t*>(ranges[i].address) + ranges[i].size,
+                ranges[i + 1].address);
+        }
+    }
+}
+
+TEST(perf_map, write_perf_map)
+{
+    const auto path = (std::filesystem::temp_directory_path() / "evmone_test_perf.map").string();
+    std::filesystem::remove(path);
+
+    const uint8_t code[8]{};
+    ASSERT_TRUE(write_perf_map(path, {{&code[0], 4, "a"}, {&code[4], 4, "b"}}));
+    ASSERT_TRUE(write_perf_map(path, {{&code[0], 16, "c"}}));  // Appends.
+
+    std::stringstream expected;
+    expected << std::hex << reinterpret_cast<uintptr_t>(&code[0]) << " 4 a\n"
+             << reinterpret_cast<uintptr_t>(&code[4]) << " 4 b\n"
+             << reinterpret_cast<uintptr_t>(&code[0]) << " 10 c\n";
+    std::stringstream content;
+    content << std::ifstream{path}.rdbuf();
+    EXPECT_EQ(content.str(), expected.str());
+    std::filesystem::remove(path);
+}
+
+TEST(perf_map, write_jitdump)
+{
+#ifdef __linux__
+    const auto path = (std::filesystem::temp_directory_path() / "evmone_test_jit.dump").string();
+    const uint8_t code[]{0xaa, 0xbb, 0xcc};
+    ASSERT_TRUE(write_jitdump(path, {{&code[0], 3, "xyz"}}));
+
+    std::stringstream content;
+    content << std::ifstream{path, std::ios::binary}.rdbuf();
+    const auto dump = content.str();
+    std::filesystem::remove(path);
+
+    // The file header (40 bytes), the code load record (56 bytes), the name and the code.
+    ASSERT_EQ(dump.size(), 40u + 56 + 4 + 3);
+    uint32_t magic = 0;
+    std::memcpy(&magic, dump.data(), sizeof(magic));
+    EXPECT_EQ(magic, 0x4A695444u);
+    uint32_t record_size = 0;
+    std::memcpy(&record_size, dump.data() + 44, sizeof(record_size));
+    EXPECT_EQ(record_size, 56u + 4 + 3);
+    EXPECT_EQ(dump.substr(40 + 56), std::string("xyz\0\xaa\xbb\xcc", 7));
+#else
+    EXPECT_FALSE(write_jitdump({}, {}));
+#endif
+}
@@ -0,0 +1,147 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "precompiles_fixture.hpp"
+#include <evmc/hex.hpp>
+#include <evmone_precompiles/blake2b.hpp>
+#include <gtest/gtest.h>
+#include <test/state/precompiles.hpp>
+#include <test/utils/utils.hpp>
+
+using namespace evmone;
+
+namespace
+{
+/// The input of the EIP-152 test vectors: the BLAKE2b-512 state for the "abc" message
+/// without the number of rounds and the final block flag.
+const auto abc_input =
+    "48c9bdf267e6096a3ba7ca8485ae67bb2bf894fe72f36e3cf1361d5f3af54fa5"
+    "d182e6ad7f520e511f6c3e2b8c68059b6bbd41fbabd9831f79217e1319cde05b"
+    "6162630000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "03000000000000000000000000000000"_hex;
+
+evmc::Result call_blake2bf(const bytes& input, int64_t gas = 1'000'000)
+{
+    evmc_message msg{};
+    msg.code_address = evmc::address{0x09};
+    msg.input_data = input.data();
+    msg.input_size = input.size();
+    msg.gas = gas;
+    auto res = state::call_precompile(EVMC_CANCUN, msg);
+    EXPECT_TRUE(res.has_value());
+    return std::move(*res);
+}
+
+/// The BLAKE2b compression functions tested.
+struct Blake2bKernels
+{
+    using CompressFn = crypto::internal::Blake2bCompressFn;
+    static constexpr auto generic = crypto::internal::blake2b_compress_generic;
+    static constexpr auto get_accelerated = crypto::internal::get_blake2b_compress_avx2;
+    static constexpr auto accelerated_name = "avx2";
+    static constexpr auto cpu_feature = "AVX2";
+};
+
+uint64_t load_le64(const uint8_t* p) noexcept
+{
+    uint64_t r = 0;
+    for (size_t i = 0; i < 8; ++i)
+        r |= uint64_t{p[i]} << (i * 8);
+    return r;
+}
+
+class blake2b_kernel : public test::precompile_kernel<Blake2bKernels>
+{
+protected:
+    /// Applies the kernel to the EIP-152 input (the big-endian rounds, the abc_input
+    /// and the final block flag) and returns the hex of the resulting state.
+    std::string blake2bf_hex(const bytes& rounds, bool last) const
+    {
+        const auto input = rounds + abc_input;
+        uint64_t h[8];
+        uint64_t m[16];
+        uint64_t t[2];
+        for (size_t i = 0; i < 8; ++i)
+            h[i] = load_le64(&input[4 + i * 8]);
+        for (size_t i = 0; i < 16; ++i)
+            m[i] = load_le64(&input[68 + i * 8]);
+        for (size_t i = 0; i < 2; ++i)
+            t[i] = load_le64(&input[196 + i * 8]);
+        const auto num_rounds = (uint32_t{input[0]} << 24) | (uint32_t{input[1]} << 16) |
+                                (uint32_t{input[2]} << 8) | uint32_t{input[3]};
+
+        compress(num_rounds, h, m, t, last);
+
+        bytes out(64, 0);
+        for (size_t i = 0; i < 8; ++i)
+        {
+            for (size_t j = 0; j < 8; ++j)
+                out[i * 8 + j] = static_cast<uint8_t>(h[i] >> (j * 8));
+        }
+        return evmc::hex(out);
+    }
+};
+}  // namespace
+
+INSTANTIATE_TEST_SUITE_P(blake2b, blake2b_kernel,
+    testing::Values(test::Kernel::generic, test::Kernel::accelerated), blake2b_kernel::kernel_name);
+
+TEST_P(blake2b_kernel, compress)
+{
+    // The BLAKE2b-512 hash of "abc": the single block compression with 12 rounds.
+    uint64_t h[8]{0x6a09e667f3bcc908 ^ 0x01010040, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b,
+        0xa54ff53a5f1d36f1, 0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b,
+        0x5be0cd19137e2179};
+    const uint64_t m[16]{0x636261};
+    const uint64_t t[2]{3, 0};
+    compress(12, h, m, t, true);
+    EXPECT_EQ(h[0], 0x0d4d1c983fa580bau);
+    EXPECT_EQ(h[7], 0x239900d4ed8623b9u);
+}
+
+TEST_P(blake2b_kernel, eip152_vectors)
+{
+    EXPECT_EQ(blake2bf_hex("00000000"_hex, true),
+        "08c9bcf367e6096a3ba7ca8485ae67bb2bf894fe72f36e3cf1361d5f3af54fa5"
+        "d282e6ad7f520e511f6c3e2b8c68059b9442be0454267ce079217e1319cde05b");
+    EXPECT_EQ(blake2bf_hex("0000000c"_hex, true),
+        "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+        "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923");
+    EXPECT_EQ(blake2bf_hex("0000000c"_hex, false),
+        "75ab69d3190a562c51aef8d88f1c2775876944407270c42c9844252c26d28752"
+        "98743e7f6d5ea2f2d3e8d226039cd31b4e426ac4f2d3d666a610c2116fde4735");
+    EXPECT_EQ(blake2bf_hex("00000001"_hex, true),
+        "b63a380cb2897d521994a85234ee2c181b5f844d2c624c002677e9703449d2fb"
+        "a551b3a8333bcdf5f2f7e08993d53923de3d64fcc68c034e717b9293fed7a421");
+}
+
+TEST_P(blake2b_kernel, rounds_over_10)
+{
+    // The message permutations repeat every 10 rounds.
+    EXPECT_EQ(blake2bf_hex("00000064"_hex, true),
+        "8136972eb0cc05f3df5ec98ac64b7e9557bad14711f15fde8f42834cf6bbab48"
+        "1b81b1b3c0bd703f65694e763975d05c55c731bfa1afdd3a118dcbf4ef7c2845");
+}
+
+TEST(blake2b, precompile)
+{
+    const auto res = call_blake2bf("0000000c"_hex + abc_input + "01"_hex);
+    EXPECT_EQ(res.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(evmc::hex({res.output_data, res.output_size}),
+        "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+        "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923");
+}
+
+TEST(blake2b, precompile_invalid_input)
+{
+    // The final block flag other than 0 or 1.
+    EXPECT_EQ(call_blake2bf("0000000c"_hex + abc_input + "02"_hex).status_code,
+        EVMC_PRECOMPILE_FAILURE);
+
+    // The input size other than 213 bytes is not affordable.
+    EXPECT_EQ(call_blake2bf("0000000c"_hex + abc_input).status_code, EVMC_OUT_OF_GAS);
+}
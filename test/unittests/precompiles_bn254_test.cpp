@@ -0,0 +1,183 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmc/hex.hpp>
+#include <evmone_precompiles/bn254.hpp>
+#include <gtest/gtest.h>
+#include <test/state/precompiles.hpp>
+#include <test/utils/utils.hpp>
+
+using namespace evmone;
+
+namespace
+{
+// The test vectors generated with py_ecc.
+const auto G1 =
+    "0000000000000000000000000000000000000000000000000000000000000001"
+    "0000000000000000000000000000000000000000000000000000000000000002"_hex;
+const auto G1_neg =
+    "0000000000000000000000000000000000000000000000000000000000000001"
+    "30644e72e131a029b85045b68181585d97816a916871ca8d3c208c16d87cfd45"_hex;
+const auto G2 =
+    "198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c2"
+    "1800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed"
+    "090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b"
+    "12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa"_hex;
+const auto P =
+    "1936f7b07be20ac4b7faac53aba252c44112b369f437c12d75b8157882b390aa"
+    "055c38c27b1dc7fbbdfbb7b4795e92d0d838126c25b6771908f9a23c35c8921a"_hex;
+const auto Q =
+    "0c6378a07fa51d94ac9bc123c54082101dc408e01c11095c1398118a58539063"
+    "1caac57bf354370552e63f735af873b026ba610b517e46ab45df26c2dd21ac00"_hex;
+const auto Zero64 = bytes(64, 0);
+const auto Zero128 = bytes(128, 0);
+
+evmc::Result call(uint8_t id, const bytes& input)
+{
+    evmc_message msg{};
+    msg.code_address = evmc::address{id};
+    msg.input_data = input.data();
+    msg.input_size = input.size();
+    msg.gas = 10'000'000;
+    auto res = state::call_precompile(EVMC_CANCUN, msg);
+    EXPECT_TRUE(res.has_value());
+    return std::move(*res);
+}
+
+std::string output_hex(const evmc::Result& res)
+{
+    EXPECT_EQ(res.status_code, EVMC_SUCCESS);
+    return evmc::hex({res.output_data, res.output_size});
+}
+}  // namespace
+
+TEST(bn254, ecadd)
+{
+    EXPECT_EQ(output_hex(call(0x06, P + Q)),
+        "2f8541d66f60e2b04d999ad3b3ab201e6246d33561881993af8c7db1927d7dbb"
+        "0abf55af96dff94fce2152d908f92e5823467c3e0e9878a56917c433fbcb0219");
+
+    // Doubling.
+    EXPECT_EQ(output_hex(call(0x06, P + P)),
+        "2d4623ee8fd42306acd535df8799acbd7698fb34b215e8be4e740240a90c2bbd"
+        "08f071efd1f4d4f4ec79c8ae283a3f7e24bedc53e6573b9c4128eaf0c798ac92");
+
+    // The point at infinity.
+    EXPECT_EQ(output_hex(call(0x06, P + Zero64)), evmc::hex(P));
+    EXPECT_EQ(output_hex(call(0x06, Zero64 + Q)), evmc::hex(Q));
+    EXPECT_EQ(output_hex(call(0x06, G1 + G1_neg)), evmc::hex(Zero64));
+
+    // The missing input bytes are zeros.
+    EXPECT_EQ(output_hex(call(0x06, {})), evmc::hex(Zero64));
+    EXPECT_EQ(output_hex(call(0x06, G1)), evmc::hex(G1));
+}
+
+TEST(bn254, ecadd_invalid)
+{
+    // Not on the curve.
+    auto bad = G1;
+    bad[63] = 3;
+    EXPECT_EQ(call(0x06, bad + G1).status_code, EVMC_PRECOMPILE_FAILURE);
+    EXPECT_EQ(call(0x06, G1 + bad).status_code, EVMC_PRECOMPILE_FAILURE);
+
+    // The coordinate not less than p: the y of -G1 plus p.
+    const auto y_plus_p =
+        "0000000000000000000000000000000000000000000000000000000000000001"
+        "60c89ce5c263405370a08b6d0302b0bb2f02d522d0e3951a7841182db0f9fa8c"_hex;
+    EXPECT_EQ(call(0x06, y_plus_p + G1).status_code, EVMC_PRECOMPILE_FAILURE);
+}
+
+TEST(bn254, ecmul)
+{
+    const auto k = "e8c1c58a3ad2ab5c8e8b5d7a1b9f8e4c3a2b1d0e9f8a7b6c5d4e3f2a1b0c9d8e"_hex;
+    EXPECT_EQ(output_hex(call(0x07, P + k)),
+        "2fe09f29130e933f55308b0c7bdf74b068f8969ed4e0525dffb27f76c7a31a72"
+        "20246f8db07f70e50b0ca482921c2c339fb5a4bcac0fb3bdf9e26ad8cea102f4");
+
+    // (r - 1)·P = -P.
+    const auto r_minus_1 = "30644e72e131a029b85045b68181585d2833e84879b9709143e1f593f0000000"_hex;
+    EXPECT_EQ(output_hex(call(0x07, P + r_minus_1)),
+        "1936f7b07be20ac4b7faac53aba252c44112b369f437c12d75b8157882b390aa"
+        "2b0815b06613d82dfa548e020822c58cbf49582542bb53743326e9daa2b46b2d");
+
+    // r·P, 0·P and k·0 are the point at infinity.
+    const auto r = "30644e72e131a029b85045b68181585d2833e84879b9709143e1f593f0000001"_hex;
+    EXPECT_EQ(output_hex(call(0x07, P + r)), evmc::hex(Zero64));
+    EXPECT_EQ(output_hex(call(0x07, P)), evmc::hex(Zero64));
+    EXPECT_EQ(output_hex(call(0x07, Zero64 + k)), evmc::hex(Zero64));
+
+    // The scalar bigger than r, 1·P.
+    const auto r_plus_1 = "30644e72e131a029b85045b68181585d2833e84879b9709143e1f593f0000002"_hex;
+    EXPECT_EQ(output_hex(call(0x07, P + r_plus_1)), evmc::hex(P));
+
+    auto bad = P;
+    bad[0] ^= 1;
+    EXPECT_EQ(call(0x07, bad + k).status_code, EVMC_PRECOMPILE_FAILURE);
+}
+
+TEST(bn254, ecpairing)
+{
+    static constexpr auto one =
+        "0000000000000000000000000000000000000000000000000000000000000001";
+    static constexpr auto zero =
+        "0000000000000000000000000000000000000000000000000000000000000000";
+
+    // e(a·G1, c·G2) · e(-ac·G1, G2) = 1.
+    const auto aG1 =
+        "0ba173a9155665e0f39b925d3118c2e68a63e5da3563e34603ffc5eb3e638584"
+        "0aaaec7094034f7386ae9046767b098d7fe39ec072143e2721fb094c527caa35"_hex;
+    const auto cG2 =
+        "1f070c201c9b6ed3c406bde5962b6b2bb66da0acd291bc17dadc3d6f9e8d75fa"
+        "0c01147cdd4828a63b6616e4b3986ef1dead9a8a41b66a4ff38b3f35e45c2ec8"
+        "08cf85a8c9e25c9862496a2aef7bc729e0caa043d1dce1994e70112cf8bf80ec"
+        "1a55c9c15c0ca13e7b0c83bc5c39c6fac3b0006432b1a124d92545f19da9abdf"_hex;
+    const auto ac_neg_G1 =
+        "1e3b559f31284b6cf4e4da7dc18fa341c40188055776bf94c22ab827f42f5b23"
+        "2d01d4c6a63b8fd3a84e46ab8a7a3722d2137622fafd0a978255191ac6a6ec15"_hex;
+    EXPECT_EQ(output_hex(call(0x08, aG1 + cG2 + ac_neg_G1 + G2)), one);
+    EXPECT_EQ(output_hex(call(0x08, aG1 + cG2 + aG1 + G2)), zero);
+    EXPECT_EQ(output_hex(call(0x08, aG1 + cG2)), zero);
+
+    EXPECT_EQ(output_hex(call(0x08, G1 + G2 + G1_neg + G2)), one);
+    EXPECT_EQ(output_hex(call(0x08, G1 + G2)), zero);
+
+    // The pairs with the point at infinity are skipped, the empty input gives 1.
+    EXPECT_EQ(output_hex(call(0x08, {})), one);
+    EXPECT_EQ(output_hex(call(0x08, Zero64 + G2)), one);
+    EXPECT_EQ(output_hex(call(0x08, G1 + Zero128 + G1 + G2 + G1_neg + G2)), one);
+}
+
+TEST(bn254, ecpairing_invalid)
+{
+    // The input size not multiple of 192.
+    EXPECT_EQ(call(0x08, G1 + G2 + G1).status_code, EVMC_PRECOMPILE_FAILURE);
+
+    // The G2 point on the twist curve but not in the subgroup of order r.
+    const auto Q_not_in_subgroup =
+        "0000000000000000000000000000000000000000000000000000000000000000"
+        "0000000000000000000000000000000000000000000000000000000000000001"
+        "0d1271953ed9ea0836846e70a1934187998c7f790cb4d7511b7f8da82de048a4"
+        "2869111d5381f072f8e2728fdb825a51aadd70e52c9830e9ab4b871c0531f1bb"_hex;
+    EXPECT_EQ(call(0x08, G1 + Q_not_in_subgroup).status_code, EVMC_PRECOMPILE_FAILURE);
+    EXPECT_EQ(call(0x08, Zero64 + Q_not_in_subgroup).status_code, EVMC_PRECOMPILE_FAILURE);
+
+    // The G2 point not on the curve.
+    auto bad_G2 = G2;
+    bad_G2[127] ^= 1;
+    EXPECT_EQ(call(0x08, G1 + bad_G2).status_code, EVMC_PRECOMPILE_FAILURE);
+
+    // The G1 point not on the curve paired with the point at infinity.
+    auto bad_G1 = G1;
+    bad_G1[63] = 3;
+    EXPECT_EQ(call(0x08, bad_G1 + Zero128).status_code, EVMC_PRECOMPILE_FAILURE);
+}
+
+TEST(bn254, pairing_check_api)
+{
+    EXPECT_EQ(crypto::bn254_pairing_check({}), true);
+    const auto input = G1 + G2 + G1_neg + G2;
+    EXPECT_EQ(crypto::bn254_pairing_check(input), true);
+    EXPECT_EQ(crypto::bn254_pairing_check({input.data(), 192}), false);
+    EXPECT_EQ(crypto::bn254_pairing_check({input.data(), 100}), std::nullopt);
+}
@@ -0,0 +1,166 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmc/hex.hpp>
+#include <evmone_precompiles/modexp.hpp>
+#include <evmone_precompiles/sha256.hpp>
+#include <gtest/gtest.h>
+#include <test/state/precompiles.hpp>
+#include <test/utils/utils.hpp>
+
+using namespace evmone;
+
+namespace
+{
+/// Generates the pseudo-random bytes.
+bytes fill(uint32_t seed, size_t size)
+{
+    bytes r(size, 0);
+    for (size_t j = 0; j < size; ++j)
+    {
+        const auto x = seed * 0x9e3779b1 + static_cast<uint32_t>(j) * 0x85ebca6b;
+        r[j] = static_cast<uint8_t>(x >> 24);
+    }
+    return r;
+}
+
+std::string modexp_hex(const bytes& base, const bytes& exp, const bytes& mod)
+{
+    bytes out(mod.size(), 0xfe);
+    crypto::modexp(base, exp, mod, out.data());
+    return evmc::hex(out);
+}
+
+evmc::Result call_expmod(const bytes& input)
+{
+    evmc_message msg{};
+    msg.code_address = evmc::address{0x05};
+    msg.input_data = input.data();
+    msg.input_size = input.size();
+    msg.gas = 10'000'000;
+    auto res = state::call_precompile(EVMC_CANCUN, msg);
+    EXPECT_TRUE(res.has_value());
+    return std::move(*res);
+}
+
+/// Encodes the precompile input header: the lengths of the base, the exponent and the modulus.
+bytes header(size_t base_len, size_t exp_len, size_t mod_len)
+{
+    bytes r(96, 0);
+    for (size_t i = 0; i < 8; ++i)
+    {
+        r[31 - i] = static_cast<uint8_t>(base_len >> (8 * i));
+        r[63 - i] = static_cast<uint8_t>(exp_len >> (8 * i));
+        r[95 - i] = static_cast<uint8_t>(mod_len >> (8 * i));
+    }
+    return r;
+}
+}  // namespace
+
+TEST(expmod, small)
+{
+    EXPECT_EQ(modexp_hex("03"_hex, "05"_hex, "64"_hex), "2b");
+    EXPECT_EQ(modexp_hex("07"_hex, "02"_hex, "0c"_hex), "01");
+    EXPECT_EQ(modexp_hex("02"_hex, "10"_hex, "01000000"_hex), "00010000");
+
+    // The output is left-padded to the modulus length.
+    EXPECT_EQ(modexp_hex("03"_hex, ""_hex, "0064"_hex), "0001");
+    EXPECT_EQ(modexp_hex(""_hex, "05"_hex, "64"_hex), "00");
+    EXPECT_EQ(modexp_hex("00"_hex, "00"_hex, "64"_hex), "01");
+
+    // The modulus 0 and 1.
+    EXPECT_EQ(modexp_hex("03"_hex, "05"_hex, "0000"_hex), "0000");
+    EXPECT_EQ(modexp_hex("03"_hex, "05"_hex, "01"_hex), "00");
+    EXPECT_EQ(modexp_hex(""_hex, ""_hex, ""_hex), "");
+}
+
+TEST(expmod, eip198_example)
+{
+    // 3^(p-1) mod p = 1 for the prime p.
+    const auto p = "fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f"_hex;
+    const auto p_minus_1 = "fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2e"_hex;
+    EXPECT_EQ(modexp_hex("03"_hex, p_minus_1, p),
+        "0000000000000000000000000000000000000000000000000000000000000001");
+}
+
+TEST(expmod, sizes)
+{
+    // All the implementations (up to 256 bits, up to 512 bits, generic; odd and even moduli)
+    // against the results of Python's pow(): the hash of all the results is compared.
+    bytes results;
+    static constexpr size_t mod_lengths[]{1, 2, 8, 31, 32, 33, 63, 64, 65, 96, 128, 200, 256, 513};
+    for (const auto mod_len : mod_lengths)
+    {
+        for (uint32_t variant = 0; variant < 5; ++variant)
+        {
+            const auto seed = static_cast<uint32_t>(mod_len * 8) + variant;
+            const auto base = fill(seed, mod_len + 5);
+            const auto exp = fill(seed + 1000, 1 + mod_len % 37);
+            auto mod = fill(seed + 2000, mod_len);
+            switch (variant)
+            {
+            case 0:  // Odd.
+                mod.back() |= 1;
+                break;
+            case 1:  // Even, 2^6 factor.
+                mod.back() = static_cast<uint8_t>((mod.back() & 0xf0) | 0x40);
+                break;
+            case 2:  // Even, the power of 2 factor over multiple words.
+                std::fill(mod.end() - static_cast<ptrdiff_t>(std::min(mod_len, size_t{9})),
+                    mod.end(), uint8_t{0});
+                mod[mod_len - std::min(mod_len, size_t{10})] |= 0x08;
+                break;
+            case 3:  // The power of 2.
+                mod.assign(mod_len, 0);
+                mod[0] = 0x10;
+                break;
+            case 4:  // Odd with the leading zero byte.
+                mod[0] = 0;
+                mod.back() |= 1;
+                break;
+            }
+
+            bytes out(mod_len, 0);
+            crypto::modexp(base, exp, mod, out.data());
+            results += out;
+        }
+    }
+
+    uint8_t hash[crypto::SHA256_HASH_SIZE];
+    crypto::sha256(hash, results.data(), results.size());
+    EXPECT_EQ(results.size(), 7460u);
+    EXPECT_EQ(evmc::hex({hash, std::size(hash)}),
+        "9bb99f393f0b1c71ad4e3afa57fdc78b8d5644d62af846a858ccff2c02708192");
+}
+
+TEST(expmod, precompile_big_output)
+{
+    // The output bigger than 256 bytes.
+    auto mod = fill(3, 300);
+    mod.back() |= 1;
+    const auto res = call_expmod(header(300, 40, 300) + fill(1, 300) + fill(2, 40) + mod);
+    EXPECT_EQ(res.status_code, EVMC_SUCCESS);
+    ASSERT_EQ(res.output_size, 300u);
+
+    uint8_t hash[crypto::SHA256_HASH_SIZE];
+    crypto::sha256(hash, res.output_data, res.output_size);
+    EXPECT_EQ(evmc::hex({hash, std::size(hash)}),
+        "48529e6c931f8d845dd118c122cbaef56b825335969abfefe8b246d8a73e5cbe");
+}
+
+TEST(expmod, precompile_truncated_input)
+{
+    // The missing input bytes are zeros: the modulus is 0x01000000.
+    const auto res = call_expmod(header(1, 1, 4) + "02100100"_hex);
+    EXPECT_EQ(res.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(evmc::hex({res.output_data, res.output_size}), "00010000");
+
+    const auto res_empty = call_expmod(header(0, 0, 0));
+    EXPECT_EQ(res_empty.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(res_empty.output_size, 0u);
+
+    const auto res_no_mod = call_expmod(header(1, 1, 0) + "0203"_hex);
+    EXPECT_EQ(res_no_mod.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(res_no_mod.output_size, 0u);
+}
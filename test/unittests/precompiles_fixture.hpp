@@ -0,0 +1,63 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+
+namespace evmone::test
+{
+/// The implementations of the compression function of a hash precompile.
+enum class Kernel
+{
+    generic,      ///< The portable implementation.
+    accelerated,  ///< The implementation using a CPU extension, if supported.
+};
+
+/// The fixture testing each compression function implementation of a hash precompile.
+///
+/// The Kernels type provides:
+/// - CompressFn: the type of the compression function,
+/// - generic: the portable compression function,
+/// - get_accelerated(): the accelerated compression function or null if not supported,
+/// - accelerated_name: the test name suffix of the accelerated implementation,
+/// - cpu_feature: the name of the required CPU extension.
+template <typename Kernels>
+class precompile_kernel : public testing::TestWithParam<Kernel>
+{
+protected:
+    typename Kernels::CompressFn compress = nullptr;
+
+    void SetUp() override
+    {
+        if (GetParam() == Kernel::generic)
+            compress = Kernels::generic;
+        else if (compress = Kernels::get_accelerated(); compress == nullptr)
+            GTEST_SKIP() << Kernels::cpu_feature << " is not supported by the CPU";
+    }
+
+public:
+    /// The test name generator for INSTANTIATE_TEST_SUITE_P().
+    static std::string kernel_name(const testing::TestParamInfo<Kernel>& info)
+    {
+        return info.param == Kernel::generic ? "generic" : Kernels::accelerated_name;
+    }
+};
+
+/// Hashes the prefixes of all lengths of a multi-block message, covering all padding cases,
+/// with hash_fn(out, data, size) and returns the concatenated hashes.
+template <size_t HashSize, typename HashFn>
+std::basic_string<uint8_t> hash_all_prefixes(HashFn hash_fn)
+{
+    std::basic_string<uint8_t> data(300, 0);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i % 251);
+
+    std::basic_string<uint8_t> hashes(data.size() * HashSize, 0);
+    for (size_t n = 0; n < data.size(); ++n)
+        hash_fn(&hashes[n * HashSize], data.data(), n);
+    return hashes;
+}
+}  // namespace evmone::test
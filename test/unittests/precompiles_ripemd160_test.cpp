@@ -0,0 +1,62 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "precompiles_fixture.hpp"
+#include <evmc/hex.hpp>
+#include <evmone_precompiles/ripemd160.hpp>
+#include <gtest/gtest.h>
+#include <test/state/precompiles.hpp>
+#include <string_view>
+
+using namespace evmone;
+using namespace evmone::crypto;
+
+namespace
+{
+std::string ripemd160_hex(std::basic_string_view<uint8_t> data)
+{
+    uint8_t hash[RIPEMD160_HASH_SIZE];
+    ripemd160(hash, data.data(), data.size());
+    return evmc::hex({hash, std::size(hash)});
+}
+
+std::string ripemd160_hex(std::string_view str)
+{
+    return ripemd160_hex({reinterpret_cast<const uint8_t*>(str.data()), str.size()});
+}
+}  // namespace
+
+TEST(ripemd160, test_vectors)
+{
+    EXPECT_EQ(ripemd160_hex(""), "9c1185a5c5e9fc54612808977ee8f548b2258d31");
+    EXPECT_EQ(ripemd160_hex("abc"), "8eb208f7e05d987a9b044a8e98c6b087f15a0bfc");
+    EXPECT_EQ(ripemd160_hex("message digest"), "5d0689ef49d2fae572b881b123a85ffa21595f36");
+    EXPECT_EQ(ripemd160_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+        "12a053384a9c0c88e405a06c27dcf49ada62eb2b");
+    EXPECT_EQ(
+        ripemd160_hex(std::string(1'000'000, 'a')), "52783243c1697bdbe16d37f97f68f08325dc1528");
+}
+
+TEST(ripemd160, all_padding_cases)
+{
+    const auto hashes = test::hash_all_prefixes<RIPEMD160_HASH_SIZE>(ripemd160);
+    EXPECT_EQ(ripemd160_hex(hashes), "0cf9be05d08dd175da3959bb066fee66067bfb65");
+}
+
+TEST(ripemd160, precompile)
+{
+    const uint8_t input[]{'a', 'b', 'c'};
+    evmc_message msg{};
+    msg.code_address = evmc::address{0x03};
+    msg.input_data = input;
+    msg.input_size = std::size(input);
+    msg.gas = 1000;
+
+    const auto res = state::call_precompile(EVMC_SHANGHAI, msg);
+    ASSERT_TRUE(res.has_value());
+    EXPECT_EQ(res->status_code, EVMC_SUCCESS);
+    EXPECT_EQ(res->gas_left, 1000 - 720);
+    EXPECT_EQ(evmc::hex({res->output_data, res->output_size}),
+        "0000000000000000000000008eb208f7e05d987a9b044a8e98c6b087f15a0bfc");
+}
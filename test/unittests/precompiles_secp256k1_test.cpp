@@ -0,0 +1,170 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmc/hex.hpp>
+#include <evmone_precompiles/secp256k1.hpp>
+#include <gtest/gtest.h>
+#include <test/state/precompiles.hpp>
+#include <test/utils/utils.hpp>
+#include <vector>
+
+using namespace evmc::literals;
+using namespace evmone;
+using namespace evmone::crypto;
+
+namespace
+{
+struct TestCase
+{
+    EcrecoverInput input;
+    evmc::address expected;
+};
+
+const TestCase test_cases[]{
+    {{0x456e9aea5e197a1f1af7a3e85a3212fa4049a3ba34c2289b4c860fc0b0c64ef3_bytes32,
+         0x9242685bf161793cc25603c231bc2f568eb630ea16aa137d2664ac8038825608_bytes32,
+         0x4f8ae3bd7535248d0bd448298cc2e2071e56992d0774dc340c368ae950852ada_bytes32, true},
+        0x7156526fbd7a3c72969b54f64e42c10fbb768c8a_address},
+    {{0x839b6d09f48a5c3d0234f9b45d4226e618c22cfcc0181bf8ee46748c95d6007f_bytes32,
+         0xb41384a541800f6a8723c03b96719313853c93a68a7ddeff77dfd38ad91eb19f_bytes32,
+         0xe44737223521da9e4279344c850b46754174cd0701f8dffb6c9b80bca141a90f_bytes32, true},
+        0x5a75540c14d7b169fbd46f71e8f455f40a9e7188_address},
+    {{0x15435e0d5c797972d89914077a7cf14412d86d0b90ae56082a054026573d2a2f_bytes32,
+         0x9e52df51d905da741d26bfbad9a5806a66e4942b201385e89bca50ee18e3019d_bytes32,
+         0x63c252025ece3861aad82ad357fb9f8ceb1b652163be8aeaf323f2570e239df6_bytes32, true},
+        0x365e951884189bbbe72e3a42aef29f14a0cdd7d5_address},
+    // The "high s" signature: rejected for transactions (EIP-2), but valid for the precompile.
+    {{0xabb2e2d51d53c5a5d480a02dd3816a78e3937dec0b843b31c1b3aa2d8e05bace_bytes32,
+         0x9884d9258c9cb96cd3ec2ceb61d879b647ac302df195c84cfa3801062a8ce9d4_bytes32,
+         0x631bded536c740b2cedf75634b627b47e526710d89b92ed6f9fbd469de0022b2_bytes32, true},
+        0x5a338aed1b636a83511cc2f6968f7a848ab48b26_address},
+    // The hash greater than the group order n.
+    {{0xfffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364146_bytes32,
+         0x8dd92a38497f163fcf1aa89f5c17e8210f1296c820627710e94a0bbf58a5c5f7_bytes32,
+         0xac2b885857f7f7621f41399d301cf1e5ec95fe34e84301829fe9edd22c542b67_bytes32, true},
+        0x70b650ce92dbb64e6852e15e8fad1cb658259e10_address},
+};
+
+std::optional<evmc::address> recover(const EcrecoverInput& in) noexcept
+{
+    return ecrecover(in.hash.bytes, in.r.bytes, in.s.bytes, in.parity);
+}
+
+/// Encodes the ecrecover precompile input: hash, v, r, s, each 32 bytes.
+bytes precompile_input(const EcrecoverInput& in, uint8_t v)
+{
+    bytes data(128, 0);
+    std::copy_n(in.hash.bytes, 32, &data[0]);
+    data[63] = v;
+    std::copy_n(in.r.bytes, 32, &data[64]);
+    std::copy_n(in.s.bytes, 32, &data[96]);
+    return data;
+}
+
+constexpr auto N = 0xfffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141_bytes32;
+}  // namespace
+
+TEST(secp256k1, ecrecover)
+{
+    for (const auto& [input, expected] : test_cases)
+    {
+        const auto addr = recover(input);
+        ASSERT_TRUE(addr.has_value());
+        EXPECT_EQ(*addr, expected);
+
+        // The other parity gives the other public key.
+        auto flipped = input;
+        flipped.parity = !flipped.parity;
+        const auto other = recover(flipped);
+        ASSERT_TRUE(other.has_value());
+        EXPECT_NE(*other, expected);
+    }
+}
+
+TEST(secp256k1, ecrecover_invalid)
+{
+    const auto& valid = test_cases[0].input;
+
+    auto in = valid;
+    in.r = {};
+    EXPECT_FALSE(recover(in).has_value());
+
+    in = valid;
+    in.s = {};
+    EXPECT_FALSE(recover(in).has_value());
+
+    in = valid;
+    in.r = N;
+    EXPECT_FALSE(recover(in).has_value());
+
+    in = valid;
+    in.s = N;
+    EXPECT_FALSE(recover(in).has_value());
+
+    // 5 is not the x coordinate of any curve point: 5^3 + 7 is not a square mod p.
+    in = valid;
+    in.r = 0x05_bytes32;
+    EXPECT_FALSE(recover(in).has_value());
+}
+
+TEST(secp256k1, ecrecover_batch)
+{
+    std::vector<EcrecoverInput> inputs;
+    for (const auto& t : test_cases)
+    {
+        inputs.push_back(t.input);
+        auto invalid = t.input;
+        invalid.r = N;
+        inputs.push_back(invalid);
+        auto flipped = t.input;
+        flipped.parity = !flipped.parity;
+        inputs.push_back(flipped);
+    }
+
+    std::vector<std::optional<evmc::address>> outputs(inputs.size());
+    ecrecover(inputs, outputs);
+    for (size_t i = 0; i < inputs.size(); ++i)
+        EXPECT_EQ(outputs[i], recover(inputs[i])) << i;
+
+    // The empty batch.
+    ecrecover({}, {});
+}
+
+TEST(secp256k1, precompile)
+{
+    const auto& [input, expected] = test_cases[0];
+    auto call = [](const bytes& data, int64_t gas) {
+        evmc_message msg{};
+        msg.code_address = evmc::address{0x01};
+        msg.input_data = data.data();
+        msg.input_size = data.size();
+        msg.gas = gas;
+        auto res = state::call_precompile(EVMC_SHANGHAI, msg);
+        EXPECT_TRUE(res.has_value());
+        return std::move(*res);
+    };
+
+    const auto data = precompile_input(input, 28);
+    const auto res = call(data, 5000);
+    EXPECT_EQ(res.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(res.gas_left, 5000 - 3000);
+    EXPECT_EQ(evmc::hex({res.output_data, res.output_size}),
+        "000000000000000000000000" + evmc::hex({expected.bytes, sizeof(expected)}));
+
+    // Invalid v: success with empty output.
+    const auto bad_v = precompile_input(input, 29);
+    const auto res_bad_v = call(bad_v, 5000);
+    EXPECT_EQ(res_bad_v.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(res_bad_v.output_size, 0u);
+
+    // Empty input: all zeros, invalid v.
+    const auto res_empty = call({}, 5000);
+    EXPECT_EQ(res_empty.status_code, EVMC_SUCCESS);
+    EXPECT_EQ(res_empty.output_size, 0u);
+
+    // Extra input bytes are ignored.
+    const auto res_long = call(data + bytes(10, 0xff), 5000);
+    EXPECT_EQ(evmc::hex({res_long.output_data, res_long.output_size}),
+        "000000000000000000000000" + evmc::hex({expected.bytes, sizeof(expected)}));
+}
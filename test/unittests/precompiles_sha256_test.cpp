@@ -0,0 +1,92 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "precompiles_fixture.hpp"
+#include <evmc/hex.hpp>
+#include <evmone_precompiles/sha256.hpp>
+#include <gtest/gtest.h>
+#include <test/state/precompiles.hpp>
+#include <string_view>
+
+using namespace evmone;
+using namespace evmone::crypto;
+
+namespace
+{
+/// The SHA-256 compression functions tested.
+struct Sha256Kernels
+{
+    using CompressFn = internal::Sha256CompressFn;
+    static constexpr auto generic = internal::sha256_compress_generic;
+    static constexpr auto get_accelerated = internal::get_sha256_compress_shani;
+    static constexpr auto accelerated_name = "shani";
+    static constexpr auto cpu_feature = "SHA-NI";
+};
+
+class sha256_kernel : public test::precompile_kernel<Sha256Kernels>
+{
+protected:
+    std::string sha256_hex(std::basic_string_view<uint8_t> data) const
+    {
+        uint8_t hash[SHA256_HASH_SIZE];
+        internal::sha256(hash, data.data(), data.size(), compress);
+        return evmc::hex({hash, std::size(hash)});
+    }
+
+    std::string sha256_hex(std::string_view str) const
+    {
+        return sha256_hex({reinterpret_cast<const uint8_t*>(str.data()), str.size()});
+    }
+};
+}  // namespace
+
+INSTANTIATE_TEST_SUITE_P(sha256, sha256_kernel,
+    testing::Values(test::Kernel::generic, test::Kernel::accelerated), sha256_kernel::kernel_name);
+
+TEST_P(sha256_kernel, test_vectors)
+{
+    EXPECT_EQ(sha256_hex(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(
+        sha256_hex("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    EXPECT_EQ(sha256_hex(std::string(1'000'000, 'a')),
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_P(sha256_kernel, all_padding_cases)
+{
+    const auto hashes = test::hash_all_prefixes<SHA256_HASH_SIZE>(
+        [this](uint8_t* out, const uint8_t* data, size_t size) {
+            internal::sha256(out, data, size, compress);
+        });
+    EXPECT_EQ(sha256_hex(hashes),
+        "fa70b867db0a30acb7218d62945db0df52eb393808b30675ea9aac6b058a9a9d");
+}
+
+TEST(sha256, dispatched)
+{
+    const uint8_t input[]{'a', 'b', 'c'};
+    uint8_t hash[SHA256_HASH_SIZE];
+    sha256(hash, input, std::size(input));
+    EXPECT_EQ(evmc::hex({hash, std::size(hash)}),
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(sha256, precompile)
+{
+    const uint8_t input[]{'a', 'b', 'c'};
+    evmc_message msg{};
+    msg.code_address = evmc::address{0x02};
+    msg.input_data = input;
+    msg.input_size = std::size(input);
+    msg.gas = 100;
+
+    const auto res = state::call_precompile(EVMC_SHANGHAI, msg);
+    ASSERT_TRUE(res.has_value());
+    EXPECT_EQ(res->status_code, EVMC_SUCCESS);
+    EXPECT_EQ(res->gas_left, 100 - 72);
+    EXPECT_EQ(evmc::hex({res->output_data, res->output_size}),
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
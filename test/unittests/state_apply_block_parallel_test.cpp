@@ -0,0 +1,160 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmone/evmone.h>
+#include <gtest/gtest.h>
+#include <test/state/errors.hpp>
+#include <test/state/mpt_hash.hpp>
+#include <test/state/parallel.hpp>
+#include <test/utils/bytecode.hpp>
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+using namespace evmc::literals;
+using namespace evmone;
+using namespace evmone::state;
+
+namespace
+{
+constexpr auto Token = 0x70c0_address;
+constexpr auto Counter = 0xc0c0_address;
+constexpr auto CoinbaseReader = 0xcbcb_address;
+constexpr auto Destructible = 0xde57_address;
+constexpr auto Coinbase = 0xc014bace_address;
+
+evmc::VM vm{evmc_create_evmone()};
+
+const BlockInfo block{
+    .gas_limit = 10'000'000,
+    .coinbase = Coinbase,
+    .base_fee = 999,
+};
+
+address sender(uint64_t i)
+{
+    return address{0x5e0000 + i};
+}
+
+/// Returns the storage key being the address (e.g. pushed by CALLER).
+bytes32 to_key(const address& addr)
+{
+    bytes32 key;
+    std::copy_n(addr.bytes, sizeof(addr), &key.bytes[sizeof(key) - sizeof(addr)]);
+    return key;
+}
+
+Transaction make_tx(const address& from, std::optional<address> to, bytes data = {})
+{
+    return {
+        .data = std::move(data),
+        .gas_limit = 200'000,
+        .max_gas_price = block.base_fee + 1,
+        .max_priority_gas_price = 1,
+        .sender = from,
+        .to = to,
+    };
+}
+
+State make_pre_state()
+{
+    State pre;
+    for (uint64_t i = 0; i < 16; ++i)
+        pre.insert(sender(i), {.balance = 1'000'000'000'000'000});
+    // Increments the caller's balance: the transactions from different senders are independent.
+    pre.insert(Token, {.code = sstore(OP_CALLER, add(sload(OP_CALLER), 1))});
+    // Increments the single counter: all transactions conflict.
+    pre.insert(Counter, {.code = sstore(0, add(sload(0), 1))});
+    pre.insert(CoinbaseReader, {.code = sstore(0, bytecode{OP_COINBASE} + OP_BALANCE)});
+    pre.insert(Destructible, {.balance = 1, .code = selfdestruct(OP_CALLER)});
+    return pre;
+}
+
+/// Applies the transactions to the copies of the state sequentially and in parallel
+/// and expects the same results.
+void expect_same_as_sequential(
+    const State& pre, std::span<const Transaction> txs, evmc_revision rev)
+{
+    auto seq_state = pre;
+    auto par_state = pre;
+    const auto seq = apply_block(seq_state, block, txs, rev, vm);
+    const auto par = apply_block_parallel(par_state, block, txs, rev, vm, 4);
+
+    ASSERT_EQ(par.index(), seq.index()) << rev;
+    if (holds_alternative<std::error_code>(seq))
+        EXPECT_EQ(get<std::error_code>(par), get<std::error_code>(seq)) << rev;
+    else
+    {
+        const auto& seq_receipts = get<BlockResult>(seq).receipts;
+        const auto& par_receipts = get<BlockResult>(par).receipts;
+        ASSERT_EQ(par_receipts.size(), seq_receipts.size()) << rev;
+        EXPECT_EQ(mpt_hash(par_receipts), mpt_hash(seq_receipts)) << rev;
+        EXPECT_EQ(get<BlockResult>(par).gas_used, get<BlockResult>(seq).gas_used) << rev;
+    }
+    EXPECT_EQ(mpt_hash(par_state.get_accounts()), mpt_hash(seq_state.get_accounts())) << rev;
+}
+
+constexpr evmc_revision revisions[]{EVMC_TANGERINE_WHISTLE, EVMC_BERLIN, EVMC_SHANGHAI};
+}  // namespace
+
+TEST(state_apply_block_parallel, independent_transactions)
+{
+    const auto pre = make_pre_state();
+    std::vector<Transaction> txs;
+    for (uint64_t i = 0; i < 16; ++i)
+        txs.push_back(make_tx(sender(i), Token));
+
+    for (const auto rev : revisions)
+        expect_same_as_sequential(pre, txs, rev);
+
+    auto state = pre;
+    const auto res = apply_block_parallel(state, block, txs, EVMC_SHANGHAI, vm, 4);
+    ASSERT_TRUE(holds_alternative<BlockResult>(res)) << get<std::error_code>(res).message();
+    for (uint64_t i = 0; i < 16; ++i)
+    {
+        EXPECT_EQ(state.get(Token).storage.at(to_key(sender(i))).current, 0x01_bytes32);
+        EXPECT_EQ(state.get(sender(i)).nonce, 1u);
+    }
+    EXPECT_EQ(state.get(Coinbase).balance, 16 * get<BlockResult>(res).receipts[0].gas_used);
+}
+
+TEST(state_apply_block_parallel, conflicting_transactions)
+{
+    const auto pre = make_pre_state();
+    const auto init_code = ret(0, 1);
+    const Transaction txs[]{
+        make_tx(sender(0), Token),
+        make_tx(sender(0), Token),  // The same sender.
+        make_tx(sender(1), Counter),
+        make_tx(sender(2), Counter),
+        make_tx(sender(3), CoinbaseReader),
+        make_tx(sender(4), Destructible),
+        make_tx(sender(5), Destructible),  // Calls the destructed account.
+        make_tx(sender(6), std::nullopt, init_code),
+        make_tx(sender(7), 0xe0_address),  // Touches an empty account.
+        make_tx(sender(8), sender(0)),
+        make_tx(sender(0), Token),  // The sender's balance modified by the value transfer.
+        make_tx(Coinbase, Token),   // The sender is the coinbase.
+    };
+
+    auto pre_with_coinbase = pre;
+    pre_with_coinbase.insert(Coinbase, {.balance = 1'000'000'000'000'000});
+    for (const auto rev : revisions)
+        expect_same_as_sequential(pre_with_coinbase, txs, rev);
+}
+
+TEST(state_apply_block_parallel, invalid_transaction)
+{
+    const auto pre = make_pre_state();
+    auto tx = make_tx(sender(1), Token);
+    tx.value = 1'000'000'000'000'000;  // Insufficient funds for the gas.
+    const Transaction txs[]{make_tx(sender(0), Token), tx, make_tx(sender(2), Token)};
+
+    for (const auto rev : revisions)
+        expect_same_as_sequential(pre, txs, rev);
+
+    auto state = pre;
+    const auto res = apply_block_parallel(state, block, txs, EVMC_SHANGHAI, vm, 4);
+    ASSERT_TRUE(holds_alternative<std::error_code>(res));
+    EXPECT_EQ(get<std::error_code>(res), make_error_code(INSUFFICIENT_FUNDS));
+}
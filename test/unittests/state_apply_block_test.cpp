@@ -0,0 +1,112 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmone/evmone.h>
+#include <gtest/gtest.h>
+#include <test/state/errors.hpp>
+#include <test/state/state.hpp>
+#include <test/utils/bytecode.hpp>
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+using namespace evmc::literals;
+using namespace evmone;
+using namespace evmone::state;
+
+namespace
+{
+constexpr auto Sender = 0xe100713FC15400D1e94096a545879E7c6407001e_address;
+constexpr auto To = 0xc0de_address;
+constexpr auto Coinbase = 0xc014bace_address;
+
+evmc::VM vm{evmc_create_evmone()};
+
+const BlockInfo block{
+    .gas_limit = 1'000'000,
+    .coinbase = Coinbase,
+    .base_fee = 999,
+};
+
+Transaction make_tx(const address& to, int64_t gas_limit = 100'000)
+{
+    return {
+        .gas_limit = gas_limit,
+        .max_gas_price = block.base_fee + 1,
+        .max_priority_gas_price = 1,
+        .sender = Sender,
+        .to = to,
+    };
+}
+
+State make_pre_state()
+{
+    State pre;
+    pre.insert(Sender, {.balance = 1'000'000'000'000'000});
+    return pre;
+}
+}  // namespace
+
+TEST(state_apply_block, storage_statuses_reset_between_transactions)
+{
+    auto state = make_pre_state();
+    state.insert(To, {.code = sstore(1, add(sload(1), 1))});
+
+    const Transaction txs[]{make_tx(To), make_tx(To)};
+    const auto res = apply_block(state, block, txs, EVMC_SHANGHAI, vm);
+    ASSERT_TRUE(holds_alternative<BlockResult>(res)) << get<std::error_code>(res).message();
+    const auto& [receipts, gas_used] = get<BlockResult>(res);
+
+    ASSERT_EQ(receipts.size(), 2u);
+    // The first transaction: cold SLOAD and SSTORE 0 → 1.
+    EXPECT_EQ(receipts[0].gas_used, 21000 + 2112 + 20000);
+    // The second transaction: the slot is cold and clean again, SSTORE 1 → 2.
+    EXPECT_EQ(receipts[1].gas_used, 21000 + 2112 + 2900);
+    EXPECT_EQ(gas_used, receipts[0].gas_used + receipts[1].gas_used);
+    EXPECT_TRUE(state.get_accessed_accounts().empty());
+
+    const auto& slot = state.get(To).storage.at(0x01_bytes32);
+    EXPECT_EQ(slot.current, 0x02_bytes32);
+    EXPECT_EQ(slot.original, 0x02_bytes32);
+    EXPECT_EQ(slot.access_status, EVMC_ACCESS_COLD);
+    EXPECT_EQ(state.get(To).access_status, EVMC_ACCESS_COLD);
+    EXPECT_EQ(state.get(Sender).nonce, 2u);
+}
+
+TEST(state_apply_block, destructed_and_touched_empty_accounts_erased)
+{
+    static constexpr auto Destructed = 0xde57_address;
+    static constexpr auto Empty = 0xe0_address;
+    static constexpr auto Untouched = 0x0e_address;
+
+    auto state = make_pre_state();
+    state.insert(Destructed, {.balance = 1, .code = selfdestruct(0xbeef_address)});
+    state.insert(Untouched, {});  // Empty but not touched.
+
+    const Transaction txs[]{make_tx(Destructed), make_tx(Empty)};
+    const auto res = apply_block(state, block, txs, EVMC_SHANGHAI, vm);
+    ASSERT_TRUE(holds_alternative<BlockResult>(res)) << get<std::error_code>(res).message();
+
+    EXPECT_EQ(state.find(Destructed), nullptr);
+    EXPECT_EQ(state.find(Empty), nullptr);
+    ASSERT_NE(state.find(0xbeef_address), nullptr);
+    EXPECT_EQ(state.get(0xbeef_address).balance, 1);
+    EXPECT_NE(state.find(Untouched), nullptr);
+}
+
+TEST(state_apply_block, block_gas_limit_reached)
+{
+    auto state = make_pre_state();
+
+    // The second transaction's gas limit exceeds the gas left after the first one.
+    const Transaction txs[]{make_tx(To, 990'000), make_tx(To, 990'000)};
+    const auto res = apply_block(state, block, txs, EVMC_SHANGHAI, vm);
+    ASSERT_TRUE(holds_alternative<std::error_code>(res));
+    EXPECT_EQ(get<std::error_code>(res), make_error_code(GAS_LIMIT_REACHED));
+
+    // The transactions within the block gas limit.
+    const Transaction txs2[]{make_tx(To, 100'000), make_tx(To, 100'000)};
+    const auto res2 = apply_block(state, block, txs2, EVMC_SHANGHAI, vm);
+    ASSERT_TRUE(holds_alternative<BlockResult>(res2)) << get<std::error_code>(res2).message();
+    EXPECT_EQ(get<BlockResult>(res2).gas_used, 2 * 21000);
+}
@@ -0,0 +1,421 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <test/state/block.hpp>
+#include <test/state/rlp.hpp>
+#include <test/utils/utils.hpp>
+
+using namespace evmone;
+using namespace evmone::state;
+using namespace evmc::literals;
+using namespace intx;
+
+namespace
+{
+/// The already RLP-encoded item to be embedded in another encoding as is.
+struct RawRlp
+{
+    bytes encoded;
+};
+
+void rlp_write(rlp::Writer& w, const RawRlp& raw)
+{
+    w.write(raw.encoded.data(), raw.encoded.size());
+}
+
+template <typename T>
+std::error_code error_of(const std::variant<T, std::error_code>& result)
+{
+    return std::holds_alternative<std::error_code>(result) ? std::get<std::error_code>(result) :
+                                                             std::error_code{};
+}
+
+Transaction make_eip1559_tx()
+{
+    Transaction tx;
+    tx.kind = Transaction::Kind::eip1559;
+    tx.data = "00"_hex;
+    tx.gas_limit = 0x3d0900;
+    tx.max_gas_price = 0x7d0;
+    tx.max_priority_gas_price = 0xa;
+    tx.to = 0xcccccccccccccccccccccccccccccccccccccccc_address;
+    tx.access_list = {{0xcccccccccccccccccccccccccccccccccccccccc_address,
+        {0x0000000000000000000000000000000000000000000000000000000000000000_bytes32,
+            0x0000000000000000000000000000000000000000000000000000000000000001_bytes32}}};
+    tx.nonce = 1;
+    tx.r = 0xd671815898b8dd34321adbba4cb6a57baa7017323c26946f3719b00e70c755c2_u256;
+    tx.s = 0x3528b9efe3be57ea65a933d1e6bbf3b7d0c78830138883c1201e0c641fee6464_u256;
+    tx.v = 0;
+    tx.chain_id = 1;
+    return tx;
+}
+
+bytes make_header(bool with_withdrawals)
+{
+    const bytes logs_bloom(256, 0);
+    const auto nonce = "0000000000000000"_hex;
+    const auto base = rlp::encode_tuple(0x01_bytes32, 0x02_bytes32, 0xc0_address, 0x03_bytes32,
+        0x04_bytes32, 0x05_bytes32, bytes_view{logs_bloom}, intx::uint256{0}, uint64_t{17'000'000},
+        uint64_t{30'000'000}, uint64_t{21'000}, uint64_t{1'700'000'000}, "cafe"_hex,
+        0x06_bytes32, bytes_view{nonce}, uint64_t{7});
+    if (!with_withdrawals)
+        return base;
+    return rlp::encode_tuple(0x01_bytes32, 0x02_bytes32, 0xc0_address, 0x03_bytes32,
+        0x04_bytes32, 0x05_bytes32, bytes_view{logs_bloom}, intx::uint256{0}, uint64_t{17'000'000},
+        uint64_t{30'000'000}, uint64_t{21'000}, uint64_t{1'700'000'000}, "cafe"_hex,
+        0x06_bytes32, bytes_view{nonce}, uint64_t{7}, 0x07_bytes32);
+}
+}  // namespace
+
+TEST(state_block_decode, legacy_tx)
+{
+    // https://etherscan.io/tx/0x033e9f8db737193d4666911a164e218d58d80edc64f4ed393d0c48c1ce2673e7
+    const auto encoded =
+        "f890"
+        "80"
+        "850373e97169"
+        "83066ebe"
+        "94963eda46936b489f4a0d153c20e47653d8bbf222"
+        "8806a94d74f4300000"
+        "a4a0712d680000000000000000000000000000000000000000000000000000000000000003"
+        "1b"
+        "a03bcaa4f1603d2b3ebe6126f57e0ddefc6c6c58d8bbef7f3b29e14a915bf1828d"
+        "9ff37b7a0b6007ef4335a35198485e443051d45b42fea8bacc054721ecccdb5f"_hex;
+
+    const auto res = decode_transaction(encoded);
+    ASSERT_FALSE(error_of(res));
+    const auto& tx = std::get<TransactionView>(res);
+    EXPECT_EQ(tx.kind, Transaction::Kind::legacy);
+    EXPECT_EQ(tx.nonce, 0u);
+    EXPECT_EQ(tx.max_gas_price, 14829580649_u256);
+    EXPECT_EQ(tx.max_priority_gas_price, 14829580649_u256);
+    EXPECT_EQ(tx.gas_limit, 421566);
+    EXPECT_EQ(tx.to.value(), 0x963eda46936b489f4a0d153c20e47653d8bbf222_address);
+    EXPECT_EQ(tx.value, 480000000000000000_u256);
+    EXPECT_EQ(hex(tx.data),
+        "a0712d680000000000000000000000000000000000000000000000000000000000000003");
+    EXPECT_EQ(tx.v, 27u);
+    EXPECT_EQ(tx.chain_id, 0u);
+    EXPECT_EQ(tx.s, 0x00f37b7a0b6007ef4335a35198485e443051d45b42fea8bacc054721ecccdb5f_u256);
+
+    // The views point into the input buffer.
+    EXPECT_EQ(tx.data.data(), encoded.data() + 44);
+    EXPECT_EQ(tx.encoded.data(), encoded.data());
+    EXPECT_EQ(keccak256(tx.encoded),
+        0x033e9f8db737193d4666911a164e218d58d80edc64f4ed393d0c48c1ce2673e7_bytes32);
+
+    const auto sender = 0xc9d955665d6f90ef483a1ac0bd2443c17a550db7_address;
+    const auto full_tx = to_transaction(tx, sender);
+    EXPECT_EQ(full_tx.sender, sender);
+    EXPECT_EQ(rlp::encode(full_tx), encoded);
+}
+
+TEST(state_block_decode, legacy_tx_eip155)
+{
+    Transaction tx;
+    tx.gas_limit = 21000;
+    tx.max_gas_price = 20000000000;
+    tx.value = 1;
+    tx.v = 37;  // chain_id = 1
+    const auto encoded = rlp::encode(tx);
+
+    const auto res = decode_transaction(encoded);
+    ASSERT_FALSE(error_of(res));
+    const auto& view = std::get<TransactionView>(res);
+    EXPECT_EQ(view.chain_id, 1u);
+    EXPECT_FALSE(view.to.has_value());
+    EXPECT_TRUE(view.data.empty());
+}
+
+TEST(state_block_decode, legacy_tx_eip155_big_chain_id)
+{
+    // The v of the chain id 17777 does not fit a byte.
+    Transaction tx;
+    tx.gas_limit = 21000;
+    tx.max_gas_price = 20000000000;
+    tx.to = 0xc0de_address;
+    tx.r = 1;
+    tx.s = 2;
+    tx.v = 17777 * 2 + 35 + 1;
+    const auto encoded = rlp::encode(tx);
+
+    const auto res = decode_transaction(encoded);
+    ASSERT_FALSE(error_of(res));
+    const auto& view = std::get<TransactionView>(res);
+    EXPECT_EQ(view.chain_id, 17777u);
+
+    const auto full_tx = to_transaction(view, {});
+    EXPECT_EQ(full_tx.v, tx.v);
+    EXPECT_EQ(rlp::encode(full_tx), encoded);
+    EXPECT_EQ(keccak256(rlp::encode(full_tx)), keccak256(view.encoded));
+}
+
+TEST(state_block_decode, typed_tx_roundtrip)
+{
+    auto tx = make_eip1559_tx();
+    const auto encoded_1559 = rlp::encode(tx);
+
+    const auto res_1559 = decode_transaction(encoded_1559);
+    ASSERT_FALSE(error_of(res_1559));
+    const auto& view_1559 = std::get<TransactionView>(res_1559);
+    EXPECT_EQ(view_1559.kind, Transaction::Kind::eip1559);
+    EXPECT_EQ(view_1559.max_priority_gas_price, 0xa_u256);
+    EXPECT_EQ(view_1559.max_gas_price, 0x7d0_u256);
+    EXPECT_EQ(keccak256(view_1559.encoded),
+        0xfb18421827800adcf465688e303cc9863045fdb96971473a114677916a3a08a4_bytes32);
+    const auto tx_1559 = to_transaction(view_1559, {});
+    EXPECT_EQ(tx_1559.access_list, tx.access_list);
+    EXPECT_EQ(rlp::encode(tx_1559), encoded_1559);
+
+    tx.kind = Transaction::Kind::eip2930;
+    tx.max_priority_gas_price = tx.max_gas_price;
+    tx.v = 1;
+    const auto encoded_2930 = rlp::encode(tx);
+
+    const auto res_2930 = decode_transaction(encoded_2930);
+    ASSERT_FALSE(error_of(res_2930));
+    const auto& view_2930 = std::get<TransactionView>(res_2930);
+    EXPECT_EQ(view_2930.kind, Transaction::Kind::eip2930);
+    EXPECT_EQ(view_2930.v, 1u);
+    EXPECT_EQ(rlp::encode(to_transaction(view_2930, {})), encoded_2930);
+}
+
+TEST(state_block_decode, tx_invalid)
+{
+    const auto legacy = rlp::encode(Transaction{});  // "c9" followed by 9 x "80"
+    ASSERT_FALSE(error_of(decode_transaction(legacy)));
+
+    EXPECT_EQ(error_of(decode_transaction({})), make_error_code(RLP_INPUT_TOO_SHORT));
+    EXPECT_EQ(error_of(decode_transaction(legacy + "00"_hex)),
+        make_error_code(RLP_TRAILING_BYTES));
+    EXPECT_EQ(error_of(decode_transaction(legacy.substr(0, legacy.size() - 1))),
+        make_error_code(RLP_INPUT_TOO_SHORT));
+    EXPECT_EQ(error_of(decode_transaction("c88080808080808080"_hex)),
+        make_error_code(RLP_TOO_FEW_ELEMENTS));
+    EXPECT_EQ(error_of(decode_transaction("ca80808080808080808080"_hex)),
+        make_error_code(RLP_TOO_MANY_ELEMENTS));
+
+    // Nonce with leading zero.
+    EXPECT_EQ(error_of(decode_transaction("ca82000180808080808080"_hex)),
+        make_error_code(RLP_NON_CANONICAL_INTEGER));
+    // Nonce 1 encoded as a string.
+    EXPECT_EQ(error_of(decode_transaction("ca81018080808080808080"_hex)),
+        make_error_code(RLP_NON_CANONICAL_SIZE));
+    // The short list encoded in the long form.
+    EXPECT_EQ(error_of(decode_transaction("f809808080808080808080"_hex)),
+        make_error_code(RLP_NON_CANONICAL_SIZE));
+    // Nonce exceeding 64 bits.
+    EXPECT_EQ(error_of(decode_transaction("d2890100000000000000008080808080808080"_hex)),
+        make_error_code(RLP_UINT_OVERFLOW));
+    // Gas limit exceeding int64.
+    EXPECT_EQ(error_of(decode_transaction("d18080888000000000000000808080808080"_hex)),
+        make_error_code(RLP_UINT_OVERFLOW));
+    // The "to" address of 19 bytes.
+    EXPECT_EQ(error_of(decode_transaction(
+                  "dc80808093000000000000000000000000000000000000008080808080"_hex)),
+        make_error_code(RLP_UNEXPECTED_SIZE));
+    // Nonce being a list.
+    EXPECT_EQ(error_of(decode_transaction("c9c08080808080808080"_hex)),
+        make_error_code(RLP_EXPECTED_STRING));
+
+    EXPECT_EQ(error_of(decode_transaction("03c0"_hex)), make_error_code(TX_TYPE_NOT_SUPPORTED));
+    EXPECT_EQ(error_of(decode_transaction("02"_hex)), make_error_code(RLP_INPUT_TOO_SHORT));
+
+    auto typed = rlp::encode(make_eip1559_tx());
+    EXPECT_EQ(error_of(decode_transaction(typed + "80"_hex)),
+        make_error_code(RLP_TRAILING_BYTES));
+
+    // Corrupt the access list: storage key of 31 bytes.
+    auto tx = make_eip1559_tx();
+    tx.access_list.clear();
+    typed = rlp::encode(tx);
+    ASSERT_EQ(typed[typed.size() - 68], 0xc0);  // the empty access list
+    const auto bad_access_list = rlp::encode_tuple(std::pair{
+        0xcccccccccccccccccccccccccccccccccccccccc_address, std::vector{bytes(31, 0)}});
+    typed = typed.substr(0, typed.size() - 68) + bad_access_list + typed.substr(typed.size() - 67);
+    typed[2] = static_cast<uint8_t>(typed[2] + bad_access_list.size() - 1);  // fix the list size
+    EXPECT_EQ(error_of(decode_transaction(typed)), make_error_code(RLP_UNEXPECTED_SIZE));
+}
+
+TEST(state_block_decode, receipt)
+{
+    TransactionReceipt receipt;
+    receipt.kind = Transaction::Kind::eip1559;
+    receipt.status = EVMC_SUCCESS;
+    receipt.gas_used = 0x24522;
+    receipt.logs = {{0xabcd_address, "0102"_hex, {0x01_bytes32, 0x02_bytes32}}};
+    const auto encoded = rlp::encode(receipt);
+
+    const auto res = decode_receipt(encoded);
+    ASSERT_FALSE(error_of(res));
+    const auto& view = std::get<TransactionReceiptView>(res);
+    EXPECT_EQ(view.kind, Transaction::Kind::eip1559);
+    EXPECT_TRUE(view.success);
+    EXPECT_FALSE(view.post_state.has_value());
+    EXPECT_EQ(view.cumulative_gas_used, 0x24522u);
+    EXPECT_EQ(view.logs_bloom.size(), 256u);
+    EXPECT_EQ(view.logs.payload, rlp::encode(receipt.logs).substr(2));
+
+    receipt.kind = Transaction::Kind::legacy;
+    receipt.status = EVMC_REVERT;
+    const auto legacy_res = decode_receipt(rlp::encode(receipt));
+    ASSERT_FALSE(error_of(legacy_res));
+    EXPECT_FALSE(std::get<TransactionReceiptView>(legacy_res).success);
+
+    const auto pre_byzantium = rlp::encode_tuple(0x01_bytes32, uint64_t{21000},
+        bytes_view{bytes(256, 0)}, std::vector<RawRlp>{});
+    const auto pre_byzantium_res = decode_receipt(pre_byzantium);
+    ASSERT_FALSE(error_of(pre_byzantium_res));
+    EXPECT_EQ(std::get<TransactionReceiptView>(pre_byzantium_res).post_state.value(), 0x01_bytes32);
+
+    EXPECT_EQ(error_of(decode_receipt("05c0"_hex)), make_error_code(TX_TYPE_NOT_SUPPORTED));
+    EXPECT_EQ(error_of(decode_receipt(rlp::encode_tuple(uint64_t{2}, uint64_t{21000},
+                  bytes_view{bytes(256, 0)}, std::vector<RawRlp>{}))),
+        make_error_code(RLP_UNEXPECTED_SIZE));
+}
+
+TEST(state_block_decode, block)
+{
+    const auto legacy_tx = rlp::encode(Transaction{});
+    const auto typed_tx = rlp::encode(make_eip1559_tx());
+    const std::vector<RawRlp> transactions{
+        {legacy_tx}, {rlp::encode(bytes_view{typed_tx})}, {legacy_tx}};
+    const std::vector<RawRlp> withdrawals{
+        {rlp::encode_tuple(uint64_t{1}, uint64_t{2}, 0x0a_address, uint64_t{1000})},
+        {rlp::encode_tuple(uint64_t{3}, uint64_t{4}, 0x0b_address, uint64_t{0})}};
+
+    const auto header = make_header(true);
+    const auto encoded =
+        rlp::encode_tuple(RawRlp{header}, transactions, std::vector<RawRlp>{}, withdrawals);
+
+    const auto res = decode_block(encoded);
+    ASSERT_FALSE(error_of(res));
+    const auto& block = std::get<BlockView>(res);
+    EXPECT_EQ(block.header.encoded, header);
+    EXPECT_EQ(block.header.number, 17'000'000u);
+    EXPECT_EQ(block.header.gas_used, 21'000u);
+    EXPECT_EQ(hex(block.header.extra_data), "cafe");
+    EXPECT_EQ(block.header.base_fee.value(), 7u);
+    EXPECT_EQ(block.header.withdrawals_root.value(), 0x07_bytes32);
+    ASSERT_EQ(block.body.transactions.size(), 3u);
+    EXPECT_EQ(block.body.transactions[0].kind, Transaction::Kind::legacy);
+    EXPECT_EQ(block.body.transactions[1].kind, Transaction::Kind::eip1559);
+    EXPECT_EQ(block.body.transactions[1].encoded, typed_tx);
+    EXPECT_EQ(block.body.transactions[2].encoded, legacy_tx);
+    EXPECT_TRUE(block.body.ommers.payload.empty());
+    ASSERT_TRUE(block.body.withdrawals.has_value());
+    ASSERT_EQ(block.body.withdrawals->size(), 2u);
+    EXPECT_EQ((*block.body.withdrawals)[0].recipient, 0x0a_address);
+    EXPECT_EQ((*block.body.withdrawals)[0].amount_in_gwei, 1000u);
+
+    const auto info = to_block_info(block);
+    EXPECT_EQ(info.number, 17'000'000);
+    EXPECT_EQ(info.timestamp, 1'700'000'000);
+    EXPECT_EQ(info.gas_limit, 30'000'000);
+    EXPECT_EQ(info.coinbase, 0xc0_address);
+    EXPECT_EQ(info.prev_randao, 0x06_bytes32);
+    EXPECT_EQ(info.base_fee, 7u);
+    EXPECT_EQ(info.withdrawals.size(), 2u);
+
+    // The body alone, before Shanghai, with an ommer.
+    const auto body = rlp::encode_tuple(
+        transactions, std::vector<RawRlp>{{make_header(false)}});
+    const auto body_res = decode_block_body(body);
+    ASSERT_FALSE(error_of(body_res));
+    EXPECT_EQ(std::get<BlockBodyView>(body_res).transactions.size(), 3u);
+    EXPECT_FALSE(std::get<BlockBodyView>(body_res).withdrawals.has_value());
+}
+
+TEST(state_block_decode, block_invalid)
+{
+    const auto header = make_header(false);
+    const std::vector<RawRlp> no_items;
+
+    EXPECT_EQ(error_of(decode_block(rlp::encode_tuple(RawRlp{header}, no_items))),
+        make_error_code(RLP_TOO_FEW_ELEMENTS));
+    EXPECT_EQ(error_of(decode_block(
+                  rlp::encode_tuple(RawRlp{header}, no_items, no_items, no_items, no_items))),
+        make_error_code(RLP_TOO_MANY_ELEMENTS));
+    EXPECT_EQ(error_of(decode_block(rlp::encode_tuple(RawRlp{header}, no_items, no_items) + "c0"_hex)),
+        make_error_code(RLP_TRAILING_BYTES));
+
+    // Transaction type byte without the string wrapping.
+    EXPECT_EQ(error_of(decode_block(rlp::encode_tuple(RawRlp{header},
+                  std::vector<RawRlp>{{"02c0"_hex}}, no_items))),
+        make_error_code(RLP_INPUT_TOO_SHORT));
+
+    // Ommer being not a valid header.
+    EXPECT_EQ(error_of(decode_block(rlp::encode_tuple(RawRlp{header}, no_items,
+                  std::vector<RawRlp>{{"c180"_hex}}))),
+        make_error_code(RLP_UNEXPECTED_SIZE));
+
+    // Header with too many fields.
+    const auto long_header = rlp::encode_tuple(0x01_bytes32, 0x02_bytes32, 0xc0_address,
+        0x03_bytes32, 0x04_bytes32, 0x05_bytes32, bytes_view{bytes(256, 0)}, uint64_t{0},
+        uint64_t{0}, uint64_t{0}, uint64_t{0}, uint64_t{0}, bytes_view{}, 0x06_bytes32,
+        bytes_view{bytes(8, 0)}, uint64_t{7}, 0x07_bytes32, uint64_t{0});
+    EXPECT_EQ(error_of(decode_block_header(long_header)), make_error_code(RLP_TOO_MANY_ELEMENTS));
+}
+
+TEST(state_block_decode, recover_senders)
+{
+    // The EIP-155 example transaction, the EIP-1559 transaction and the pre-EIP-155 one.
+    const bytes encoded[]{
+        "f86c098504a817c800825208943535353535353535353535353535353535353535880de0b6b3a76400008025a028ef61340bd939bc2195fe537567866003e1a15d3c71ff63e1590620aa636276a067cbe9d8997f761aecb703304b3800ccf555c9f3dc64214b297fb1966a3b6d83"_hex,
+        "02f8a60180843b9aca0085174876e80082c35094000000000000000000000000000000000000c0de01821234f838f794000000000000000000000000000000000000c0dee1a0000000000000000000000000000000000000000000000000000000000000000180a0d415ef5d8acdf8b8626ce3f90f1afd286e17f4321f6f8325f1b5059eb808d7aea011b2c324056c751415ef5348bc06a3394b9ebf95e52bb2dd8ca86f587f7eb11a"_hex,
+        "f85180843b9aca0082520880808260001ca05b652b14a10daabab121f611574b2be2f8b1b3f2aa659ffeac5d7d8f688612b9a03228b41f40f344b1e3975e5e2a5964bf19a5866a171d3fdb46806e0a861fa626"_hex,
+    };
+    std::vector<TransactionView> txs;
+    for (const auto& e : encoded)
+    {
+        const auto res = decode_transaction(e);
+        ASSERT_FALSE(error_of(res));
+        txs.push_back(std::get<TransactionView>(res));
+    }
+
+    // The same transaction with the "high s" signature (n - s and the flipped parity)
+    // recovers the same public key, but is invalid since EIP-2.
+    static constexpr auto n =
+        0xfffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141_u256;
+    auto high_s = txs[1];
+    high_s.s = n - high_s.s;
+    high_s.v ^= 1;
+    txs.push_back(high_s);
+
+    // The unsupported "v" value.
+    auto invalid_v = txs[2];
+    invalid_v.v = 29;
+    txs.push_back(invalid_v);
+
+    const auto senders = recover_senders(txs);
+    ASSERT_EQ(senders.size(), txs.size());
+    EXPECT_EQ(senders[0], 0x9d8a62f656a8d1615c1294fd71e9cfb3e4855a4f_address);
+    EXPECT_EQ(senders[1], 0x1be31a94361a391bbafb2a4ccd704f57dc04d4bb_address);
+    EXPECT_EQ(senders[2], 0x1be31a94361a391bbafb2a4ccd704f57dc04d4bb_address);
+    EXPECT_EQ(senders[3], std::nullopt);
+    EXPECT_EQ(senders[4], std::nullopt);
+
+    EXPECT_TRUE(recover_senders({}).empty());
+}
+
+TEST(state_block_decode, recover_senders_multithreaded)
+{
+    const auto encoded =
+        "f86c098504a817c800825208943535353535353535353535353535353535353535880de0b6b3a76400008026a0d7da18e28d6463ea9b7e93402aec0e122b76a669e04ad12f5f4b913f772751efa028bdabb1e5b3e309e94c976184f4692781f3c2636544e21c2bca301b812850a6"_hex;
+    const auto res = decode_transaction(encoded);
+    ASSERT_FALSE(error_of(res));
+    const auto& tx = std::get<TransactionView>(res);
+
+    // Many chunks, some signatures are invalid (modified r).
+    std::vector<TransactionView> txs(100, tx);
+    for (size_t i = 0; i < txs.size(); i += 7)
+        txs[i].r += 1;
+
+    const auto senders = recover_senders(txs, 1);
+    ASSERT_EQ(senders.size(), txs.size());
+    EXPECT_EQ(senders[1], 0x9d8a62f656a8d1615c1294fd71e9cfb3e4855a4f_address);
+    for (const auto num_threads : {2u, 3u, 8u})
+        EXPECT_EQ(recover_senders(txs, num_threads), senders) << num_threads;
+}
@@ -0,0 +1,131 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmone/evmone.h>
+#include <gtest/gtest.h>
+#include <test/state/host.hpp>
+#include <test/state/mpt_hash.hpp>
+#include <test/utils/bytecode.hpp>
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+using namespace evmc::literals;
+using namespace evmone;
+using namespace evmone::state;
+
+namespace
+{
+constexpr auto Sender = 0xe100713FC15400D1e94096a545879E7c6407001e_address;
+constexpr auto To = 0xc0de_address;
+constexpr auto Destructible = 0xde57_address;
+
+State make_parent()
+{
+    State parent;
+    parent.insert(Sender, {.balance = 1'000'000'000'000'000});
+    parent.insert(To, {.storage = {{0x01_bytes32, {0x01_bytes32, 0x01_bytes32}},
+                                      {0x02_bytes32, {0x02_bytes32, 0x02_bytes32}}},
+                          .code = sstore(1, add(sload(1), 1))});
+    parent.insert(Destructible, {.balance = 1, .code = selfdestruct(0xbeef_address)});
+    return parent;
+}
+}  // namespace
+
+TEST(state_fork, reads_parent_and_isolates_modifications)
+{
+    const auto parent = make_parent();
+    auto child = parent.fork();
+
+    ASSERT_NE(child.find(To), nullptr);
+    EXPECT_EQ(child.get(To).code, parent.peek(To)->code);
+    EXPECT_EQ(child.find(0xdead_address), nullptr);
+
+    auto& acc = child.get(To);
+    child.get_storage(To, acc, 0x01_bytes32).current = 0xff_bytes32;
+    acc.balance = 7;
+    child.insert(0x0e_address, {.nonce = 1});
+    child.erase(Destructible);
+
+    EXPECT_EQ(child.peek_storage(To, 0x01_bytes32), 0xff_bytes32);
+    EXPECT_EQ(child.peek_storage(To, 0x02_bytes32), 0x02_bytes32);
+    EXPECT_EQ(child.find(Destructible), nullptr);
+    EXPECT_EQ(child.peek(Destructible), nullptr);
+
+    EXPECT_EQ(parent.peek_storage(To, 0x01_bytes32), 0x01_bytes32);
+    EXPECT_EQ(parent.peek(To)->balance, 0);
+    EXPECT_EQ(parent.peek(0x0e_address), nullptr);
+    EXPECT_NE(parent.peek(Destructible), nullptr);
+}
+
+TEST(state_fork, nested_forks)
+{
+    const auto parent = make_parent();
+    auto child = parent.fork();
+    auto& acc = child.get(To);
+    child.get_storage(To, acc, 0x01_bytes32).current = 0x11_bytes32;
+    child.erase(Destructible);
+
+    auto grandchild = child.fork();
+    EXPECT_EQ(grandchild.peek_storage(To, 0x01_bytes32), 0x11_bytes32);
+    EXPECT_EQ(grandchild.peek_storage(To, 0x02_bytes32), 0x02_bytes32);
+    EXPECT_EQ(grandchild.find(Destructible), nullptr);
+
+    // Recreate the erased account: the storage of the lower layers is not visible.
+    grandchild.erase(To);
+    grandchild.insert(To, {});
+    EXPECT_EQ(grandchild.peek_storage(To, 0x02_bytes32), bytes32{});
+    auto& new_acc = grandchild.get(To);
+    EXPECT_EQ(grandchild.get_storage(To, new_acc, 0x01_bytes32).current, bytes32{});
+    EXPECT_EQ(child.peek_storage(To, 0x01_bytes32), 0x11_bytes32);
+}
+
+TEST(state_fork, mpt_hash_merges_layers)
+{
+    const auto parent = make_parent();
+    EXPECT_EQ(mpt_hash(parent), mpt_hash(parent.get_accounts()));
+
+    auto child = parent.fork();
+    EXPECT_EQ(mpt_hash(child), mpt_hash(parent.get_accounts()));
+
+    auto copy = parent;
+    for (auto* s : {&child, &copy})
+    {
+        auto& acc = s->get(To);
+        s->get_storage(To, acc, 0x02_bytes32).current = 0x22_bytes32;
+        s->erase(Destructible);
+    }
+    EXPECT_EQ(mpt_hash(child), mpt_hash(copy.get_accounts()));
+
+    auto grandchild = child.fork();
+    grandchild.get(Sender).nonce = 5;
+    copy.get(Sender).nonce = 5;
+    EXPECT_EQ(mpt_hash(grandchild), mpt_hash(copy.get_accounts()));
+    EXPECT_NE(mpt_hash(child), mpt_hash(copy.get_accounts()));
+}
+
+TEST(state_fork, transactions_on_fork_match_copy)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    const BlockInfo block{.gas_limit = 1'000'000, .coinbase = 0xcb_address, .base_fee = 1};
+    const auto make_tx = [](const address& to) {
+        return Transaction{.gas_limit = 100'000,
+            .max_gas_price = 2,
+            .max_priority_gas_price = 1,
+            .sender = Sender,
+            .to = to};
+    };
+    const Transaction txs[]{make_tx(To), make_tx(Destructible), make_tx(To), make_tx(0x0e_address)};
+
+    const auto parent = make_parent();
+    auto child = parent.fork();
+    auto copy = parent;
+    const auto res_child = apply_block(child, block, txs, EVMC_SHANGHAI, vm);
+    const auto res_copy = apply_block(copy, block, txs, EVMC_SHANGHAI, vm);
+    ASSERT_TRUE(holds_alternative<BlockResult>(res_child));
+    ASSERT_TRUE(holds_alternative<BlockResult>(res_copy));
+    EXPECT_EQ(mpt_hash(get<BlockResult>(res_child).receipts),
+        mpt_hash(get<BlockResult>(res_copy).receipts));
+    EXPECT_EQ(mpt_hash(child), mpt_hash(copy.get_accounts()));
+    EXPECT_EQ(mpt_hash(parent), mpt_hash(make_parent().get_accounts()));
+}
@@ -0,0 +1,348 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmone/evmone.h>
+#include <gtest/gtest.h>
+#include <test/state/mmap_state_backend.hpp>
+#include <test/state/mpt_hash.hpp>
+#include <test/state/prefetch.hpp>
+#include <test/state/state.hpp>
+#include <test/utils/bytecode.hpp>
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+using namespace evmc::literals;
+using namespace evmone;
+using namespace evmone::state;
+
+namespace
+{
+constexpr auto Sender = 0xe100713FC15400D1e94096a545879E7c6407001e_address;
+constexpr auto To = 0xc0de_address;
+constexpr auto Destructible = 0xde57_address;
+
+const bytes to_code = sstore(1, add(sload(1), 1));
+
+class state_mmap_backend : public testing::Test
+{
+protected:
+    std::filesystem::path path;
+
+    void SetUp() override
+    {
+        const auto name = testing::UnitTest::GetInstance()->current_test_info()->name();
+        path = std::filesystem::temp_directory_path() /
+               ("evmone_state_mmap_backend_" + std::string{name} + ".db");
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override { std::filesystem::remove(path); }
+};
+
+/// Inserts the accounts of the pre-state into the state.
+void insert_pre_state(State& state)
+{
+    state.insert(Sender, {.balance = 1'000'000'000'000'000});
+    state.insert(To, {.storage = {{0x01_bytes32, {0x01_bytes32, 0x01_bytes32}},
+                                     {0x02_bytes32, {0x02_bytes32, 0x02_bytes32}}},
+                         .code = to_code});
+    state.insert(Destructible, {.balance = 1, .code = selfdestruct(0xbeef_address)});
+}
+}  // namespace
+
+TEST_F(state_mmap_backend, commit_and_reopen)
+{
+    {
+        MmapStateBackend backend{path};
+        State state{backend};
+        EXPECT_EQ(state.find(To), nullptr);
+        insert_pre_state(state);
+        state.commit();
+        EXPECT_EQ(backend.num_segments(), 1u);
+    }
+
+    MmapStateBackend backend{path};
+    EXPECT_EQ(backend.num_segments(), 1u);
+    const auto acc = backend.get_account(To);
+    ASSERT_NE(acc, nullptr);
+    EXPECT_EQ(acc->code, to_code);
+    EXPECT_EQ(backend.get_account(Sender)->balance, 1'000'000'000'000'000);
+    EXPECT_EQ(backend.get_account(0xdead_address), nullptr);
+    EXPECT_EQ(backend.get_storage(To, 0x01_bytes32), 0x01_bytes32);
+    EXPECT_EQ(backend.get_storage(To, 0x03_bytes32), 0x00_bytes32);
+
+    auto keys = backend.get_storage_keys(To);
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(keys, (std::vector{0x01_bytes32, 0x02_bytes32}));
+
+    size_t num_accounts = 0;
+    backend.for_each_address([&](const address&) { ++num_accounts; });
+    EXPECT_EQ(num_accounts, 3u);
+}
+
+TEST_F(state_mmap_backend, modifications_in_new_segment)
+{
+    MmapStateBackend backend{path, false};
+    {
+        State state{backend};
+        insert_pre_state(state);
+        state.commit();
+    }
+
+    State state{backend};
+    auto& acc = state.get(To);
+    state.get_storage(To, acc, 0x01_bytes32).current = 0x00_bytes32;
+    state.get_storage(To, acc, 0x03_bytes32).current = 0x03_bytes32;
+    state.get(Sender).nonce = 1;
+    state.commit();
+
+    EXPECT_EQ(backend.num_segments(), 2u);
+    EXPECT_EQ(backend.get_storage(To, 0x01_bytes32), 0x00_bytes32);
+    EXPECT_EQ(backend.get_storage(To, 0x02_bytes32), 0x02_bytes32);
+    EXPECT_EQ(backend.get_storage(To, 0x03_bytes32), 0x03_bytes32);
+    EXPECT_EQ(backend.get_account(Sender)->nonce, 1u);
+    EXPECT_EQ(backend.get_account(To)->code, to_code);
+
+    auto keys = backend.get_storage_keys(To);
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(keys, (std::vector{0x02_bytes32, 0x03_bytes32}));
+
+    // Nothing modified, no new segment.
+    State unmodified{backend};
+    std::ignore = unmodified.find(To);
+    unmodified.commit();
+    EXPECT_EQ(backend.num_segments(), 2u);
+}
+
+TEST_F(state_mmap_backend, erase_and_recreate)
+{
+    MmapStateBackend backend{path};
+    {
+        State state{backend};
+        insert_pre_state(state);
+        state.commit();
+    }
+    {
+        State state{backend};
+        state.erase(To);
+        state.erase(Destructible);
+        state.insert(To, {.nonce = 1, .storage = {{0x03_bytes32, {0x03_bytes32}}}});
+        state.commit();
+    }
+
+    EXPECT_EQ(backend.get_account(Destructible), nullptr);
+    const auto acc = backend.get_account(To);
+    ASSERT_NE(acc, nullptr);
+    EXPECT_EQ(acc->nonce, 1u);
+    EXPECT_TRUE(acc->code.empty());
+    EXPECT_EQ(backend.get_storage(To, 0x01_bytes32), 0x00_bytes32);
+    EXPECT_EQ(backend.get_storage(To, 0x03_bytes32), 0x03_bytes32);
+    EXPECT_EQ(backend.get_storage_keys(To), std::vector{0x03_bytes32});
+
+    std::vector<address> addresses;
+    backend.for_each_address([&](const address& addr) { addresses.push_back(addr); });
+    std::sort(addresses.begin(), addresses.end());
+    EXPECT_EQ(addresses, (std::vector{To, Sender}));
+}
+
+TEST_F(state_mmap_backend, apply_block_same_as_in_memory)
+{
+    static constexpr auto Coinbase = 0xc014bace_address;
+    evmc::VM vm{evmc_create_evmone()};
+    BlockInfo block;
+    block.gas_limit = 1'000'000;
+    block.coinbase = Coinbase;
+    block.base_fee = 999;
+    const Transaction tx{.gas_limit = 100'000,
+        .max_gas_price = block.base_fee + 1,
+        .max_priority_gas_price = 1,
+        .sender = Sender,
+        .to = To};
+    auto destruct_tx = tx;
+    destruct_tx.to = Destructible;
+    const Transaction txs[]{tx, tx, destruct_tx};
+
+    State in_memory;
+    insert_pre_state(in_memory);
+    const auto pre_hash = mpt_hash(in_memory);
+    ASSERT_TRUE(holds_alternative<BlockResult>(
+        apply_block(in_memory, block, txs, EVMC_SHANGHAI, vm)));
+
+    {
+        MmapStateBackend backend{path};
+        State state{backend};
+        insert_pre_state(state);
+        state.commit();
+        EXPECT_EQ(mpt_hash(state), pre_hash);
+
+        const auto res = apply_block(state, block, txs, EVMC_SHANGHAI, vm);
+        ASSERT_TRUE(holds_alternative<BlockResult>(res)) << get<std::error_code>(res).message();
+        EXPECT_EQ(mpt_hash(state), mpt_hash(in_memory));
+        state.commit();
+    }
+
+    MmapStateBackend backend{path};
+    const State reopened{backend};
+    EXPECT_EQ(mpt_hash(reopened), mpt_hash(in_memory));
+    EXPECT_EQ(backend.get_account(Destructible), nullptr);
+    EXPECT_EQ(backend.get_storage(To, 0x01_bytes32), 0x03_bytes32);
+}
+
+TEST_F(state_mmap_backend, async_prefetcher)
+{
+    evmc::VM vm{evmc_create_evmone()};
+    const BlockInfo block{.gas_limit = 1'000'000, .coinbase = 0xcb_address};
+    std::vector<Transaction> txs(6);
+    for (auto& tx : txs)
+        tx = {.gas_limit = 100'000, .max_gas_price = 1, .sender = Sender, .to = To};
+
+    MmapStateBackend backend{path};
+    {
+        State state{backend};
+        insert_pre_state(state);
+        state.commit();
+    }
+
+    AsyncPrefetcher prefetcher{backend};
+    State state{backend};
+    const auto res = apply_block(state, block, txs, EVMC_SHANGHAI, vm, &prefetcher);
+    ASSERT_TRUE(holds_alternative<BlockResult>(res)) << get<std::error_code>(res).message();
+    prefetcher.wait();
+
+    // The sender, the coinbase and the recipient with the slot 1 found in its code.
+    EXPECT_EQ(prefetcher.num_accounts(), 3 * txs.size());
+    EXPECT_EQ(prefetcher.num_storage_slots(), txs.size());
+
+    state.commit();
+    EXPECT_EQ(backend.get_storage(To, 0x01_bytes32), 0x07_bytes32);
+
+    // The prefetcher can be used after the commit.
+    prefetcher.prefetch({.accounts = {To}, .storage = {{To, 0x01_bytes32}}});
+    prefetcher.wait();
+    EXPECT_EQ(prefetcher.num_accounts(), 3 * txs.size() + 1);
+    EXPECT_EQ(prefetcher.num_storage_slots(), txs.size() + 1);
+}
+
+TEST_F(state_mmap_backend, compact)
+{
+    MmapStateBackend backend{path, false};
+    {
+        State state{backend};
+        insert_pre_state(state);
+        state.commit();
+    }
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        State state{backend};
+        auto& acc = state.get(To);
+        state.get_storage(To, acc, 0x01_bytes32).current = bytes32{i};
+        state.erase(Destructible);
+        state.commit();
+    }
+    const auto hash = mpt_hash(State{backend});
+    const auto size = std::filesystem::file_size(path);
+    EXPECT_EQ(backend.num_segments(), 4u);
+
+    backend.compact();
+    EXPECT_EQ(backend.num_segments(), 1u);
+    EXPECT_LT(std::filesystem::file_size(path), size);
+    EXPECT_EQ(mpt_hash(State{backend}), hash);
+    EXPECT_EQ(backend.get_storage(To, 0x01_bytes32), bytes32{2});
+    EXPECT_EQ(backend.get_storage(To, 0x02_bytes32), 0x02_bytes32);
+    EXPECT_EQ(backend.get_account(Destructible), nullptr);
+    EXPECT_EQ(backend.dead_size(), 0u);
+}
+
+TEST_F(state_mmap_backend, auto_merge)
+{
+    std::unordered_map<address, std::unordered_map<bytes32, bytes32>> expected;
+    {
+        MmapStateBackend backend{path};
+        for (uint64_t i = 1; i <= 200; ++i)
+        {
+            State state{backend};
+            const auto addr = address{i % 7 + 1};
+            if (i % 13 == 0)
+            {
+                // Erase and recreate the account so it shadows its records in older segments.
+                state.erase(addr);
+                state.insert(addr, {.nonce = i});
+                expected[addr].clear();
+            }
+            auto& acc = state.get_or_insert(addr, {.nonce = i});
+            const auto key = bytes32{i % 5};
+            const auto value = i % 3 == 0 ? bytes32{} : bytes32{i};
+            state.get_storage(addr, acc, key).current = value;
+            expected[addr][key] = value;
+            state.commit();
+
+            EXPECT_LE(backend.num_segments(), 8u) << i;
+            EXPECT_LE(backend.dead_size(), std::filesystem::file_size(path) / 2) << i;
+        }
+    }
+
+    MmapStateBackend backend{path};
+    EXPECT_LE(backend.num_segments(), 8u);
+    size_t num_accounts = 0;
+    backend.for_each_address([&](const address&) { ++num_accounts; });
+    EXPECT_EQ(num_accounts, expected.size());
+    for (const auto& [addr, slots] : expected)
+    {
+        ASSERT_NE(backend.get_account(addr), nullptr);
+        size_t num_nonzero = 0;
+        for (const auto& [key, value] : slots)
+        {
+            EXPECT_EQ(backend.get_storage(addr, key), value);
+            num_nonzero += !is_zero(value);
+        }
+        EXPECT_EQ(backend.get_storage_keys(addr).size(), num_nonzero);
+    }
+}
+
+TEST_F(state_mmap_backend, merge_keeps_code)
+{
+    MmapStateBackend backend{path};
+    {
+        State state{backend};
+        insert_pre_state(state);
+        state.commit();
+    }
+    // Small commits are merged into the first segment, the code stays where it was written.
+    for (uint8_t i = 0; i < 10; ++i)
+    {
+        State state{backend};
+        state.get(Sender).nonce = i;
+        state.commit();
+    }
+    EXPECT_LE(backend.num_segments(), 2u);
+    EXPECT_EQ(backend.get_account(To)->code, to_code);
+    EXPECT_EQ(backend.get_account(Sender)->nonce, 9u);
+
+    backend.compact();
+    EXPECT_EQ(backend.num_segments(), 1u);
+    EXPECT_EQ(backend.dead_size(), 0u);
+    EXPECT_EQ(backend.get_account(To)->code, to_code);
+    EXPECT_EQ(backend.get_account(Destructible)->code, bytes{selfdestruct(0xbeef_address)});
+}
+
+TEST_F(state_mmap_backend, invalid_file)
+{
+    std::ofstream{path} << "not a state file, but long enough to contain the file header";
+    EXPECT_THROW(MmapStateBackend{path}, std::invalid_argument);
+}
+
+TEST_F(state_mmap_backend, other_byte_order)
+{
+    MmapStateBackend{path};
+    {
+        // Swap the byte order mark following the magic and the end of the segments.
+        std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+        file.seekp(16);
+        file.write("\x01\x02\x03\x04", 4);
+    }
+    EXPECT_THROW(MmapStateBackend{path}, std::invalid_argument);
+}
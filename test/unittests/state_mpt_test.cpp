@@ -331,3 +331,28 @@ TEST(state_mpt, trie_topologies)
         }
     }
 }
+
+TEST(state_mpt, arena_memory)
+{
+    MPT trie;
+    EXPECT_EQ(trie.arena_capacity(), 0u);
+    EXPECT_EQ(trie.arena_bytes_allocated(), 0u);
+
+    // The key and the value are copied to the arena together with the leaf node.
+    const auto key = 0x01_bytes32;
+    const auto value = bytes(10, 0xaa);
+    trie.insert(key, value);
+    const auto single = trie.arena_bytes_allocated();
+    EXPECT_GT(single, sizeof(key) + value.size());
+    EXPECT_LE(single, trie.arena_capacity());
+
+    for (uint8_t i = 2; i < 100; ++i)
+        trie.insert(bytes32{i}, value);
+    EXPECT_GT(trie.arena_bytes_allocated(), 99 * single);
+    EXPECT_LE(trie.arena_bytes_allocated(), trie.arena_capacity());
+
+    // A value too big for the shared blocks gets a dedicated one.
+    const auto capacity = trie.arena_capacity();
+    trie.insert(0xff_bytes32, bytes(2000, 0xbb));
+    EXPECT_GE(trie.arena_capacity(), capacity + 2000);
+}
@@ -0,0 +1,201 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <test/state/precompiles_cache.hpp>
+#include <test/state/precompiles_cache_file.hpp>
+#include <test/utils/utils.hpp>
+#include <fstream>
+
+using namespace evmc::literals;
+using namespace evmone;
+using namespace evmone::state;
+
+namespace
+{
+using Output = PrecompilesCacheFile::Output;
+
+constexpr auto K1 = 0x01_bytes32;
+constexpr auto K2 = 0x02_bytes32;
+constexpr auto K3 = 0x03_bytes32;
+
+const bytes out1 = "aabbcc"_hex;
+const bytes out2 = "0102030405060708"_hex;
+
+/// Returns the output of the successful result.
+bytes found_output(const PrecompilesCacheFile& file, PrecompileId id, const hash256& key)
+{
+    const auto r = file.find(id, key);
+    if (!r.has_value() || !r->has_value())
+        return {};
+    return bytes{**r};
+}
+
+class state_precompiles_cache_file : public testing::Test
+{
+protected:
+    std::filesystem::path path;
+
+    void SetUp() override
+    {
+        const auto name = testing::UnitTest::GetInstance()->current_test_info()->name();
+        path = std::filesystem::temp_directory_path() /
+               ("evmone_precompiles_cache_" + std::string{name} + ".bin");
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override { std::filesystem::remove(path); }
+};
+}  // namespace
+
+TEST_F(state_precompiles_cache_file, create_empty)
+{
+    const PrecompilesCacheFile file{path};
+    EXPECT_TRUE(std::filesystem::exists(path));
+    EXPECT_FALSE(file.find(PrecompileId::ecrecover, K1).has_value());
+    EXPECT_TRUE(file.entries().empty());
+}
+
+TEST_F(state_precompiles_cache_file, write_and_find)
+{
+    PrecompilesCacheFile::write(path, {
+                                          {PrecompileId::sha256, K2, out2},
+                                          {PrecompileId::ecrecover, K1, out1},
+                                          {PrecompileId::expmod, K1, std::nullopt},
+                                          {PrecompileId::sha256, K1, bytes{}},
+                                      });
+
+    const PrecompilesCacheFile file{path};
+    EXPECT_EQ(found_output(file, PrecompileId::ecrecover, K1), out1);
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K2), out2);
+
+    const auto empty = file.find(PrecompileId::sha256, K1);
+    ASSERT_TRUE(empty.has_value());
+    ASSERT_TRUE(empty->has_value());
+    EXPECT_TRUE((*empty)->empty());
+
+    const auto failure = file.find(PrecompileId::expmod, K1);
+    ASSERT_TRUE(failure.has_value());
+    EXPECT_FALSE(failure->has_value());
+
+    EXPECT_FALSE(file.find(PrecompileId::ecrecover, K2).has_value());
+    EXPECT_FALSE(file.find(PrecompileId::ripemd160, K1).has_value());
+    EXPECT_EQ(file.entries().size(), 4u);
+}
+
+TEST_F(state_precompiles_cache_file, write_duplicates)
+{
+    PrecompilesCacheFile::write(path, {
+                                          {PrecompileId::sha256, K1, out1},
+                                          {PrecompileId::sha256, K2, out1},
+                                          {PrecompileId::sha256, K1, out2},
+                                      });
+
+    const PrecompilesCacheFile file{path};
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K1), out2);
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K2), out1);
+    EXPECT_EQ(file.entries().size(), 2u);
+}
+
+TEST_F(state_precompiles_cache_file, append)
+{
+    PrecompilesCacheFile::write(path, {{PrecompileId::sha256, K1, out1}});
+    {
+        PrecompilesCacheFile file{path};
+        file.append(PrecompileId::sha256, K2, Output{out2});
+        file.append(PrecompileId::expmod, K3, std::nullopt);
+        file.append(PrecompileId::sha256, K1, Output{out2});
+    }
+
+    const PrecompilesCacheFile file{path};
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K1), out2);
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K2), out2);
+    const auto failure = file.find(PrecompileId::expmod, K3);
+    ASSERT_TRUE(failure.has_value());
+    EXPECT_FALSE(failure->has_value());
+    EXPECT_EQ(file.entries().size(), 3u);
+}
+
+TEST_F(state_precompiles_cache_file, compact)
+{
+    PrecompilesCacheFile::write(path, {{PrecompileId::sha256, K1, out1}});
+    {
+        PrecompilesCacheFile file{path};
+        file.append(PrecompileId::sha256, K2, Output{out2});
+        file.append(PrecompileId::sha256, K1, Output{out2});
+    }
+    const auto size_before = std::filesystem::file_size(path);
+
+    PrecompilesCacheFile::compact(path);
+    EXPECT_LT(std::filesystem::file_size(path), size_before);
+
+    const PrecompilesCacheFile file{path};
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K1), out2);
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K2), out2);
+    EXPECT_EQ(file.entries().size(), 2u);
+}
+
+TEST_F(state_precompiles_cache_file, truncated_log)
+{
+    {
+        PrecompilesCacheFile file{path};
+        file.append(PrecompileId::sha256, K1, Output{out1});
+        file.append(PrecompileId::sha256, K2, Output{out2});
+    }
+    // Cut off the end of the last output as if the write was interrupted.
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+
+    {
+        PrecompilesCacheFile file{path};
+        EXPECT_EQ(found_output(file, PrecompileId::sha256, K1), out1);
+        EXPECT_FALSE(file.find(PrecompileId::sha256, K2).has_value());
+        file.append(PrecompileId::sha256, K3, Output{out2});
+    }
+
+    const PrecompilesCacheFile file{path};
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K1), out1);
+    EXPECT_FALSE(file.find(PrecompileId::sha256, K2).has_value());
+    EXPECT_EQ(found_output(file, PrecompileId::sha256, K3), out2);
+}
+
+TEST_F(state_precompiles_cache_file, invalid)
+{
+    std::ofstream{path} << "[{}, {}]\n";
+    EXPECT_THROW(PrecompilesCacheFile{path}, std::invalid_argument);
+
+    std::ofstream{path} << "evm";
+    EXPECT_THROW(PrecompilesCacheFile{path}, std::invalid_argument);
+}
+
+TEST_F(state_precompiles_cache_file, cache_stub_and_dump)
+{
+    const auto input = "0badf00d"_hex;
+    PrecompilesCacheFile::write(path, {{PrecompileId::sha256, keccak256(input), out1}});
+    auto dump_path = path;
+    dump_path += ".dump";
+    std::filesystem::remove(dump_path);
+
+    {
+        Cache cache{Cache::DefaultMemoryBudget, path, dump_path};
+        const auto r = cache.find(PrecompileId::sha256, input, 10);
+        ASSERT_TRUE(r.has_value());
+        EXPECT_EQ(r->gas_left, 10);
+        EXPECT_EQ(bytes(r->output_data, r->output_size), out1);
+        EXPECT_FALSE(cache.find(PrecompileId::ecrecover, input, 10).has_value());
+
+        const evmc::Result result{EVMC_SUCCESS, 0, 0, out2.data(), out2.size()};
+        cache.insert(PrecompileId::ecrecover, input, result);
+        cache.insert(PrecompileId::ecrecover, input, result);
+        cache.insert(PrecompileId::identity, input, result);
+        cache.insert(PrecompileId::expmod, input, evmc::Result{EVMC_PRECOMPILE_FAILURE});
+    }
+
+    const PrecompilesCacheFile dump{dump_path};
+    EXPECT_EQ(found_output(dump, PrecompileId::ecrecover, keccak256(input)), out2);
+    const auto failure = dump.find(PrecompileId::expmod, keccak256(input));
+    ASSERT_TRUE(failure.has_value());
+    EXPECT_FALSE(failure->has_value());
+    EXPECT_EQ(dump.entries().size(), 2u);
+    std::filesystem::remove(dump_path);
+}
@@ -0,0 +1,135 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+#include <test/state/precompiles_cache.hpp>
+#include <thread>
+#include <vector>
+
+using namespace evmone;
+using namespace evmone::state;
+
+namespace
+{
+bytes make_input(uint32_t seed, size_t size = 192)
+{
+    bytes r(size, 0);
+    for (size_t i = 0; i < size; ++i)
+        r[i] = static_cast<uint8_t>((seed * 0x9e3779b1 + i * 0x85ebca6b) >> 24);
+    return r;
+}
+
+evmc::Result success(const bytes& output)
+{
+    return evmc::Result{EVMC_SUCCESS, 0, 0, output.data(), output.size()};
+}
+}  // namespace
+
+TEST(state_precompiles_cache, hit_and_miss)
+{
+    Cache cache;
+    const auto input = make_input(1);
+    const auto output = make_input(2, 32);
+
+    EXPECT_FALSE(cache.find(PrecompileId::ecpairing, input, 100).has_value());
+    cache.insert(PrecompileId::ecpairing, input, success(output));
+
+    const auto r = cache.find(PrecompileId::ecpairing, input, 100);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->status_code, EVMC_SUCCESS);
+    EXPECT_EQ(r->gas_left, 100);
+    EXPECT_EQ(bytes(r->output_data, r->output_size), output);
+
+    // The same input of other precompile or the other input of the same size are not found.
+    EXPECT_FALSE(cache.find(PrecompileId::expmod, input, 100).has_value());
+    EXPECT_FALSE(cache.find(PrecompileId::ecpairing, make_input(3), 100).has_value());
+
+    const auto s = cache.stats();
+    EXPECT_EQ(s.hits, 1u);
+    EXPECT_EQ(s.misses, 3u);
+    EXPECT_EQ(s.evictions, 0u);
+    EXPECT_EQ(s.num_entries, 1u);
+    EXPECT_GT(s.memory_usage, input.size() + output.size());
+}
+
+TEST(state_precompiles_cache, failure)
+{
+    Cache cache;
+    const auto input = make_input(1, 100);
+    cache.insert(PrecompileId::expmod, input, evmc::Result{EVMC_PRECOMPILE_FAILURE});
+
+    const auto r = cache.find(PrecompileId::expmod, input, 100);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->status_code, EVMC_PRECOMPILE_FAILURE);
+    EXPECT_EQ(r->gas_left, 0);
+}
+
+TEST(state_precompiles_cache, cheap_precompiles_not_cached)
+{
+    Cache cache;
+    const auto input = make_input(1, 64);
+    cache.insert(PrecompileId::sha256, input, success(make_input(2, 32)));
+    cache.insert(PrecompileId::ecadd, input, success(make_input(2, 64)));
+    EXPECT_FALSE(cache.find(PrecompileId::sha256, input, 100).has_value());
+    EXPECT_FALSE(cache.find(PrecompileId::ecadd, input, 100).has_value());
+    EXPECT_EQ(cache.stats().num_entries, 0u);
+}
+
+TEST(state_precompiles_cache, memory_budget)
+{
+    static constexpr size_t budget = 16 * 1024;
+    Cache cache{budget};
+    const auto output = make_input(0, 32);
+    const auto hot = make_input(0);
+    cache.insert(PrecompileId::ecpairing, hot, success(output));
+
+    for (uint32_t i = 1; i <= 1000; ++i)
+    {
+        // Keep using one entry, it must never be evicted as the least recently used.
+        ASSERT_TRUE(cache.find(PrecompileId::ecpairing, hot, 0).has_value()) << i;
+        cache.insert(PrecompileId::ecpairing, make_input(i), success(output));
+    }
+
+    const auto s = cache.stats();
+    EXPECT_LE(s.memory_usage, budget);
+    EXPECT_GT(s.evictions, 0u);
+    EXPECT_EQ(s.num_entries + s.evictions, 1001u);
+
+    // The entries bigger than the shard budget are not cached.
+    const auto big_input = make_input(1, budget);
+    cache.insert(PrecompileId::ecpairing, big_input, success(output));
+    EXPECT_FALSE(cache.find(PrecompileId::ecpairing, big_input, 0).has_value());
+}
+
+TEST(state_precompiles_cache, multithreaded)
+{
+    Cache cache{64 * 1024};
+    static constexpr uint32_t num_inputs = 200;
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&cache, t] {
+            for (uint32_t i = 0; i < 2000; ++i)
+            {
+                const auto k = (i * 7 + t * 13) % num_inputs;
+                const auto input = make_input(k);
+                const auto expected_output = make_input(k + 1000, 32);
+                if (const auto r = cache.find(PrecompileId::ecpairing, input, 0); r.has_value())
+                {
+                    EXPECT_EQ(bytes(r->output_data, r->output_size), expected_output);
+                    continue;
+                }
+                cache.insert(PrecompileId::ecpairing, input, success(expected_output));
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+
+    const auto s = cache.stats();
+    EXPECT_EQ(s.hits + s.misses, 8u * 2000);
+    EXPECT_GT(s.hits, 0u);
+    EXPECT_LE(s.memory_usage, 64u * 1024);
+}
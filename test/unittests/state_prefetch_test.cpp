@@ -0,0 +1,100 @@
+// evmone: Fast Ethereum Virtual Machine implementation
+// Copyright 2023 The evmone Authors.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <evmone/evmone.h>
+#include <gtest/gtest.h>
+#include <test/state/prefetch.hpp>
+#include <test/utils/bytecode.hpp>
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+using namespace evmc::literals;
+using namespace evmone;
+using namespace evmone::state;
+
+namespace
+{
+/// Records the prefetch requests.
+class RecordingPrefetcher : public StatePrefetcher
+{
+public:
+    std::vector<PrefetchRequest> requests;
+
+    void prefetch(const PrefetchRequest& request) override { requests.push_back(request); }
+};
+}  // namespace
+
+TEST(state_prefetch, find_static_storage_keys)
+{
+    EXPECT_TRUE(find_static_storage_keys({}).empty());
+    EXPECT_TRUE(find_static_storage_keys(sstore(OP_CALLER, 1)).empty());
+
+    const auto keys = find_static_storage_keys(
+        sload(0x0102) + sstore(0, 1) + sload(0x0102) + push(0x0a_bytes32) + OP_SLOAD);
+    ASSERT_EQ(keys.size(), 3u);
+    EXPECT_EQ(keys[0], 0x00_bytes32);
+    EXPECT_EQ(keys[1], 0x0a_bytes32);
+    EXPECT_EQ(keys[2], 0x0102_bytes32);
+
+    // PUSH0 (EIP-3855).
+    EXPECT_EQ(find_static_storage_keys(bytecode{OP_PUSH0} + OP_SLOAD).size(), 1u);
+}
+
+TEST(state_prefetch, find_static_storage_keys_skips_push_data)
+{
+    // The SLOAD opcode in the push data is not an instruction.
+    EXPECT_TRUE(find_static_storage_keys(push(0x6001540000_bytes32)).empty());
+    // Truncated push at the end of the code.
+    EXPECT_TRUE(find_static_storage_keys("7f0154"_hex).empty());
+    EXPECT_TRUE(find_static_storage_keys("6001"_hex).empty());
+}
+
+TEST(state_prefetch, collect_prefetch_request)
+{
+    static constexpr auto Sender = 0x5e_address;
+    static constexpr auto To = 0xc0de_address;
+    static constexpr auto Other = 0x07_address;
+
+    const BlockInfo block{.coinbase = 0xcb_address};
+    Transaction tx{
+        .sender = Sender,
+        .to = To,
+        .access_list = {{Other, {0x03_bytes32}}},
+    };
+
+    const auto request = collect_prefetch_request(block, tx);
+    EXPECT_EQ(request.accounts, (std::vector{Sender, block.coinbase, To, Other}));
+    const std::vector<std::pair<address, bytes32>> expected_storage{{Other, 0x03_bytes32}};
+    EXPECT_EQ(request.storage, expected_storage);
+    EXPECT_EQ(request.code_storage, std::vector{To});
+
+    // Contract creation.
+    tx.to.reset();
+    EXPECT_TRUE(collect_prefetch_request(block, tx).code_storage.empty());
+}
+
+TEST(state_prefetch, apply_block_prefetches_all_transactions)
+{
+    static constexpr auto Sender = 0xe100713FC15400D1e94096a545879E7c6407001e_address;
+    static constexpr auto To = 0xc0de_address;
+
+    evmc::VM vm{evmc_create_evmone()};
+    State state;
+    state.insert(Sender, {.balance = 1'000'000'000'000'000});
+    state.insert(To, {.code = sstore(1, add(sload(1), 1))});
+    const BlockInfo block{.gas_limit = 1'000'000, .coinbase = 0xcb_address};
+
+    std::vector<Transaction> txs(6);
+    for (auto& tx : txs)
+        tx = {.gas_limit = 100'000, .max_gas_price = 1, .sender = Sender, .to = To};
+
+    RecordingPrefetcher prefetcher;
+    const auto res = apply_block(state, block, txs, EVMC_SHANGHAI, vm, &prefetcher);
+    ASSERT_TRUE(holds_alternative<BlockResult>(res)) << get<std::error_code>(res).message();
+    EXPECT_EQ(state.get(To).storage.at(0x01_bytes32).current, 0x06_bytes32);
+
+    ASSERT_EQ(prefetcher.requests.size(), txs.size());
+    for (const auto& request : prefetcher.requests)
+        EXPECT_EQ(request.code_storage, std::vector{To});
+}
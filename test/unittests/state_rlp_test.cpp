@@ -110,9 +110,9 @@ struct CustomStruct
     bytes b;
 };
 
-inline bytes rlp_encode(const CustomStruct& t)
+inline void rlp_write(rlp::Writer& w, const CustomStruct& t)
 {
-    return rlp::encode_tuple(t.a, t.b);
+    rlp::write_tuple(w, t.a, t.b);
 }
 
 TEST(state_rlp, encode_custom_struct)
@@ -127,6 +127,42 @@ TEST(state_rlp, encode_custom_struct_list)
     EXPECT_EQ(rlp::encode(v), "ca c401820203 c404820506"_hex);
 }
 
+/// The tree of lists counting the rlp_write() calls.
+struct ListTree
+{
+    std::vector<ListTree> children;
+
+    static inline int num_writes = 0;
+};
+
+inline void rlp_write(rlp::Writer& w, const ListTree& t)
+{
+    ++ListTree::num_writes;
+    rlp::write(w, t.children);
+}
+
+TEST(state_rlp, encode_nested_lists_once_per_pass)
+{
+    ListTree tree;
+    for (int i = 0; i < 10; ++i)
+        tree = ListTree{{std::move(tree)}};
+
+    ListTree::num_writes = 0;
+    EXPECT_EQ(rlp::encode(tree), "ca c9 c8 c7 c6 c5 c4 c3 c2 c1 c0"_hex);
+    EXPECT_EQ(ListTree::num_writes, 2 * 11);  // The sizing and the writing passes.
+}
+
+TEST(state_rlp, encode_many_lists)
+{
+    // More lists than the sizes stored inline in the Writer.
+    const std::vector<std::vector<uint64_t>> v(20, std::vector<uint64_t>{1, 2});
+    bytes expected = "f83c"_hex;
+    for (size_t i = 0; i < v.size(); ++i)
+        expected += "c20102"_hex;
+    EXPECT_EQ(rlp::encode(v), expected);
+    EXPECT_EQ(rlp::encoded_size(v), expected.size());
+}
+
 TEST(state_rlp, encode_uint64)
 {
     EXPECT_EQ(rlp::encode(uint64_t{0}), "80"_hex);
@@ -151,6 +187,55 @@ TEST(state_rlp, encode_uint64)
     EXPECT_EQ(rlp::encode(uint64_t{0xffffffffffffffff}), "88ffffffffffffffff"_hex);
 }
 
+TEST(state_rlp, encode_to_buffer)
+{
+    const std::vector<CustomStruct> v{{1, {0x02, 0x03}}, {4, {0x05, 0x06}}};
+    const auto expected = "d3 ca c401820203 c404820506 8180 85aabbccddee"_hex;
+    const auto tuple_size = rlp::encoded_tuple_size(v, uint64_t{0x80}, "aabbccddee"_hex);
+    EXPECT_EQ(tuple_size, expected.size());
+
+    bytes buffer(tuple_size + 1, 0xfe);
+    rlp::BufferWriter writer{buffer.data()};
+    rlp::encode_tuple_to(writer, v, uint64_t{0x80}, "aabbccddee"_hex);
+    EXPECT_EQ(writer.pos, buffer.data() + tuple_size);
+    EXPECT_EQ(bytes_view(buffer.data(), tuple_size), expected);
+    EXPECT_EQ(buffer.back(), 0xfe);
+
+    EXPECT_EQ(rlp::encoded_size(v), rlp::encode(v).size());
+    EXPECT_EQ(rlp::encoded_size(bytes_view{}), 1u);
+    EXPECT_EQ(rlp::encoded_size(uint64_t{0x7f}), 1u);
+    EXPECT_EQ(rlp::encoded_size(0xffff_u256), 3u);
+}
+
+TEST(state_rlp, keccak256_hasher)
+{
+    bytes data(1000, 0);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i);
+
+    for (const size_t size : {0u, 1u, 7u, 8u, 135u, 136u, 137u, 271u, 272u, 1000u})
+    {
+        const bytes_view input{data.data(), size};
+        for (const size_t chunk_size : {1u, 3u, 8u, 136u, 1000u})
+        {
+            Keccak256Hasher hasher;
+            for (size_t pos = 0; pos < size; pos += chunk_size)
+                hasher.write(&input[pos], std::min(chunk_size, size - pos));
+            EXPECT_EQ(hasher.finalize(), keccak256(input)) << size << " " << chunk_size;
+        }
+    }
+}
+
+TEST(state_rlp, hash_without_materializing)
+{
+    const auto x = 0xe1e2e3e4e5e6e7d0d1d2d3d4d5d6d7c0c1c2c3c4c5c6c7b0b1b2b3b4b5b6b7_u256;
+    const std::vector<uint256> v(100, x);
+
+    Keccak256Hasher hasher;
+    rlp::encode_tuple_to(hasher, uint64_t{1}, v, emptyMPTHash);
+    EXPECT_EQ(hasher.finalize(), keccak256(rlp::encode_tuple(uint64_t{1}, v, emptyMPTHash)));
+}
+
 inline bytes to_significant_be_bytes(uint64_t x)
 {
     const auto byte_width = (std::bit_width(x) + 7) / 8;
@@ -6,11 +6,17 @@
 #include <evmc/evmc.hpp>
 #include <evmc/mocked_host.hpp>
 #include <evmone/evmone.h>
+#include <evmone/execution_state.hpp>
 #include <evmone/instructions_traits.hpp>
 #include <evmone/tracing.hpp>
 #include <evmone/vm.hpp>
 #include <gmock/gmock.h>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <thread>
 
+using namespace evmc::literals;
 using namespace testing;
 
 class tracing : public Test
@@ -124,6 +130,18 @@ TEST_F(tracing, three_tracers)
     EXPECT_EQ(trace(dup1(0)), "A0:PUSH1 B0:PUSH1 C0:PUSH1 A2:DUP1 B2:DUP1 C2:DUP1 ");
 }
 
+TEST_F(tracing, filter_depth)
+{
+    vm.add_tracer(std::make_unique<OpcodeTracer>(*this, ""));
+    vm.tracer_filter.min_depth = 1;
+    vm.tracer_filter.max_depth = 2;
+
+    EXPECT_EQ(trace(add(1, 2), 0), "");
+    EXPECT_EQ(trace(add(1, 2), 1), "0:PUSH1 2:PUSH1 4:ADD ");
+    EXPECT_EQ(trace(add(1, 2), 2), "0:PUSH1 2:PUSH1 4:ADD ");
+    EXPECT_EQ(trace(add(1, 2), 3), "");
+}
+
 TEST_F(tracing, histogram)
 {
     vm.add_tracer(evmone::create_histogram_tracer(trace_stream));
@@ -308,3 +326,628 @@ TEST_F(tracing, trace_eof)
 {"error":null,"gas":0xf4237,"gasUsed":0x9,"output":""}
 )");
 }
+
+namespace
+{
+/// Replaces the time values in the profiler report which are not deterministic.
+std::string mask_profile_time(const std::string& report)
+{
+    static const std::regex csv_time{",[0-9]+\n"};
+    static const std::regex folded_time{" [0-9]+\n"};
+    const auto pos = report.find("--- # FOLDED time_ns\n");
+    const auto head = report.substr(0, pos);
+    return std::regex_replace(head.substr(0, head.find("--- # FOLDED gas")), csv_time, ",T\n") +
+           head.substr(head.find("--- # FOLDED gas")) +
+           std::regex_replace(report.substr(pos), folded_time, " T\n");
+}
+
+evmc_result success(int64_t gas_left)
+{
+    evmc_result r{};
+    r.status_code = EVMC_SUCCESS;
+    r.gas_left = gas_left;
+    return r;
+}
+}  // namespace
+
+TEST(tracing_profiler, executions)
+{
+    std::ostringstream out;
+    {
+        evmc::VM profiled_vm{evmc_create_evmone()};
+        static_cast<evmone::VM*>(profiled_vm.get_raw_pointer())
+            ->add_tracer(evmone::create_profiler_tracer(out));
+
+        const auto code = add(1, 2);
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        profiled_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        profiled_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+    }
+
+    EXPECT_EQ(mask_profile_time(out.str()), R"(--- # PROFILE sample_period=1
+code_hash,pc,opcode,samples,gas,time_ns
+321783c79d5106032d050f3845cb392249d22433e2c82c8a018a19e4462541aa,0,PUSH1,2,6,T
+321783c79d5106032d050f3845cb392249d22433e2c82c8a018a19e4462541aa,2,PUSH1,2,6,T
+321783c79d5106032d050f3845cb392249d22433e2c82c8a018a19e4462541aa,4,ADD,2,6,T
+--- # FOLDED gas
+0x321783c7;ADD 6
+0x321783c7;PUSH1 12
+--- # FOLDED time_ns
+0x321783c7;ADD T
+0x321783c7;PUSH1 T
+)");
+}
+
+TEST(tracing_profiler, call_stacks)
+{
+    std::ostringstream out;
+    const auto caller = bytecode{} + OP_JUMPDEST + OP_CALL + OP_STOP;
+    const auto callee = bytecode{} + OP_JUMPDEST + OP_STOP;
+    evmone::ExecutionState state;
+
+    auto tracer = evmone::create_profiler_tracer(out);
+    evmc_message msg{};
+    msg.gas = 1000;
+    tracer->notify_execution_start(EVMC_BERLIN, msg, caller);
+    tracer->notify_instruction_start(0, nullptr, 0, 1000, state);
+    tracer->notify_instruction_start(1, nullptr, 0, 999, state);
+    {
+        evmc_message call_msg{};
+        call_msg.gas = 500;
+        call_msg.depth = 1;
+        tracer->notify_execution_start(EVMC_BERLIN, call_msg, callee);
+        tracer->notify_instruction_start(0, nullptr, 0, 500, state);
+        tracer->notify_instruction_start(1, nullptr, 0, 499, state);
+        tracer->notify_execution_end(success(499));
+    }
+    // The CALL costs 100 plus 1 used by the callee which is attributed to the callee.
+    tracer->notify_instruction_start(2, nullptr, 0, 898, state);
+    tracer->notify_execution_end(success(898));
+    tracer.reset();
+
+    EXPECT_EQ(mask_profile_time(out.str()), R"(--- # PROFILE sample_period=1
+code_hash,pc,opcode,samples,gas,time_ns
+6cf416eff29e4cd0cd7a22b3b40625b14b55c88473f9dbc061da0cde272d7b3d,0,JUMPDEST,1,1,T
+6cf416eff29e4cd0cd7a22b3b40625b14b55c88473f9dbc061da0cde272d7b3d,1,STOP,1,0,T
+b842d7667bdf445829f69a3c239fccedf8e62625c3228ff88a63077b62937f40,0,JUMPDEST,1,1,T
+b842d7667bdf445829f69a3c239fccedf8e62625c3228ff88a63077b62937f40,1,CALL,1,100,T
+b842d7667bdf445829f69a3c239fccedf8e62625c3228ff88a63077b62937f40,2,STOP,1,0,T
+--- # FOLDED gas
+0xb842d766;0x6cf416ef;JUMPDEST 1
+0xb842d766;0x6cf416ef;STOP 0
+0xb842d766;CALL 100
+0xb842d766;JUMPDEST 1
+0xb842d766;STOP 0
+--- # FOLDED time_ns
+0xb842d766;0x6cf416ef;JUMPDEST T
+0xb842d766;0x6cf416ef;STOP T
+0xb842d766;CALL T
+0xb842d766;JUMPDEST T
+0xb842d766;STOP T
+)");
+}
+
+TEST(tracing_profiler, sampling)
+{
+    std::ostringstream out;
+    const auto code = add(1, 2);
+    evmone::ExecutionState state;
+
+    // Every second instruction is measured, the results are multiplied by 2.
+    auto tracer = evmone::create_profiler_tracer(out, 2);
+    evmc_message msg{};
+    msg.gas = 100;
+    tracer->notify_execution_start(EVMC_BERLIN, msg, code);
+    tracer->notify_instruction_start(0, nullptr, 0, 100, state);
+    tracer->notify_instruction_start(2, nullptr, 0, 97, state);
+    tracer->notify_instruction_start(4, nullptr, 0, 94, state);
+    tracer->notify_execution_end(success(91));
+    tracer.reset();
+
+    EXPECT_EQ(mask_profile_time(out.str()), R"(--- # PROFILE sample_period=2
+code_hash,pc,opcode,samples,gas,time_ns
+321783c79d5106032d050f3845cb392249d22433e2c82c8a018a19e4462541aa,0,PUSH1,1,6,T
+321783c79d5106032d050f3845cb392249d22433e2c82c8a018a19e4462541aa,4,ADD,1,6,T
+--- # FOLDED gas
+0x321783c7;ADD 6
+0x321783c7;PUSH1 6
+--- # FOLDED time_ns
+0x321783c7;ADD T
+0x321783c7;PUSH1 T
+)");
+}
+
+namespace
+{
+/// Executes the code with the binary tracer and returns the trace converted to JSON.
+std::string trace_binary(bytes_view code, evmc_revision rev = EVMC_BERLIN, bool memory = false)
+{
+    const auto name = testing::UnitTest::GetInstance()->current_test_info()->name();
+    const auto path =
+        std::filesystem::temp_directory_path() / ("evmone_trace_" + std::string{name} + ".bin");
+    {
+        evmc::VM traced_vm{evmc_create_evmone()};
+        auto tracer = evmone::create_binary_tracer(path.string(), memory);
+        EXPECT_NE(tracer, nullptr);
+        static_cast<evmone::VM*>(traced_vm.get_raw_pointer())->add_tracer(std::move(tracer));
+
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        traced_vm.execute(host, rev, msg, code.data(), code.size());
+        traced_vm.execute(host, rev, msg, code.data(), code.size());
+    }
+
+    std::ifstream in{path, std::ios::binary};
+    const bytes trace{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    in.close();
+    std::filesystem::remove(path);
+
+    std::ostringstream out;
+    EXPECT_TRUE(evmone::convert_binary_trace(trace, out));
+
+    // The truncated trace is converted up to the last complete record.
+    std::ostringstream truncated_out;
+    EXPECT_FALSE(evmone::convert_binary_trace(trace.substr(0, trace.size() - 1), truncated_out));
+    EXPECT_EQ(out.str().substr(0, truncated_out.str().size()), truncated_out.str());
+    return out.str();
+}
+}  // namespace
+
+TEST_F(tracing, binary_trace_same_as_json)
+{
+    vm.add_tracer(evmone::create_instruction_tracer(trace_stream));
+
+    const bytecode codes[] = {
+        add(2, 3),
+        push(1) + push(2) + push(3) + push(4) + OP_ADD + OP_ADD + OP_ADD,
+        push(0xabcdef) + ret_top(),
+        mstore(0, 0x0e4404) + push(3) + push(29) + OP_REVERT,
+        push(0) + OP_DUP1 + OP_SWAP1 + OP_POP + OP_POP + push(~uint64_t{0}) + push(1) + OP_SWAP1 + OP_DUP2,
+        bytecode{OP_POP},
+        bytecode{} + OP_JUMPDEST + "EF",
+        {},
+    };
+    for (const auto& code : codes)
+    {
+        const auto expected = trace(code) + trace(code);
+        EXPECT_EQ(trace_binary(code), expected) << hex(code);
+    }
+
+    const bytecode eof_codes[] = {
+        eof1_bytecode(add(2, 3) + OP_STOP, 2),
+        eof1_bytecode(push(1) + push(2) + OP_SWAPN + "00" + OP_STOP, 2),
+        eof1_bytecode(push(1) + push(2) + push(3) + OP_SWAPN + "01" + OP_DUPN + "02" + OP_STOP, 4),
+    };
+    for (const auto& code : eof_codes)
+    {
+        const auto expected = trace(code, 0, 0, EVMC_CANCUN) + trace(code, 0, 0, EVMC_CANCUN);
+        EXPECT_EQ(trace_binary(code, EVMC_CANCUN), expected) << hex(code);
+    }
+}
+
+TEST(tracing_binary, memory)
+{
+    const auto code = mstore(0, 0xabcdef) + mstore8(33, 0xff) + OP_STOP;
+    const auto json = trace_binary(code, EVMC_BERLIN, true);
+    const auto zeros = std::string(58, '0');
+    EXPECT_THAT(json, HasSubstr(R"("memorySize":0,"memory":""})"));
+    EXPECT_THAT(json, HasSubstr(R"("memorySize":32,"memory":")" + zeros + "abcdef\"}"));
+    EXPECT_THAT(json, HasSubstr(R"("memorySize":64,"memory":")" + zeros + "abcdef00ff" +
+                                std::string(60, '0') + "\"}"));
+}
+
+TEST(tracing_binary, invalid)
+{
+    std::ostringstream out;
+    EXPECT_FALSE(evmone::convert_binary_trace({}, out));
+    EXPECT_FALSE(evmone::convert_binary_trace("65766d74726163650200"_hex, out));  // Version 2.
+
+    // The instruction outside of execution.
+    EXPECT_FALSE(evmone::convert_binary_trace("65766d7472616365010002"_hex, out));
+    EXPECT_TRUE(out.str().empty());
+
+    // The memory size beyond the limit and the memory range beyond the memory size.
+    EXPECT_FALSE(evmone::convert_binary_trace(
+        "65766d7472616365010101000000000200000000000080808080808080808001"_hex, out));
+    EXPECT_FALSE(evmone::convert_binary_trace(
+        "65766d74726163650101010000000002000000000002010002ffff"_hex, out));
+
+    EXPECT_TRUE(evmone::convert_binary_trace("65766d74726163650100"_hex, out));
+}
+
+TEST(tracing_cycles, executions)
+{
+    std::ostringstream out;
+    {
+        evmc::VM cycles_vm{evmc_create_evmone()};
+        static_cast<evmone::VM*>(cycles_vm.get_raw_pointer())
+            ->add_tracer(evmone::create_cycle_tracer(out));
+
+        const auto code = add(1, 2);
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        cycles_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        cycles_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+    }
+
+    const auto report = out.str();
+    EXPECT_THAT(report, StartsWith("--- # CYCLES clock="));
+    EXPECT_THAT(report, HasSubstr("\nname,count,gas,ns,ns_per_gas,p50_ns,p90_ns,p99_ns,"
+                                  "p50_ns_per_gas,p99_ns_per_gas\n"));
+    EXPECT_THAT(report, HasSubstr("\nPUSH1,4,12,"));
+    EXPECT_THAT(report, HasSubstr("\nADD,2,6,"));
+    EXPECT_THAT(report, Not(HasSubstr("STOP")));
+}
+
+TEST(tracing_cycles, precompile_calls)
+{
+    std::ostringstream out;
+    const auto code = bytecode{} + OP_STATICCALL + OP_STATICCALL + OP_STOP;
+    evmone::ExecutionState state;
+
+    auto tracer = evmone::create_cycle_tracer(out);
+    evmc_message msg{};
+    msg.gas = 10000;
+    tracer->notify_execution_start(EVMC_BERLIN, msg, code);
+
+    // The stacks of the calls: the address, then the gas on the top.
+    intx::uint256 precompile_call_stack[]{1, 5000};
+    intx::uint256 other_call_stack[]{0xc0de, 5000};
+    tracer->notify_instruction_start(0, &precompile_call_stack[1], 2, 10000, state);
+    tracer->notify_instruction_start(1, &other_call_stack[1], 2, 7000, state);
+    tracer->notify_instruction_start(2, nullptr, 0, 6000, state);
+    tracer->notify_execution_end(success(6000));
+    tracer.reset();
+
+    const auto report = out.str();
+    EXPECT_THAT(report, HasSubstr("\nprecompile/0x01,1,3000,"));
+    EXPECT_THAT(report, HasSubstr("\nSTATICCALL,1,1000,"));
+
+    // The instructions without gas cost are reported last without the time per gas.
+    EXPECT_THAT(report, MatchesRegex(".*\nSTOP,1,0,[0-9.]+,,[0-9.]+,[0-9.]+,[0-9.]+,,\n$"));
+}
+
+TEST(tracing_storage, slots)
+{
+    std::ostringstream out;
+    {
+        evmc::VM storage_vm{evmc_create_evmone()};
+        static_cast<evmone::VM*>(storage_vm.get_raw_pointer())
+            ->add_tracer(evmone::create_storage_tracer(out));
+
+        const auto code = sstore(1, 2) + sload(1) + sload(2);
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        storage_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        storage_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+    }
+
+    EXPECT_EQ(out.str(), R"(--- # STORAGE slots=2 reads=4 writes=2
+address,key,reads,writes,cold_reads,cold_writes,assigned,added,deleted,modified,deleted_added,modified_deleted,deleted_restored,added_deleted,modified_restored
+0000000000000000000000000000000000000000,0000000000000000000000000000000000000000000000000000000000000001,2,2,0,1,1,1,0,0,0,0,0,0,0
+0000000000000000000000000000000000000000,0000000000000000000000000000000000000000000000000000000000000002,2,0,1,0,0,0,0,0,0,0,0,0,0
+)");
+}
+
+TEST(tracing_storage, filter)
+{
+    std::ostringstream out;
+    {
+        evmc::VM storage_vm{evmc_create_evmone()};
+        auto& vm = *static_cast<evmone::VM*>(storage_vm.get_raw_pointer());
+        vm.add_tracer(evmone::create_storage_tracer(out));
+        vm.tracer_filter.min_depth = 1;
+
+        const auto code = sload(1);
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        storage_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        msg.depth = 1;
+        storage_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+    }
+
+    // Only the access from the frame selected by the filter is counted (and it is warm).
+    EXPECT_THAT(out.str(), StartsWith("--- # STORAGE slots=1 reads=1 writes=0\n"));
+    EXPECT_THAT(out.str(), EndsWith(",1,0,0,0,0,0,0,0,0,0,0,0,0\n"));
+}
+
+TEST(tracing_storage, max_slots)
+{
+    std::ostringstream out;
+    {
+        evmc::VM storage_vm{evmc_create_evmone()};
+        static_cast<evmone::VM*>(storage_vm.get_raw_pointer())
+            ->add_tracer(evmone::create_storage_tracer(out, 1));
+
+        // Before Berlin all the accesses are warm.
+        const auto code = sload(1) + sload(2) + sload(2);
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        storage_vm.execute(host, EVMC_ISTANBUL, msg, code.data(), code.size());
+    }
+
+    const auto report = out.str();
+    EXPECT_THAT(report, StartsWith("--- # STORAGE slots=2 reads=3 writes=0\n"));
+    EXPECT_THAT(report, EndsWith("\n0000000000000000000000000000000000000000,"
+                                 "0000000000000000000000000000000000000000000000000000000000000002,"
+                                 "2,0,0,0,0,0,0,0,0,0,0,0,0\n"));
+    EXPECT_EQ(std::count(report.begin(), report.end(), '\n'), 3);
+}
+
+TEST(tracing_filter, matches)
+{
+    const auto code = add(1, 2);
+    evmc_message msg{};
+    msg.depth = 1;
+    msg.gas = 1000;
+    msg.code_address = 0xc0de_address;
+
+    evmone::TracerFilter filter;
+    EXPECT_TRUE(filter.matches(msg, code));
+
+    filter.min_gas = 1001;
+    EXPECT_FALSE(filter.matches(msg, code));
+    filter.min_gas = 1000;
+    EXPECT_TRUE(filter.matches(msg, code));
+
+    filter.code_address = 0xbad_address;
+    EXPECT_FALSE(filter.matches(msg, code));
+    filter.code_address = 0xc0de_address;
+    EXPECT_TRUE(filter.matches(msg, code));
+
+    filter.code_hash = 0x01_bytes32;
+    EXPECT_FALSE(filter.matches(msg, code));
+    filter.code_hash =
+        0x321783c79d5106032d050f3845cb392249d22433e2c82c8a018a19e4462541aa_bytes32;
+    EXPECT_TRUE(filter.matches(msg, code));
+
+    filter.min_depth = 2;
+    EXPECT_FALSE(filter.matches(msg, code));
+    filter.min_depth = 0;
+    filter.max_depth = 0;
+    EXPECT_FALSE(filter.matches(msg, code));
+}
+
+TEST(tracing_aggregated_histogram, revisions)
+{
+    std::ostringstream out;
+    {
+        evmc::VM histogram_vm{evmc_create_evmone()};
+        static_cast<evmone::VM*>(histogram_vm.get_raw_pointer())
+            ->add_tracer(evmone::create_aggregated_histogram_tracer(out));
+
+        const auto code = add(1, 2);
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        histogram_vm.execute(host, EVMC_SHANGHAI, msg, code.data(), code.size());
+        histogram_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        histogram_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+    }
+
+    EXPECT_EQ(out.str(), R"(--- # HISTOGRAM rev=Berlin executions=2
+opcode,count
+ADD,2
+PUSH1,4
+--- # HISTOGRAM rev=Shanghai executions=1
+opcode,count
+ADD,1
+PUSH1,2
+)");
+}
+
+TEST(tracing_aggregated_histogram, pairs)
+{
+    std::ostringstream out;
+    {
+        evmc::VM histogram_vm{evmc_create_evmone()};
+        static_cast<evmone::VM*>(histogram_vm.get_raw_pointer())
+            ->add_tracer(evmone::create_aggregated_histogram_tracer(out, true));
+
+        const auto code = add(1, 2) + add(3, 4);
+        evmc::MockedHost host;
+        evmc_message msg{};
+        msg.gas = 1000000;
+        histogram_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+    }
+
+    EXPECT_EQ(out.str(), R"(--- # HISTOGRAM rev=Berlin executions=1
+opcode,count
+ADD,2
+PUSH1,4
+--- # PAIRS rev=Berlin
+first,second,count
+ADD,PUSH1,1
+PUSH1,ADD,2
+PUSH1,PUSH1,2
+)");
+}
+
+TEST(tracing_aggregated_histogram, threads)
+{
+    std::ostringstream out;
+    {
+        evmc::VM histogram_vm{evmc_create_evmone()};
+        static_cast<evmone::VM*>(histogram_vm.get_raw_pointer())
+            ->add_tracer(evmone::create_aggregated_histogram_tracer(out));
+
+        const auto execute = [&histogram_vm] {
+            const auto code = add(1, 2);
+            evmc::MockedHost host;
+            evmc_message msg{};
+            msg.gas = 1000000;
+            for (int i = 0; i < 100; ++i)
+                histogram_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        };
+        std::thread t1{execute};
+        std::thread t2{execute};
+        t1.join();
+        t2.join();
+    }
+
+    EXPECT_EQ(out.str(), R"(--- # HISTOGRAM rev=Berlin executions=200
+opcode,count
+ADD,200
+PUSH1,400
+)");
+}
+
+TEST(tracing_aggregated_histogram, snapshot)
+{
+    std::ostringstream out;
+    evmc::VM histogram_vm{evmc_create_evmone()};
+    auto* const vm = static_cast<evmone::VM*>(histogram_vm.get_raw_pointer());
+    auto tracer = evmone::create_aggregated_histogram_tracer(out, true);
+    auto& histogram = *tracer;
+    vm->add_tracer(std::move(tracer));
+
+    const auto code = add(1, 2);
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+    const auto execute = [&] {
+        for (int i = 0; i < 10; ++i)
+            histogram_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+    };
+    execute();
+    std::thread{execute}.join();
+
+    // The counters of both threads are merged without destroying the tracer.
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot->executions[EVMC_BERLIN], 20u);
+    EXPECT_EQ(snapshot->executions[EVMC_SHANGHAI], 0u);
+    EXPECT_EQ(snapshot->opcodes[EVMC_BERLIN][OP_ADD], 20u);
+    EXPECT_EQ(snapshot->opcodes[EVMC_BERLIN][OP_PUSH1], 40u);
+    ASSERT_NE(snapshot->pairs[EVMC_BERLIN], nullptr);
+    EXPECT_EQ((*snapshot->pairs[EVMC_BERLIN])[OP_PUSH1 << 8 | OP_ADD], 20u);
+    EXPECT_EQ(snapshot->pairs[EVMC_SHANGHAI], nullptr);
+
+    execute();
+    EXPECT_EQ(histogram.snapshot()->executions[EVMC_BERLIN], 30u);
+    EXPECT_TRUE(out.str().empty());
+}
+
+TEST(tracing_aggregated_histogram, multiple_tracers)
+{
+    const auto code = add(1, 2);
+    evmc::MockedHost host;
+    evmc_message msg{};
+    msg.gas = 1000000;
+
+    // More tracers than cached in the thread, replacing the ones destroyed before.
+    for (int round = 0; round < 3; ++round)
+    {
+        std::ostringstream out;
+        evmc::VM histogram_vm{evmc_create_evmone()};
+        auto* const vm = static_cast<evmone::VM*>(histogram_vm.get_raw_pointer());
+        std::vector<evmone::AggregatedHistogramTracer*> tracers;
+        for (int i = 0; i < 6; ++i)
+        {
+            auto tracer = evmone::create_aggregated_histogram_tracer(out);
+            tracers.push_back(tracer.get());
+            vm->add_tracer(std::move(tracer));
+        }
+
+        histogram_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        histogram_vm.execute(host, EVMC_BERLIN, msg, code.data(), code.size());
+        for (auto* tracer : tracers)
+            EXPECT_EQ(tracer->snapshot()->opcodes[EVMC_BERLIN][OP_PUSH1], 4u);
+    }
+}
+
+namespace
+{
+/// Replaces the time values in the call tree which are not deterministic.
+std::string mask_call_tree_time(const std::string& trace)
+{
+    static const std::regex time{R"re(("[a-zA-Z]+(Ns|Us)"|"ts"|"dur"):[0-9.]+)re"};
+    return std::regex_replace(trace, time, "$1:T");
+}
+
+/// Executes the CALL of 0xc0de with the STATICCALL of 0xbeef and the CREATE nested.
+void notify_call_tree(evmone::Tracer& tracer)
+{
+    evmc_message msg{};
+    msg.gas = 1000;
+    msg.code_address = 0xc0de_address;
+    msg.recipient = 0xc0de_address;
+    tracer.notify_execution_start(EVMC_BERLIN, msg, {});
+    {
+        evmc_message call_msg{};
+        call_msg.flags = EVMC_STATIC;
+        call_msg.depth = 1;
+        call_msg.gas = 500;
+        call_msg.sender = 0xc0de_address;
+        call_msg.recipient = 0xbeef_address;
+        call_msg.code_address = 0xbeef_address;
+        call_msg.input_size = 4;
+        tracer.notify_execution_start(EVMC_BERLIN, call_msg, {});
+        auto result = success(400);
+        result.status_code = EVMC_REVERT;
+        tracer.notify_execution_end(result);
+
+        call_msg.kind = EVMC_CREATE;
+        call_msg.flags = 0;
+        call_msg.input_size = 0;
+        tracer.notify_execution_start(EVMC_BERLIN, call_msg, {});
+        result = success(300);
+        result.storage_gas_consumed = 50;
+        result.speculative_cpu_gas_consumed = 20;
+        tracer.notify_execution_end(result);
+    }
+    tracer.notify_execution_end(success(100));
+}
+}  // namespace
+
+TEST(tracing_call_tree, json)
+{
+    std::ostringstream out;
+    auto tracer = evmone::create_call_tree_tracer(out);
+    notify_call_tree(*tracer);
+    tracer.reset();
+
+    EXPECT_EQ(mask_call_tree_time(out.str()),
+        R"({"kind":"CALL","depth":0,"from":"0x0000000000000000000000000000000000000000",)"
+        R"("to":"0x000000000000000000000000000000000000c0de",)"
+        R"("code":"0x000000000000000000000000000000000000c0de","inputSize":0,"gas":1000,)"
+        R"("gasUsed":900,"storageGas":0,"speculativeCpuGas":0,"status":"success",)"
+        R"("timeNs":T,"selfTimeNs":T,"calls":[)"
+        R"({"kind":"STATICCALL","depth":1,"from":"0x000000000000000000000000000000000000c0de",)"
+        R"("to":"0x000000000000000000000000000000000000beef",)"
+        R"("code":"0x000000000000000000000000000000000000beef","inputSize":4,"gas":500,)"
+        R"("gasUsed":100,"storageGas":0,"speculativeCpuGas":0,"status":"revert",)"
+        R"("timeNs":T,"selfTimeNs":T,"calls":[]},)"
+        R"({"kind":"CREATE","depth":1,"from":"0x000000000000000000000000000000000000c0de",)"
+        R"("to":"0x000000000000000000000000000000000000beef",)"
+        R"("code":"0x000000000000000000000000000000000000beef","inputSize":0,"gas":500,)"
+        R"("gasUsed":200,"storageGas":50,"speculativeCpuGas":20,"status":"success",)"
+        R"("timeNs":T,"selfTimeNs":T,"calls":[]}]})"
+        "\n");
+}
+
+TEST(tracing_call_tree, chrome)
+{
+    std::ostringstream out;
+    auto tracer = evmone::create_call_tree_tracer(out, evmone::CallTreeFormat::chrome);
+    notify_call_tree(*tracer);
+    notify_call_tree(*tracer);
+    tracer.reset();
+
+    const auto trace = mask_call_tree_time(out.str());
+    EXPECT_EQ(trace.substr(0, 2), "[\n");
+    EXPECT_EQ(trace.substr(trace.size() - 3), "\n]\n");
+    EXPECT_THAT(trace, HasSubstr(R"({"name":"CALL 0x000000000000000000000000000000000000c0de",)"
+                                 R"("ph":"X","pid":0,"tid":0,"ts":T,"dur":T,"args":{)"
+                                 R"("kind":"CALL","depth":0,)"));
+    EXPECT_THAT(trace, HasSubstr(R"("status":"revert","selfTimeUs":T}},)"
+                                 "\n"
+                                 R"({"name":"CREATE 0x000000000000000000000000000000000000beef")"));
+    EXPECT_EQ(std::count(trace.begin(), trace.end(), '\n'), 8);
+}